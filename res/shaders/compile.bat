@@ -25,6 +25,12 @@ for %%f in (*.frag) do (
     "%GLSLANG%" %GLSL_FLAGS% "%%f" -o "%OUTPUT_DIR%/%%~nf.frag.spv"
 )
 
+:: Compile .comp
+for %%f in (*.comp) do (
+    echo Compiling %%f...
+    "%GLSLANG%" %GLSL_FLAGS% "%%f" -o "%OUTPUT_DIR%/%%~nf.comp.spv"
+)
+
 echo.
 echo Compilation complete.
 pause
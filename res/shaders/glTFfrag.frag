@@ -1,9 +1,36 @@
 #version 450
 #extension GL_KHR_vulkan_glsl : enable
+#extension GL_EXT_nonuniform_qualifier : enable
 
-// Material textures (set = 2)
-layout(set = 2, binding = 0) uniform sampler2D materialSampler;
-layout(set = 2, binding = 1) uniform sampler2D normalSampler;
+// Bindless textures and the material buffer (set = 2)
+layout(set = 2, binding = 0) uniform sampler2D textures[];
+
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+// vkc::GpuMaterial
+struct Material {
+    vec4  baseColorFactor;
+    vec4  emissiveFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    float alphaCutoff;
+    uint  alphaMode;
+    uint  baseColorTexture;
+    uint  normalTexture;
+    uint  metallicRoughnessTexture;
+    uint  occlusionTexture;
+    uint  emissiveTexture;
+    uint  _pad0, _pad1, _pad2;
+};
+layout(std430, set = 2, binding = 1) readonly buffer Materials {
+    Material materials[];
+};
+
+// vkglTF::DrawConstants
+layout(push_constant) uniform DrawConstants {
+    uint nodeIndex;
+    uint materialIndex;
+} draw;
 
 // Inputs
 layout(location = 0) in vec3 inNormal;
@@ -18,23 +45,31 @@ layout(location = 0) out vec4 outFragColor;
 
 // Constants
 layout(constant_id = 0) const bool  ALPHA_MASK = false;
-layout(constant_id = 1) const float ALPHA_MASK_CUTOFF = 0.0;
 
 
 void main()
 {
-    vec4 texColor = texture(materialSampler, inUV) * inColor;
+    Material material = materials[draw.materialIndex];
+
+    vec4 texColor = material.baseColorFactor * inColor;
+    if (material.baseColorTexture != NO_TEXTURE) {
+        texColor *= texture(textures[material.baseColorTexture], inUV);
+    }
 
-    if (ALPHA_MASK && texColor.a < ALPHA_MASK_CUTOFF) {
+    if (ALPHA_MASK && texColor.a < material.alphaCutoff) {
         discard;
     }
 
     vec3 N = normalize(inNormal);
-    vec3 T = normalize(inTangent.xyz);
-    vec3 B = cross(N, T) * inTangent.w;
-    mat3 TBN = mat3(T, B, N);
-    vec3 normalMap = texture(normalSampler, inUV).xyz * 2.0 - vec3(1.0);
-    N = normalize(TBN * normalMap);
+    if (material.normalTexture != NO_TEXTURE) {
+        vec3 T = normalize(inTangent.xyz);
+        vec3 B = cross(N, T) * inTangent.w;
+        mat3 TBN = mat3(T, B, N);
+        // Z is rebuilt from XY so two channel (BC5) normal maps work as well
+        vec2 normalXY = texture(textures[material.normalTexture], inUV).xy * 2.0 - vec2(1.0);
+        vec3 normalMap = vec3(normalXY, sqrt(max(0.0, 1.0 - dot(normalXY, normalXY))));
+        N = normalize(TBN * normalMap);
+    }
 
     // Light and view vectors are passed from vertex shader (in world space)
     vec3 L = normalize(inLightVec);
@@ -49,7 +84,12 @@ void main()
     float specAmt = pow(max(dot(R, V), 0.0), 32.0) * inLightColor.a;
     vec3 specular = specAmt * lightCol;
 
+    vec3 emissive = material.emissiveFactor.rgb;
+    if (material.emissiveTexture != NO_TEXTURE) {
+        emissive *= texture(textures[material.emissiveTexture], inUV).rgb;
+    }
+
     // combine with texture
-    vec3 result = texColor.rgb * (ambient + diffuse) + specular;
+    vec3 result = texColor.rgb * (ambient + diffuse) + specular + emissive;
     outFragColor = vec4(result, texColor.a);
 }
\ No newline at end of file
@@ -27,10 +27,20 @@ layout(std140, set = 0, binding = 0) uniform GlobalUbo {
 } ubo;
 
 
-layout(set = 1, binding = 0) uniform PerNode {
+struct NodeUniform {
     mat4 modelMatrix;
     mat4 normalMatrix;           // inverse-transpose of model
-} perNode;
+};
+//— This frame's node transforms (set 1), one per drawn node instance
+layout(std430, set = 1, binding = 0) readonly buffer Nodes {
+    NodeUniform nodes[];
+};
+
+//— vkglTF::DrawConstants
+layout(push_constant) uniform DrawConstants {
+    uint nodeIndex;
+    uint materialIndex;
+} draw;
 
 //— Outputs to fragment
 layout(location = 0) out vec3  fragNormal;
@@ -41,6 +51,9 @@ layout(location = 4) out vec3  fragLightVec;
 layout(location = 5) out vec4  fragTangent;
 layout(location = 6) out vec4  fragLightColor;
 void main() {
+    // Instances of the node take consecutive entries
+    NodeUniform perNode = nodes[draw.nodeIndex + gl_InstanceIndex];
+
     // world-space position
     vec4 worldPos = perNode.modelMatrix * vec4(inPos, 1.0);
     gl_Position   = ubo.projection * ubo.view * worldPos;
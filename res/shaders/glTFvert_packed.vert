@@ -0,0 +1,88 @@
+// glTFvert_packed.vert
+#version 450
+#extension GL_KHR_vulkan_glsl : enable
+
+//— Vertex inputs
+//— vkglTF::PackedVertex. The position is UNORM16 within the model bounds
+//  (perNode.modelMatrix includes the decode); .w holds the bitangent sign.
+layout(location = 0) in vec4  inPosPacked;
+layout(location = 1) in vec2  inNormalOct;
+layout(location = 2) in vec2  inUV;
+layout(location = 3) in vec4  inColor;
+layout(location = 4) in vec2  inTangentOct;
+
+//— Scene UBO (set 0)
+struct PointLight {
+    vec4 position;
+    vec4 color;
+};
+layout(std140, set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    mat4 invView;
+    vec4 ambientLightColor;
+    vec4 lightDirection;
+    vec4 viewPos;   
+    PointLight pointLights[10];
+    int     numLights;
+    ivec3 _pad;
+} ubo;
+
+
+struct NodeUniform {
+    mat4 modelMatrix;
+    mat4 normalMatrix;           // inverse-transpose of model
+};
+//— This frame's node transforms (set 1), one per drawn node instance
+layout(std430, set = 1, binding = 0) readonly buffer Nodes {
+    NodeUniform nodes[];
+};
+
+//— vkglTF::DrawConstants
+layout(push_constant) uniform DrawConstants {
+    uint nodeIndex;
+    uint materialIndex;
+} draw;
+
+//— Outputs to fragment
+layout(location = 0) out vec3  fragNormal;
+layout(location = 1) out vec4  fragColor;
+layout(location = 2) out vec2  fragUV;
+layout(location = 3) out vec3  fragViewVec;
+layout(location = 4) out vec3  fragLightVec;
+layout(location = 5) out vec4  fragTangent;
+layout(location = 6) out vec4  fragLightColor;
+vec3 octDecode(vec2 e) {
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+    return normalize(v);
+}
+
+void main() {
+    vec3 inPos     = inPosPacked.xyz;
+    vec3 inNormal  = octDecode(inNormalOct);
+    vec4 inTangent = vec4(octDecode(inTangentOct), inPosPacked.w > 0.5 ? 1.0 : -1.0);
+
+    // Instances of the node take consecutive entries
+    NodeUniform perNode = nodes[draw.nodeIndex + gl_InstanceIndex];
+
+    // world-space position
+    vec4 worldPos = perNode.modelMatrix * vec4(inPos, 1.0);
+    gl_Position   = ubo.projection * ubo.view * worldPos;
+
+    // normals & tangents in world-space
+    fragNormal   = normalize(mat3(perNode.normalMatrix) * inNormal);
+    fragTangent  = normalize(perNode.normalMatrix * inTangent); 
+    // color & UV
+    fragColor    = inColor;
+    fragUV       = inUV;
+
+    // view & light vectors
+    vec3 camPos   = (ubo.invView * vec4(0.0, 0.0, 0.0, 1.0)).xyz;
+    vec3 lightPos = ubo.pointLights[0].position.xyz;
+
+    fragViewVec  = camPos   - worldPos.xyz;
+    fragLightVec = lightPos - worldPos.xyz;
+    fragLightColor = ubo.pointLights[0].color;
+}
\ No newline at end of file
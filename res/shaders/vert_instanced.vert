@@ -0,0 +1,53 @@
+#version 460
+#extension GL_KHR_vulkan_glsl : enable
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout(location = 3) out vec2 fragUV;
+layout(location = 4) flat out int outTexIndex;
+
+struct PointLight {
+	vec4 position;
+	vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  PointLight pointLights[10];
+  int numLights;
+} ubo;
+
+// SimpleRenderSystem's InstanceData in this frame's allocator buffer; each
+// instanced draw starts at its group's firstInstance
+struct Instance {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+  int textureIndex;
+  uint _pad0;
+  uint _pad1;
+  uint _pad2;
+};
+
+layout(set = 2, binding = 0) readonly buffer Instances { Instance instances[]; };
+
+void main() {
+  Instance instance = instances[gl_InstanceIndex];
+  vec4 positionWorld = instance.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+  fragNormalWorld = normalize(mat3(instance.normalMatrix) * normal);
+  fragPosWorld = positionWorld.xyz;
+  fragColor = color;
+  fragUV = uv;
+
+  outTexIndex = instance.textureIndex;
+}
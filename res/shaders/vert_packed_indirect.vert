@@ -0,0 +1,81 @@
+#version 460
+#extension GL_KHR_vulkan_glsl : enable
+
+// VkcOBJmodel::PackedVertex. The position is UNORM16 within the mesh bounds,
+// decoded by the mesh's positionDecode.
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 normalOct;
+layout(location = 3) in vec2 uv;
+
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout(location = 3) out vec2 fragUV;
+layout(location = 4) flat out int outTexIndex;
+
+struct PointLight {
+	vec4 position;
+	vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  PointLight pointLights[10];
+  int numLights;
+} ubo;
+
+// VkcGpuScene::GpuInstance, indexed by the draw's firstInstance
+struct Instance {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+  uint mesh;
+  int textureIndex;
+  uint _pad0;
+  uint _pad1;
+};
+
+struct MeshLod {
+  uint firstIndex;
+  uint indexCount;
+  float error;
+  uint _pad;
+};
+
+// VkcGpuScene::GpuMesh
+struct Mesh {
+  mat4 positionDecode;
+  vec4 boundingSphere;
+  int vertexOffset;
+  uint bucket;
+  uint drawBase;
+  uint lodCount;
+  MeshLod lods[8];
+};
+
+layout(set = 2, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout(set = 2, binding = 1) readonly buffer Meshes { Mesh meshes[]; };
+
+vec3 octDecode(vec2 e) {
+  vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-v.z, 0.0);
+  v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+  return normalize(v);
+}
+
+void main() {
+  vec3 normal = octDecode(normalOct);
+  Instance instance = instances[gl_InstanceIndex];
+  vec4 positionWorld = instance.modelMatrix * meshes[instance.mesh].positionDecode * vec4(position.xyz, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+  fragNormalWorld = normalize(mat3(instance.normalMatrix) * normal);
+  fragPosWorld = positionWorld.xyz;
+  fragColor = color.rgb;
+  fragUV = uv;
+
+  outTexIndex = instance.textureIndex;
+}
@@ -0,0 +1,63 @@
+#version 460
+#extension GL_KHR_vulkan_glsl : enable
+
+// VkcOBJmodel::PackedVertex. The position is UNORM16 within the mesh bounds;
+// each instance's modelMatrix already includes the decode scale and offset.
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 normalOct;
+layout(location = 3) in vec2 uv;
+
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout(location = 3) out vec2 fragUV;
+layout(location = 4) flat out int outTexIndex;
+
+struct PointLight {
+	vec4 position;
+	vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  PointLight pointLights[10];
+  int numLights;
+} ubo;
+
+// SimpleRenderSystem's InstanceData in this frame's allocator buffer; each
+// instanced draw starts at its group's firstInstance
+struct Instance {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+  int textureIndex;
+  uint _pad0;
+  uint _pad1;
+  uint _pad2;
+};
+
+layout(set = 2, binding = 0) readonly buffer Instances { Instance instances[]; };
+
+vec3 octDecode(vec2 e) {
+  vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-v.z, 0.0);
+  v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+  return normalize(v);
+}
+
+void main() {
+  vec3 normal = octDecode(normalOct);
+  Instance instance = instances[gl_InstanceIndex];
+  vec4 positionWorld = instance.modelMatrix * vec4(position.xyz, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+  fragNormalWorld = normalize(mat3(instance.normalMatrix) * normal);
+  fragPosWorld = positionWorld.xyz;
+  fragColor = color.rgb;
+  fragUV = uv;
+
+  outTexIndex = instance.textureIndex;
+}
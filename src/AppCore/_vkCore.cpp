@@ -1,14 +1,24 @@
 // vk_core.cpp
 #include "_vkCore.h"
+#include "VK_abstraction/vk_geometryArena.h"
+#include "VK_abstraction/vk_uploadBatcher.h"
 
 // STD
+#include <algorithm>
 #include <chrono>
+#include <iostream>
 
 namespace vkc {
     Application::Application()
     {
-        _assetManager.preloadGlobalAssets();
+        // Assets decode on worker threads while the scene loads; the scene only
+        // blocks on the assets it references, the rest are uploaded afterwards
+        _assetManager.preloadGlobalAssetsAsync();
         _game.Init(_window.getGLFWwindow());
+        _assetManager.finishPendingUploads();
+        _assetManager.printLoadTimings();
+        _device.allocator().printStats();
+        _device.geometryArena().printStats();
 
         DescriptorConfig config{
             VkcSwapChain::MAX_FRAMES_IN_FLIGHT,
@@ -27,7 +37,8 @@ namespace vkc {
             _renderer.getSwapChainRenderPass(),
             _descriptorManager.getAllLayouts(),
             _descriptorManager,
-            _assetManager
+            _assetManager,
+            _renderer.getGpuScene()
         );
 
         _renderSystemManager.registerSystems(_game.getScene());
@@ -50,18 +61,91 @@ namespace vkc {
                 frameCount = 0;
                 fpsTimer -= 1.0f;
             }
-           
+
+            // Allocator statistics on demand: summary to stdout, full VMA dump to JSON
+            const bool statsKey = glfwGetKey(_window.getGLFWwindow(), GLFW_KEY_F9) == GLFW_PRESS;
+            if (statsKey && !_statsKeyDown) {
+                _device.allocator().printStats();
+                _device.geometryArena().printStats();
+                _renderer.getLodSelector().printStats();
+                _renderer.getCommandRecorder().printStats();
+                _descriptorManager.printBindlessStats();
+                if (VkcGpuScene* gpuScene = _renderer.getGpuScene()) {
+                    gpuScene->printStats();
+                }
+                _game.getScene().printRenderSystemStats();
+                if (_device.allocator().writeStatsJson("vma_stats.json")) {
+                    std::cout << "wrote vma_stats.json\n";
+                }
+            }
+            _statsKeyDown = statsKey;
+
+            // Switch between GPU-driven and per-object CPU drawing, to compare frame times
+            const bool gpuDrivenKey = glfwGetKey(_window.getGLFWwindow(), GLFW_KEY_F8) == GLFW_PRESS;
+            VkcGpuScene* gpuScene = _renderer.getGpuScene();
+            if (gpuDrivenKey && !_gpuDrivenKeyDown && gpuScene) {
+                gpuScene->settings.enabled = !gpuScene->settings.enabled;
+                std::cout << "GPU-driven drawing " << (gpuScene->settings.enabled ? "on" : "off") << "\n";
+            }
+            _gpuDrivenKeyDown = gpuDrivenKey;
+
+            // Switch between instanced and per-object draws on the CPU path; F9 shows the draw counts
+            const bool instancingKey = glfwGetKey(_window.getGLFWwindow(), GLFW_KEY_F7) == GLFW_PRESS;
+            if (instancingKey && !_instancingKeyDown) {
+                Scene& scene = _game.getScene();
+                scene.setInstancingEnabled(!scene.isInstancingEnabled());
+                std::cout << "Instancing " << (scene.isInstancingEnabled() ? "on" : "off") << "\n";
+            }
+            _instancingKeyDown = instancingKey;
+
+            // Switch between recording the render pass on worker threads and inline, to compare
+            const bool recordingKey = glfwGetKey(_window.getGLFWwindow(), GLFW_KEY_F6) == GLFW_PRESS;
+            if (recordingKey && !_recordingKeyDown) {
+                VkcCommandRecorder& recorder = _renderer.getCommandRecorder();
+                recorder.settings.enabled = !recorder.settings.enabled;
+                std::cout << "Parallel command recording " << (recorder.settings.enabled ? "on" : "off") << "\n";
+            }
+            _recordingKeyDown = recordingKey;
+
+            // Hot reload: re-import edited assets in the background and swap them in
+            // once ready; the scene file is re-applied as a diff
+            auto changedFiles = _fileWatcher.poll();
+            if (!changedFiles.empty()) {
+                _assetManager.reloadChangedFiles(changedFiles);
+                Scene& scene = _game.getScene();
+                if (std::find(changedFiles.begin(), changedFiles.end(), scene.getScenePath()) != changedFiles.end()) {
+                    scene.reloadSceneData();
+                }
+            }
+            _game.getScene().onAssetsReloaded(_assetManager.update());
+
+            // Stream texture mips towards what the camera saw last frame
+            _game.getScene().requestTextureMips(_game.getPlayerCamera(), static_cast<float>(_window.getExtent().height));
+            _assetManager.getTextureStreamer().update();
+
+            // Recycle geometry ranges freed by unloaded models; compacts when fragmented
+            _device.geometryArena().update();
+
+            // Submit any uploads recorded since the last frame ahead of it; never waits
+            _device.uploadBatcher().flush();
+
             if (auto commandBuffer = _renderer.beginFrame()) 
             {
                 int frameIndex = _renderer.getFrameIndex();
+                // This slot's previous frame has finished, so its bindless set can change
+                _descriptorManager.refreshTextureDescriptors(frameIndex);
                 FrameInfo frameInfo{
                     frameIndex, frameTime, commandBuffer,
                     _game.getPlayerCamera(),
                     _descriptorManager.getGlobalDescriptorSets()[frameIndex],
-                    _descriptorManager.getTextureDescriptorSet(),
+                    _descriptorManager.getTextureDescriptorSet(frameIndex),
                     _descriptorManager.getSkyboxDescriptorSet(),
                     _game.getGameObjects(),
-                    &_game.getScene()
+                    &_game.getScene(),
+                    _renderer.getFrameAllocator(),
+                    _renderer.getLodSelector(),
+                    _renderer.getGpuScene(),
+                    &_renderer.getCommandRecorder()
                 };
 
                 // update
@@ -11,6 +11,7 @@
 #include "Game/vk_game.h"
 #include "Renderer/RendererSystems/vk_renderSystemManager.h"
 #include "Renderer/vk_descriptorManager.h"
+#include "Utils/vkc_fileWatcher.h"
 
 
 namespace vkc {
@@ -36,6 +37,18 @@ namespace vkc {
 		Game _game{ _device, _assetManager, _renderer };
 		DescriptorManager _descriptorManager{ _device };
 		RenderSystemManager _renderSystemManager;
+
+		// Hot reload of everything under res/ except the generated caches
+		FileWatcher _fileWatcher{ PROJECT_ROOT_DIR "/res", { "cache" } };
+
+		// F9 dumps allocator statistics; edge-triggered
+		bool _statsKeyDown = false;
+		// F8 toggles the GPU-driven path
+		bool _gpuDrivenKeyDown = false;
+		// F7 toggles instanced drawing of objects that share a model
+		bool _instancingKeyDown = false;
+		// F6 toggles recording the render pass into secondary command buffers on worker threads
+		bool _recordingKeyDown = false;
 	};
 
 
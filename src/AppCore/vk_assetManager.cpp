@@ -2,41 +2,87 @@
 
 // Project headers
 #include "vk_assetManager.h"
+#include "VK_abstraction/vk_uploadBatcher.h"
+#include "VK_abstraction/vk_swapchain.h"
+
+// STD
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
 
 
 namespace vkc {
 
+    namespace {
+        // A replaced asset may still be referenced by every frame in flight
+        constexpr uint64_t kRetireFrames = VkcSwapChain::MAX_FRAMES_IN_FLIGHT + 1;
+
+        std::string normalizePath(const std::string& path)
+        {
+            return std::filesystem::path(path).lexically_normal().generic_string();
+        }
+
+        double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - start).count();
+        }
+
+        std::string lowerExtension(const std::string& filepath)
+        {
+            auto ext = filepath.substr(filepath.find_last_of('.') + 1);
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            return ext;
+        }
 
-	AssetManager::AssetManager(VkcDevice& device) : _device(device), _transferQueue(device.graphicsQueue())
+        // Keeps a loaded KTX texture alive between the CPU and upload stages
+        std::shared_ptr<ktxTexture> loadKTXShared(const std::string& filename)
+        {
+            ktxTexture* ktx = nullptr;
+            if (VkcTexture::loadKTXFile(filename, &ktx) != KTX_SUCCESS || !ktx) {
+                throw std::runtime_error("Failed to load KTX file: " + filename);
+            }
+            return std::shared_ptr<ktxTexture>(ktx, [](ktxTexture* t) { ktxTexture_Destroy(t); });
+        }
+    }
+
+	AssetManager::AssetManager(VkcDevice& device)
+        : _device(device), _transferQueue(device.transferQueue()), _meshCache(PROJECT_ROOT_DIR "/res/cache/meshes")
+        , _textureCache(PROJECT_ROOT_DIR "/res", PROJECT_ROOT_DIR "/res/cache/textures")
+        , _textureStreamer(device)
     {
     }
-    void AssetManager::preloadGlobalAssets() 
+    void AssetManager::preloadGlobalAssetsAsync()
     {
-        loadModel("quad", PROJECT_ROOT_DIR "/res/models/quad.obj");
-        loadModel("flat_vase", PROJECT_ROOT_DIR "/res/models/flat_vase.obj");
-        loadModel("smooth_vase", PROJECT_ROOT_DIR "/res/models/smooth_vase.obj");
-        loadModel("barrel", PROJECT_ROOT_DIR "/res/models/Barrel_OBJ.obj");
-        loadModel("stone_sphere", PROJECT_ROOT_DIR "/res/models/StoneSphere.obj");
-        loadModel("living_room", PROJECT_ROOT_DIR "/res/models/InteriorTest.obj");
-        loadModel("viking_room", PROJECT_ROOT_DIR "/res/models/VikingRoom.obj");
-        loadModel("character", PROJECT_ROOT_DIR "/res/models/Square Character/Square Character.obj");
+        requestModel("quad", PROJECT_ROOT_DIR "/res/models/quad.obj");
+        requestModel("flat_vase", PROJECT_ROOT_DIR "/res/models/flat_vase.obj");
+        requestModel("smooth_vase", PROJECT_ROOT_DIR "/res/models/smooth_vase.obj");
+        requestModel("barrel", PROJECT_ROOT_DIR "/res/models/Barrel_OBJ.obj");
+        requestModel("stone_sphere", PROJECT_ROOT_DIR "/res/models/StoneSphere.obj");
+        requestModel("living_room", PROJECT_ROOT_DIR "/res/models/InteriorTest.obj");
+        requestModel("viking_room", PROJECT_ROOT_DIR "/res/models/VikingRoom.obj");
+        requestModel("character", PROJECT_ROOT_DIR "/res/models/Square Character/Square Character.obj");
         //const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY;
 
-        loadModel("helmet", PROJECT_ROOT_DIR "/res/models/gltf/FlightHelmet/glTF/FlightHelmet.gltf");
-        loadModel("cerberus", PROJECT_ROOT_DIR "/res/models/gltf/cerberus/cerberus.gltf");
-        loadModel("dragon", PROJECT_ROOT_DIR "/res/models/gltf/chinesedragon.gltf");
-        loadModel("sponza", PROJECT_ROOT_DIR "/res/models/gltf/sponza/sponza.gltf");
+        requestModel("helmet", PROJECT_ROOT_DIR "/res/models/gltf/FlightHelmet/glTF/FlightHelmet.gltf");
+        requestModel("cerberus", PROJECT_ROOT_DIR "/res/models/gltf/cerberus/cerberus.gltf");
+        requestModel("dragon", PROJECT_ROOT_DIR "/res/models/gltf/chinesedragon.gltf");
+        requestModel("sponza", PROJECT_ROOT_DIR "/res/models/gltf/sponza/sponza.gltf");
 
-        loadCubemap("environmentHDR",
+        requestCubemap("environmentHDR",
             PROJECT_ROOT_DIR "/res/textures/ktx/hdr/gcanyon_cube.ktx",
             VK_FORMAT_R16G16B16A16_SFLOAT,
             VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
         );
-        loadSkyboxModel("cube", PROJECT_ROOT_DIR "/res/models/cube.obj");
-        loadSkyboxModel("cube_gltf", PROJECT_ROOT_DIR "/res/models/gltf/cube.gltf");
+        requestSkyboxModel("cube", PROJECT_ROOT_DIR "/res/models/cube.obj");
+        requestSkyboxModel("cube_gltf", PROJECT_ROOT_DIR "/res/models/gltf/cube.gltf");
 
-        loadCubemap("skybox", { {
+        requestCubemap("skybox", { {
          PROJECT_ROOT_DIR "/res/textures/SpaceSkybox/right.png",
          PROJECT_ROOT_DIR "/res/textures/SpaceSkybox/left.png",
          PROJECT_ROOT_DIR "/res/textures/SpaceSkybox/top.png",
@@ -45,63 +91,167 @@ namespace vkc {
          PROJECT_ROOT_DIR "/res/textures/SpaceSkybox/back.png"
          } });
 
-        loadTexture("floor", PROJECT_ROOT_DIR "/res/textures/spaceFloor.jpg");
-        loadTexture("container", PROJECT_ROOT_DIR "/res/textures/container2.png");
-        loadTexture("stoneWall", PROJECT_ROOT_DIR "/res/textures/stoneWall.jpg");
-        loadTexture("vikingRoom", PROJECT_ROOT_DIR "/res/textures/viking_room.png");
-		loadTexture("stoneFloor01", PROJECT_ROOT_DIR "/res/textures/ktx/stonefloor01_color_rgba.ktx", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
-		loadTexture("fireplaceColorMap", PROJECT_ROOT_DIR "/res/textures/ktx/fireplace_colormap_rgba.ktx", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
-		loadTexture("rock_array", PROJECT_ROOT_DIR "/res/textures/ktx/particle_gradient_rgba.ktx", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
-		loadTexture("metal_plate", PROJECT_ROOT_DIR "/res/textures/ktx/metalplate01_rgba.ktx", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+        requestTexture("floor", PROJECT_ROOT_DIR "/res/textures/spaceFloor.jpg");
+        requestTexture("container", PROJECT_ROOT_DIR "/res/textures/container2.png");
+        requestTexture("stoneWall", PROJECT_ROOT_DIR "/res/textures/stoneWall.jpg");
+        requestTexture("vikingRoom", PROJECT_ROOT_DIR "/res/textures/viking_room.png");
+		requestTexture("stoneFloor01", PROJECT_ROOT_DIR "/res/textures/ktx/stonefloor01_color_rgba.ktx", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+		requestTexture("fireplaceColorMap", PROJECT_ROOT_DIR "/res/textures/ktx/fireplace_colormap_rgba.ktx", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+		requestTexture("rock_array", PROJECT_ROOT_DIR "/res/textures/ktx/particle_gradient_rgba.ktx", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+		requestTexture("metal_plate", PROJECT_ROOT_DIR "/res/textures/ktx/metalplate01_rgba.ktx", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
 		// Cerberus
-        loadTexture("cerberus_a", PROJECT_ROOT_DIR "/res/models/gltf/cerberus/albedo.ktx", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
-        loadTexture("cerberus_n", PROJECT_ROOT_DIR "/res/models/gltf/cerberus/normal.ktx", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
-        loadTexture("cerberus_ao", PROJECT_ROOT_DIR "/res/models/gltf/cerberus/ao.ktx", VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
-        loadTexture("cerberus_m", PROJECT_ROOT_DIR "/res/models/gltf/cerberus/metallic.ktx", VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
-        loadTexture("cerberus_r", PROJECT_ROOT_DIR "/res/models/gltf/cerberus/roughness.ktx", VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
-        
+        requestTexture("cerberus_a", PROJECT_ROOT_DIR "/res/models/gltf/cerberus/albedo.ktx", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+        requestTexture("cerberus_n", PROJECT_ROOT_DIR "/res/models/gltf/cerberus/normal.ktx", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+        requestTexture("cerberus_ao", PROJECT_ROOT_DIR "/res/models/gltf/cerberus/ao.ktx", VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+        requestTexture("cerberus_m", PROJECT_ROOT_DIR "/res/models/gltf/cerberus/metallic.ktx", VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+        requestTexture("cerberus_r", PROJECT_ROOT_DIR "/res/models/gltf/cerberus/roughness.ktx", VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+    }
+
+    void AssetManager::preloadGlobalAssets()
+    {
+        preloadGlobalAssetsAsync();
+        finishPendingUploads();
+        printLoadTimings();
     }
     std::shared_ptr<IModel> AssetManager::loadModel(const std::string& name,
         const std::string& filepath,
         uint32_t gltfFlags,
         float scale) {
+        return loadModelNow(name, filepath, false, gltfFlags, scale);
+    }
+
+    std::shared_ptr<IModel> AssetManager::loadSkyboxModel(const std::string& modelName, const std::string& filepath)
+    {
+        return loadModelNow(modelName, filepath, true, 0u, 1.0f);
+    }
+
+    std::shared_ptr<IModel> AssetManager::loadModelNow(const std::string& name,
+        const std::string& filepath,
+        bool isSkybox,
+        uint32_t gltfFlags,
+        float scale)
+    {
+        waitForAsset(name);
+        if (_evictedAssets.count(name))
+            reloadEvicted(name);
         if (auto it = modelCache.find(name); it != modelCache.end())
             return it->second;
 
-        // Determine extension
-        auto ext = filepath.substr(filepath.find_last_of('.') + 1);
-        for (auto& c : ext) c = char(::tolower(c));
+        auto model = prepareModel(filepath, isSkybox, gltfFlags, scale)();
+        modelCache[name] = model;
+        recordModelSource(name, filepath, isSkybox, gltfFlags, scale);
+        return model;
+    }
+
+    std::function<std::shared_ptr<IModel>()> AssetManager::prepareModel(
+        const std::string& filepath,
+        bool isSkybox,
+        uint32_t gltfFlags,
+        float scale)
+    {
+        auto ext = lowerExtension(filepath);
+
+        // Reports the packed size next to what the full-precision layout would take
+        auto reportGeometry = [filepath](const IModel& model) {
+            const IModel::MemoryUsage usage = model.getMemoryUsage();
+            if (!model.hasPackedVertices())
+                return;
+            std::cout << "AssetManager: " << std::filesystem::path(filepath).filename().string()
+                << " geometry " << (usage.geometryBytes >> 10) << " KiB ("
+                << (usage.unpackedGeometryBytes >> 10) << " KiB unpacked)\n";
+        };
 
-        std::shared_ptr<IModel> model;
         if (ext == "obj") {
-            model = VkcOBJmodel::createModelFromFile(_device, filepath);
-        }
-        else if (ext == "gltf" || ext == "glb") {
-            auto gltf = std::make_shared<vkglTF::Model>();
-            gltf->loadFromFile(filepath, &_device, _device.graphicsQueue(), gltfFlags, scale);
-            model = gltf;
+            auto upload = prepareOBJModel(filepath, isSkybox);
+            return [upload, reportGeometry]() -> std::shared_ptr<IModel> {
+                auto model = upload();
+                reportGeometry(*model);
+                return model;
+            };
         }
-        else {
-            throw std::runtime_error("Unsupported format: " + ext);
+        if (ext == "gltf" || ext == "glb") {
+            if (isSkybox) {
+                gltfFlags =
+                    vkglTF::FileLoadingFlags::PreTransformVertices
+                    | vkglTF::FileLoadingFlags::PreMultiplyVertexColors
+                    | vkglTF::FileLoadingFlags::FlipY; // needed for skybox orientation
+                scale = 1.0f;
+            }
+            else if (_packVertices) {
+                gltfFlags |= vkglTF::FileLoadingFlags::PackVertices;
+            }
+
+            auto parsed = std::make_shared<vkglTF::Model::ParsedFile>(
+                vkglTF::Model::parseFile(filepath, gltfFlags, cookedTextures()));
+
+            // Vertex cache / overdraw / fetch order, computed once per source file
+            if (parsed->loaded) {
+                const bool cached = _meshCache.loadGeometryOrder(filepath, parsed->geometryOrder);
+                if (!cached) {
+                    vkglTF::Model::optimizeGeometry(*parsed);
+                    _meshCache.storeGeometryOrder(filepath, parsed->geometryOrder);
+                }
+                const vkglTF::GeometryOrder& order = parsed->geometryOrder;
+                std::cout << std::fixed << std::setprecision(3)
+                    << "MeshOptimizer: " << filepath
+                    << " ACMR " << order.before.acmr << " -> " << order.after.acmr
+                    << ", ATVR " << order.before.atvr << " -> " << order.after.atvr
+                    << (cached ? " (cached)\n" : "\n");
+                std::cout.unsetf(std::ios::floatfield);
+            }
+            return [this, parsed, gltfFlags, scale, reportGeometry]() -> std::shared_ptr<IModel> {
+                auto gltf = std::make_shared<vkglTF::Model>();
+                gltf->loadFromParsed(*parsed, &_device, _device.graphicsQueue(), gltfFlags, scale);
+                reportGeometry(*gltf);
+                return gltf;
+            };
         }
 
-        modelCache[name] = model;
-        return model;
+        throw std::runtime_error(isSkybox
+            ? "Unsupported skybox model format: " + ext
+            : "Unsupported format: " + ext);
     }
 
+    std::function<std::shared_ptr<VkcOBJmodel>()> AssetManager::prepareOBJModel(const std::string& filepath, bool isSkybox)
+    {
+        const uint32_t loaderFlags = isSkybox ? MeshCache::Skybox : MeshCache::None;
+        const bool packVertices = _packVertices && !isSkybox;
+
+        // Cache hit: upload straight from the mapped entry
+        auto entry = std::make_shared<MeshCache::Entry>();
+        if (_meshCache.load(filepath, loaderFlags, *entry)) {
+            return [this, entry, isSkybox, packVertices]() {
+                return std::make_shared<VkcOBJmodel>(
+                    _device,
+                    entry->vertexData, entry->vertexStride, entry->vertexCount,
+                    entry->indexData, entry->indexCount,
+                    isSkybox, packVertices, entry->lods);
+            };
+        }
+
+        // Miss: parse with tinyobj and write the result back for next launch
+        auto start = std::chrono::high_resolution_clock::now();
+        auto builder = std::make_shared<VkcOBJmodel::Builder>();
+        builder->loadModel(filepath, isSkybox);
+        double parseMs = elapsedMs(start);
+
+        _meshCache.recordMiss(parseMs);
+        _meshCache.store(filepath, loaderFlags, *builder, parseMs);
+
+        return [this, builder, packVertices]() {
+            return std::make_shared<VkcOBJmodel>(_device, *builder, packVertices);
+        };
+    }
 
     std::shared_ptr<VkcTexture> AssetManager::loadCubemap(
         const std::string& name,
         const std::array<std::string, 6>& faces)
     {
+        waitForAsset(name);
         if (auto it = textures.find(name); it != textures.end())
             return it->second;
 
-        auto tex = std::make_shared<VkcTexture>(&_device);
-        if (!tex->LoadCubemap(faces)) {
-            throw std::runtime_error("Failed to load cubemap: " + name);
-        }
-
+        auto tex = prepareCubemap(faces)();
         registerTextureIfNeeded(name, tex, textures, textureIndexMap, textureList);
         return tex;
     }
@@ -112,20 +262,13 @@ namespace vkc {
         VkImageUsageFlags usageFlags,
         VkImageLayout initialLayout)
     {
+        waitForAsset(name);
         if (auto it = textures.find(name); it != textures.end())
             return it->second;
 
-        auto tex = std::make_shared<VkcTexture>();
-        tex->device = &_device;
+        std::shared_ptr<VkcTexture> tex;
         try {
-            tex->KtxLoadCubemapFromFile(
-                ktxFilename,
-                format,
-                &_device,
-                _transferQueue,
-                usageFlags,
-                initialLayout
-            );
+            tex = prepareCubemap(ktxFilename, format, usageFlags, initialLayout)();
         }
         catch (const std::exception& e) {
             throw std::runtime_error("Failed to load HDR cubemap '" + name + "': " + e.what());
@@ -135,6 +278,40 @@ namespace vkc {
         return tex;
     }
 
+    std::function<std::shared_ptr<VkcTexture>()> AssetManager::prepareCubemap(const std::array<std::string, 6>& faces)
+    {
+        auto decoded = std::make_shared<VkcTexture::DecodedImage>(VkcTexture::DecodeSTBCubemap(faces));
+        return [this, decoded]() {
+            auto tex = std::make_shared<VkcTexture>(&_device);
+            if (!tex->UploadDecoded(*decoded)) {
+                throw std::runtime_error("Failed to upload cubemap");
+            }
+            return tex;
+        };
+    }
+
+    std::function<std::shared_ptr<VkcTexture>()> AssetManager::prepareCubemap(
+        const std::string& ktxFilename,
+        VkFormat format,
+        VkImageUsageFlags usageFlags,
+        VkImageLayout initialLayout)
+    {
+        auto ktx = loadKTXShared(ktxFilename);
+        return [this, ktx, format, usageFlags, initialLayout]() {
+            auto tex = std::make_shared<VkcTexture>();
+            tex->device = &_device;
+            tex->KtxUploadCubemap(
+                ktx.get(),
+                format,
+                &_device,
+                _transferQueue,
+                usageFlags,
+                initialLayout
+            );
+            return tex;
+        };
+    }
+
     void AssetManager::generateIrradianceMap(VkQueue copyQueue)
     {
     }
@@ -156,84 +333,541 @@ namespace vkc {
         VkImageLayout layout,
         bool forceLinear)
     {
+        waitForAsset(name);
+        if (_evictedAssets.count(name))
+            reloadEvicted(name);
         if (auto it = textures.find(name); it != textures.end())
             return it->second;
 
-        auto tex = std::make_shared<VkcTexture>(&_device);
+        auto tex = prepareTexture(filepath, format, usageFlags, layout, forceLinear)();
+        registerTextureIfNeeded(name, tex, textures, textureIndexMap, textureList);
+        recordTextureSource(name, filepath, [this, filepath, format, usageFlags, layout, forceLinear]() {
+            return prepareTexture(filepath, format, usageFlags, layout, forceLinear);
+        });
+        return tex;
+    }
 
-        // Determine extension
-        auto ext = filepath.substr(filepath.find_last_of('.') + 1);
-        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    std::function<std::shared_ptr<VkcTexture>()> AssetManager::prepareTexture(
+        const std::string& filepath,
+        VkFormat format,
+        VkImageUsageFlags usageFlags,
+        VkImageLayout layout,
+        bool forceLinear)
+    {
+        if (lowerExtension(filepath) == "ktx") {
+            return prepareKTXTexture(filepath, format, usageFlags, layout, forceLinear);
+        }
 
-        bool ok = false;
-        if (ext == "ktx") {
-            tex->KTXLoadFromFile(
-                filepath,
-                format,
-                &_device,
-                _transferQueue,
-                usageFlags,
-                layout,
-                forceLinear
-            );
-            ok = true;
+        // Prefer a cooked BCn copy; its format comes from the KTX header
+        std::string cooked;
+        if (const TextureCache* cache = cookedTextures(); cache && cache->findCooked(filepath, cooked)) {
+            return prepareKTXTexture(cooked, VK_FORMAT_UNDEFINED, usageFlags, layout, false);
         }
-        else {
-            ok = tex->STBLoadFromFile(filepath);
+
+        auto decoded = std::make_shared<VkcTexture::DecodedImage>(VkcTexture::DecodeSTB(filepath));
+        return [this, decoded, filepath]() {
+            auto tex = std::make_shared<VkcTexture>(&_device);
+            if (!tex->UploadDecoded(*decoded)) {
+                throw std::runtime_error("AssetManager: failed to load texture " + filepath);
+            }
+            return tex;
+        };
+    }
+
+
+    std::function<std::shared_ptr<VkcTexture>()> AssetManager::prepareKTXTexture(
+        const std::string& filepath,
+        VkFormat format,
+        VkImageUsageFlags usageFlags,
+        VkImageLayout layout,
+        bool forceLinear)
+    {
+        auto ktx = loadKTXShared(filepath);
+        if (format == VK_FORMAT_UNDEFINED) {
+            format = ktxTexture_GetVkFormat(ktx.get());
         }
+        return [this, ktx, filepath, format, usageFlags, layout, forceLinear]() {
+            auto tex = std::make_shared<VkcTexture>(&_device);
+            // Streamed textures start with their small mips; the streamer keeps the KTX data
+            if (!forceLinear && _textureStreamer.isEnabled() && TextureStreamer::isStreamable(ktx.get())) {
+                _textureStreamer.add(tex, ktx, format, usageFlags, layout);
+                return tex;
+            }
+            if (!tex->KTXUpload(ktx.get(), format, &_device, _transferQueue, usageFlags, layout, forceLinear)) {
+                throw std::runtime_error("AssetManager: failed to load texture " + filepath);
+            }
+            return tex;
+        };
+    }
+
+    const TextureCache* AssetManager::cookedTextures() const
+    {
+        // Cooked textures are BCn only, fall back to the source images without BC support
+        return _device.enabledFeatures.textureCompressionBC ? &_textureCache : nullptr;
+    }
 
-        if (!ok) {
-            throw std::runtime_error("AssetManager: failed to load texture " + name);
+
+    // Async loading
+  //------------------------------------------------------------------------------
+    void AssetManager::requestModel(const std::string& name,
+        const std::string& filepath,
+        uint32_t gltfFlags,
+        float scale)
+    {
+        if (modelCache.count(name) || isPending(name))
+            return;
+        _evictedAssets.erase(name);
+
+        enqueue(name, [this, name, filepath, gltfFlags, scale]() -> std::function<void()> {
+            auto upload = prepareModel(filepath, false, gltfFlags, scale);
+            return [this, name, upload]() { modelCache[name] = upload(); };
+        });
+        recordModelSource(name, filepath, false, gltfFlags, scale);
+    }
+
+    void AssetManager::requestSkyboxModel(const std::string& name, const std::string& filepath)
+    {
+        if (modelCache.count(name) || isPending(name))
+            return;
+        _evictedAssets.erase(name);
+
+        enqueue(name, [this, name, filepath]() -> std::function<void()> {
+            auto upload = prepareModel(filepath, true, 0u, 1.0f);
+            return [this, name, upload]() { modelCache[name] = upload(); };
+        });
+        recordModelSource(name, filepath, true, 0u, 1.0f);
+    }
+
+    void AssetManager::requestTexture(const std::string& name,
+        const std::string& filepath,
+        VkFormat format,
+        VkImageUsageFlags usageFlags,
+        VkImageLayout layout,
+        bool forceLinear)
+    {
+        if (textureIndexMap.count(name) || isPending(name))
+            return;
+
+        auto cpuStage = [this, filepath, format, usageFlags, layout, forceLinear]() {
+            return prepareTexture(filepath, format, usageFlags, layout, forceLinear);
+        };
+        requestTextureSlot(name, cpuStage);
+        recordTextureSource(name, filepath, cpuStage);
+    }
+
+    void AssetManager::requestCubemap(const std::string& name, const std::array<std::string, 6>& faces)
+    {
+        requestTextureSlot(name, [this, faces]() {
+            return prepareCubemap(faces);
+        }, true);
+    }
+
+    void AssetManager::requestCubemap(const std::string& name,
+        const std::string& ktxFilename,
+        VkFormat format,
+        VkImageUsageFlags usageFlags,
+        VkImageLayout initialLayout)
+    {
+        requestTextureSlot(name, [this, ktxFilename, format, usageFlags, initialLayout]() {
+            return prepareCubemap(ktxFilename, format, usageFlags, initialLayout);
+        }, true);
+    }
+
+    void AssetManager::requestTextureSlot(const std::string& name,
+        std::function<std::function<std::shared_ptr<VkcTexture>()>()> cpuStage,
+        bool cubemap)
+    {
+        if (textureIndexMap.count(name) || isPending(name))
+            return;
+
+        // Reserve the bindless slot now; the upload stage fills it in
+        textureList.push_back(nullptr);
+        textureIndexMap[name] = textureList.size() - 1;
+
+        // A failed load fills the slot with the fallback, so it never stays null
+        enqueue(name, [this, name, cpuStage, cubemap]() -> std::function<void()> {
+            std::function<std::shared_ptr<VkcTexture>()> upload;
+            std::string error;
+            try {
+                upload = cpuStage();
+            }
+            catch (const std::exception& e) {
+                error = e.what();
+            }
+            return [this, name, upload, error, cubemap]() {
+                std::shared_ptr<VkcTexture> tex;
+                std::string failure = error;
+                if (upload) {
+                    try {
+                        tex = upload();
+                    }
+                    catch (const std::exception& e) {
+                        failure = e.what();
+                    }
+                }
+                if (!tex) {
+                    std::cerr << "AssetManager: loading texture '" << name << "' failed, using a fallback: "
+                        << failure << "\n";
+                    tex = getFallbackTexture(cubemap);
+                }
+                textures[name] = tex;
+                textureList[textureIndexMap.at(name)] = tex;
+            };
+        });
+    }
+
+    std::shared_ptr<VkcTexture> AssetManager::getFallbackTexture(bool cubemap)
+    {
+        std::shared_ptr<VkcTexture>& fallback = cubemap ? _fallbackCubemap : _fallbackTexture;
+        if (fallback)
+            return fallback;
+
+        // One white RGBA8 texel per layer
+        VkcTexture::DecodedImage decoded;
+        decoded.width = 1;
+        decoded.height = 1;
+        for (uint32_t i = 0; i < (cubemap ? 6u : 1u); i++) {
+            auto* texel = static_cast<unsigned char*>(std::malloc(4));
+            std::memset(texel, 0xFF, 4);
+            decoded.layers.emplace_back(texel, std::free);
+        }
+        fallback = std::make_shared<VkcTexture>(&_device);
+        if (!fallback->UploadDecoded(decoded)) {
+            throw std::runtime_error("Failed to upload fallback texture");
         }
+        return fallback;
+    }
 
-        registerTextureIfNeeded(name, tex, textures, textureIndexMap, textureList);
-        return tex;
+    void AssetManager::enqueue(const std::string& name, std::function<std::function<void()>()> cpuStage)
+    {
+        auto pending = std::make_shared<PendingAsset>();
+        pending->name = name;
+        pending->cpuReady = _workers.submit([pending, cpuStage]() {
+            auto start = std::chrono::high_resolution_clock::now();
+            pending->upload = cpuStage();
+            pending->cpuMs = elapsedMs(start);
+        });
+
+        _pending[name] = pending;
+        _pendingOrder.push_back(pending);
     }
 
-    std::shared_ptr<IModel> AssetManager::loadSkyboxModel(const std::string& modelName, const std::string& filepath)
+    void AssetManager::waitForAsset(const std::string& name)
     {
-        // Avoid reloading if cached
-        auto it = modelCache.find(modelName);
-        if (it != modelCache.end()) {
-            return it->second;
+        auto it = _pending.find(name);
+        if (it == _pending.end())
+            return;
+
+        auto pending = it->second;
+        _pending.erase(it);
+
+        pending->cpuReady.get();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        pending->upload();
+        _loadTimings.push_back({ pending->name, pending->cpuMs, elapsedMs(start) });
+
+        // Drop the CPU-side data (decoded pixels, parsed documents) right away
+        pending->upload = nullptr;
+    }
+
+    void AssetManager::finishPendingUploads()
+    {
+        for (auto& pending : _pendingOrder) {
+            auto it = _pending.find(pending->name);
+            if (it != _pending.end() && it->second == pending) {
+                waitForAsset(pending->name);
+            }
         }
+        _pendingOrder.clear();
 
-        // Determine file extension
-        auto ext = filepath.substr(filepath.find_last_of('.') + 1);
-        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        // Everything above was recorded into the upload batcher; submit it in one go
+        _device.uploadBatcher().flush();
+    }
 
-        std::shared_ptr<IModel> model;
+    // Hot reload
+  //------------------------------------------------------------------------------
+    void AssetManager::recordModelSource(const std::string& name,
+        const std::string& filepath,
+        bool isSkybox,
+        uint32_t gltfFlags,
+        float scale)
+    {
+        AssetSource source;
+        source.dependencyFile = normalizePath(filepath);
+        // Buffers and images of a glTF model live next to it
+        const auto ext = lowerExtension(filepath);
+        if (ext == "gltf") {
+            source.dependencyDir = normalizePath(std::filesystem::path(filepath).parent_path().string());
+        }
+        source.reload = [this, name, filepath, isSkybox, gltfFlags, scale]() -> std::function<void()> {
+            auto upload = prepareModel(filepath, isSkybox, gltfFlags, scale);
+            return [this, name, upload]() { replaceModel(name, upload()); };
+        };
+        _sources[name] = std::move(source);
+    }
 
-        if (ext == "obj") {
-            model = VkcOBJmodel::createModelFromFile(_device, filepath, true); // true = isSkybox or flipY
+    void AssetManager::recordTextureSource(const std::string& name,
+        const std::string& filepath,
+        std::function<std::function<std::shared_ptr<VkcTexture>()>()> cpuStage)
+    {
+        AssetSource source;
+        source.dependencyFile = normalizePath(filepath);
+        source.reload = [this, name, cpuStage]() -> std::function<void()> {
+            auto upload = cpuStage();
+            return [this, name, upload]() { replaceTexture(name, upload()); };
+        };
+        _sources[name] = std::move(source);
+    }
+
+    void AssetManager::reloadChangedFiles(const std::vector<std::string>& paths)
+    {
+        for (const auto& changed : paths) {
+            const std::string path = normalizePath(changed);
+            const std::string dir = normalizePath(std::filesystem::path(path).parent_path().string());
+            for (const auto& [name, source] : _sources) {
+                const bool inDir = !source.dependencyDir.empty() &&
+                    dir.compare(0, source.dependencyDir.size(), source.dependencyDir) == 0 &&
+                    (dir.size() == source.dependencyDir.size() || dir[source.dependencyDir.size()] == '/');
+                if (path == source.dependencyFile || inDir) {
+                    _staleAssets.insert(name);
+                }
+            }
+        }
+    }
+
+    std::vector<std::string> AssetManager::update()
+    {
+        _frame++;
+        while (!_retiredAssets.empty() && _frame >= _retiredAssets.front().frame + kRetireFrames) {
+            _retiredAssets.pop_front();
+        }
+
+        // Start re-imports. Assets still loading, or already reloading, wait for the next frame.
+        for (auto it = _staleAssets.begin(); it != _staleAssets.end();) {
+            const std::string& name = *it;
+            // Evicted assets are imported fresh on their next use anyway
+            if (_evictedAssets.count(name)) {
+                it = _staleAssets.erase(it);
+                continue;
+            }
+            const bool reloading = std::any_of(_reloads.begin(), _reloads.end(),
+                [&](const std::shared_ptr<PendingAsset>& reload) { return reload->name == name; });
+            if (isPending(name) || reloading) {
+                ++it;
+                continue;
+            }
+
+            auto reload = std::make_shared<PendingAsset>();
+            reload->name = name;
+            reload->cpuReady = _workers.submit([reload, cpuStage = _sources.at(name).reload]() {
+                auto start = std::chrono::high_resolution_clock::now();
+                reload->upload = cpuStage();
+                reload->cpuMs = elapsedMs(start);
+            });
+            _reloads.push_back(reload);
+            it = _staleAssets.erase(it);
+        }
+
+        // Swap in the ones whose CPU stage finished; a failed import keeps the old version
+        std::vector<std::string> swapped;
+        for (auto it = _reloads.begin(); it != _reloads.end();) {
+            auto& reload = *it;
+            if (reload->cpuReady.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                ++it;
+                continue;
+            }
+            try {
+                reload->cpuReady.get();
+                auto start = std::chrono::high_resolution_clock::now();
+                reload->upload();
+                std::cout << "AssetManager: reloaded '" << reload->name << "' (cpu "
+                    << static_cast<int>(reload->cpuMs) << " ms, upload " << static_cast<int>(elapsedMs(start)) << " ms)\n";
+                swapped.push_back(reload->name);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "AssetManager: reload of '" << reload->name << "' failed, keeping the old version: "
+                    << e.what() << "\n";
+            }
+            it = _reloads.erase(it);
         }
-        else if (ext == "gltf" || ext == "glb") {
-            auto gltf = std::make_shared<vkglTF::Model>();
 
-            constexpr uint32_t gltfFlags =
-                vkglTF::FileLoadingFlags::PreTransformVertices
-                | vkglTF::FileLoadingFlags::PreMultiplyVertexColors
-                | vkglTF::FileLoadingFlags::FlipY; // needed for skybox orientation
+        updateResidency();
+        return swapped;
+    }
+
+    void AssetManager::replaceModel(const std::string& name, std::shared_ptr<IModel> model)
+    {
+        auto& slot = modelCache[name];
+        if (slot) {
+            _retiredAssets.push_back({ slot, _frame });
+        }
+        slot = std::move(model);
+    }
 
-            constexpr float scale = 1.0f;
+    void AssetManager::replaceTexture(const std::string& name, std::shared_ptr<VkcTexture> tex)
+    {
+        // Same bindless index; the descriptor manager rewrites the slot per frame
+        auto& slot = textures[name];
+        if (slot) {
+            _textureStreamer.remove(*slot);
+            _retiredAssets.push_back({ slot, _frame });
+        }
+        slot = tex;
+        textureList[textureIndexMap.at(name)] = std::move(tex);
+    }
 
-            gltf->loadFromFile(filepath, &_device, _device.graphicsQueue(), gltfFlags, scale);
-            model = gltf;
+    // Residency
+  //------------------------------------------------------------------------------
+    void AssetManager::updateResidency()
+    {
+        struct Candidate {
+            const std::string* name;
+            uint64_t           lastUsed;
+            VkDeviceSize       bytes;
+        };
+        std::vector<Candidate> candidates;
+        MemoryStats stats = _memoryStats;
+        stats.meshBytes = stats.textureBytes = stats.cubemapBytes = stats.gltfImageBytes = 0;
+
+        // Anything holding a shared_ptr besides the caches (scene objects) counts as a use
+        auto track = [&](const std::string& name, long useCount, long cacheRefs, VkDeviceSize bytes) {
+            uint64_t& lastUsed = _lastUsedFrame[name];
+            if (useCount > cacheRefs) {
+                lastUsed = _frame;
+            }
+            else if (_frame - lastUsed >= _memorySettings.evictAfterFrames && _sources.count(name) && !isPending(name)) {
+                candidates.push_back({ &name, lastUsed, bytes });
+            }
+        };
+
+        for (const auto& [name, model] : modelCache) {
+            const IModel::MemoryUsage usage = model->getMemoryUsage();
+            stats.meshBytes += usage.geometryBytes;
+            stats.gltfImageBytes += usage.imageBytes;
+            track(name, model.use_count(), 1, usage.geometryBytes + usage.imageBytes);
         }
-        else {
-            throw std::runtime_error("Unsupported skybox model format: " + ext);
+        for (const auto& [name, tex] : textures) {
+            if (tex->IsCubemap()) {
+                stats.cubemapBytes += tex->residentBytes;
+                continue;  // the skybox descriptor is fixed, cubemaps stay resident
+            }
+            stats.textureBytes += tex->residentBytes;
+            // textures + textureList, and the streamer for streamed ones
+            const long cacheRefs = 2 + (_textureStreamer.isStreaming(*tex) ? 1 : 0);
+            track(name, tex.use_count(), cacheRefs, tex->residentBytes);
         }
 
-        // Cache and return
-        modelCache[modelName] = model;
-        return model;
+        VkDeviceSize resident = stats.totalBytes();
+        stats.budgetBytes = memoryBudget(resident);
+        stats.driverBudget = _device.memoryBudgetSupported;
+
+        if (resident > stats.budgetBytes && !candidates.empty()) {
+            std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+                return a.lastUsed < b.lastUsed;
+            });
+            for (const auto& candidate : candidates) {
+                if (resident <= stats.budgetBytes)
+                    break;
+                resident -= std::min(resident, candidate.bytes);
+                evict(*candidate.name);
+                stats.evictions++;
+            }
+        }
+
+        stats.evictedAssets = static_cast<uint32_t>(_evictedAssets.size());
+        _memoryStats = stats;
+    }
+
+    VkDeviceSize AssetManager::memoryBudget(VkDeviceSize residentBytes)
+    {
+        VkDeviceSize heapBudget = 0;
+        VkDeviceSize heapUsage = 0;
+        if (!_device.queryDeviceLocalBudget(heapBudget, heapUsage)) {
+            return _memorySettings.manualBudgetBytes;
+        }
+
+        // Leave room for everything else the process allocates (swapchain, UBOs, ...)
+        const auto allowed = static_cast<VkDeviceSize>(static_cast<double>(heapBudget) * _memorySettings.deviceBudgetFraction);
+        const VkDeviceSize otherUsage = heapUsage > residentBytes ? heapUsage - residentBytes : 0;
+        return allowed > otherUsage ? allowed - otherUsage : 0;
+    }
+
+    void AssetManager::evict(const std::string& name)
+    {
+        // Frames in flight may still use the GPU resources; they go through the retire list
+        if (auto it = modelCache.find(name); it != modelCache.end()) {
+            _retiredAssets.push_back({ it->second, _frame });
+            modelCache.erase(it);
+        }
+        else if (auto tex = textures.find(name); tex != textures.end()) {
+            _textureStreamer.remove(*tex->second);
+            _retiredAssets.push_back({ tex->second, _frame });
+            textureList[textureIndexMap.at(name)] = nullptr;
+            textures.erase(tex);
+        }
+        _evictedAssets.insert(name);
+        _lastUsedFrame.erase(name);
+    }
+
+    void AssetManager::reloadEvicted(const std::string& name)
+    {
+        // Same path as a hot reload, run to completion on this thread
+        auto upload = _sources.at(name).reload();
+        upload();
+        _evictedAssets.erase(name);
+        _lastUsedFrame[name] = _frame;
+        _memoryStats.reloads++;
+    }
+
+    void AssetManager::printMemoryStats() const
+    {
+        const MemoryStats& stats = _memoryStats;
+        std::cout << "AssetManager memory: " << (stats.totalBytes() >> 20) << " / " << (stats.budgetBytes >> 20)
+            << " MiB (" << (stats.driverBudget ? "VK_EXT_memory_budget" : "manual cap") << "), meshes "
+            << (stats.meshBytes >> 20) << " MiB, textures " << (stats.textureBytes >> 20) << " MiB, cubemaps "
+            << (stats.cubemapBytes >> 20) << " MiB, glTF images " << (stats.gltfImageBytes >> 20) << " MiB, "
+            << stats.evictedAssets << " evicted (" << stats.evictions << " evictions, " << stats.reloads << " reloads)\n";
+    }
+
+    void AssetManager::printLoadTimings() const
+    {
+        double cpuTotal = 0.0;
+        double uploadTotal = 0.0;
+
+        std::cout << std::fixed << std::setprecision(2)
+            << "AssetManager: " << _loadTimings.size() << " assets on "
+            << _workers.getThreadCount() << " worker threads\n";
+        for (const auto& timing : _loadTimings) {
+            std::cout << "  " << std::left << std::setw(20) << timing.name << std::right
+                << " cpu " << std::setw(8) << timing.cpuMs << " ms"
+                << "  upload " << std::setw(8) << timing.uploadMs << " ms\n";
+            cpuTotal += timing.cpuMs;
+            uploadTotal += timing.uploadMs;
+        }
+        std::cout << "  total cpu " << cpuTotal << " ms (parallel), upload " << uploadTotal << " ms\n";
+
+        const auto& uploads = _device.uploadBatcher().getStats();
+        std::cout << "  uploads: " << uploads.batchesSubmitted << " submits, "
+            << uploads.bufferCopies << " buffer copies, " << uploads.imageCopies << " image copies, "
+            << uploads.mipBlits << " mip blits, " << (uploads.bytesStaged >> 20) << " MiB staged, "
+            << uploads.ringStalls << " ring stalls, " << uploads.ownershipTransfers << " queue ownership transfers"
+            << (_device.uploadBatcher().usesDedicatedTransferQueue() ? "" : " (graphics queue only)") << "\n";
+        std::cout.unsetf(std::ios::floatfield);
+
+        _meshCache.printStats();
+        _textureStreamer.printStats();
+        printMemoryStats();
     }
 
 
     // Getters
   //------------------------------------------------------------------------------
-    std::shared_ptr<IModel> AssetManager::getModel(const std::string& name) const
+    std::shared_ptr<IModel> AssetManager::getModel(const std::string& name)
     {
+        if (_evictedAssets.count(name))
+            reloadEvicted(name);
+
         auto it = modelCache.find(name);
         if (it == modelCache.end())
             throw std::runtime_error("Model not found: " + name);
@@ -241,8 +875,11 @@ namespace vkc {
     }
 
     //------------------------------------------------------------------------------
-    std::shared_ptr<VkcTexture> AssetManager::getTexture(const std::string& name) const
+    std::shared_ptr<VkcTexture> AssetManager::getTexture(const std::string& name)
     {
+        if (_evictedAssets.count(name))
+            reloadEvicted(name);
+
         auto it = textures.find(name);
         if (it == textures.end())
             throw std::runtime_error("Texture not found: " + name);
@@ -274,7 +911,7 @@ namespace vkc {
 
     // Helpers
     bool AssetManager::hasTexture(const std::string& name) const {
-        return textures.find(name) != textures.end();
+        return textures.find(name) != textures.end() || _evictedAssets.count(name) != 0;
     }
 
     void AssetManager::registerTextureIfNeeded(
@@ -7,21 +7,126 @@
 #include "VK_abstraction/vk_device.h"
 #include "VK_abstraction/vk_texture.h"
 #include "VK_abstraction/vk_IModel.hpp"
+#include "AppCore/vk_meshCache.h"
+#include "AppCore/vk_textureStreamer.h"
+#include "Utils/vkc_threadPool.h"
+#include "Utils/vkc_textureCache.h"
 
 // STD
 #include <unordered_map>
 #include <vector>
 #include <array>
+#include <atomic>
 #include <string>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <unordered_set>
 
 namespace vkc {
 
     class AssetManager {
     public:
+        // Per-asset load time, split into the worker-side CPU stage (file I/O,
+        // decoding, parsing) and the GPU upload stage on the calling thread
+        struct AssetTiming {
+            std::string name;
+            double      cpuMs = 0.0;
+            double      uploadMs = 0.0;
+        };
+
+        // Device memory held by the caches. With VK_EXT_memory_budget the budget
+        // follows what the driver reports for the device-local heaps (less the
+        // memory the rest of the process uses); otherwise manualBudgetBytes is
+        // used. Over budget, assets that no scene object has referenced for
+        // evictAfterFrames frames are evicted least recently used first. Evicted
+        // assets keep their name and bindless index and are re-imported on the
+        // next getModel()/getTexture() by name.
+        struct MemorySettings {
+            VkDeviceSize manualBudgetBytes = 1024ull * 1024 * 1024;
+            float        deviceBudgetFraction = 0.8f;
+            uint32_t     evictAfterFrames = 600;
+        };
+
+        struct MemoryStats {
+            VkDeviceSize meshBytes = 0;        // vertex/index buffers of OBJ and glTF models
+            VkDeviceSize textureBytes = 0;     // 2D textures
+            VkDeviceSize cubemapBytes = 0;
+            VkDeviceSize gltfImageBytes = 0;   // images owned by glTF models
+            VkDeviceSize budgetBytes = 0;
+            bool         driverBudget = false; // budget came from VK_EXT_memory_budget
+            uint32_t     evictedAssets = 0;    // currently evicted
+            uint64_t     evictions = 0;
+            uint64_t     reloads = 0;
+
+            VkDeviceSize totalBytes() const { return meshBytes + textureBytes + cubemapBytes + gltfImageBytes; }
+        };
+
         AssetManager(VkcDevice& device);
 
+        // Queues the global asset list on the worker pool and returns immediately
+        void preloadGlobalAssetsAsync();
+        // Queues the global asset list and blocks until every asset is uploaded
         void preloadGlobalAssets();
 
+        // Asynchronous requests. The CPU stage runs on a worker; the GPU upload runs
+        // on whichever thread calls waitForAsset() or finishPendingUploads().
+        // Textures get their bindless index at request time, so indices follow
+        // request order regardless of which worker finishes first.
+        void requestModel(
+            const std::string& name,
+            const std::string& filepath,
+            uint32_t gltfFlags = 0u,
+            float scale = 1.0f
+        );
+        void requestSkyboxModel(const std::string& name, const std::string& filepath);
+        void requestTexture(
+            const std::string& name,
+            const std::string& path,
+            VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
+            VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+            VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            bool forceLinearTiling = false
+        );
+        void requestCubemap(const std::string& name, const std::array<std::string, 6>& faces);
+        void requestCubemap(
+            const std::string& name,
+            const std::string& ktxFilename,
+            VkFormat format,
+            VkImageUsageFlags usageFlags,
+            VkImageLayout initialLayout
+        );
+
+        // Blocks until the named asset is resident. Does nothing if it is not pending.
+        // Rethrows any error raised by the CPU stage.
+        void waitForAsset(const std::string& name);
+        // Uploads every outstanding request, in request order
+        void finishPendingUploads();
+        bool isPending(const std::string& name) const { return _pending.count(name) != 0; }
+
+        // Hot reload. reloadChangedFiles() marks every asset that depends on one of
+        // the given files; update() re-imports them on the workers and swaps each
+        // finished one into the caches under the same name and bindless index.
+        // Replaced versions are kept until no frame in flight can still use them.
+        void reloadChangedFiles(const std::vector<std::string>& paths);
+        // Once a frame. Returns the names swapped in during this call.
+        std::vector<std::string> update();
+
+        const std::vector<AssetTiming>& getLoadTimings() const { return _loadTimings; }
+        void printLoadTimings() const;
+
+        // Quantized vertices and 16-bit indices for models loaded from now on (skyboxes
+        // excluded). Needs the *_packed.vert shaders compiled to SPIR-V.
+        void setPackVertices(bool enabled) { _packVertices = enabled; }
+        bool getPackVertices() const { return _packVertices; }
+
+        void setMemorySettings(const MemorySettings& settings) { _memorySettings = settings; }
+        const MemorySettings& getMemorySettings() const { return _memorySettings; }
+        // Resident bytes per category as of the last update()
+        const MemoryStats& getMemoryStats() const { return _memoryStats; }
+        void printMemoryStats() const;
+
         std::shared_ptr<IModel> loadModel(
             const std::string& name,
             const std::string& filepath,
@@ -61,23 +166,29 @@ namespace vkc {
         );
 
         // Getters
-        std::shared_ptr<IModel> getModel(const std::string& name) const;
+        // The name lookups re-import an evicted asset before returning it; its upload
+        // is recorded into the upload batcher, so call them before the frame's flush
+        std::shared_ptr<IModel> getModel(const std::string& name);
 
         // name → texture lookup
-        std::shared_ptr<VkcTexture> getTexture(const std::string& name) const;
+        std::shared_ptr<VkcTexture> getTexture(const std::string& name);
 
-        // index → texture lookup
+        // index → texture lookup; null while the texture is pending or evicted
         std::shared_ptr<VkcTexture> getTexture(size_t index) const;
 
         // name → index lookup
         size_t getTextureIndex(const std::string& name) const;
 
-        // all textures in load order
+        // all textures in load order; slots of pending or evicted textures are null,
+        // those whose load failed hold a 1x1 white fallback
         const std::vector<std::shared_ptr<VkcTexture>>& getAllTextures() const;
 
         // Helpers
         bool hasTexture(const std::string& name) const;
 
+        const MeshCache& getMeshCache() const { return _meshCache; }
+        TextureStreamer& getTextureStreamer() { return _textureStreamer; }
+
     private:
         // Models
         std::unordered_map<std::string, std::shared_ptr<IModel>> modelCache;
@@ -88,13 +199,101 @@ namespace vkc {
         std::vector<std::shared_ptr<VkcTexture>>                     textureList;     // index → texture
 
         VkcTexture irradianceCube{};
+
+        // 1x1 white stand-ins for textures that failed to load, created on first use
+        std::shared_ptr<VkcTexture> _fallbackTexture;
+        std::shared_ptr<VkcTexture> _fallbackCubemap;
         VkcTexture prefilteredCube{};
         VkcTexture brdfLut{};
 
         VkcDevice& _device;
         VkQueue    _transferQueue;
 
+        // Binary OBJ cache under res/cache/meshes
+        MeshCache  _meshCache;
+
+        // BCn textures cooked offline by TextureCooker under res/cache/textures
+        TextureCache _textureCache;
+        const TextureCache* cookedTextures() const;
+
+        // Mipmapped 2D KTX textures (including cooked ones) are streamed by level
+        TextureStreamer _textureStreamer;
+
+        // Async loading
+        struct PendingAsset {
+            std::string           name;
+            std::future<void>     cpuReady;
+            std::function<void()> upload;   // produced by the CPU stage, run on the upload thread
+            double                cpuMs = 0.0;
+        };
+        std::unordered_map<std::string, std::shared_ptr<PendingAsset>> _pending;
+        std::vector<std::shared_ptr<PendingAsset>>                     _pendingOrder;
+        std::vector<AssetTiming>                                       _loadTimings;
+
+        // Hot reload
+        struct AssetSource {
+            std::string dependencyFile;   // normalized source path
+            std::string dependencyDir;    // glTF: any file next to the model
+            std::function<std::function<void()>()> reload;  // CPU stage of a re-import
+        };
+        struct RetiredAsset {
+            std::shared_ptr<void> asset;
+            uint64_t              frame = 0;
+        };
+        std::unordered_map<std::string, AssetSource>  _sources;
+        std::unordered_set<std::string>               _staleAssets;
+        std::vector<std::shared_ptr<PendingAsset>>    _reloads;
+        std::deque<RetiredAsset>                      _retiredAssets;
+        uint64_t                                      _frame = 0;
+
+        // Residency
+        MemorySettings                                _memorySettings;
+        std::atomic<bool>                             _packVertices{ false };
+        MemoryStats                                   _memoryStats;
+        std::unordered_map<std::string, uint64_t>     _lastUsedFrame;  // frame an outside reference was last seen
+        std::unordered_set<std::string>               _evictedAssets;
+
+        // Declared last so workers are joined before anything they touch is destroyed
+        ThreadPool _workers;
+
         // Helpers
+        // The prepare* functions perform the CPU stage and return the GPU stage.
+        // They may run on a worker and must not touch the lookup tables.
+        std::function<std::shared_ptr<IModel>()> prepareModel(
+            const std::string& filepath, bool isSkybox, uint32_t gltfFlags, float scale);
+        std::function<std::shared_ptr<VkcOBJmodel>()> prepareOBJModel(const std::string& filepath, bool isSkybox);
+        std::function<std::shared_ptr<VkcTexture>()> prepareTexture(
+            const std::string& filepath, VkFormat format, VkImageUsageFlags usageFlags,
+            VkImageLayout layout, bool forceLinear);
+        std::function<std::shared_ptr<VkcTexture>()> prepareKTXTexture(
+            const std::string& filepath, VkFormat format, VkImageUsageFlags usageFlags,
+            VkImageLayout layout, bool forceLinear);
+        std::function<std::shared_ptr<VkcTexture>()> prepareCubemap(const std::array<std::string, 6>& faces);
+        std::function<std::shared_ptr<VkcTexture>()> prepareCubemap(
+            const std::string& ktxFilename, VkFormat format, VkImageUsageFlags usageFlags,
+            VkImageLayout initialLayout);
+
+        void enqueue(const std::string& name, std::function<std::function<void()>()> cpuStage);
+        void requestTextureSlot(
+            const std::string& name,
+            std::function<std::function<std::shared_ptr<VkcTexture>()>()> cpuStage,
+            bool cubemap = false);
+        std::shared_ptr<VkcTexture> getFallbackTexture(bool cubemap);
+        void recordModelSource(
+            const std::string& name, const std::string& filepath, bool isSkybox,
+            uint32_t gltfFlags, float scale);
+        void recordTextureSource(
+            const std::string& name, const std::string& filepath,
+            std::function<std::function<std::shared_ptr<VkcTexture>()>()> cpuStage);
+        void replaceModel(const std::string& name, std::shared_ptr<IModel> model);
+        void replaceTexture(const std::string& name, std::shared_ptr<VkcTexture> tex);
+        void updateResidency();
+        VkDeviceSize memoryBudget(VkDeviceSize residentBytes);
+        void evict(const std::string& name);
+        void reloadEvicted(const std::string& name);
+        std::shared_ptr<IModel> loadModelNow(
+            const std::string& name, const std::string& filepath, bool isSkybox,
+            uint32_t gltfFlags, float scale);
 
         static void registerTextureIfNeeded(
             const std::string& name,
@@ -0,0 +1,379 @@
+// vk_meshCache.cpp
+
+// Project headers
+#include "vk_meshCache.h"
+#include "Utils/vkc_utils.h"
+
+// STD
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace vkc {
+
+    namespace {
+
+        constexpr uint32_t kMeshCacheMagic = 0x4D434B56; // "VKCM"
+        constexpr uint32_t kMeshCacheVersion = 3;   // 2: optimized vertex/index order, 3: LODs
+        constexpr uint64_t kMeshCacheAlignment = 16;
+
+        struct MeshCacheHeader {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t loaderFlags;
+            uint32_t vertexStride;
+            uint64_t pathHash;
+            uint64_t sourceSize;
+            int64_t  sourceMtime;
+            uint32_t vertexCount;
+            uint32_t indexCount;
+            uint64_t vertexOffset;
+            uint64_t indexOffset;
+            double   parseMs;
+            uint32_t lodCount;
+            uint32_t _pad;
+            uint64_t lodOffset;
+        };
+
+        constexpr uint32_t kGeometryOrderMagic = 0x4F434B56; // "VKCO"
+        constexpr uint32_t kGeometryOrderVersion = 2;   // 2: LODs
+        constexpr uint32_t kGeometryOrderFlag = 0x80000000u; // keeps order entries apart from mesh entries
+
+        // Followed by, per mesh: uint32 primitive count; per primitive: uint32 vertex
+        // count, uint32 index count, uint32 LOD count, the vertex order, the indices
+        // (every level), then the LOD table
+        struct GeometryOrderHeader {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t pathHash;
+            uint64_t sourceSize;
+            int64_t  sourceMtime;
+            uint32_t meshCount;
+            float    acmrBefore, acmrAfter;
+            float    atvrBefore, atvrAfter;
+        };
+
+        struct SourceStamp {
+            uint64_t size = 0;
+            int64_t  mtime = 0;
+        };
+
+        bool stampSource(const std::string& sourcePath, SourceStamp& outStamp)
+        {
+            std::error_code ec;
+            auto size = fs::file_size(sourcePath, ec);
+            if (ec) return false;
+            auto mtime = fs::last_write_time(sourcePath, ec);
+            if (ec) return false;
+
+            outStamp.size = static_cast<uint64_t>(size);
+            outStamp.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+            return true;
+        }
+
+        uint64_t alignUp(uint64_t value, uint64_t alignment)
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - start).count();
+        }
+    }
+
+    MeshCache::MeshCache(std::string cacheDir)
+        : _cacheDir(std::move(cacheDir))
+    {
+    }
+
+    std::string MeshCache::entryPath(const std::string& sourcePath, uint32_t loaderFlags) const
+    {
+        size_t seed = 0;
+        hashCombine(seed, sourcePath, loaderFlags);
+
+        std::ostringstream name;
+        name << _cacheDir << "/" << std::hex << std::setw(16) << std::setfill('0')
+            << static_cast<uint64_t>(seed) << ".vkcmesh";
+        return name.str();
+    }
+
+    bool MeshCache::load(const std::string& sourcePath, uint32_t loaderFlags, Entry& outEntry)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        SourceStamp stamp;
+        if (!stampSource(sourcePath, stamp)) {
+            return false;
+        }
+
+        MappedFile file;
+        if (!file.open(entryPath(sourcePath, loaderFlags))) {
+            return false;
+        }
+        if (file.size() < sizeof(MeshCacheHeader)) {
+            return false;
+        }
+
+        MeshCacheHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+
+        const bool isSkybox = (loaderFlags & Skybox) != 0;
+        const uint32_t expectedStride = isSkybox
+            ? static_cast<uint32_t>(sizeof(VkcOBJmodel::SkyboxVertex))
+            : static_cast<uint32_t>(sizeof(VkcOBJmodel::Vertex));
+
+        if (header.magic != kMeshCacheMagic ||
+            header.version != kMeshCacheVersion ||
+            header.loaderFlags != loaderFlags ||
+            header.vertexStride != expectedStride ||
+            header.pathHash != std::hash<std::string>{}(sourcePath) ||
+            header.sourceSize != stamp.size ||
+            header.sourceMtime != stamp.mtime) {
+            return false;
+        }
+
+        const uint64_t vertexBytes = uint64_t(header.vertexCount) * header.vertexStride;
+        const uint64_t indexBytes = uint64_t(header.indexCount) * sizeof(uint32_t);
+        const uint64_t lodBytes = uint64_t(header.lodCount) * sizeof(meshopt::Lod);
+        if (header.vertexOffset + vertexBytes > file.size() ||
+            header.indexOffset + indexBytes > file.size() ||
+            header.lodOffset + lodBytes > file.size()) {
+            std::cerr << "MeshCache: truncated entry for " << sourcePath << ", ignoring\n";
+            return false;
+        }
+
+        outEntry.vertexData = file.data() + header.vertexOffset;
+        outEntry.vertexStride = header.vertexStride;
+        outEntry.vertexCount = header.vertexCount;
+        outEntry.indexData = reinterpret_cast<const uint32_t*>(file.data() + header.indexOffset);
+        outEntry.indexCount = header.indexCount;
+        outEntry.lods.resize(header.lodCount);
+        std::memcpy(outEntry.lods.data(), file.data() + header.lodOffset, lodBytes);
+        outEntry.file = std::move(file);
+
+        double loadMs = elapsedMs(start);
+        std::lock_guard<std::mutex> lock(_statsMutex);
+        _stats.hits++;
+        _stats.cachedLoadMs += loadMs;
+        _stats.savedMs += header.parseMs - loadMs;
+        return true;
+    }
+
+    void MeshCache::store(const std::string& sourcePath, uint32_t loaderFlags,
+        const VkcOBJmodel::Builder& builder, double parseMs)
+    {
+        SourceStamp stamp;
+        if (!stampSource(sourcePath, stamp)) {
+            return;
+        }
+
+        const bool isSkybox = (loaderFlags & Skybox) != 0;
+        const void* vertexData = isSkybox
+            ? static_cast<const void*>(builder.skyboxVertices.data())
+            : static_cast<const void*>(builder.vertices.data());
+
+        MeshCacheHeader header{};
+        header.magic = kMeshCacheMagic;
+        header.version = kMeshCacheVersion;
+        header.loaderFlags = loaderFlags;
+        header.vertexStride = isSkybox
+            ? static_cast<uint32_t>(sizeof(VkcOBJmodel::SkyboxVertex))
+            : static_cast<uint32_t>(sizeof(VkcOBJmodel::Vertex));
+        header.pathHash = std::hash<std::string>{}(sourcePath);
+        header.sourceSize = stamp.size;
+        header.sourceMtime = stamp.mtime;
+        header.vertexCount = static_cast<uint32_t>(isSkybox ? builder.skyboxVertices.size() : builder.vertices.size());
+        header.indexCount = static_cast<uint32_t>(builder.indices.size());
+        header.vertexOffset = alignUp(sizeof(MeshCacheHeader), kMeshCacheAlignment);
+        header.indexOffset = alignUp(header.vertexOffset + uint64_t(header.vertexCount) * header.vertexStride, kMeshCacheAlignment);
+        header.parseMs = parseMs;
+        header.lodCount = static_cast<uint32_t>(builder.lods.size());
+        header.lodOffset = alignUp(header.indexOffset + uint64_t(header.indexCount) * sizeof(uint32_t), kMeshCacheAlignment);
+
+        std::error_code ec;
+        fs::create_directories(_cacheDir, ec);
+
+        // Write to a temporary file and rename so a crash never leaves a half-written entry
+        const std::string finalPath = entryPath(sourcePath, loaderFlags);
+        const std::string tmpPath = finalPath + ".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                std::cerr << "MeshCache: could not write " << tmpPath << "\n";
+                return;
+            }
+
+            static const char padding[kMeshCacheAlignment] = {};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(padding, header.vertexOffset - sizeof(header));
+            out.write(static_cast<const char*>(vertexData), uint64_t(header.vertexCount) * header.vertexStride);
+            out.write(padding, header.indexOffset - (header.vertexOffset + uint64_t(header.vertexCount) * header.vertexStride));
+            out.write(reinterpret_cast<const char*>(builder.indices.data()), uint64_t(header.indexCount) * sizeof(uint32_t));
+            out.write(padding, header.lodOffset - (header.indexOffset + uint64_t(header.indexCount) * sizeof(uint32_t)));
+            out.write(reinterpret_cast<const char*>(builder.lods.data()), uint64_t(header.lodCount) * sizeof(meshopt::Lod));
+            if (!out) {
+                std::cerr << "MeshCache: failed writing " << tmpPath << "\n";
+                return;
+            }
+        }
+
+        fs::rename(tmpPath, finalPath, ec);
+        if (ec) {
+            fs::remove(tmpPath, ec);
+        }
+    }
+
+    bool MeshCache::loadGeometryOrder(const std::string& sourcePath, vkglTF::GeometryOrder& outOrder)
+    {
+        SourceStamp stamp;
+        if (!stampSource(sourcePath, stamp)) {
+            return false;
+        }
+
+        MappedFile file;
+        if (!file.open(entryPath(sourcePath, kGeometryOrderFlag)) || file.size() < sizeof(GeometryOrderHeader)) {
+            return false;
+        }
+
+        GeometryOrderHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (header.magic != kGeometryOrderMagic ||
+            header.version != kGeometryOrderVersion ||
+            header.pathHash != std::hash<std::string>{}(sourcePath) ||
+            header.sourceSize != stamp.size ||
+            header.sourceMtime != stamp.mtime) {
+            return false;
+        }
+
+        const unsigned char* cursor = file.data() + sizeof(header);
+        const unsigned char* end = file.data() + file.size();
+        auto read = [&](void* dst, uint64_t bytes) {
+            if (uint64_t(end - cursor) < bytes) return false;
+            std::memcpy(dst, cursor, bytes);
+            cursor += bytes;
+            return true;
+        };
+
+        vkglTF::GeometryOrder order;
+        order.before = { header.acmrBefore, header.atvrBefore };
+        order.after = { header.acmrAfter, header.atvrAfter };
+        order.meshes.resize(header.meshCount);
+        bool valid = true;
+        for (auto& primitives : order.meshes) {
+            uint32_t primitiveCount = 0;
+            valid = valid && read(&primitiveCount, sizeof(primitiveCount));
+            if (!valid) break;
+            primitives.resize(primitiveCount);
+            for (vkglTF::PrimitiveOrder& primitive : primitives) {
+                uint32_t counts[3] = {};
+                valid = valid && read(counts, sizeof(counts));
+                if (!valid) break;
+                primitive.vertexOrder.resize(counts[0]);
+                primitive.indices.resize(counts[1]);
+                primitive.lods.resize(counts[2]);
+                valid = read(primitive.vertexOrder.data(), uint64_t(counts[0]) * sizeof(uint32_t)) &&
+                    read(primitive.indices.data(), uint64_t(counts[1]) * sizeof(uint32_t)) &&
+                    read(primitive.lods.data(), uint64_t(counts[2]) * sizeof(meshopt::Lod));
+                if (!valid) break;
+            }
+        }
+        if (!valid || cursor != end) {
+            std::cerr << "MeshCache: truncated geometry order for " << sourcePath << ", ignoring\n";
+            return false;
+        }
+
+        outOrder = std::move(order);
+        return true;
+    }
+
+    void MeshCache::storeGeometryOrder(const std::string& sourcePath, const vkglTF::GeometryOrder& order)
+    {
+        SourceStamp stamp;
+        if (!stampSource(sourcePath, stamp)) {
+            return;
+        }
+
+        GeometryOrderHeader header{};
+        header.magic = kGeometryOrderMagic;
+        header.version = kGeometryOrderVersion;
+        header.pathHash = std::hash<std::string>{}(sourcePath);
+        header.sourceSize = stamp.size;
+        header.sourceMtime = stamp.mtime;
+        header.meshCount = static_cast<uint32_t>(order.meshes.size());
+        header.acmrBefore = order.before.acmr;
+        header.acmrAfter = order.after.acmr;
+        header.atvrBefore = order.before.atvr;
+        header.atvrAfter = order.after.atvr;
+
+        std::error_code ec;
+        fs::create_directories(_cacheDir, ec);
+
+        const std::string finalPath = entryPath(sourcePath, kGeometryOrderFlag);
+        const std::string tmpPath = finalPath + ".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                std::cerr << "MeshCache: could not write " << tmpPath << "\n";
+                return;
+            }
+
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for (const auto& primitives : order.meshes) {
+                const uint32_t primitiveCount = static_cast<uint32_t>(primitives.size());
+                out.write(reinterpret_cast<const char*>(&primitiveCount), sizeof(primitiveCount));
+                for (const vkglTF::PrimitiveOrder& primitive : primitives) {
+                    const uint32_t counts[3] = {
+                        static_cast<uint32_t>(primitive.vertexOrder.size()),
+                        static_cast<uint32_t>(primitive.indices.size()),
+                        static_cast<uint32_t>(primitive.lods.size()) };
+                    out.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+                    out.write(reinterpret_cast<const char*>(primitive.vertexOrder.data()), uint64_t(counts[0]) * sizeof(uint32_t));
+                    out.write(reinterpret_cast<const char*>(primitive.indices.data()), uint64_t(counts[1]) * sizeof(uint32_t));
+                    out.write(reinterpret_cast<const char*>(primitive.lods.data()), uint64_t(counts[2]) * sizeof(meshopt::Lod));
+                }
+            }
+            if (!out) {
+                std::cerr << "MeshCache: failed writing " << tmpPath << "\n";
+                return;
+            }
+        }
+
+        fs::rename(tmpPath, finalPath, ec);
+        if (ec) {
+            fs::remove(tmpPath, ec);
+        }
+    }
+
+    void MeshCache::recordMiss(double parseMs)
+    {
+        std::lock_guard<std::mutex> lock(_statsMutex);
+        _stats.misses++;
+        _stats.parseMs += parseMs;
+    }
+
+    MeshCache::Stats MeshCache::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(_statsMutex);
+        return _stats;
+    }
+
+    void MeshCache::printStats() const
+    {
+        std::lock_guard<std::mutex> lock(_statsMutex);
+        std::cout << std::fixed << std::setprecision(2)
+            << "MeshCache: " << _stats.hits << " hits, " << _stats.misses << " misses, "
+            << _stats.parseMs << " ms parsing, " << _stats.cachedLoadMs << " ms mapping, "
+            << _stats.savedMs << " ms saved\n";
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+} // namespace vkc
@@ -0,0 +1,77 @@
+// vk_meshCache.h
+#pragma once
+
+// Project headers
+#include "VK_abstraction/vk_obj_model.h"
+#include "VK_abstraction/vk_glTFModel.h"
+#include "Utils/vkc_mappedFile.h"
+
+// STD
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vkc {
+
+    // On-disk cache of deduplicated, optimized OBJ vertex/index arrays, and of the
+    // optimized vertex/index order of glTF files. Entries are keyed by source path,
+    // size, mtime and loader flags, and are read back through a memory mapping so
+    // the arrays can be copied straight into staging buffers.
+    // load/store may be called from asset worker threads.
+    class MeshCache {
+    public:
+        enum LoaderFlags : uint32_t {
+            None = 0x0,
+            Skybox = 0x1
+        };
+
+        // A cache hit. Vertex and index pointers point into the mapped file and
+        // stay valid until the entry is destroyed.
+        struct Entry {
+            MappedFile      file;
+            const void*     vertexData = nullptr;
+            uint32_t        vertexStride = 0;
+            uint32_t        vertexCount = 0;
+            const uint32_t* indexData = nullptr;
+            uint32_t        indexCount = 0;     // every level
+            std::vector<meshopt::Lod> lods;
+        };
+
+        struct Stats {
+            uint32_t hits = 0;
+            uint32_t misses = 0;
+            double   parseMs = 0.0;      // time spent in tinyobj on misses
+            double   cachedLoadMs = 0.0; // time spent mapping entries on hits
+            double   savedMs = 0.0;      // recorded parse time minus mapping time, summed over hits
+        };
+
+        explicit MeshCache(std::string cacheDir);
+
+        // Maps the cache entry for this source. Returns false on a miss or a stale entry.
+        bool load(const std::string& sourcePath, uint32_t loaderFlags, Entry& outEntry);
+
+        // Writes the builder's final arrays for this source. parseMs is stored so
+        // later hits can report the time they saved.
+        void store(const std::string& sourcePath, uint32_t loaderFlags,
+            const VkcOBJmodel::Builder& builder, double parseMs);
+
+        // glTF primitive orders from vkglTF::Model::optimizeGeometry. Returns false on a
+        // miss or a stale entry.
+        bool loadGeometryOrder(const std::string& sourcePath, vkglTF::GeometryOrder& outOrder);
+        void storeGeometryOrder(const std::string& sourcePath, const vkglTF::GeometryOrder& order);
+
+        void recordMiss(double parseMs);
+
+        Stats getStats() const;
+        void printStats() const;
+
+    private:
+        std::string entryPath(const std::string& sourcePath, uint32_t loaderFlags) const;
+
+        std::string        _cacheDir;
+        Stats              _stats;
+        mutable std::mutex _statsMutex;
+    };
+
+} // namespace vkc
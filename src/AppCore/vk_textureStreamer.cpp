@@ -0,0 +1,271 @@
+// vk_textureStreamer.cpp
+
+// Project headers
+#include "vk_textureStreamer.h"
+#include "VK_abstraction/vk_swapchain.h"
+#include "VK_abstraction/vk_uploadBatcher.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace vkc {
+
+    namespace {
+        // A replaced image may still be sampled by every frame in flight
+        constexpr uint64_t kRetireFrames = VkcSwapChain::MAX_FRAMES_IN_FLIGHT + 1;
+    }
+
+    TextureStreamer::TextureStreamer(VkcDevice& device)
+        : TextureStreamer(device, Settings{})
+    {
+    }
+
+    TextureStreamer::TextureStreamer(VkcDevice& device, const Settings& settings)
+        : _device(device), _settings(settings)
+    {
+    }
+
+    TextureStreamer::~TextureStreamer()
+    {
+        // Current images belong to the textures; pending and retired ones are ours
+        _device.uploadBatcher().waitIdle();
+        vkDeviceWaitIdle(_device.device());
+        for (auto& entry : _entries) {
+            if (entry.pending) {
+                VkcTexture::DestroyImage(&_device, entry.pendingImage);
+            }
+        }
+        destroyRetired(true);
+    }
+
+    bool TextureStreamer::isStreamable(const ktxTexture* ktx)
+    {
+        return ktx->numLevels > 1 && ktx->numDimensions == 2 && ktx->numFaces == 1
+            && ktx->numLayers == 1 && !ktx->isArray;
+    }
+
+    void TextureStreamer::add(const std::shared_ptr<VkcTexture>& texture, const std::shared_ptr<ktxTexture>& ktx,
+        VkFormat format, VkImageUsageFlags usageFlags, VkImageLayout layout)
+    {
+        Entry entry;
+        entry.texture = texture;
+        entry.source = ktx;
+
+        const uint32_t levels = ktx->numLevels;
+        entry.tailBytes.assign(levels + 1, 0);
+        for (uint32_t mip = levels; mip-- > 0;) {
+            entry.tailBytes[mip] = entry.tailBytes[mip + 1] + ktxTexture_GetImageSize(ktx.get(), mip);
+        }
+
+        const uint32_t largest = std::max(ktx->baseWidth, ktx->baseHeight);
+        while (entry.floorMip + 1 < levels && (largest >> entry.floorMip) > _settings.initialMaxDimension) {
+            entry.floorMip++;
+        }
+        entry.wantedMip = entry.floorMip;
+
+        texture->KTXUploadStreamed(ktx.get(), format, &_device, usageFlags, layout, entry.floorMip);
+        _projectedBytes += entry.tailBytes[entry.floorMip];
+        _stats.bytesUploaded += entry.tailBytes[entry.floorMip];
+
+        _lookup[texture.get()] = _entries.size();
+        _entries.push_back(std::move(entry));
+    }
+
+    void TextureStreamer::remove(const VkcTexture& texture)
+    {
+        auto it = _lookup.find(&texture);
+        if (it == _lookup.end())
+            return;
+
+        const size_t index = it->second;
+        Entry& entry = _entries[index];
+        if (entry.pending) {
+            // The batch may still be copying into the image
+            _device.uploadBatcher().wait(entry.pendingBatch);
+            _retired.push_back({ entry.pendingImage, _frame });
+        }
+        _projectedBytes -= entry.tailBytes[entry.targetMip()];
+        _lookup.erase(it);
+
+        if (index + 1 != _entries.size()) {
+            _entries[index] = std::move(_entries.back());
+            _lookup[_entries[index].texture.get()] = index;
+        }
+        _entries.pop_back();
+    }
+
+    void TextureStreamer::request(const VkcTexture& texture, float pixelsPerUV)
+    {
+        auto it = _lookup.find(&texture);
+        if (it == _lookup.end() || !(pixelsPerUV > 0.0f))
+            return;
+
+        Entry& entry = _entries[it->second];
+
+        // Level at which one texel covers about one pixel
+        const float texels = static_cast<float>(std::max(texture.width, texture.height));
+        uint32_t mip = 0;
+        if (pixelsPerUV < texels) {
+            mip = static_cast<uint32_t>(std::floor(std::log2(texels / pixelsPerUV)));
+        }
+
+        entry.wantedMip = std::min({ entry.wantedMip, mip, entry.floorMip });
+        entry.lastNeededFrame = _frame;
+    }
+
+    void TextureStreamer::update()
+    {
+        destroyRetired(false);
+        completeUploads();
+
+        // Textures that need finer levels, most under-resolved first
+        std::vector<Entry*> candidates;
+        for (auto& entry : _entries) {
+            if (!entry.pending && entry.wantedMip < entry.texture->residentMip) {
+                candidates.push_back(&entry);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b) {
+            const uint32_t deficitA = a->texture->residentMip - a->wantedMip;
+            const uint32_t deficitB = b->texture->residentMip - b->wantedMip;
+            if (deficitA != deficitB)
+                return deficitA > deficitB;
+            return a->wantedMip < b->wantedMip;
+        });
+
+        VkDeviceSize uploaded = 0;
+        for (Entry* candidate : candidates) {
+            Entry& entry = *candidate;
+            const uint32_t resident = entry.texture->residentMip;
+
+            // Stay within this frame's upload allowance, one level at a time if need be
+            uint32_t target = entry.wantedMip;
+            while (target + 1 < resident && uploaded + entry.tailBytes[target] > _settings.uploadBytesPerFrame) {
+                target++;
+            }
+            if (uploaded > 0 && uploaded + entry.tailBytes[target] > _settings.uploadBytesPerFrame)
+                break;
+
+            // Make room by dropping the finest levels of the least recently needed textures
+            auto projectedWith = [&](uint32_t mip) {
+                return _projectedBytes - entry.tailBytes[resident] + entry.tailBytes[mip];
+            };
+            while (projectedWith(target) > _settings.budgetBytes) {
+                Entry* victim = pickVictim(entry);
+                if (!victim)
+                    break;
+                const uint32_t evictTo = victim->texture->residentMip + 1;
+                schedule(*victim, evictTo);
+                uploaded += victim->tailBytes[evictTo];
+                _stats.levelsEvicted++;
+            }
+            while (target < resident && projectedWith(target) > _settings.budgetBytes) {
+                target++;
+            }
+            if (target >= resident) {
+                _stats.budgetDeferrals++;
+                continue;
+            }
+
+            schedule(entry, target);
+            uploaded += entry.tailBytes[target];
+            _stats.levelsStreamedIn += resident - target;
+        }
+
+        // Requests only live for one frame
+        for (auto& entry : _entries) {
+            entry.wantedMip = entry.floorMip;
+        }
+        _frame++;
+    }
+
+    void TextureStreamer::schedule(Entry& entry, uint32_t mip)
+    {
+        _projectedBytes = _projectedBytes - entry.tailBytes[entry.targetMip()] + entry.tailBytes[mip];
+
+        entry.pendingImage = entry.texture->CreateMipTail(entry.source.get(), mip);
+        entry.pendingMip = mip;
+        entry.pendingBatch = _device.uploadBatcher().currentBatchId();
+        entry.pending = true;
+
+        _stats.bytesUploaded += entry.tailBytes[mip];
+    }
+
+    TextureStreamer::Entry* TextureStreamer::pickVictim(const Entry& requester)
+    {
+        Entry* victim = nullptr;
+        for (auto& entry : _entries) {
+            if (&entry == &requester || entry.pending)
+                continue;
+
+            const uint32_t resident = entry.texture->residentMip;
+            if (resident >= entry.floorMip)
+                continue;
+
+            // Only evict textures needed less recently than the requester, or ones
+            // holding finer levels than they currently need
+            const bool overResident = resident < entry.wantedMip;
+            if (!overResident && entry.lastNeededFrame >= requester.lastNeededFrame)
+                continue;
+
+            if (!victim || entry.lastNeededFrame < victim->lastNeededFrame ||
+                (entry.lastNeededFrame == victim->lastNeededFrame &&
+                    entry.tailBytes[resident] > victim->tailBytes[victim->texture->residentMip])) {
+                victim = &entry;
+            }
+        }
+        return victim;
+    }
+
+    void TextureStreamer::completeUploads()
+    {
+        VkcUploadBatcher& batcher = _device.uploadBatcher();
+        for (auto& entry : _entries) {
+            if (!entry.pending || !batcher.isComplete(entry.pendingBatch))
+                continue;
+
+            // Bindless descriptors pick up the new view as each frame slot comes around
+            _retired.push_back({ entry.texture->SwapImage(entry.pendingImage, entry.pendingMip), _frame });
+            entry.pendingImage = {};
+            entry.pending = false;
+        }
+    }
+
+    void TextureStreamer::destroyRetired(bool all)
+    {
+        while (!_retired.empty() && (all || _frame >= _retired.front().frame + kRetireFrames)) {
+            VkcTexture::DestroyImage(&_device, _retired.front().image);
+            _retired.pop_front();
+        }
+    }
+
+    TextureStreamer::Stats TextureStreamer::getStats() const
+    {
+        Stats stats = _stats;
+        stats.textures = static_cast<uint32_t>(_entries.size());
+        stats.residentBytes = 0;
+        stats.pendingBytes = 0;
+        stats.retiredBytes = 0;
+        for (const auto& entry : _entries) {
+            stats.residentBytes += entry.texture->residentBytes;
+            stats.pendingBytes += entry.pending ? entry.pendingImage.size : 0;
+        }
+        for (const auto& retired : _retired) {
+            stats.retiredBytes += retired.image.size;
+        }
+        return stats;
+    }
+
+    void TextureStreamer::printStats() const
+    {
+        const Stats stats = getStats();
+        std::cout << "TextureStreamer: " << stats.textures << " textures, "
+            << (stats.residentBytes >> 20) << " / " << (_settings.budgetBytes >> 20) << " MiB resident, "
+            << (stats.pendingBytes >> 20) << " MiB pending, " << (stats.retiredBytes >> 20) << " MiB retiring, "
+            << stats.levelsStreamedIn << " levels streamed in, " << stats.levelsEvicted << " evicted, "
+            << (stats.bytesUploaded >> 20) << " MiB uploaded, " << stats.budgetDeferrals << " deferred\n";
+    }
+
+} // namespace vkc
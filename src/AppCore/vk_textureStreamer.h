@@ -0,0 +1,118 @@
+// vk_textureStreamer.h
+#pragma once
+
+// Project headers
+#include "VK_abstraction/vk_device.h"
+#include "VK_abstraction/vk_texture.h"
+
+// STD
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace vkc {
+
+    // Mip-level streaming for mipmapped 2D KTX textures. Textures start with only
+    // their small mips resident; each frame the scene reports how large every
+    // texture appears on screen, and update() streams finer levels towards that
+    // through the upload batcher. The resident set is kept under a VRAM budget by
+    // dropping the finest levels of the least recently needed textures first.
+    //
+    // A texture's image is replaced (not resized) when its resident range changes.
+    // The new image is swapped in once its upload batch completes, and the old
+    // one is destroyed after every frame in flight has moved past it. The KTX
+    // source stays in system memory so levels can be staged again later.
+    // Main thread only.
+    class TextureStreamer {
+    public:
+        struct Settings {
+            bool         enabled = true;
+            VkDeviceSize budgetBytes = 256ull * 1024 * 1024;
+            VkDeviceSize uploadBytesPerFrame = 16ull * 1024 * 1024;
+            uint32_t     initialMaxDimension = 128;   // largest level resident at load time
+        };
+
+        struct Stats {
+            uint32_t     textures = 0;
+            VkDeviceSize residentBytes = 0;    // current images of streamed textures
+            VkDeviceSize pendingBytes = 0;     // images waiting for their upload
+            VkDeviceSize retiredBytes = 0;     // images still used by frames in flight
+            uint64_t     levelsStreamedIn = 0;
+            uint64_t     levelsEvicted = 0;
+            uint64_t     bytesUploaded = 0;
+            uint64_t     budgetDeferrals = 0;  // requests held back because nothing could be evicted
+        };
+
+        explicit TextureStreamer(VkcDevice& device);
+        TextureStreamer(VkcDevice& device, const Settings& settings);
+        ~TextureStreamer();
+
+        TextureStreamer(const TextureStreamer&) = delete;
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+        static bool isStreamable(const ktxTexture* ktx);
+        bool isEnabled() const { return _settings.enabled; }
+        bool isStreaming(const VkcTexture& texture) const { return _lookup.count(&texture) != 0; }
+
+        // Uploads the initial mip tail of ktx into texture and keeps ktx as its source
+        void add(const std::shared_ptr<VkcTexture>& texture, const std::shared_ptr<ktxTexture>& ktx,
+            VkFormat format, VkImageUsageFlags usageFlags, VkImageLayout layout);
+
+        // Stops streaming texture. Its current image stays with the texture; a
+        // pending upload is waited for and its image retired.
+        void remove(const VkcTexture& texture);
+
+        // Reports that texture is visible this frame, with one UV unit covering
+        // pixelsPerUV pixels on screen. Ignored for textures that are not streamed.
+        void request(const VkcTexture& texture, float pixelsPerUV);
+
+        // Once a frame, before the upload batcher is flushed
+        void update();
+
+        void setBudget(VkDeviceSize budgetBytes) { _settings.budgetBytes = budgetBytes; }
+        const Settings& getSettings() const { return _settings; }
+        Stats getStats() const;
+        void printStats() const;
+
+    private:
+        struct Entry {
+            std::shared_ptr<VkcTexture>   texture;
+            std::shared_ptr<ktxTexture>   source;
+            std::vector<VkDeviceSize>     tailBytes;   // bytes of levels [mip, mipLevels)
+            uint32_t                      floorMip = 0;  // coarsest resident level, never evicted
+            uint32_t                      wantedMip = 0; // finest level requested this frame
+            uint64_t                      lastNeededFrame = 0;
+
+            bool                          pending = false;
+            uint32_t                      pendingMip = 0;
+            uint64_t                      pendingBatch = 0;
+            VkcTexture::ImageAllocation   pendingImage;
+
+            uint32_t targetMip() const { return pending ? pendingMip : texture->residentMip; }
+        };
+
+        struct Retired {
+            VkcTexture::ImageAllocation image;
+            uint64_t                    frame = 0;
+        };
+
+        void completeUploads();
+        void destroyRetired(bool all);
+        void schedule(Entry& entry, uint32_t mip);
+        Entry* pickVictim(const Entry& requester);
+
+        VkcDevice&  _device;
+        Settings    _settings;
+
+        std::vector<Entry>                             _entries;
+        std::unordered_map<const VkcTexture*, size_t>  _lookup;
+        std::deque<Retired>                            _retired;
+
+        uint64_t     _frame = 1;
+        VkDeviceSize _projectedBytes = 0;   // sum of every entry's target image
+        Stats        _stats;
+    };
+
+} // namespace vkc
@@ -1,5 +1,8 @@
 #include "vk_game.h"
 
+// STD
+#include <cstdlib>
+
 namespace vkc
 {
 	Game::Game(VkcDevice& device, AssetManager& assetManager, Renderer& renderer)
@@ -9,7 +12,9 @@ namespace vkc
 
 	void Game::Init(GLFWwindow* window)
 	{
-		_scene.loadSceneData("defaultScene");
+		// VKC_SCENE picks another scene under res/scenes, e.g. stressScene
+		const char* sceneName = std::getenv("VKC_SCENE");
+		_scene.loadSceneData(sceneName && *sceneName ? sceneName : "defaultScene");
 
 		_player = std::make_shared<Player>(window);
 		_player->Init();
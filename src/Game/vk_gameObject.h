@@ -63,6 +63,8 @@ namespace vkc
 		bool isSkybox{ false };
 		bool isOBJ{ false };
 		bool isglTF{ false };
+		// Level of detail drawn last frame, see VkcLodSelector
+		uint32_t lodLevel{ 0 };
 
 		std::unique_ptr<PointLightComponent> pointLight = nullptr;
 	private:
@@ -6,6 +6,7 @@
 #include "Renderer/RendererSystems/vk_basicRenderSystem.h"
 #include "Renderer/RendererSystems/vk_pointLightSystem.h"
 #include "Game/Camera/vk_camera.h"
+#include "Renderer/vk_commandRecorder.h"
 
 // External
 #include <glm/gtc/matrix_transform.hpp>
@@ -13,6 +14,10 @@
 
 
 // STD
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 
@@ -24,88 +29,228 @@ namespace vkc {
         : device(device), assetManager(assetManager) {
     }
 
+    namespace {
+        // Object description with the fields that can change without a rebuild removed
+        json withoutTransform(json objJson)
+        {
+            objJson.erase("position");
+            objJson.erase("rotation");
+            objJson.erase("scale");
+            return objJson;
+        }
+
+        json readSceneFile(const std::string& path)
+        {
+            std::ifstream inFile(path);
+            if (!inFile.is_open()) {
+                throw std::runtime_error("Could not open scene file: " + path);
+            }
+            json sceneJson;
+            inFile >> sceneJson;
+            return sceneJson;
+        }
+    }
+
     void Scene::loadSceneData(const std::string& sceneFile)
     {
-        std::string path = std::string(PROJECT_ROOT_DIR) + "/res/scenes/" + sceneFile + ".json";
-        std::ifstream inFile(path);
-        if (!inFile.is_open()) {
-            throw std::runtime_error("Could not open scene file: " + path);
+        const std::string scenesDir = std::string(PROJECT_ROOT_DIR) + "/res/scenes/";
+        std::string path = scenesDir + sceneFile + ".json";
+
+        // Scenes shipped only in binary form, as written by SceneExporter
+        if (!std::filesystem::exists(path)) {
+            const std::string binaryPath = scenesDir + sceneFile + ".vkscene";
+            if (!loadBinaryScene(binaryPath, "")) {
+                throw std::runtime_error("Could not open scene file: " + path);
+            }
+            scenePath = std::filesystem::path(binaryPath).lexically_normal().generic_string();
+            return;
         }
 
-        json sceneJson;
-        inFile >> sceneJson;
+        scenePath = std::filesystem::path(path).lexically_normal().generic_string();
+
+        // The JSON compiled on an earlier run, while it is newer than the JSON
+        const std::string cachePath = std::string(PROJECT_ROOT_DIR) + "/res/cache/scenes/" + sceneFile + ".vkscene";
+        if (loadBinaryScene(cachePath, path)) {
+            return;
+        }
+
+        json sceneJson = readSceneFile(path);
         std::cout << "Loading scene: " << sceneFile << " (" << path << ")\n";
+        applySceneJson(sceneJson, false);
+
+        std::string error;
+        if (!writeBinaryScene(cachePath, sceneDataFromJson(sceneJson), path, error)) {
+            std::cerr << "Scene: binary cache not written: " << error << "\n";
+        }
+    }
+
+    void Scene::reloadSceneData()
+    {
+        if (scenePath.empty())
+            return;
 
-        // Parse game objects
-        for (auto& objJson : sceneJson["objects"]) {
-            // Special handling for spinning point lights
-            if (objJson.value("special", "") == "lights") {
-                int count = objJson.value("count", 1);
-                float radius = objJson.value("radius", 4.8f);
-                float height = objJson.value("height", -2.5f);
-                float intensity = objJson.value("intensity", 15.8f);
-                auto colorsJson = objJson["colors"];
-
-                glm::vec3 basePosition = glm::normalize(glm::vec3(-1.f, 0.f, -1.f)) * radius;
-                for (int i = 0; i < count; i++) {
-                    auto pointLight = VkcGameObject::makePointLight(intensity);
-                    auto c = colorsJson[i % colorsJson.size()];
-                    pointLight.color = { c[0].get<float>(), c[1].get<float>(), c[2].get<float>() };
-
-                    float angle = (i * glm::two_pi<float>()) / count;
-                    glm::mat4 rot = glm::rotate(glm::mat4(1.f), angle, glm::vec3(0.f, -1.f, 0.f));
-                    glm::vec3 pos = glm::vec3(rot * glm::vec4(basePosition, 1.f));
-                    pos.y = height;
-                    pointLight.transform.translation = pos;
-
-                    gameObjects.emplace(pointLight.getId(), std::move(pointLight));
+        try {
+            if (std::filesystem::path(scenePath).extension() == ".vkscene") {
+                // No per-object diff for binary scenes: swap the whole set
+                BinaryScene check;
+                if (!check.open(scenePath)) {
+                    throw std::runtime_error("invalid binary scene " + scenePath);
                 }
-                continue;
+                clearBulkObjects();
+                loadBinaryScene(scenePath, "");
+            }
+            else {
+                json sceneJson = readSceneFile(scenePath);
+                // Objects loaded from the binary cache have no JSON entries to diff against
+                clearBulkObjects();
+                applySceneJson(sceneJson, true);
             }
+            std::cout << "Reloaded scene: " << scenePath << "\n";
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Scene reload failed, keeping the current scene: " << e.what() << "\n";
+        }
+    }
 
-            // Game object
-            auto go = VkcGameObject::createGameObject();
+    void Scene::applySceneJson(const json& sceneJson, bool keepOnError)
+    {
+        std::unordered_map<std::string, SceneEntry> entries;
+        const auto& objects = sceneJson.at("objects");
 
-            // Model
-            if (auto it = objJson.find("model"); it != objJson.end()) {
-                go.model = assetManager.getModel(it->get<std::string>());
+        for (size_t i = 0; i < objects.size(); ++i) {
+            const auto& objJson = objects[i];
+            std::string key = objJson.value("name", "#" + std::to_string(i));
+            if (entries.count(key)) {
+                key += "#" + std::to_string(i);
+            }
 
-                if (std::dynamic_pointer_cast<VkcOBJmodel>(go.model)) {
-                    go.isOBJ = true;
+            auto old = sceneEntries.find(key);
+            SceneEntry entry{ objJson, {} };
+            try {
+                if (old == sceneEntries.end()) {
+                    entry.objectIds = createObjects(objJson);
+                }
+                else if (old->second.desc == objJson) {
+                    entry.objectIds = old->second.objectIds;
                 }
-				if (std::dynamic_pointer_cast<vkglTF::Model>(go.model)) {
-					go.isglTF = true;
-				}   
-            }
-         
-            // Transform
-            auto pos = objJson.value("position", std::vector<float>{0.f, 0.f, 0.f});
-            auto rot = objJson.value("rotation", std::vector<float>{0.f, 0.f, 0.f});
-            auto scl = objJson.value("scale", std::vector<float>{1.f, 1.f, 1.f});
-            go.transform.translation = { pos[0], pos[1], pos[2] };
-            go.transform.rotation = { rot[0], rot[1], rot[2] };
-            go.transform.scale = { scl[0], scl[1], scl[2] };
-
-            // Skybox
-            go.isSkybox = objJson.value("isSkybox", false);
-
-            // Name-based texture lookup (handles all model types)
-            if (auto texIt = objJson.find("textureName"); texIt != objJson.end()) {
-                std::string name = texIt->get<std::string>();
-                if (assetManager.hasTexture(name)) {
-                    go.texture = assetManager.getTexture(name);
-                    go.textureIndex = static_cast<int>(assetManager.getTextureIndex(name));
+                else if (!objJson.contains("special") &&
+                    withoutTransform(old->second.desc) == withoutTransform(objJson)) {
+                    entry.objectIds = old->second.objectIds;
+                    for (uint32_t id : entry.objectIds) {
+                        if (auto* go = getGameObject(id)) {
+                            applyTransform(*go, objJson);
+                        }
+                    }
                 }
                 else {
-                    throw std::runtime_error("Texture '" + name + "' not found for object: " + objJson.value("name", "<unnamed>"));
+                    // Build the replacement first so a failure leaves the old objects in place
+                    entry.objectIds = createObjects(objJson);
+                    removeObjects(old->second.objectIds);
+                }
+            }
+            catch (const std::exception& e) {
+                if (!keepOnError)
+                    throw;
+                std::cerr << "Scene: object '" << key << "' not updated: " << e.what() << "\n";
+                if (old == sceneEntries.end())
+                    continue;
+                entry = old->second;
+            }
+
+            if (old != sceneEntries.end()) {
+                sceneEntries.erase(old);
+            }
+            entries[key] = std::move(entry);
+        }
+
+        // Whatever is left was removed from the file
+        for (const auto& [key, stale] : sceneEntries) {
+            removeObjects(stale.objectIds);
+        }
+        sceneEntries = std::move(entries);
+        markObjectsChanged();
+    }
+
+    std::vector<uint32_t> Scene::createObjects(const json& objJson)
+    {
+        SceneData data;
+        appendSceneRecords(objJson, data);
+        try {
+            return instantiateRecords(data.assetNames, data.objects.data(), data.objects.size());
+        }
+        catch (const std::exception& e) {
+            throw std::runtime_error(std::string(e.what()) + " (object: " + objJson.value("name", "<unnamed>") + ")");
+        }
+    }
+
+    std::vector<uint32_t> Scene::instantiateRecords(
+        const std::vector<std::string>& assetNames, const SceneRecord* records, size_t count)
+    {
+        // Every referenced asset is looked up once, not once per object
+        struct ResolvedAsset {
+            std::shared_ptr<IModel>     model;
+            std::shared_ptr<VkcTexture> texture;
+            int                         textureIndex = -1;
+        };
+        std::vector<ResolvedAsset> resolved(assetNames.size());
+
+        for (size_t i = 0; i < count; ++i) {
+            const SceneRecord& record = records[i];
+            if (record.model != SceneRecord::kNoAsset) {
+                if (record.model >= assetNames.size())
+                    throw std::runtime_error("Scene: model index out of range");
+                auto& asset = resolved[record.model];
+                if (!asset.model) {
+                    assetManager.waitForAsset(assetNames[record.model]);
+                    asset.model = assetManager.getModel(assetNames[record.model]);
                 }
             }
+            if (record.texture != SceneRecord::kNoAsset) {
+                if (record.texture >= assetNames.size())
+                    throw std::runtime_error("Scene: texture index out of range");
+                auto& asset = resolved[record.texture];
+                if (!asset.texture) {
+                    const std::string& name = assetNames[record.texture];
+                    assetManager.waitForAsset(name);
+                    if (!assetManager.hasTexture(name))
+                        throw std::runtime_error("Texture '" + name + "' not found");
+                    asset.texture = assetManager.getTexture(name);
+                    asset.textureIndex = static_cast<int>(assetManager.getTextureIndex(name));
+                }
+            }
+        }
+
+        // Bulk insert
+        std::vector<uint32_t> ids;
+        ids.reserve(count);
+        gameObjects.reserve(gameObjects.size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            const SceneRecord& record = records[i];
+            const glm::vec3 color{ record.color[0], record.color[1], record.color[2] };
+            auto go = (record.flags & SceneRecord::PointLight)
+                ? VkcGameObject::makePointLight(record.lightIntensity, record.scale[0], color)
+                : VkcGameObject::createGameObject();
+
+            go.transform.translation = { record.translation[0], record.translation[1], record.translation[2] };
+            go.transform.rotation = { record.rotation[0], record.rotation[1], record.rotation[2] };
+            go.transform.scale = { record.scale[0], record.scale[1], record.scale[2] };
+            go.isSkybox = (record.flags & SceneRecord::Skybox) != 0;
+
+            if (record.model != SceneRecord::kNoAsset) {
+                go.model = resolved[record.model].model;
+                go.isOBJ = std::dynamic_pointer_cast<VkcOBJmodel>(go.model) != nullptr;
+                go.isglTF = std::dynamic_pointer_cast<vkglTF::Model>(go.model) != nullptr;
+            }
+            if (record.texture != SceneRecord::kNoAsset) {
+                go.texture = resolved[record.texture].texture;
+                go.textureIndex = resolved[record.texture].textureIndex;
+            }
             else {
                 go.texture = nullptr;
                 go.textureIndex = -1;
             }
 
-            // Insert into scene
+            ids.push_back(go.getId());
             if (go.isSkybox) {
                 setSkyboxObject(std::move(go));
             }
@@ -113,6 +258,134 @@ namespace vkc {
                 gameObjects.emplace(go.getId(), std::move(go));
             }
         }
+        markObjectsChanged();
+        return ids;
+    }
+
+    bool Scene::loadBinaryScene(const std::string& path, const std::string& sourcePath)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        BinaryScene binary;
+        if (!binary.open(path, sourcePath))
+            return false;
+
+        std::vector<std::string> assetNames;
+        assetNames.reserve(binary.assetCount());
+        for (uint32_t i = 0; i < binary.assetCount(); ++i) {
+            assetNames.emplace_back(binary.assetName(i));
+        }
+
+        auto ids = instantiateRecords(assetNames, binary.objects(), binary.objectCount());
+        bulkObjectIds.insert(bulkObjectIds.end(), ids.begin(), ids.end());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            const SceneRecord& record = binary.objects()[i];
+            if (record.model != SceneRecord::kNoAsset)
+                bulkModelUsers[assetNames[record.model]].push_back(ids[i]);
+            if (record.texture != SceneRecord::kNoAsset)
+                bulkTextureUsers[assetNames[record.texture]].push_back(ids[i]);
+        }
+
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << "Loaded binary scene: " << path << " (" << binary.objectCount() << " objects, "
+            << static_cast<int>(ms) << " ms)\n";
+        return true;
+    }
+
+    void Scene::removeObjects(const std::vector<uint32_t>& ids)
+    {
+        for (uint32_t id : ids) {
+            if (skyboxId && *skyboxId == id) {
+                skyboxId.reset();
+            }
+            gameObjects.erase(id);
+        }
+        markObjectsChanged();
+    }
+
+    void Scene::clearBulkObjects()
+    {
+        removeObjects(bulkObjectIds);
+        bulkObjectIds.clear();
+        bulkModelUsers.clear();
+        bulkTextureUsers.clear();
+    }
+
+    void Scene::assignModel(VkcGameObject& go, const std::string& modelName)
+    {
+        assetManager.waitForAsset(modelName);
+        go.model = assetManager.getModel(modelName);
+        go.isOBJ = std::dynamic_pointer_cast<VkcOBJmodel>(go.model) != nullptr;
+        go.isglTF = std::dynamic_pointer_cast<vkglTF::Model>(go.model) != nullptr;
+    }
+
+    void Scene::applyTransform(VkcGameObject& go, const json& objJson)
+    {
+        auto pos = objJson.value("position", std::vector<float>{0.f, 0.f, 0.f});
+        auto rot = objJson.value("rotation", std::vector<float>{0.f, 0.f, 0.f});
+        auto scl = objJson.value("scale", std::vector<float>{1.f, 1.f, 1.f});
+        go.transform.translation = { pos[0], pos[1], pos[2] };
+        go.transform.rotation = { rot[0], rot[1], rot[2] };
+        go.transform.scale = { scl[0], scl[1], scl[2] };
+    }
+
+    void Scene::onAssetsReloaded(const std::vector<std::string>& assetNames)
+    {
+        if (assetNames.empty())
+            return;
+        markObjectsChanged();
+
+        auto reloaded = [&](const json& desc, const char* field) -> std::string {
+            auto it = desc.find(field);
+            if (it == desc.end() || !it->is_string())
+                return {};
+            std::string name = it->get<std::string>();
+            return std::find(assetNames.begin(), assetNames.end(), name) != assetNames.end() ? name : std::string();
+        };
+
+        for (const auto& [key, entry] : sceneEntries) {
+            const std::string modelName = reloaded(entry.desc, "model");
+            const std::string textureName = reloaded(entry.desc, "textureName");
+            if (modelName.empty() && textureName.empty())
+                continue;
+
+            for (uint32_t id : entry.objectIds) {
+                auto* go = getGameObject(id);
+                if (!go)
+                    continue;
+                if (!modelName.empty()) {
+                    assignModel(*go, modelName);
+                }
+                if (!textureName.empty()) {
+                    // Same bindless index, only the texture object changed
+                    go->texture = assetManager.getTexture(textureName);
+                }
+            }
+        }
+
+        // Objects from a binary scene
+        for (const auto& name : assetNames) {
+            if (auto users = bulkModelUsers.find(name); users != bulkModelUsers.end()) {
+                auto model = assetManager.getModel(name);
+                const bool isOBJ = std::dynamic_pointer_cast<VkcOBJmodel>(model) != nullptr;
+                const bool isglTF = std::dynamic_pointer_cast<vkglTF::Model>(model) != nullptr;
+                for (uint32_t id : users->second) {
+                    if (auto* go = getGameObject(id)) {
+                        go->model = model;
+                        go->isOBJ = isOBJ;
+                        go->isglTF = isglTF;
+                    }
+                }
+            }
+            if (auto users = bulkTextureUsers.find(name); users != bulkTextureUsers.end()) {
+                auto texture = assetManager.getTexture(name);
+                for (uint32_t id : users->second) {
+                    if (auto* go = getGameObject(id)) {
+                        go->texture = texture;
+                    }
+                }
+            }
+        }
     }
 
 
@@ -125,22 +398,97 @@ namespace vkc {
         }
     }
      
+    void Scene::requestTextureMips(const VkcCamera& camera, float viewportHeight)
+    {
+        TextureStreamer& streamer = assetManager.getTextureStreamer();
+        if (!streamer.isEnabled())
+            return;
+
+        // Pixels covered by one world unit at a distance of one unit
+        const float pixelsPerUnit = 0.5f * viewportHeight * std::abs(camera.getProjection()[1][1]);
+        const glm::vec3 cameraPos = camera.getPosition();
+
+        for (auto& [id, obj] : gameObjects) {
+            if (!obj.texture || !obj.model || obj.isSkybox)
+                continue;
+
+            glm::vec3 center{ 0.f };
+            float radius = 1.f;
+            float worldUnitsPerUV = 2.f;
+            if (auto objModel = std::dynamic_pointer_cast<VkcOBJmodel>(obj.model)) {
+                center = objModel->getBoundingCenter();
+                radius = objModel->getBoundingRadius();
+                worldUnitsPerUV = objModel->getWorldUnitsPerUV();
+            }
+
+            const glm::vec3 absScale = glm::abs(obj.transform.scale);
+            const float scale = glm::max(glm::max(absScale.x, absScale.y), absScale.z);
+            const glm::vec3 worldCenter = glm::vec3(obj.transform.mat4() * glm::vec4(center, 1.f));
+            // Nearest point of the bounding sphere decides the finest level needed
+            const float distance = glm::max(glm::length(worldCenter - cameraPos) - radius * scale, 0.1f);
+
+            streamer.request(*obj.texture, pixelsPerUnit / distance * worldUnitsPerUV * scale);
+        }
+    }
+
     void Scene::render(FrameInfo& frameInfo) 
     {
-        // Render scene
-        for (auto& renderSystem : renderSystems) {
-            renderSystem->render(frameInfo);
+        VkcCommandRecorder* recorder = frameInfo.commandRecorder;
+        const bool parallel = recorder && recorder->isRecordingPass();
+
+        // Every system's CPU work first, on this thread; recording only reads its results
+        chunkCounts.resize(renderSystems.size());
+        for (size_t i = 0; i < renderSystems.size(); i++) {
+            chunkCounts[i] = renderSystems[i]->prepare(frameInfo, parallel ? recorder->getLaneCount() : 1);
+        }
+
+        if (!parallel) {
+            for (size_t i = 0; i < renderSystems.size(); i++) {
+                for (uint32_t chunk = 0; chunk < chunkCounts[i]; chunk++) {
+                    renderSystems[i]->renderChunk(frameInfo, chunk, chunkCounts[i]);
+                }
+            }
+            return;
+        }
+
+        // One secondary command buffer per chunk, executed in this order when the pass ends
+        for (size_t i = 0; i < renderSystems.size(); i++) {
+            VkcRenderSystem* renderSystem = renderSystems[i].get();
+            const uint32_t chunkCount = chunkCounts[i];
+            for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+                recorder->record([frameInfo, renderSystem, chunk, chunkCount](VkCommandBuffer commandBuffer) mutable {
+                    frameInfo.commandBuffer = commandBuffer;
+                    renderSystem->renderChunk(frameInfo, chunk, chunkCount);
+                });
+            }
+        }
+    }
+
+    void Scene::printRenderSystemStats() const
+    {
+        for (const auto& renderSystem : renderSystems) {
+            renderSystem->printStats();
+        }
     }
+
+    void Scene::setInstancingEnabled(bool enabled)
+    {
+        instancingEnabled = enabled;
+        for (auto& renderSystem : renderSystems) {
+            renderSystem->setInstancingEnabled(enabled);
+        }
     }
 
     void Scene::addRenderSystem(std::unique_ptr<VkcRenderSystem> renderSystem) 
     {
+        renderSystem->setInstancingEnabled(instancingEnabled);
         renderSystems.push_back(std::move(renderSystem));
     }
 
     void Scene::setSkyboxObject(VkcGameObject obj) {
         skyboxId = obj.getId();
         gameObjects.emplace(obj.getId(), std::move(obj));
+        markObjectsChanged();
     }
 
     std::optional<std::reference_wrapper<VkcGameObject>> Scene::getSkyboxObject() {
@@ -155,11 +503,13 @@ namespace vkc {
     void Scene::addGameObject(uint32_t id, VkcGameObject obj) 
     {
         gameObjects[id] = std::move(obj);
+        markObjectsChanged();
     }
 
     void Scene::removeGameObject(uint32_t id) 
     {
         gameObjects.erase(id);
+        markObjectsChanged();
     }
 
     void Scene::addPlayer(std::shared_ptr<Player> p)
@@ -11,8 +11,16 @@
 #include "Game/vk_player.h"
 #include "VK_abstraction/vk_obj_model.h"
 #include "VK_abstraction/vk_glTFModel.h"
+#include "Utils/vkc_sceneBinary.h"
 
+// External
+#include <json.hpp>
+
+// STD
 #include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace vkc {
 	class Scene {
@@ -20,9 +28,29 @@ namespace vkc {
 	public:
 		Scene(VkcDevice& device, AssetManager& assetManager);
 		void addRenderSystem(std::unique_ptr<VkcRenderSystem> renderSystem);
+		// Loads res/scenes/<sceneFile>.json, through its compiled copy under
+		// res/cache/scenes when that is current, or res/scenes/<sceneFile>.vkscene
+		// when there is no JSON
 		void loadSceneData(const std::string& sceneFile);
+		// Re-reads the loaded scene file and applies it as a diff: objects whose
+		// description is unchanged are kept, transform-only edits move objects in
+		// place, and only added, removed or otherwise edited objects are rebuilt.
+		// Errors are logged and leave the affected objects as they were.
+		void reloadSceneData();
+		// Re-fetches the model/texture of objects that use any of the given assets
+		void onAssetsReloaded(const std::vector<std::string>& assetNames);
+		const std::string& getScenePath() const { return scenePath; }
+		// Prepares every render system, then records them inline or, while
+		// frameInfo.commandRecorder records the pass, as secondary command buffers
 		void render(FrameInfo& frameInfo);
 		void update(FrameInfo& frameInfo, GlobalUbo& ubo, float deltaTime);
+		// Each render system's counters from the last frame
+		void printRenderSystemStats() const;
+		// Instanced drawing of objects that share a model, in every render system
+		void setInstancingEnabled(bool enabled);
+		bool isInstancingEnabled() const { return instancingEnabled; }
+		// Reports the on-screen texel density of every textured object to the texture streamer
+		void requestTextureMips(const VkcCamera& camera, float viewportHeight);
 		
 		// Getters
 		std::unordered_map<uint32_t, VkcGameObject>& getGameObjects() { return gameObjects; }
@@ -32,6 +60,12 @@ namespace vkc {
 			return (it != gameObjects.end()) ? &it->second : nullptr;
 		}
 
+		// Bumped whenever objects are added or removed, or their model, texture or
+		// transform is changed by the scene. Code that moves or edits objects directly
+		// calls markObjectsChanged(), so caches of the object list see the change.
+		uint64_t getObjectsVersion() const { return objectsVersion; }
+		void markObjectsChanged() { objectsVersion++; }
+
 		// Misc
 		void addGameObject(uint32_t id, VkcGameObject obj);
 		void removeGameObject(uint32_t id);
@@ -43,11 +77,39 @@ namespace vkc {
 		VkcCamera activeCamera;
 		AssetManager& assetManager;
 		std::vector<std::unique_ptr<VkcRenderSystem>> renderSystems;
+		std::vector<uint32_t> chunkCounts;		// per render system, this frame
 		std::unordered_map <uint32_t, VkcGameObject> gameObjects;
 		std::optional<uint32_t> skyboxId;
+		uint64_t objectsVersion = 0;
+		bool instancingEnabled = true;
 
 		std::shared_ptr<Player> player;
 
+		// Scene file description of each object, keyed by its "name" (or "#<index>"),
+		// with the game objects created from it
+		struct SceneEntry {
+			nlohmann::json        desc;
+			std::vector<uint32_t> objectIds;
+		};
+		std::string scenePath;
+		std::unordered_map<std::string, SceneEntry> sceneEntries;
+
+		void applySceneJson(const nlohmann::json& sceneJson, bool keepOnError);
+		// Objects created from the binary form, which has no per-object entries,
+		// and which of them use each model/texture
+		std::vector<uint32_t> bulkObjectIds;
+		std::unordered_map<std::string, std::vector<uint32_t>> bulkModelUsers;
+		std::unordered_map<std::string, std::vector<uint32_t>> bulkTextureUsers;
+		void clearBulkObjects();
+
+		std::vector<uint32_t> createObjects(const nlohmann::json& objJson);
+		std::vector<uint32_t> instantiateRecords(
+			const std::vector<std::string>& assetNames, const SceneRecord* records, size_t count);
+		bool loadBinaryScene(const std::string& path, const std::string& sourcePath);
+		void removeObjects(const std::vector<uint32_t>& ids);
+		void assignModel(VkcGameObject& go, const std::string& modelName);
+		static void applyTransform(VkcGameObject& go, const nlohmann::json& objJson);
+
 	
 	};
 }
\ No newline at end of file
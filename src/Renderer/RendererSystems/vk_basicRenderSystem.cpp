@@ -1,5 +1,10 @@
 // vk_basicRenderSystem.cpp
 #include "vk_basicRenderSystem.h"
+#include "VK_abstraction/vk_frameAllocator.h"
+#include "VK_abstraction/vk_geometryArena.h"
+#include "VK_abstraction/vk_obj_model.h"
+#include "VK_abstraction/vk_swapchain.h"
+#include "Renderer/vk_lodSelector.h"
 
 // External
 #define GLM_FORCE_RADIANS	
@@ -8,8 +13,12 @@
 #include <glm/gtc/constants.hpp>
 
 // STD
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
 #include <string>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <stdexcept>
 
@@ -22,9 +31,19 @@ namespace vkc
 		int textureIndex;
 	};
 
-	SimpleRenderSystem::SimpleRenderSystem(VkcDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout textureSetLayout)
-		: vkcDevice{ device }, globalSetLayout{ globalSetLayout }, textureSetLayout{ textureSetLayout }
+	// std430 Instance of vert_instanced.vert and vert_packed_instanced.vert
+	struct InstanceData {
+		glm::mat4 modelMatrix{ 1.f };
+		glm::mat4 normalMatrix{ 1.f };
+		int32_t   textureIndex = -1;
+		uint32_t  _pad0 = 0, _pad1 = 0, _pad2 = 0;
+	};
+
+	SimpleRenderSystem::SimpleRenderSystem(VkcDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+		VkDescriptorSetLayout textureSetLayout, VkcGpuScene* gpuScene)
+		: vkcDevice{ device }, globalSetLayout{ globalSetLayout }, textureSetLayout{ textureSetLayout }, gpuScene{ gpuScene }
 	{
+		instanceSet = std::make_unique<VkcFrameAllocatorSet>(vkcDevice, VkcSwapChain::MAX_FRAMES_IN_FLIGHT, VK_SHADER_STAGE_VERTEX_BIT);
 		createPipelineLayout(globalSetLayout, textureSetLayout);
 		createPipeline(renderPass);
 
@@ -33,18 +52,62 @@ namespace vkc
 	SimpleRenderSystem::~SimpleRenderSystem()
 	{
 		vkDestroyPipelineLayout(vkcDevice.device(), pipelineLayout, nullptr);
+		vkDestroyPipelineLayout(vkcDevice.device(), instancedPipelineLayout, nullptr);
 	}
 
+	void SimpleRenderSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo)
+	{
+		culledThisFrame = indirectPipeline && gpuScene && gpuScene->settings.enabled && frameInfo.scene;
+		if (culledThisFrame) {
+			gpuScene->cull(frameInfo.commandBuffer, frameInfo.frameIndex, *frameInfo.scene, frameInfo.camera, frameInfo.lodSelector);
+		}
+	}
+
+	uint32_t SimpleRenderSystem::prepare(FrameInfo& frameInfo, uint32_t maxChunks)
+	{
+		drawStats = DrawStats{};
+		frameInstanceSet = instancedPipeline
+			? instanceSet->get(frameInfo.frameAllocator, static_cast<uint32_t>(frameInfo.frameIndex))
+			: VK_NULL_HANDLE;
+
+		// glTF objects are drawn, and have their level picked, by glTFRenderSystem
+		candidates.clear();
+		if (culledThisFrame) {
+			// Models the GPU scene can't draw, e.g. non-indexed ones
+			for (VkcGameObject::id_t id : gpuScene->getFallbackObjects()) {
+				auto it = frameInfo.gameObjects.find(id);
+				if (it != frameInfo.gameObjects.end() && it->second.model && it->second.isOBJ && !it->second.isSkybox) {
+					candidates.push_back(&it->second);
+				}
+			}
+		}
+		else {
+			for (auto& kv : frameInfo.gameObjects) {
+				if (kv.second.model && kv.second.isOBJ && !kv.second.isSkybox) {
+					candidates.push_back(&kv.second);
+				}
+			}
+		}
+		prepareCulled(frameInfo);
 
+		// Chunks record in parallel, but each starts by binding its own state
+		const uint32_t chunks = static_cast<uint32_t>(draws.size() / kMinDrawsPerChunk);
+		return std::clamp(chunks, 1u, std::max(maxChunks, 1u));
+	}
 
 	void SimpleRenderSystem::render(FrameInfo& frameInfo)
 	{
+		renderChunk(frameInfo, 0, 1);
+	}
 
+	void SimpleRenderSystem::renderChunk(FrameInfo& frameInfo, uint32_t chunk, uint32_t chunkCount)
+	{
 		vkcPipeline->bind(frameInfo.commandBuffer);
 
-		std::array<VkDescriptorSet, 2> descriptorSets = {
+		std::array<VkDescriptorSet, 3> descriptorSets = {
 		frameInfo.globalDescriptorSet,
-		frameInfo.textureDescriptorSet
+		frameInfo.textureDescriptorSet,
+		culledThisFrame ? gpuScene->getDescriptorSet(frameInfo.frameIndex) : VK_NULL_HANDLE
 		};
 
 		vkCmdBindDescriptorSets(
@@ -52,39 +115,220 @@ namespace vkc
 			VK_PIPELINE_BIND_POINT_GRAPHICS,
 			pipelineLayout,
 			0,
-			static_cast<uint32_t>(descriptorSets.size()),
+			culledThisFrame ? 3u : 2u,
 			descriptorSets.data(),
 			0,
 			nullptr
 		);
 
-		for (auto& kv : frameInfo.gameObjects) {
-		
-			auto& obj = kv.second;
-
-			SimplePushConstantData push{};
-			push.modelMatrix = obj.transform.mat4();
-			push.normalMatrix = obj.transform.normalMatrix();
-			push.textureIndex = obj.textureIndex;
-
-			vkCmdPushConstants(
-				frameInfo.commandBuffer,
-				pipelineLayout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-				0,
-				sizeof(SimplePushConstantData),
-				&push);
-			if (obj.model) {
-				if (obj.isSkybox) continue;
-				obj.model->bind(frameInfo.commandBuffer);
-				obj.model->draw(frameInfo.commandBuffer);
+		// Every model lives in the shared geometry arena
+		vkcDevice.geometryArena().bind(frameInfo.commandBuffer);
+
+		const VkcPipeline* boundPipeline = vkcPipeline.get();
+		if (culledThisFrame && chunk == 0) {
+			renderIndirect(frameInfo, boundPipeline);
+		}
+
+		const size_t first = draws.size() * chunk / chunkCount;
+		const size_t last = draws.size() * (chunk + 1) / chunkCount;
+		bool instanceSetBound = false;
+		for (size_t i = first; i < last; i++) {
+			recordDraw(frameInfo, draws[i], boundPipeline, instanceSetBound);
+		}
+	}
+
+	void SimpleRenderSystem::renderIndirect(FrameInfo& frameInfo, const VkcPipeline*& boundPipeline) const
+	{
+		// One draw per bucket, whatever the number of objects
+		indirectPipeline->bind(frameInfo.commandBuffer);
+		boundPipeline = indirectPipeline.get();
+		gpuScene->drawBucket(frameInfo.commandBuffer, frameInfo.frameIndex, VkcGpuScene::Unpacked32);
+		gpuScene->drawBucket(frameInfo.commandBuffer, frameInfo.frameIndex, VkcGpuScene::Unpacked16);
+
+		const bool hasPacked = gpuScene->getBucketCapacity(VkcGpuScene::Packed32) > 0 ||
+			gpuScene->getBucketCapacity(VkcGpuScene::Packed16) > 0;
+		if (!hasPacked)
+			return;
+		if (!packedIndirectPipeline) {
+			static std::atomic<bool> warned{ false };
+			if (!warned.exchange(true)) {
+				std::cerr << "SimpleRenderSystem: vert_packed_indirect.vert.spv missing, skipping models with packed vertices\n";
 			}
+			return;
+		}
+		packedIndirectPipeline->bind(frameInfo.commandBuffer);
+		boundPipeline = packedIndirectPipeline.get();
+		gpuScene->drawBucket(frameInfo.commandBuffer, frameInfo.frameIndex, VkcGpuScene::Packed32);
+		gpuScene->drawBucket(frameInfo.commandBuffer, frameInfo.frameIndex, VkcGpuScene::Packed16);
+	}
 
+	void SimpleRenderSystem::prepareCulled(FrameInfo& frameInfo)
+	{
+		// One batch for every candidate, before any of them is recorded
+		frustumCuller.begin(Frustum::fromViewProjection(frameInfo.camera.getProjection() * frameInfo.camera.getView()));
+		for (VkcGameObject* obj : candidates) {
+			frustumCuller.add(transformSphere(obj->transform.mat4(), obj->model->getBoundingSphere()));
+		}
+		frustumCuller.run();
+
+		drawItems.clear();
+		for (uint32_t i = 0; i < frustumCuller.size(); i++) {
+			if (!frustumCuller.isVisible(i)) continue;
+			VkcGameObject& obj = *candidates[i];
+			DrawItem item;
+			item.model = obj.model.get();
+			item.lod = frameInfo.lodSelector.select(*obj.model, obj.transform.mat4(), frameInfo.camera, obj.lodLevel);
+			item.candidate = i;
+			drawItems.push_back(item);
+		}
+
+		draws.clear();
+		if (!instancingEnabled || !instancedPipeline) {
+			for (uint32_t i = 0; i < drawItems.size(); i++) {
+				prepareObject(frameInfo, i);
+			}
+			return;
 		}
 
+		// Objects sharing a model and level become one group, and one draw
+		std::sort(drawItems.begin(), drawItems.end(), [](const DrawItem& a, const DrawItem& b) {
+			return a.model != b.model ? std::less<const IModel*>()(a.model, b.model) : a.lod < b.lod;
+		});
+		for (size_t first = 0; first < drawItems.size();) {
+			size_t last = first + 1;
+			while (last < drawItems.size() && drawItems[last].model == drawItems[first].model && drawItems[last].lod == drawItems[first].lod) {
+				last++;
+			}
+			if (!prepareInstanced(frameInfo, first, last)) {
+				for (size_t i = first; i < last; i++) {
+					prepareObject(frameInfo, static_cast<uint32_t>(i));
+				}
+			}
+			first = last;
+		}
 	}
 
+	bool SimpleRenderSystem::prepareInstanced(FrameInfo& frameInfo, size_t first, size_t last)
+	{
+		const IModel& model = *drawItems[first].model;
+		const uint32_t lod = drawItems[first].lod;
+		Draw draw;
+		if (!model.getIndexedDraw(lod, draw.indexed))
+			return false;
+		const bool packed = model.hasPackedVertices();
+		if (packed && !packedInstancedPipeline)
+			return false;
+
+		// Slices are aligned to the allocator, not to InstanceData, so one spare entry
+		// leaves room to start on the first whole entry inside
+		const uint32_t count = static_cast<uint32_t>(last - first);
+		const VkcFrameAllocator::Allocation slice = frameInfo.frameAllocator.allocate((count + 1) * sizeof(InstanceData));
+		if (!slice.mapped)
+			return false; // frame allocator full this frame; the objects are drawn one by one
+		draw.firstInstance = static_cast<uint32_t>((slice.offset + sizeof(InstanceData) - 1) / sizeof(InstanceData));
+		draw.instances = static_cast<unsigned char*>(slice.mapped) + (draw.firstInstance * sizeof(InstanceData) - slice.offset);
+		draw.instanceCount = count;
+		draw.item = static_cast<uint32_t>(first);
+		draw.pipeline = packed ? packedInstancedPipeline.get() : instancedPipeline.get();
+		draws.push_back(draw);
 
+		for (uint32_t i = 0; i < count; i++) {
+			frameInfo.lodSelector.recordDraw(model, lod);
+		}
+		drawStats.draws++;
+		drawStats.objects += count;
+		return true;
+	}
+
+	void SimpleRenderSystem::prepareObject(FrameInfo& frameInfo, uint32_t item)
+	{
+		// Packed vertices use their own pipeline and fold the position decode into the model matrix
+		const DrawItem& drawItem = drawItems[item];
+		const bool packed = drawItem.model->hasPackedVertices();
+		if (packed && !packedPipeline) {
+			static bool warned = false;
+			if (!warned) {
+				std::cerr << "SimpleRenderSystem: vert_packed.vert.spv missing, skipping models with packed vertices\n";
+				warned = true;
+			}
+			return;
+		}
+
+		Draw draw;
+		draw.item = item;
+		draw.pipeline = packed ? packedPipeline.get() : vkcPipeline.get();
+		draws.push_back(draw);
+
+		frameInfo.lodSelector.recordDraw(*drawItem.model, drawItem.lod);
+		drawStats.draws++;
+		drawStats.objects++;
+	}
+
+	void SimpleRenderSystem::recordDraw(FrameInfo& frameInfo, const Draw& draw, const VkcPipeline*& boundPipeline, bool& instanceSetBound) const
+	{
+		if (draw.pipeline != boundPipeline) {
+			draw.pipeline->bind(frameInfo.commandBuffer);
+			boundPipeline = draw.pipeline;
+		}
+
+		if (draw.instanceCount > 0) {
+			// The group's slice is this draw's alone, so it is filled while recording
+			const IModel& model = *drawItems[draw.item].model;
+			const glm::mat4 positionDecode = model.hasPackedVertices() ? model.getPositionDecode() : glm::mat4(1.f);
+			InstanceData* instances = static_cast<InstanceData*>(draw.instances);
+			for (uint32_t i = 0; i < draw.instanceCount; i++) {
+				const VkcGameObject& obj = *candidates[drawItems[draw.item + i].candidate];
+				InstanceData& instance = instances[i];
+				instance.modelMatrix = obj.transform.mat4() * positionDecode;
+				instance.normalMatrix = obj.transform.normalMatrix();
+				instance.textureIndex = obj.textureIndex;
+			}
+
+			if (!instanceSetBound) {
+				vkCmdBindDescriptorSets(
+					frameInfo.commandBuffer,
+					VK_PIPELINE_BIND_POINT_GRAPHICS,
+					instancedPipelineLayout,
+					2,
+					1,
+					&frameInstanceSet,
+					0,
+					nullptr);
+				instanceSetBound = true;
+			}
+
+			// gl_InstanceIndex starts at firstInstance, so the shader indexes the slice directly
+			vkcDevice.geometryArena().bindIndexType(frameInfo.commandBuffer, draw.indexed.indexType);
+			vkCmdDrawIndexed(frameInfo.commandBuffer, draw.indexed.indexCount, draw.instanceCount,
+				draw.indexed.firstIndex, draw.indexed.vertexOffset, draw.firstInstance);
+			return;
+		}
+
+		// CPU path: one push constant update and draw for the object
+		const DrawItem& item = drawItems[draw.item];
+		const VkcGameObject& obj = *candidates[item.candidate];
+		SimplePushConstantData push{};
+		push.modelMatrix = item.model->hasPackedVertices() ? obj.transform.mat4() * item.model->getPositionDecode() : obj.transform.mat4();
+		push.normalMatrix = obj.transform.normalMatrix();
+		push.textureIndex = obj.textureIndex;
+
+		vkCmdPushConstants(
+			frameInfo.commandBuffer,
+			pipelineLayout,
+			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+			0,
+			sizeof(SimplePushConstantData),
+			&push);
+		obj.model->drawLod(frameInfo.commandBuffer, item.lod);
+	}
+
+	void SimpleRenderSystem::printStats() const
+	{
+		// With the GPU scene drawing, only its fallback objects go through the CPU culler
+		frustumCuller.printStats(culledThisFrame ? "SimpleRenderSystem (fallback objects)" : "SimpleRenderSystem");
+		std::cout << "SimpleRenderSystem: " << drawStats.draws << " draws for " << drawStats.objects
+			<< " objects, instancing " << (instancingEnabled && instancedPipeline ? "on" : "off") << "\n";
+	}
 
 	void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout textureSetLayout) {
 
@@ -93,11 +337,14 @@ namespace vkc
 		pushConstantRange.offset = 0;
 		pushConstantRange.size = sizeof(SimplePushConstantData);
 
-		// Include both descriptor set layouts
+		// Include both descriptor set layouts, and the GPU scene's instances for the indirect pipelines
 		std::vector<VkDescriptorSetLayout> descriptorSetLayouts = {
 			globalSetLayout,
 			textureSetLayout
 		};
+		if (gpuScene) {
+			descriptorSetLayouts.push_back(gpuScene->getDescriptorSetLayout());
+		}
 
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -109,6 +356,15 @@ namespace vkc
 		if (vkCreatePipelineLayout(vkcDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to create pipeline layout");
 		}
+
+		// Same sets 0 and 1 and push constant range, instances at set 2
+		descriptorSetLayouts.resize(2);
+		descriptorSetLayouts.push_back(instanceSet->getLayout());
+		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+		if (vkCreatePipelineLayout(vkcDevice.device(), &pipelineLayoutInfo, nullptr, &instancedPipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create instanced pipeline layout");
+		}
 	}
 	void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) 
 	{
@@ -121,8 +377,8 @@ namespace vkc
 		pipelineConfig.pipelineLayout = pipelineLayout;
 
 		// Construct paths using PROJECT_ROOT_DIR
-		std::string vertShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/Shaders/SpirV/vert.vert.spv";
-		std::string fragShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/Shaders/SpirV/frag.frag.spv";
+		std::string vertShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/vert.vert.spv";
+		std::string fragShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/frag.frag.spv";
 
 		vkcPipeline = std::make_unique<VkcPipeline>(
 			vkcDevice,
@@ -130,5 +386,77 @@ namespace vkc
 			fragShaderPath.c_str(),
 			pipelineConfig
 		);
+
+		// Same fragment stage, packed vertex input
+		std::string packedVertShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/vert_packed.vert.spv";
+		if (std::filesystem::exists(packedVertShaderPath)) {
+			pipelineConfig.bindingDescriptions = VkcOBJmodel::PackedVertex::getBindingDescriptions();
+			pipelineConfig.attributeDescriptions = VkcOBJmodel::PackedVertex::getAttributeDescriptions();
+			packedPipeline = std::make_unique<VkcPipeline>(
+				vkcDevice,
+				packedVertShaderPath.c_str(),
+				fragShaderPath.c_str(),
+				pipelineConfig
+			);
+		}
+
+		// Instance data from the frame allocator, for objects sharing a model
+		std::string instancedVertShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/vert_instanced.vert.spv";
+		if (std::filesystem::exists(instancedVertShaderPath)) {
+			pipelineConfig.pipelineLayout = instancedPipelineLayout;
+			pipelineConfig.bindingDescriptions = VkcOBJmodel::Vertex::getBindingDescriptions();
+			pipelineConfig.attributeDescriptions = VkcOBJmodel::Vertex::getAttributeDescriptions();
+			instancedPipeline = std::make_unique<VkcPipeline>(
+				vkcDevice,
+				instancedVertShaderPath.c_str(),
+				fragShaderPath.c_str(),
+				pipelineConfig
+			);
+
+			std::string packedInstancedVertShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/vert_packed_instanced.vert.spv";
+			if (std::filesystem::exists(packedInstancedVertShaderPath)) {
+				pipelineConfig.bindingDescriptions = VkcOBJmodel::PackedVertex::getBindingDescriptions();
+				pipelineConfig.attributeDescriptions = VkcOBJmodel::PackedVertex::getAttributeDescriptions();
+				packedInstancedPipeline = std::make_unique<VkcPipeline>(
+					vkcDevice,
+					packedInstancedVertShaderPath.c_str(),
+					fragShaderPath.c_str(),
+					pipelineConfig
+				);
+			}
+			pipelineConfig.pipelineLayout = pipelineLayout;
+		}
+		else {
+			std::cout << "SimpleRenderSystem: vert_instanced.vert.spv missing, drawing objects one by one\n";
+		}
+
+		// Instance data from the GPU scene instead of push constants
+		if (!gpuScene)
+			return;
+		std::string indirectVertShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/vert_indirect.vert.spv";
+		if (!std::filesystem::exists(indirectVertShaderPath)) {
+			std::cout << "SimpleRenderSystem: vert_indirect.vert.spv missing, drawing objects on the CPU path\n";
+			return;
+		}
+		pipelineConfig.bindingDescriptions = VkcOBJmodel::Vertex::getBindingDescriptions();
+		pipelineConfig.attributeDescriptions = VkcOBJmodel::Vertex::getAttributeDescriptions();
+		indirectPipeline = std::make_unique<VkcPipeline>(
+			vkcDevice,
+			indirectVertShaderPath.c_str(),
+			fragShaderPath.c_str(),
+			pipelineConfig
+		);
+
+		std::string packedIndirectVertShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/vert_packed_indirect.vert.spv";
+		if (std::filesystem::exists(packedIndirectVertShaderPath)) {
+			pipelineConfig.bindingDescriptions = VkcOBJmodel::PackedVertex::getBindingDescriptions();
+			pipelineConfig.attributeDescriptions = VkcOBJmodel::PackedVertex::getAttributeDescriptions();
+			packedIndirectPipeline = std::make_unique<VkcPipeline>(
+				vkcDevice,
+				packedIndirectVertShaderPath.c_str(),
+				fragShaderPath.c_str(),
+				pipelineConfig
+			);
+		}
 	}
 }// namespace vkc
\ No newline at end of file
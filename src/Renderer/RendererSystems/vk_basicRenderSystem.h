@@ -2,13 +2,17 @@
 #pragma once
 
 // Project headers
+#include "VK_abstraction/vk_descriptors.h"
 #include "VK_abstraction/vk_device.h"
+#include "VK_abstraction/vk_frameAllocatorSet.h"
 #include "VK_abstraction/vk_pipeline.h"
 #include "Game/vk_gameObject.h"
 #include "VK_abstraction/vk_frameInfo.h"
 #include "Game/Camera/vk_camera.h"
 #include "Renderer/RendererSystems/vk_renderSystem.h"
 #include "Renderer/vk_descriptorManager.h"
+#include "Renderer/vk_frustumCuller.h"
+#include "Renderer/vk_gpuScene.h"
 
 // STD
 #include <memory>
@@ -19,17 +23,61 @@
 namespace vkc {
 	class SimpleRenderSystem : public VkcRenderSystem {
 	public:
-		SimpleRenderSystem(VkcDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout textureSetLayout);
+		// gpuScene may be null; objects are then drawn one by one from the CPU
+		SimpleRenderSystem(VkcDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+			VkDescriptorSetLayout textureSetLayout, VkcGpuScene* gpuScene);
 		~SimpleRenderSystem();
 
 		SimpleRenderSystem(const SimpleRenderSystem&) = delete;
 		SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
+		// Records the GPU scene's cull pass, before the render pass begins
+		void update(FrameInfo& frameInfo, GlobalUbo& ubo) override;
+		// Culls, picks levels and groups instances; the draws split into chunks of at least kMinDrawsPerChunk
+		uint32_t prepare(FrameInfo& frameInfo, uint32_t maxChunks) override;
 		void render(FrameInfo& frameInfo) override;
+		void renderChunk(FrameInfo& frameInfo, uint32_t chunk, uint32_t chunkCount) override;
+		void printStats() const override;
+		void setInstancingEnabled(bool enabled) override { instancingEnabled = enabled; }
 	
 	private:
+		// A visible object of the CPU path, at the level of detail chosen for it
+		struct DrawItem {
+			const IModel* model = nullptr;
+			uint32_t lod = 0;
+			uint32_t candidate = 0;		// into candidates
+		};
+
+		// One draw of the CPU path, decided in prepare() and recorded by renderChunk()
+		struct Draw {
+			VkcPipeline* pipeline = nullptr;
+			uint32_t item = 0;				// into drawItems: the object, or the group's first
+			uint32_t instanceCount = 0;		// 0 for one object drawn with push constants
+			uint32_t firstInstance = 0;
+			void* instances = nullptr;		// the group's InstanceData in the frame allocator
+			IModel::IndexedDraw indexed;
+		};
+
+		struct DrawStats {
+			uint32_t draws = 0;
+			uint32_t objects = 0;
+		};
+
 		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout textureSetLayout);
 		void createPipeline(VkRenderPass renderPass);
+		void renderIndirect(FrameInfo& frameInfo, const VkcPipeline*& boundPipeline) const;
+		// CPU path for everything in candidates that is inside the view frustum
+		void prepareCulled(FrameInfo& frameInfo);
+		// One instanced draw for drawItems [first, last), which share their model and
+		// level. False when the group has to be drawn object by object instead.
+		bool prepareInstanced(FrameInfo& frameInfo, size_t first, size_t last);
+		// One push constant update and draw for the object of drawItems[item]
+		void prepareObject(FrameInfo& frameInfo, uint32_t item);
+		// Only reads the system's state, so chunks may record it on several threads at once
+		void recordDraw(FrameInfo& frameInfo, const Draw& draw, const VkcPipeline*& boundPipeline, bool& instanceSetBound) const;
+
+		// Fewer draws are not worth a secondary command buffer of their own
+		static constexpr size_t kMinDrawsPerChunk = 256;
 
 		VkcDevice& vkcDevice;
 
@@ -40,6 +88,31 @@ namespace vkc {
 	
 
 		std::unique_ptr<VkcPipeline> vkcPipeline;
+		// Models with packed vertices; null when vert_packed.vert.spv has not been compiled
+		std::unique_ptr<VkcPipeline> packedPipeline;
+		// Same, reading the GPU scene's instances; null without it or the *_indirect shaders
+		std::unique_ptr<VkcPipeline> indirectPipeline;
+		std::unique_ptr<VkcPipeline> packedIndirectPipeline;
 		VkPipelineLayout pipelineLayout;
+
+		// Instanced CPU path: objects sharing a model and level are drawn together, reading
+		// their transforms from this frame's allocator buffer at set 2. Sets 0 and 1 and the
+		// push constant range match pipelineLayout, so switching keeps them bound. The
+		// pipelines are null when vert_instanced.vert.spv has not been compiled.
+		VkPipelineLayout instancedPipelineLayout = VK_NULL_HANDLE;
+		std::unique_ptr<VkcFrameAllocatorSet> instanceSet;		// set 2, instance data in the frame allocator
+		std::unique_ptr<VkcPipeline> instancedPipeline;
+		std::unique_ptr<VkcPipeline> packedInstancedPipeline;
+		VkDescriptorSet frameInstanceSet = VK_NULL_HANDLE;		// this frame's instance set
+		bool instancingEnabled = true;
+
+		VkcGpuScene* gpuScene = nullptr;
+		bool culledThisFrame = false;
+
+		VkcFrustumCuller frustumCuller;
+		std::vector<VkcGameObject*> candidates;		// this frame's CPU-path objects
+		std::vector<DrawItem> drawItems;
+		std::vector<Draw> draws;
+		DrawStats drawStats;
 	};
 }// namespace vkc
@@ -1,4 +1,5 @@
 #include "vk_deferredGeomRenderSystem.h"
+#include "VK_abstraction/vk_geometryArena.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <stdexcept>
 
@@ -72,8 +73,8 @@ namespace vkc
 		pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS;
 
 		// Vertex/fragment SPIR-V shaders that output to multiple attachments:
-		//std::string vertShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/Shaders/SpirV/deferredGeom.vert.spv";
-		//std::string fragShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/Shaders/SpirV/deferredGeom.frag.spv";
+		//std::string vertShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/deferredGeom.vert.spv";
+		//std::string fragShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/deferredGeom.frag.spv";
 
 		geometryPipeline = std::make_unique<VkcPipeline>(
 			vkcDevice,
@@ -104,7 +105,10 @@ namespace vkc
 			nullptr
 		);
 
-		// 3) Loop over all game objects (same as your SimpleRenderSystem)
+		// 3) Bind the shared geometry arena once; models only issue draws
+		vkcDevice.geometryArena().bind(frameInfo.commandBuffer);
+
+		// 4) Loop over all game objects (same as your SimpleRenderSystem)
 		for (auto& kv : frameInfo.gameObjects) {
 			auto& obj = kv.second;
 			if (!obj.model || obj.isSkybox) {
@@ -125,7 +129,6 @@ namespace vkc
 				&push
 			);
 
-			obj.model->bind(frameInfo.commandBuffer);
 			obj.model->draw(frameInfo.commandBuffer);
 		}
 	}
@@ -1,19 +1,69 @@
 #include "vk_glTFRenderSystem.h"
+#include "VK_abstraction/vk_frameAllocator.h"
+#include "VK_abstraction/vk_geometryArena.h"
+#include "VK_abstraction/vk_swapchain.h"
 #include "VK_abstraction/vk_tools.h"
+#include "Renderer/vk_lodSelector.h"
+
+// STD
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
 
 
 namespace vkc
 {
+	namespace {
+		// Never culled
+		const glm::vec4 kUnbounded{ 0.f, 0.f, 0.f, std::numeric_limits<float>::max() };
+
+		// True when a SPIR-V module decorates a variable as BuiltIn InstanceIndex
+		bool readsInstanceIndex(const std::string& spvPath)
+		{
+			constexpr uint32_t kOpDecorate = 71;
+			constexpr uint32_t kDecorationBuiltIn = 11;
+			constexpr uint32_t kBuiltInInstanceIndex = 43;
+
+			std::ifstream file{ spvPath, std::ios::ate | std::ios::binary };
+			if (!file.is_open())
+				return false;
+			std::vector<uint32_t> words(static_cast<size_t>(file.tellg()) / sizeof(uint32_t));
+			file.seekg(0);
+			file.read(reinterpret_cast<char*>(words.data()), words.size() * sizeof(uint32_t));
+
+			// Instructions follow the five word header; each starts with its word count and opcode
+			for (size_t i = 5; i < words.size();) {
+				const uint32_t wordCount = words[i] >> 16;
+				const uint32_t opcode = words[i] & 0xFFFF;
+				if (wordCount == 0) break;
+				if (opcode == kOpDecorate && wordCount >= 4 && i + 3 < words.size() &&
+					words[i + 2] == kDecorationBuiltIn && words[i + 3] == kBuiltInInstanceIndex) {
+					return true;
+				}
+				i += wordCount;
+			}
+			return false;
+		}
+	}
+
 	glTFRenderSystem::glTFRenderSystem(
 		VkcDevice& device,
 		VkRenderPass renderPass,
-		VkDescriptorSetLayout globalSetLayout
+		VkDescriptorSetLayout globalSetLayout,
+		DescriptorManager& descriptorManager
 	)
 		: vkcDevice(device),
+		descriptorManager(descriptorManager),
 		globalSetLayout(globalSetLayout)
 	{
-		createPipelineLayout(globalSetLayout);
+		nodeSet = std::make_unique<VkcFrameAllocatorSet>(vkcDevice, VkcSwapChain::MAX_FRAMES_IN_FLIGHT, VK_SHADER_STAGE_VERTEX_BIT);
+		createPipelineLayout(globalSetLayout, descriptorManager.getTextureLayout());
 		createPipelines(renderPass);
+		createMaterialPipelines();
 	}
 
 	glTFRenderSystem::~glTFRenderSystem()
@@ -22,85 +72,230 @@ namespace vkc
 	}
 
 
+	uint32_t glTFRenderSystem::prepare(FrameInfo& frameInfo, uint32_t maxChunks) {
+
+		// 1) Cull whole models, in one batch
+		const Frustum frustum = Frustum::fromViewProjection(frameInfo.camera.getProjection() * frameInfo.camera.getView());
+		candidates.clear();
+		objectCuller.begin(frustum);
+		for (auto& [id, go] : frameInfo.gameObjects) {
+			if (!go.model || go.isSkybox || go.isOBJ) continue;
+			auto gltfModel = std::static_pointer_cast<vkglTF::Model>(go.model);
+
+			// Packed models need the packed pipeline variants; their position decode
+			// goes into the model matrix, but not into the normal matrix
+			if (gltfModel->hasPackedVertices() && !packedOpaquePipeline) {
+				static bool warned = false;
+				if (!warned) {
+					std::cerr << "glTFRenderSystem: glTFvert_packed.vert.spv missing, skipping models with packed vertices\n";
+					warned = true;
+				}
+				continue;
+			}
+			// Images and materials join the bindless set the first time the model is drawn
+			if (gltfModel->materialBase == ~0u && !descriptorManager.registerModel(gltfModel)) continue;
+
+			Candidate candidate;
+			candidate.object = &go;
+			candidate.model = gltfModel.get();
+			candidate.transform = go.transform.mat4();
+			// Model bounds are from the bind pose, so animated models only have their nodes culled
+			objectCuller.add(gltfModel->animations.empty()
+				? transformSphere(candidate.transform, gltfModel->getBoundingSphere())
+				: kUnbounded);
+			candidates.push_back(candidate);
+		}
+		objectCuller.run();
+
+		// 2) Cull the nodes of the models left, in a second batch
+		const glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+		nodeDraws.clear();
+		nodeCuller.begin(frustum);
+		for (uint32_t c = 0; c < candidates.size(); c++) {
+			if (!objectCuller.isVisible(c)) continue;
+			Candidate& candidate = candidates[c];
+
+			// One level for the whole model, from its bounds; each primitive clamps it to its own chain
+			candidate.lod = frameInfo.lodSelector.select(*candidate.model, candidate.transform, frameInfo.camera, candidate.object->lodLevel);
+			frameInfo.lodSelector.recordDraw(*candidate.model, candidate.lod);
+
+			for (const vkglTF::Node& node : candidate.model->nodes) {
+				if (!node.mesh || node.mesh->primitives.empty()) continue;
+				NodeDraw draw;
+				draw.candidate = c;
+				draw.node = &node;
+				draw.world = candidate.transform * node.getMatrix();
+				// Skinned meshes are deformed by their joints, away from the mesh bounds
+				const glm::vec4 sphere = transformSphere(draw.world, node.mesh->boundingSphere);
+				nodeCuller.add(node.skin ? kUnbounded : sphere);
+				draw.distance = glm::length(glm::vec3(sphere) - cameraPosition);
+				draw.blended = std::any_of(node.mesh->primitives.begin(), node.mesh->primitives.end(), [](const vkglTF::Primitive& primitive) {
+					return primitive.material->alphaMode == vkglTF::Material::ALPHAMODE_BLEND;
+				});
+				nodeDraws.push_back(draw);
+			}
+		}
+		nodeCuller.run();
+
+		// 3) Group the visible nodes: instances of one node at one level share a draw.
+		//    Nodes with blended primitives stay single, so each can be depth sorted.
+		const bool instancing = instancingEnabled && instancingSupported;
+		visibleNodes.clear();
+		for (uint32_t n = 0; n < nodeDraws.size(); n++) {
+			if (nodeCuller.isVisible(n)) {
+				visibleNodes.push_back(n);
+			}
+		}
+		auto sameGroup = [&](uint32_t a, uint32_t b) {
+			return !nodeDraws[a].blended && nodeDraws[a].node == nodeDraws[b].node &&
+				candidates[nodeDraws[a].candidate].lod == candidates[nodeDraws[b].candidate].lod;
+		};
+		if (instancing) {
+			std::sort(visibleNodes.begin(), visibleNodes.end(), [&](uint32_t a, uint32_t b) {
+				const NodeDraw& x = nodeDraws[a];
+				const NodeDraw& y = nodeDraws[b];
+				if (x.node != y.node)
+					return std::less<const vkglTF::Node*>()(x.node, y.node);
+				return candidates[x.candidate].lod < candidates[y.candidate].lod;
+			});
+		}
+
+		// 4) Node transforms go to this frame's slice of the frame allocator, so instances
+		//    of one model and frames in flight never share the memory. Every group's slice
+		//    is reserved first, so no node is dropped when the buffer is too small.
+		auto groupEnd = [&](size_t first) {
+			size_t last = first + 1;
+			while (instancing && last < visibleNodes.size() && sameGroup(visibleNodes[first], visibleNodes[last])) {
+				last++;
+			}
+			return last;
+		};
+		const VkDeviceSize alignment = frameInfo.frameAllocator.alignment();
+		VkDeviceSize nodeBytes = 0;
+		for (size_t first = 0; first < visibleNodes.size(); first = groupEnd(first)) {
+			const VkDeviceSize size = (groupEnd(first) - first) * sizeof(NodeUniform);
+			nodeBytes += (size + alignment - 1) & ~(alignment - 1);
+		}
+		frameInfo.frameAllocator.reserve(nodeBytes);
+		frameNodeSet = nodeSet->get(frameInfo.frameAllocator, static_cast<uint32_t>(frameInfo.frameIndex));
+
+		// 5) Queue every primitive of every group under its sort key
+		renderQueue.clear();
+		nodeInstances = 0;
+		for (size_t first = 0; first < visibleNodes.size();) {
+			const size_t last = groupEnd(first);
+			const NodeDraw& draw = nodeDraws[visibleNodes[first]];
+			const Candidate& candidate = candidates[draw.candidate];
+			const bool packed = candidate.model->hasPackedVertices();
+			const uint32_t count = static_cast<uint32_t>(last - first);
+
+			// Transforms of every instance, consecutively; the nearest one sorts the group
+			const VkcFrameAllocator::Allocation slice = frameInfo.frameAllocator.allocate(count * sizeof(NodeUniform));
+			assert(slice.mapped && "glTF node slices are reserved up front");
+			NodeUniform* uniforms = static_cast<NodeUniform*>(slice.mapped);
+			const glm::mat4 positionDecode = packed ? candidate.model->getPositionDecode() : glm::mat4(1.f);
+			float distance = draw.distance;
+			for (uint32_t i = 0; i < count; i++) {
+				const NodeDraw& instance = nodeDraws[visibleNodes[first + i]];
+				uniforms[i].modelMatrix = instance.world * positionDecode;
+				uniforms[i].normalMatrix = glm::transpose(glm::inverse(instance.world));
+				distance = std::min(distance, instance.distance);
+			}
+			const uint32_t nodeIndex = slice.offset / sizeof(NodeUniform);
+
+			for (const vkglTF::Primitive& primitive : draw.node->mesh->primitives) {
+				const vkglTF::Material& material = *primitive.material;
+				VkcRenderQueue::Item item;
+				item.material.pipeline = &materialPipelines[packed ? 1 : 0][material.alphaMode];
+				item.material.materialSet = frameInfo.textureDescriptorSet;
+				item.material.passType = material.alphaMode == vkglTF::Material::ALPHAMODE_BLEND
+					? MaterialPass::Transparent
+					: MaterialPass::MainColor;
+				item.objectIndex = nodeIndex;
+				item.materialIndex = candidate.model->materialBase + material.index;
+				item.instanceCount = count;
+				candidate.model->getPrimitiveDraw(primitive, candidate.lod, item.draw);
+				item.key = VkcRenderQueue::makeKey(item.material.passType, renderQueue.pipelineId(item.material.pipeline),
+					item.materialIndex, VkcRenderQueue::meshId(&primitive), distance);
+				renderQueue.push(item);
+			}
+			nodeInstances += count;
+			first = last;
+		}
+
+		// 6) Order by key: opaque front to back, blended back to front
+		renderQueue.sort();
+		return 1;
+	}
+
 	void glTFRenderSystem::render(FrameInfo& frameInfo) {
 
-		// Bind the global descriptor set once
+		// Sets shared by every draw; the bindless material set (set 2) is bound by the
+		// render queue as the items' MaterialInstance, and draws select their node and
+		// material with push constants
+		const std::array<VkDescriptorSet, 2> sets = {
+			frameInfo.globalDescriptorSet,
+			frameNodeSet
+		};
 		vkCmdBindDescriptorSets(
 			frameInfo.commandBuffer,
 			VK_PIPELINE_BIND_POINT_GRAPHICS,
 			pipelineLayout,
-			/* firstSet */ 0, 1,
-			&frameInfo.globalDescriptorSet,
+			/* firstSet */ 0, static_cast<uint32_t>(sets.size()),
+			sets.data(),
 			0, nullptr);
 
-		for (auto& [id, go] : frameInfo.gameObjects) {
-			if (!go.model || go.isSkybox || go.isOBJ) continue;
-			auto gltfModel = std::static_pointer_cast<vkglTF::Model>(go.model);
+		// Vertex/index buffers are shared by every model
+		vkcDevice.geometryArena().bind(frameInfo.commandBuffer);
 
-			// Bind vertex/index buffers
-			gltfModel->bind(frameInfo.commandBuffer);
-
-			for (auto* node : gltfModel->linearNodes) {
-				if (!node->mesh) continue;
-
-				// 1) Update per-node UBO
-				glm::mat4 world = go.transform.mat4() * node->getMatrix();
-				glm::mat4 normalMat = glm::transpose(glm::inverse(world));
-				memcpy(node->mesh->uniformBuffer.mapped, &world, sizeof(world));
-				memcpy((char*)node->mesh->uniformBuffer.mapped + sizeof(world),
-					&normalMat, sizeof(normalMat));
-
-				// 2) Bind per-node UBO descriptor set (set = 1)
-				vkCmdBindDescriptorSets(
-					frameInfo.commandBuffer,
-					VK_PIPELINE_BIND_POINT_GRAPHICS,
-					pipelineLayout,
-					/* firstSet */ 1, 1,
-					&node->mesh->uniformBuffer.descriptorSet,
-					0, nullptr);
-
-				// 3) Choose and bind the correct pipeline variant
-				auto& mat = node->mesh->primitives[0]->material; // Assuming single primitive per node
-				if (mat.alphaMode == vkglTF::Material::ALPHAMODE_OPAQUE) {
-					opaquePipeline->bind(frameInfo.commandBuffer);
-				}
-				else if (mat.alphaMode == vkglTF::Material::ALPHAMODE_MASK) {
-					maskPipeline->bind(frameInfo.commandBuffer);
-				}
-				else { // ALPHAMODE_BLEND
-					blendPipeline->bind(frameInfo.commandBuffer);
-				}
+		renderQueue.execute(frameInfo.commandBuffer, vkcDevice.geometryArena());
+	}
 
-				// 4) Draw the primitive (binds set = 2 inside)
-				gltfModel->drawNode(
-					node,
-					frameInfo.commandBuffer,
-					vkglTF::RenderFlags::BindImages,
-					pipelineLayout,
-					/* bindImageSet */ 2
-				);
-			}
-		}
+	void glTFRenderSystem::printStats() const
+	{
+		objectCuller.printStats("glTFRenderSystem models");
+		nodeCuller.printStats("glTFRenderSystem nodes");
+		renderQueue.printStats("glTFRenderSystem queue");
+		std::cout << "glTFRenderSystem: " << renderQueue.getStats().draws << " draws for " << nodeInstances
+			<< " node instances, instancing " << (instancingEnabled && instancingSupported ? "on" : "off") << "\n";
 	}
 
 
 
-	void glTFRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
+	void glTFRenderSystem::createMaterialPipelines()
+	{
+		// Variants that were not built keep a null pipeline; models needing them are skipped
+		auto materialPipeline = [&](const std::unique_ptr<VkcPipeline>& pipeline) {
+			return MaterialPipeline{ pipeline ? pipeline->getPipeline() : VK_NULL_HANDLE, pipelineLayout };
+		};
+		materialPipelines[0][vkglTF::Material::ALPHAMODE_OPAQUE] = materialPipeline(opaquePipeline);
+		materialPipelines[0][vkglTF::Material::ALPHAMODE_MASK] = materialPipeline(maskPipeline);
+		materialPipelines[0][vkglTF::Material::ALPHAMODE_BLEND] = materialPipeline(blendPipeline);
+		materialPipelines[1][vkglTF::Material::ALPHAMODE_OPAQUE] = materialPipeline(packedOpaquePipeline);
+		materialPipelines[1][vkglTF::Material::ALPHAMODE_MASK] = materialPipeline(packedMaskPipeline);
+		materialPipelines[1][vkglTF::Material::ALPHAMODE_BLEND] = materialPipeline(packedBlendPipeline);
+	}
+
+	void glTFRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout bindlessSetLayout)
 	{
 
 		const std::vector<VkDescriptorSetLayout> layouts = {
 			globalSetLayout,
-			vkglTF::descriptorSetLayoutUbo,
-			vkglTF::descriptorSetLayoutImage,
-            vkglTF::descriptorSetLayoutIbl
+			nodeSet->getLayout(),
+			bindlessSetLayout
 		};
-		
+
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(vkglTF::DrawConstants);
 
 		VkPipelineLayoutCreateInfo pipelineLayoutCI = {};
 		pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 		pipelineLayoutCI.setLayoutCount = static_cast<uint32_t>(layouts.size());
 		pipelineLayoutCI.pSetLayouts = layouts.data();
-		pipelineLayoutCI.pPushConstantRanges = nullptr;
+		pipelineLayoutCI.pushConstantRangeCount = 1;
+		pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
 		if (vkCreatePipelineLayout(vkcDevice.device(), &pipelineLayoutCI, nullptr, &pipelineLayout) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to create GLTF pipeline layout");
 		}
@@ -135,6 +330,37 @@ namespace vkc
                 offsetof(vkglTF::Vertex, tangent))
         };
 
+        // Packed variants share everything but the vertex stage and input layout
+        auto packedVertSpv = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/glTFvert_packed.vert.spv";
+        const bool buildPacked = std::filesystem::exists(packedVertSpv);
+        std::vector<VkVertexInputBindingDescription>  packedBindings = {
+            vkc::vkinit::vertexInputBindingDescription(
+                0, sizeof(vkglTF::PackedVertex), VK_VERTEX_INPUT_RATE_VERTEX)
+        };
+        std::vector<VkVertexInputAttributeDescription> packedAttributes = {
+            vkc::vkinit::vertexInputAttributeDescription(
+                0, 0, VK_FORMAT_R16G16B16A16_UNORM,
+                offsetof(vkglTF::PackedVertex, pos)),
+            vkc::vkinit::vertexInputAttributeDescription(
+                0, 1, VK_FORMAT_R16G16_SNORM,
+                offsetof(vkglTF::PackedVertex, normal)),
+            vkc::vkinit::vertexInputAttributeDescription(
+                0, 2, VK_FORMAT_R16G16_SFLOAT,
+                offsetof(vkglTF::PackedVertex, uv)),
+            vkc::vkinit::vertexInputAttributeDescription(
+                0, 3, VK_FORMAT_R8G8B8A8_UNORM,
+                offsetof(vkglTF::PackedVertex, color)),
+            vkc::vkinit::vertexInputAttributeDescription(
+                0, 4, VK_FORMAT_R16G16_SNORM,
+                offsetof(vkglTF::PackedVertex, tangent))
+        };
+        auto createPackedVariant = [&](PipelineConfigInfo& config) -> std::unique_ptr<VkcPipeline> {
+            if (!buildPacked) return nullptr;
+            config.bindingDescriptions = packedBindings;
+            config.attributeDescriptions = packedAttributes;
+            return std::make_unique<VkcPipeline>(vkcDevice, packedVertSpv, fragSpv, config);
+        };
+
         //
         // 1) OPAQUE pipeline
         //
@@ -147,6 +373,7 @@ namespace vkc
         // (blendEnable = VK_FALSE by default in defaultPipelineConfigInfo)
         opaquePipeline = std::make_unique<VkcPipeline>(
             vkcDevice, vertSpv, fragSpv, opaqueConfig);
+        packedOpaquePipeline = createPackedVariant(opaqueConfig);
 
         //
         // 2) MASK (alpha‐cutout) pipeline
@@ -162,15 +389,14 @@ namespace vkc
         maskConfig.colorBlendInfo.attachmentCount = 1;
         maskConfig.colorBlendInfo.pAttachments = &maskConfig.colorBlendAttachment;
 
-        // set up specialization for ALPHA_MASK = true, cutoff = e.g. 0.5f
-        struct SpecData { VkBool32 alphaMask; float cutoff; };
-        static SpecData specData{ VK_TRUE, 0.5f };
-        static VkSpecializationMapEntry mapEntries[2] = {
-          { 0, offsetof(SpecData, alphaMask), sizeof(VkBool32) },
-          { 1, offsetof(SpecData, cutoff),    sizeof(float)    }
+        // set up specialization for ALPHA_MASK = true; the cutoff comes from the material
+        struct SpecData { VkBool32 alphaMask; };
+        static SpecData specData{ VK_TRUE };
+        static VkSpecializationMapEntry mapEntries[1] = {
+          { 0, offsetof(SpecData, alphaMask), sizeof(VkBool32) }
         };
         static VkSpecializationInfo specInfo{};
-        specInfo.mapEntryCount = 2;
+        specInfo.mapEntryCount = 1;
         specInfo.pMapEntries = mapEntries;
         specInfo.dataSize = sizeof(specData);
         specInfo.pData = &specData;
@@ -178,6 +404,7 @@ namespace vkc
 
         maskPipeline = std::make_unique<VkcPipeline>(
             vkcDevice, vertSpv, fragSpv, maskConfig);
+        packedMaskPipeline = createPackedVariant(maskConfig);
 
         //
         // 3) BLEND (alpha‐blend) pipeline
@@ -209,5 +436,13 @@ namespace vkc
 
         blendPipeline = std::make_unique<VkcPipeline>(
             vkcDevice, vertSpv, fragSpv, blendConfig);
+        packedBlendPipeline = createPackedVariant(blendConfig);
+
+        // Instances of a node read their transform at nodeIndex + gl_InstanceIndex. A blob
+        // compiled before that would draw every instance at the first one's transform.
+        instancingSupported = readsInstanceIndex(vertSpv) && (!buildPacked || readsInstanceIndex(packedVertSpv));
+        if (!instancingSupported) {
+            std::cout << "glTFRenderSystem: glTFvert.vert.spv predates instancing, drawing nodes one by one\n";
+        }
     }
 }
\ No newline at end of file
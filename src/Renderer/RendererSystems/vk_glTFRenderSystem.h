@@ -2,8 +2,12 @@
 #include "vk_renderSystem.h"
 #include "AppCore/vk_assetManager.h"
 #include "Renderer/vk_descriptorManager.h"
+#include "Renderer/vk_frustumCuller.h"
+#include "Renderer/vk_renderQueue.h"
 #include "VK_abstraction/vk_pipeline.h"
+#include "VK_abstraction/vk_descriptors.h"
 #include "VK_abstraction/vk_device.h"
+#include "VK_abstraction/vk_frameAllocatorSet.h"
 #include "VK_abstraction/vk_glTFModel.h"
 
 // STD
@@ -18,24 +22,75 @@ namespace vkc
 		glTFRenderSystem(
 			VkcDevice& device,
 			VkRenderPass renderPass,
-			VkDescriptorSetLayout globalSetLayout
+			VkDescriptorSetLayout globalSetLayout,
+			DescriptorManager& descriptorManager
 		);
 		~glTFRenderSystem();
+		// Culls, groups and queues this frame's primitives; render() records the queue
+		uint32_t prepare(FrameInfo& frameInfo, uint32_t maxChunks) override;
 		void render(FrameInfo& frameInfo) override;
+		void printStats() const override;
+		void setInstancingEnabled(bool enabled) override { instancingEnabled = enabled; }
 
 	private:
-		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+		// set = 1: the frame allocator's buffer as an array of these, indexed by
+		// DrawConstants::nodeIndex. Allocation offsets are multiples of 256, so
+		// every slice starts on a NodeUniform boundary.
+		struct NodeUniform {
+			glm::mat4 modelMatrix;
+			glm::mat4 normalMatrix;
+		};
+
+		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout bindlessSetLayout);
 		void createPipelines(VkRenderPass renderPass);
+		void createMaterialPipelines();
 
 		VkcDevice& vkcDevice;
+		DescriptorManager& descriptorManager;
 		VkDescriptorSetLayout globalSetLayout;
-		VkDescriptorSetLayout textureSetLayout;
 
 		std::unique_ptr<VkcPipeline> opaquePipeline;
 		std::unique_ptr<VkcPipeline> maskPipeline;
 		std::unique_ptr<VkcPipeline> blendPipeline;
 
+		// Variants for vkglTF::PackedVertex; null when glTFvert_packed.vert.spv has not been compiled
+		std::unique_ptr<VkcPipeline> packedOpaquePipeline;
+		std::unique_ptr<VkcPipeline> packedMaskPipeline;
+		std::unique_ptr<VkcPipeline> packedBlendPipeline;
+
+		// The pipelines above for the render queue, as [packed][vkglTF::Material::AlphaMode]
+		MaterialPipeline materialPipelines[2][3]{};
+
 		VkPipelineLayout pipelineLayout;
 
+		std::unique_ptr<VkcFrameAllocatorSet> nodeSet;    // set 1, node transforms in the frame allocator
+		VkDescriptorSet frameNodeSet = VK_NULL_HANDLE;  // this frame's
+
+		// Models are culled by their bounds, then the nodes of the visible ones by their meshes'
+		struct Candidate {
+			VkcGameObject* object = nullptr;
+			vkglTF::Model* model = nullptr;
+			glm::mat4 transform{ 1.f };
+			uint32_t lod = 0;
+		};
+		struct NodeDraw {
+			uint32_t candidate = 0;
+			const vkglTF::Node* node = nullptr;
+			glm::mat4 world{ 1.f };
+			float distance = 0.f;		// camera to the node's bounds
+			bool blended = false;		// any primitive alpha blended
+		};
+		VkcFrustumCuller objectCuller;
+		VkcFrustumCuller nodeCuller;
+		std::vector<Candidate> candidates;
+		std::vector<NodeDraw> nodeDraws;
+		std::vector<uint32_t> visibleNodes;		// into nodeDraws, grouped by node and level when instancing
+		bool instancingEnabled = true;
+		bool instancingSupported = false;	// the vertex shader blobs index nodes by gl_InstanceIndex
+		uint32_t nodeInstances = 0;		// drawn last frame
+
+		// Set 2 holds the materials, bound per MaterialInstance
+		VkcRenderQueue renderQueue{ 2 };
+
 	};
 }
\ No newline at end of file
@@ -8,9 +8,10 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
-#include <map>
+#include <cmath>
 #include <stdexcept>
  
 
@@ -69,8 +70,8 @@ namespace vkc {
         pipelineConfig.pipelineLayout = pipelineLayout;
 
         // Construct paths using PROJECT_ROOT_DIR
-        std::string vertShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/Shaders/SpirV/point_light.vert.spv";
-        std::string fragShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/Shaders/SpirV/point_light.frag.spv";
+        std::string vertShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/point_light.vert.spv";
+        std::string fragShaderPath = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/point_light.frag.spv";
 
         vkcPipeline = std::make_unique<VkcPipeline>(
             vkcDevice,
@@ -79,20 +80,38 @@ namespace vkc {
             pipelineConfig
         );
     }
-    void PointLightSystem::render(FrameInfo& frameInfo)
+    uint32_t PointLightSystem::prepare(FrameInfo& frameInfo, uint32_t maxChunks)
     {
-        // sort lights
-        std::map<float, VkcGameObject::id_t> sorted;
+        // cull the light billboards, a sphere of their radius around each
+        lights.clear();
+        frustumCuller.begin(Frustum::fromViewProjection(frameInfo.camera.getProjection() * frameInfo.camera.getView()));
         for (auto& kv : frameInfo.gameObjects) {
             auto& obj = kv.second;
             if (obj.pointLight == nullptr) continue;
+            frustumCuller.add(glm::vec4(obj.transform.translation, std::abs(obj.transform.scale.x)));
+            lights.push_back(&obj);
+        }
+        frustumCuller.run();
+
+        // sort lights back to front, so the billboards blend in order
+        visibleLights.clear();
+        for (uint32_t i = 0; i < frustumCuller.size(); i++) {
+            if (!frustumCuller.isVisible(i)) continue;
+            auto& obj = *lights[i];
 
             // calculate distance
             auto offset = frameInfo.camera.GetPosition() - obj.transform.translation;
             float disSquared = glm::dot(offset, offset);
-            sorted[disSquared] = obj.getId();
+            visibleLights.emplace_back(disSquared, &obj);
         }
+        std::sort(visibleLights.begin(), visibleLights.end(), [](const auto& a, const auto& b) {
+            return a.first > b.first;
+        });
+        return 1;
+    }
 
+    void PointLightSystem::render(FrameInfo& frameInfo)
+    {
         vkcPipeline->bind(frameInfo.commandBuffer);
 
         vkCmdBindDescriptorSets(
@@ -105,10 +124,8 @@ namespace vkc {
             0,
             nullptr); // Implement dynamic offset
 
-        // iterate through sorted lights in reverse order
-        for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
-            // use game obj id to find light object
-            auto& obj = frameInfo.gameObjects.at(it->second);
+        for (const auto& [disSquared, light] : visibleLights) {
+            const VkcGameObject& obj = *light;
 
             PointLightPushConstants push{};
             push.position = glm::vec4(obj.transform.translation, 1.f);
@@ -127,6 +144,11 @@ namespace vkc {
 
     }
 
+    void PointLightSystem::printStats() const
+    {
+        frustumCuller.printStats("PointLightSystem");
+    }
+
     void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo)
     {
         auto rotateLight = glm::rotate(glm::mat4(1.f), rotationSpeed * frameInfo.frameTime, { 0.f, -1.f, 0.f });
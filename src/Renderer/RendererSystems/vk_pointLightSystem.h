@@ -8,8 +8,10 @@
 #include "Game/vk_gameObject.h"
 #include "VK_abstraction/vk_pipeline.h"
 #include "Renderer/RendererSystems/vk_renderSystem.h"
+#include "Renderer/vk_frustumCuller.h"
 // std
 #include <memory>
+#include <utility>
 #include <vector>
 
 namespace vkc {
@@ -23,8 +25,10 @@ namespace vkc {
         PointLightSystem& operator=(const PointLightSystem&) = delete;
 
       
+        uint32_t prepare(FrameInfo& frameInfo, uint32_t maxChunks) override;
         void render(FrameInfo& frameInfo) override;
         void update(FrameInfo& framInfo, GlobalUbo& ubo) override;
+        void printStats() const override;
 
 
         void setRotationSpeed(float speed) { rotationSpeed = speed; }
@@ -38,5 +42,10 @@ namespace vkc {
         VkPipelineLayout pipelineLayout;
 
         float rotationSpeed = .5f;
+
+        // Lights only light the scene through the ubo; culling skips their billboards
+        VkcFrustumCuller frustumCuller;
+        std::vector<VkcGameObject*> lights;
+        std::vector<std::pair<float, const VkcGameObject*>> visibleLights;   // squared distance, far to near
     };
 }// namespace vkc
\ No newline at end of file
@@ -16,10 +16,40 @@ namespace vkc {
             // Default empty implementation
         }
 
+        // Runs before the render pass begins, so it may also record transfer or
+        // compute work into frameInfo.commandBuffer
         virtual void update(FrameInfo& frameInfo, GlobalUbo& ubo) {
             // Default empty implementation
         }
 
+        // Runs on the main thread once the render pass has begun, before any system
+        // records into it: CPU work whose results render() only reads, such as culling,
+        // picking levels of detail and writing to the frame allocator. Returns how many
+        // chunks, at most maxChunks, renderChunk() may split the system's draws into.
+        virtual uint32_t prepare(FrameInfo& frameInfo, uint32_t maxChunks) {
+            return 1;
+        }
+
+        // Records into frameInfo.commandBuffer, which may be a secondary command buffer
+        // of its own, on any thread, while other systems record theirs. Must not change
+        // state shared with them, and must bind everything it uses: nothing is inherited.
         virtual void render(FrameInfo& frameInfo) = 0;
+
+        // Records one of the chunkCount chunks prepare() asked for; chunks of a system
+        // may record at the same time
+        virtual void renderChunk(FrameInfo& frameInfo, uint32_t chunk, uint32_t chunkCount) {
+            render(frameInfo);
+        }
+
+        // Systems that batch objects sharing a model into instanced draws can be
+        // switched back to one draw per object, to compare the two
+        virtual void setInstancingEnabled(bool enabled) {
+            // Default empty implementation
+        }
+
+        // Debug counters of the last frame, e.g. objects culled and drawn
+        virtual void printStats() const {
+            // Default empty implementation
+        }
     };
 }// namespace vkc
\ No newline at end of file
@@ -7,7 +7,8 @@ namespace vkc {
         VkRenderPass renderPass,
         const DescriptorLayouts& layouts,
         DescriptorManager& descriptorManager,
-        AssetManager& assetManager)
+        AssetManager& assetManager,
+        VkcGpuScene* gpuScene)
     {
         _descriptorManager = &descriptorManager;
 
@@ -15,12 +16,14 @@ namespace vkc {
             device,
             renderPass,
             layouts.globalLayout,
-            layouts.textureLayout));
+            layouts.textureLayout,
+            gpuScene));
 
         systems.push_back(std::make_unique<glTFRenderSystem>(
             device,
             renderPass,
-            layouts.globalLayout));
+            layouts.globalLayout,
+            descriptorManager));
 
         systems.push_back(std::make_unique<PointLightSystem>(
             device,
@@ -17,7 +17,8 @@ namespace vkc {
             VkRenderPass renderPass,
             const DescriptorLayouts& layouts,
             DescriptorManager& descriptorManager,
-            AssetManager& assetManager);
+            AssetManager& assetManager,
+            VkcGpuScene* gpuScene);
 
         // Register all systems into a scene
         void registerSystems(Scene& scene);
@@ -1,4 +1,5 @@
 #include "vk_skyboxRenderSystem.h"
+#include "VK_abstraction/vk_geometryArena.h"
 
 // External
 #define GLM_FORCE_RADIANS
@@ -53,7 +54,7 @@ namespace vkc {
         );
         if (skybox.model)
         {
-            skybox.model->bind(frameInfo.commandBuffer);
+            vkcDevice.geometryArena().bind(frameInfo.commandBuffer);
             skybox.model->draw(frameInfo.commandBuffer);
         }
   
@@ -90,8 +91,8 @@ namespace vkc {
         config.renderPass = renderPass;
         config.pipelineLayout = pipelineLayout;
 
-        std::string vertPath = std::string(PROJECT_ROOT_DIR) + "/res/Shaders/SpirV/skybox.vert.spv";
-        std::string fragPath = std::string(PROJECT_ROOT_DIR) + "/res/Shaders/SpirV/skybox.frag.spv";
+        std::string vertPath = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/skybox.vert.spv";
+        std::string fragPath = std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/skybox.frag.spv";
 
         vkcPipeline = std::make_unique<VkcPipeline>(
             vkcDevice,
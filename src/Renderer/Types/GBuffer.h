@@ -1,48 +1,52 @@
 #pragma once
 #include "VK_abstraction/vk_device.h"
+#include "VK_abstraction/vk_renderTargets.h"
+#include <memory>
 #include <vector>
 
 
 
 namespace vkc
 {
-	struct GBufferAttachment {
-		VkImage        image = VK_NULL_HANDLE;
-		VkDeviceMemory memory = VK_NULL_HANDLE;
-		VkImageView    imageView = VK_NULL_HANDLE;
-		VkFormat       format = VK_FORMAT_UNDEFINED;
-	};
-
 	class GBuffer {
 	public:
-		GBuffer(VkcDevice& device, VkExtent2D extent);
+		// The geometry pass writes the attachments in pass geometryPass and lighting
+		// samples them in the next one. Passing a VkcRenderTargets shared with the
+		// frame's other passes lets attachments with disjoint lifetimes share memory;
+		// the caller then builds it after every user has added its targets.
+		GBuffer(VkcDevice& device, VkExtent2D extent, VkcRenderTargets* sharedTargets = nullptr, uint32_t geometryPass = 0);
 		~GBuffer();
 
 		// Call this after swapchain and depth format are known:
 		void createAttachments(VkFormat positionFmt, VkFormat normalFmt, VkFormat albedoFmt, VkFormat depthFmt);
 
+		// Recreates the attachments at the new size; views change, framebuffers must be rebuilt
+		void resize(VkExtent2D newExtent);
+
 		// Returns all color‐attachment views for the MRT
 		std::vector<VkImageView> getColorAttachmentViews() const;
 
 		// Returns the depth image view
-		VkImageView getDepthAttachmentView() const { return depthAttachment.imageView; }
+		VkImageView getDepthAttachmentView() const { return targets->view(depthAttachment); }
 
 		// Cleanup
 		void cleanup();
 
 	private:
-		void createAttachment(VkFormat format, VkImageUsageFlags usage, GBufferAttachment& outAttachment);
-
 		VkcDevice& vkcDevice;
 		VkExtent2D           swapChainExtent;
+		uint32_t             geometryPass;
+
+		std::unique_ptr<VkcRenderTargets> ownTargets;
+		VkcRenderTargets*    targets;
 
 		// MRT attachments
-		GBufferAttachment    positionAttachment;
-		GBufferAttachment    normalAttachment;
-		GBufferAttachment    albedoAttachment;
+		VkcRenderTargets::Handle positionAttachment = 0;
+		VkcRenderTargets::Handle normalAttachment = 0;
+		VkcRenderTargets::Handle albedoAttachment = 0;
 
 		// Depth
-		GBufferAttachment    depthAttachment;
+		VkcRenderTargets::Handle depthAttachment = 0;
 	};
 
 }
\ No newline at end of file
@@ -1,44 +1,57 @@
 #include "OffscreenPass.h"
 
+#include <array>
+#include <stdexcept>
+
 namespace vkc
 {
 
-	OffscreenPass::OffscreenPass(VkcDevice& deviceRef, VkExtent2D initialExtent)
-		: device(deviceRef), extent(initialExtent)
+	OffscreenPass::OffscreenPass(VkcDevice& deviceRef, VkExtent2D initialExtent, VkcRenderTargets* sharedTargets, uint32_t pass)
+		: device(deviceRef), extent(initialExtent), targets(sharedTargets)
 	{
-		// (You still need to implement createResources() here to fill
-		//  hdrImage, hdrImageMemory, hdrImageView, renderPass, framebuffer)
+		if (!targets) {
+			ownTargets = std::make_unique<VkcRenderTargets>(device, "offscreen HDR");
+			targets = ownTargets.get();
+		}
+		VkcRenderTargets::Desc desc;
+		desc.format = VK_FORMAT_R16G16B16A16_SFLOAT; // HDR format
+		desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		desc.firstPass = pass;
+		desc.lastPass = pass + 1;
+		hdrTarget = targets->add(desc);
+		if (ownTargets) {
+			ownTargets->build(extent);
+		}
 		createResources();
 	}
 
 	OffscreenPass::~OffscreenPass()
 	{
 		// clean up in reverse order of creation:
-		vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+		if (framebuffer != VK_NULL_HANDLE) {
+			vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+		}
 		vkDestroyRenderPass(device.device(), renderPass, nullptr);
-		vkDestroyImageView(device.device(), hdrImageView, nullptr);
-        vkDestroySampler(device.device(), hdrSampler, nullptr);
-		vkDestroyImage(device.device(), hdrImage, nullptr);
-		vkFreeMemory(device.device(), hdrImageMemory, nullptr);
+		vkDestroySampler(device.device(), hdrSampler, nullptr);
 	}
 	void OffscreenPass::resize(VkExtent2D newExtent)
 	{
 		if (newExtent.width == extent.width && newExtent.height == extent.height)
 			return;
-		// destroy old
-		vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
-		vkDestroyImageView(device.device(), hdrImageView, nullptr);
-		vkDestroyImage(device.device(), hdrImage, nullptr);
-		vkFreeMemory(device.device(), hdrImageMemory, nullptr);
-		vkDestroyRenderPass(device.device(), renderPass, nullptr);
-
-		// update extent and recreate
 		extent = newExtent;
-		// (re-call your createResources() logic here)
+		// A shared target set is resized by its owner; either way begin() sees the
+		// targets' version change and recreates the framebuffer
+		if (ownTargets) {
+			ownTargets->build(extent);
+		}
 	}
 
 	void OffscreenPass::begin(VkCommandBuffer cmd)
 	{
+		if (framebuffer == VK_NULL_HANDLE || framebufferVersion != targets->version()) {
+			createFramebuffer();
+		}
+
 		// 1) Clear values: color = black, depth = 1.0
 		std::array<VkClearValue, 2> clears{};
 		clears[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
@@ -50,7 +63,7 @@ namespace vkc
 		info.renderPass = renderPass;
 		info.framebuffer = framebuffer;
 		info.renderArea.offset = { 0, 0 };
-		info.renderArea.extent = extent;
+		info.renderArea.extent = targets->getExtent();
 		info.clearValueCount = static_cast<uint32_t>(clears.size());
 		info.pClearValues = clears.data();
 
@@ -63,54 +76,7 @@ namespace vkc
 	}
 	void OffscreenPass::createResources()
 	{
-        // Create HDR color image
-        VkImageCreateInfo imageInfo{};
-        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        imageInfo.imageType = VK_IMAGE_TYPE_2D;
-        imageInfo.extent.width = extent.width;
-        imageInfo.extent.height = extent.height;
-        imageInfo.extent.depth = 1;
-        imageInfo.mipLevels = 1;
-        imageInfo.arrayLayers = 1;
-        imageInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT; // HDR format
-        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        if (vkCreateImage(device.device(), &imageInfo, nullptr, &hdrImage) != VK_SUCCESS)
-            throw std::runtime_error("failed to create HDR image");
-
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(device.device(), hdrImage, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = device.findMemoryType(
-            memRequirements.memoryTypeBits,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-        if (vkAllocateMemory(device.device(), &allocInfo, nullptr, &hdrImageMemory) != VK_SUCCESS)
-            throw std::runtime_error("failed to allocate HDR image memory");
-
-        vkBindImageMemory(device.device(), hdrImage, hdrImageMemory, 0);
-
-        // Create image view
-        VkImageViewCreateInfo viewInfo{};
-        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        viewInfo.image = hdrImage;
-        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        viewInfo.format = imageInfo.format;
-        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = 1;
-        viewInfo.subresourceRange.baseArrayLayer = 0;
-        viewInfo.subresourceRange.layerCount = 1;
-
-        if (vkCreateImageView(device.device(), &viewInfo, nullptr, &hdrImageView) != VK_SUCCESS)
-            throw std::runtime_error("failed to create HDR image view");
+        const VkFormat format = targets->format(hdrTarget);
 
         // Create Sampler
         VkSamplerCreateInfo samplerInfo{};
@@ -125,9 +91,10 @@ namespace vkc
         if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &hdrSampler) != VK_SUCCESS)
             throw std::runtime_error("failed to create HDR sampler");
 
-        // Create render pass
+        // Create render pass. The HDR target may alias other attachments, so its
+        // contents are never loaded
         VkAttachmentDescription colorAttachment{};
-        colorAttachment.format = imageInfo.format;
+        colorAttachment.format = format;
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
         colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
@@ -145,29 +112,56 @@ namespace vkc
         subpass.colorAttachmentCount = 1;
         subpass.pColorAttachments = &colorAttachmentRef;
 
+        // Earlier users of aliased memory finish before this pass writes it, and
+        // the next pass samples only after it is done
+        std::array<VkSubpassDependency, 2> dependencies{};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
+        dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
         VkRenderPassCreateInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
         renderPassInfo.attachmentCount = 1;
         renderPassInfo.pAttachments = &colorAttachment;
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
 
         if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
             throw std::runtime_error("failed to create offscreen render pass");
+	}
+
+	void OffscreenPass::createFramebuffer()
+	{
+        if (framebuffer != VK_NULL_HANDLE) {
+            // Only reached when the target was recreated, after the device waited for resizing
+            vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+        }
 
-        // Create framebuffer
-        VkImageView attachments[] = { hdrImageView };
+        VkImageView attachments[] = { targets->view(hdrTarget) };
+        const VkExtent2D targetExtent = targets->getExtent();
 
         VkFramebufferCreateInfo framebufferInfo{};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebufferInfo.renderPass = renderPass;
         framebufferInfo.attachmentCount = 1;
         framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = extent.width;
-        framebufferInfo.height = extent.height;
+        framebufferInfo.width = targetExtent.width;
+        framebufferInfo.height = targetExtent.height;
         framebufferInfo.layers = 1;
 
         if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
             throw std::runtime_error("failed to create offscreen framebuffer");
+        framebufferVersion = targets->version();
 	}
-}
\ No newline at end of file
+}
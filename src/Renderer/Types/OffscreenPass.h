@@ -1,26 +1,35 @@
 // OffscreenPass.h
 #pragma once
 #include "VK_abstraction/vk_device.h"
+#include "VK_abstraction/vk_renderTargets.h"
+
+#include <memory>
 
 namespace vkc
 {
 	struct OffscreenPass {
 		VkcDevice& device;
 		VkExtent2D extent;
-		VkImage        hdrImage;
-		VkDeviceMemory hdrImageMemory;
-		VkImageView    hdrImageView;
-		VkRenderPass   renderPass;
-		VkFramebuffer  framebuffer;
-		VkSampler	   hdrSampler;
-		OffscreenPass(VkcDevice&, VkExtent2D);
+		// The HDR target is written in pass `pass` and sampled in the next one. A
+		// VkcRenderTargets shared with the frame's other passes lets it alias
+		// attachments that are dead by then; its owner builds and resizes it.
+		std::unique_ptr<VkcRenderTargets> ownTargets;
+		VkcRenderTargets* targets;
+		VkcRenderTargets::Handle hdrTarget = 0;
+		VkRenderPass   renderPass = VK_NULL_HANDLE;
+		VkFramebuffer  framebuffer = VK_NULL_HANDLE;
+		uint32_t       framebufferVersion = 0;	// targets->version() the framebuffer was created for
+		VkSampler	   hdrSampler = VK_NULL_HANDLE;
+		OffscreenPass(VkcDevice&, VkExtent2D, VkcRenderTargets* sharedTargets = nullptr, uint32_t pass = 0);
 		~OffscreenPass();
+		// Only the HDR target and the framebuffer depend on the size
 		void resize(VkExtent2D newExtent);
 		void begin(VkCommandBuffer);
 		void end(VkCommandBuffer);
 		void createResources();
+		void createFramebuffer();
 
-		VkImageView getColorImageView() const { return hdrImageView; }
+		VkImageView getColorImageView() const { return targets->view(hdrTarget); }
 		VkSampler getSampler() const { return hdrSampler; }
 	};
 }
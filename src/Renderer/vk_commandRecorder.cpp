@@ -0,0 +1,184 @@
+// vk_commandRecorder.cpp
+#include "vk_commandRecorder.h"
+#include "VK_abstraction/vk_device.h"
+#include "VK_abstraction/vk_geometryArena.h"
+#include "VK_abstraction/vk_initializers.h"
+
+// STD
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace vkc
+{
+	VkcCommandRecorder::VkcCommandRecorder(VkcDevice& device, uint32_t frameCount, uint32_t threadCount)
+		: device{ device }, workers{ threadCount }
+	{
+		const uint32_t laneCount = workers.getThreadCount() + 1;
+
+		// Transient: the buffers are re-recorded every time the frame comes round
+		VkCommandPoolCreateInfo poolInfo = vkinit::commandPoolCreateInfo();
+		poolInfo.queueFamilyIndex = device.findPhysicalQueueFamilies().graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		frames.resize(frameCount);
+		for (Frame& frame : frames) {
+			frame.lanes.resize(laneCount);
+			for (Lane& lane : frame.lanes) {
+				if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &lane.pool) != VK_SUCCESS) {
+					throw std::runtime_error("failed to create secondary command pool!");
+				}
+			}
+		}
+	}
+
+	VkcCommandRecorder::~VkcCommandRecorder()
+	{
+		// Destroying a pool frees its command buffers
+		for (Frame& frame : frames) {
+			for (Lane& lane : frame.lanes) {
+				vkDestroyCommandPool(device.device(), lane.pool, nullptr);
+			}
+		}
+	}
+
+	void VkcCommandRecorder::beginPass(uint32_t frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D passExtent)
+	{
+		assert(!recordingPass && "Can't call beginPass while a pass is being recorded");
+		currentFrame = frameIndex;
+		for (Lane& lane : frames[currentFrame].lanes) {
+			vkResetCommandPool(device.device(), lane.pool, 0);
+			lane.used = 0;
+		}
+
+		inheritance = VkCommandBufferInheritanceInfo{};
+		inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance.renderPass = renderPass;
+		inheritance.subpass = 0;
+		inheritance.framebuffer = framebuffer;
+		extent = passExtent;
+
+		jobs.clear();
+		recordingPass = true;
+	}
+
+	uint32_t VkcCommandRecorder::getLaneCount() const
+	{
+		const uint32_t laneCount = static_cast<uint32_t>(frames[0].lanes.size());
+		return settings.maxThreads > 0 ? std::min(settings.maxThreads, laneCount) : laneCount;
+	}
+
+	void VkcCommandRecorder::record(Job job)
+	{
+		assert(recordingPass && "Can't record outside of beginPass and endPass");
+		jobs.push_back(std::move(job));
+	}
+
+	void VkcCommandRecorder::endPass(VkCommandBuffer primaryCommandBuffer)
+	{
+		assert(recordingPass && "Can't call endPass without beginPass");
+		recordingPass = false;
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		std::vector<Lane>& lanes = frames[currentFrame].lanes;
+		const uint32_t laneCount = static_cast<uint32_t>(std::min<size_t>(getLaneCount(), jobs.size()));
+		recorded.assign(jobs.size(), VK_NULL_HANDLE);
+		nextJob = 0;
+
+		// The calling thread is lane 0 instead of waiting idle
+		pending.clear();
+		for (uint32_t i = 1; i < laneCount; i++) {
+			Lane* lane = &lanes[i];
+			pending.push_back(workers.submit([this, lane]() { recordLane(*lane); }));
+		}
+		std::exception_ptr error;
+		if (laneCount > 0) {
+			try {
+				recordLane(lanes[0]);
+			}
+			catch (...) {
+				error = std::current_exception();
+			}
+		}
+		// Every lane has to stop touching jobs before they are cleared
+		for (auto& future : pending) {
+			try {
+				future.get();
+			}
+			catch (...) {
+				if (!error) error = std::current_exception();
+			}
+		}
+		pending.clear();
+		jobs.clear();
+		if (error) {
+			std::rethrow_exception(error);
+		}
+
+		if (!recorded.empty()) {
+			vkCmdExecuteCommands(primaryCommandBuffer, static_cast<uint32_t>(recorded.size()), recorded.data());
+		}
+
+		stats.jobs = static_cast<uint32_t>(recorded.size());
+		stats.lanes = laneCount;
+		stats.recordMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	void VkcCommandRecorder::recordLane(Lane& lane)
+	{
+		VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo();
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = &inheritance;
+
+		VkViewport viewport{};
+		viewport.width = static_cast<float>(extent.width);
+		viewport.height = static_cast<float>(extent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		const VkRect2D scissor{ { 0, 0 }, extent };
+
+		for (size_t job = nextJob++; job < jobs.size(); job = nextJob++) {
+			VkCommandBuffer commandBuffer = acquire(lane);
+			if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+				throw std::runtime_error("failed to begin recording secondary command buffer!");
+			}
+			VkcGeometryArena::resetBinding();
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			jobs[job](commandBuffer);
+			if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to record secondary command buffer!");
+			}
+			recorded[job] = commandBuffer;
+		}
+	}
+
+	VkCommandBuffer VkcCommandRecorder::acquire(Lane& lane)
+	{
+		if (lane.used == lane.commandBuffers.size()) {
+			VkCommandBufferAllocateInfo allocInfo = vkinit::commandBufferAllocateInfo(lane.pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, 1);
+			VkCommandBuffer commandBuffer;
+			if (vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate secondary command buffer!");
+			}
+			lane.commandBuffers.push_back(commandBuffer);
+		}
+		return lane.commandBuffers[lane.used++];
+	}
+
+	void VkcCommandRecorder::printStats() const
+	{
+		if (!settings.enabled) {
+			std::cout << "Command recording: inline into the primary buffer\n";
+			return;
+		}
+		std::cout << std::fixed << std::setprecision(2)
+			<< "Command recording: " << stats.jobs << " secondary buffers on " << stats.lanes << " of "
+			<< getLaneCount() << " threads, " << stats.recordMs << " ms last frame\n";
+		std::cout.unsetf(std::ios::floatfield);
+	}
+}
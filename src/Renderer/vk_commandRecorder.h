@@ -0,0 +1,102 @@
+// vk_commandRecorder.h
+#pragma once
+#include "Utils/vkc_threadPool.h"
+
+// External
+#include <vulkan/vulkan.h>
+
+// STD
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <vector>
+
+namespace vkc
+{
+	class VkcDevice;
+
+	// Records the swap chain render pass as secondary command buffers on several
+	// threads. Between beginPass() and endPass() the render pass runs with
+	// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS; record() queues a job that
+	// fills one secondary buffer, and endPass() records the queued jobs in
+	// parallel, then executes their buffers from the primary in queue order.
+	//
+	// Every recording lane (the calling thread plus each worker) has its own
+	// command pool per frame in flight, reset as a whole when the frame comes
+	// round again, so no pool is ever used by two threads at once. Lanes take the
+	// next queued job as they finish one. Secondary buffers inherit the render
+	// pass and framebuffer but no state, so each job starts with the viewport and
+	// scissor set and must bind everything else itself.
+	//
+	// Jobs run concurrently with each other: they may only read state they share.
+	// begin/endPass and record() are main (render) thread only.
+	class VkcCommandRecorder
+	{
+	public:
+		using Job = std::function<void(VkCommandBuffer)>;
+
+		struct Settings {
+			bool     enabled = true;	// off: the pass records inline into the primary buffer
+			uint32_t maxThreads = 0;	// recording threads to use, 0 for all; to measure scaling
+		};
+
+		struct Stats {
+			uint32_t jobs = 0;
+			uint32_t lanes = 0;			// threads that recorded them
+			double   recordMs = 0.0;	// endPass() wall time, from the first job to the last executed
+		};
+
+		// threadCount == 0 picks hardware_concurrency - 1 workers, as ThreadPool does
+		VkcCommandRecorder(VkcDevice& device, uint32_t frameCount, uint32_t threadCount = 0);
+		~VkcCommandRecorder();
+
+		VkcCommandRecorder(const VkcCommandRecorder&) = delete;
+		VkcCommandRecorder& operator=(const VkcCommandRecorder&) = delete;
+
+		// After vkCmdBeginRenderPass with secondary contents on the primary buffer.
+		// The frame's previous submission must have finished.
+		void beginPass(uint32_t frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent);
+		bool isRecordingPass() const { return recordingPass; }
+		// Jobs that can record at the same time; render systems split draw lists into at most this many
+		uint32_t getLaneCount() const;
+
+		void record(Job job);
+		// Records every queued job and executes them, before vkCmdEndRenderPass on the primary buffer
+		void endPass(VkCommandBuffer primaryCommandBuffer);
+
+		const Stats& getStats() const { return stats; }
+		void printStats() const;
+
+		Settings settings;
+
+	private:
+		struct Lane {
+			VkCommandPool                pool = VK_NULL_HANDLE;
+			std::vector<VkCommandBuffer> commandBuffers;	// allocated so far, reused every frame
+			uint32_t                     used = 0;
+		};
+		struct Frame {
+			std::vector<Lane> lanes;
+		};
+
+		void recordLane(Lane& lane);
+		VkCommandBuffer acquire(Lane& lane);
+
+		VkcDevice&         device;
+		ThreadPool         workers;
+		std::vector<Frame> frames;
+
+		uint32_t currentFrame = 0;
+		bool     recordingPass = false;
+		VkCommandBufferInheritanceInfo inheritance{};
+		VkExtent2D extent{};
+
+		std::vector<Job>             jobs;
+		std::vector<VkCommandBuffer> recorded;		// by job, filled by the lanes
+		std::atomic<size_t>          nextJob{ 0 };
+		std::vector<std::future<void>> pending;
+
+		Stats stats;
+	};
+}
@@ -2,6 +2,11 @@
 #include "vk_descriptorManager.h"
 #include <vulkan/vulkan.h>
 
+// STD
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
 
 namespace vkc {
 
@@ -37,20 +42,37 @@ namespace vkc {
     }
 
     DescriptorManager& DescriptorManager::addBindlessTextures(const AssetManager& assetManager) {
-        auto allTextures = assetManager.getAllTextures();
-        _maxTextures = static_cast<uint32_t>(allTextures.size());
-
-        _imageInfos.clear();
-        _imageInfos.reserve(_maxTextures);
-
-        for (auto& tex : allTextures) {
-            if (tex->IsCubemap()) continue;
-            VkDescriptorImageInfo info{};
-            info.sampler = tex->GetSampler();
-            info.imageView = tex->GetImageView();
-            info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            _imageInfos.push_back(info);
+        _assetManager = &assetManager;
+
+        // Sized for everything that may ever be loaded, not what is loaded now; the
+        // other sets of a pipeline layout count against the same per-stage limits
+        constexpr uint32_t kReservedSamplers = 16;
+        const auto& limits = _device.descriptorIndexingProperties;
+        uint32_t capacity = kMaxBindlessTextures;
+        for (uint32_t limit : { limits.maxDescriptorSetUpdateAfterBindSampledImages,
+                                limits.maxDescriptorSetUpdateAfterBindSamplers,
+                                limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                limits.maxPerStageDescriptorUpdateAfterBindSamplers }) {
+            if (limit > kReservedSamplers) {
+                capacity = std::min(capacity, limit - kReservedSamplers);
+            }
         }
+        _maxTextures = capacity;
+
+        _slotInfos.assign(_maxTextures, VkDescriptorImageInfo{});
+        _slotDirtyFrames.assign(_maxTextures, 0);
+        _freeSlots.clear();
+        _retiringSlots.clear();
+        _assetSlotCount = 0;
+        _dynamicSlotBase = _maxTextures;
+        _bindlessStats = BindlessStats{};
+        _bindlessStats.capacity = _maxTextures;
+
+        _freeMaterials.clear();
+        _retiringMaterials.clear();
+        _materialHead = 0;
+        _models.clear();
+        _bindlessStats.materialCapacity = kMaxMaterials;
 
         return *this;
     }
@@ -67,9 +89,10 @@ namespace vkc {
     void DescriptorManager::buildLayouts() {
         // === Create Pool ===
         _pool = VkcDescriptorPool::Builder(_device)
-            .setMaxSets(_maxFrames + 2)  // frame sets + 1 texture set
+            .setMaxSets(_maxFrames * 2 + 1)  // frame sets + per-frame texture sets + skybox set
             .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, _maxFrames)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _maxTextures + 1)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _maxTextures * _maxFrames + 1)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _maxFrames)
             .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
             .build();
 
@@ -79,15 +102,17 @@ namespace vkc {
             .build();
 
         // === Texture Set Layout ===
+        // binding 0: the bindless heap, always allocated at full capacity
+        // binding 1: the material buffer
         _textureLayout = VkcDescriptorSetLayout::Builder(_device)
             .addBinding(
                 0,
                 VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                 VK_SHADER_STAGE_FRAGMENT_BIT,
                 _maxTextures,
-                VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT |
                 VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
                 VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
             .build();
 
         // === Skybox Cubemap Layout ===
@@ -111,6 +136,15 @@ namespace vkc {
                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
             _uboBuffers[i]->map();
         }
+
+        // === Material Buffer ===
+        _materialBuffer = std::make_unique<VkcBuffer>(
+            _device,
+            sizeof(GpuMaterial),
+            kMaxMaterials,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        _materialBuffer->map();
     }
 
     void DescriptorManager::createDescriptorSets() {
@@ -123,10 +157,28 @@ namespace vkc {
                 .build(_frameDescriptorSets[i]);
         }
 
-        // === Texture Set (Bindless) ===
-        VkcDescriptorWriter(*_textureLayout, *_pool)
-            .writeImage(0, _imageInfos.data(), static_cast<uint32_t>(_imageInfos.size()))
-            .build(_textureDescriptorSet);
+        // === Texture Sets (Bindless) ===
+        // Textures start out empty (partially bound); each frame slot is filled by
+        // its first refreshTextureDescriptors
+        _textureDescriptorSets.resize(_maxFrames);
+        _dirtySlots.assign(_maxFrames, {});
+        auto materialInfo = _materialBuffer->descriptorInfo();
+        for (uint32_t i = 0; i < _maxFrames; ++i) {
+            const bool allocated = VkcDescriptorWriter(*_textureLayout, *_pool)
+                .writeBuffer(1, &materialInfo)
+                .build(_textureDescriptorSets[i]);
+            if (!allocated) {
+                throw std::runtime_error("failed to allocate bindless texture set!");
+            }
+        }
+        // Slots set before the sets existed
+        std::fill(_slotDirtyFrames.begin(), _slotDirtyFrames.end(), 0u);
+        for (uint32_t slot = 0; slot < _maxTextures; ++slot) {
+            if (_slotInfos[slot].imageView != VK_NULL_HANDLE) {
+                markSlotDirty(slot);
+            }
+        }
+        syncAssetTextures();
 
         // === Texture set (Skybox) ===
         VkcDescriptorWriter(*_skyboxLayout, *_pool)
@@ -136,6 +188,262 @@ namespace vkc {
     }
 
 
+    void DescriptorManager::refreshTextureDescriptors(uint32_t frameIndex) {
+        ++_frameCounter;
+        _currentFrame = frameIndex;
+        releaseDestroyedModels();
+        recycleRetiredSlots();
+        syncAssetTextures();
+        writeDirtySlots(frameIndex);
+    }
+
+    void DescriptorManager::writeDirtySlots(uint32_t frameIndex) {
+        auto& dirty = _dirtySlots[frameIndex];
+        if (dirty.empty()) return;
+
+        const uint32_t frameBit = 1u << frameIndex;
+        std::vector<VkWriteDescriptorSet> writes;
+        writes.reserve(dirty.size());
+        for (uint32_t slot : dirty) {
+            _slotDirtyFrames[slot] &= ~frameBit;
+            // Released or evicted since it was marked: nothing samples it (partially bound)
+            if (_slotInfos[slot].imageView == VK_NULL_HANDLE) continue;
+
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = _textureDescriptorSets[frameIndex];
+            write.dstBinding = 0;
+            write.dstArrayElement = slot;
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write.pImageInfo = &_slotInfos[slot];
+            writes.push_back(write);
+        }
+        dirty.clear();
+
+        if (!writes.empty()) {
+            vkUpdateDescriptorSets(_device.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+            _bindlessStats.descriptorWrites += writes.size();
+            _bindlessStats.updateCalls++;
+        }
+    }
+
+    uint32_t DescriptorManager::allocateTextureSlot() {
+        uint32_t slot = UINT32_MAX;
+        if (!_freeSlots.empty()) {
+            slot = _freeSlots.back();
+            _freeSlots.pop_back();
+        }
+        else if (_dynamicSlotBase > _assetSlotCount) {
+            slot = --_dynamicSlotBase;
+        }
+        else {
+            std::cerr << "DescriptorManager: bindless texture heap is full (" << _maxTextures << " slots)\n";
+            return UINT32_MAX;
+        }
+        _bindlessStats.slotAllocations++;
+        _bindlessStats.allocatedSlots++;
+        return slot;
+    }
+
+    void DescriptorManager::setTextureSlot(uint32_t slot, VkSampler sampler, VkImageView view) {
+        VkDescriptorImageInfo& info = _slotInfos[slot];
+        if (info.sampler == sampler && info.imageView == view) return;
+        info = { sampler, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+        markSlotDirty(slot);
+    }
+
+    void DescriptorManager::releaseTextureSlot(uint32_t slot) {
+        // The descriptor stays as it is; frames still in flight may sample it
+        _slotInfos[slot] = VkDescriptorImageInfo{};
+        _retiringSlots.emplace_back(slot, _frameCounter + _maxFrames);
+        _bindlessStats.slotReleases++;
+        _bindlessStats.allocatedSlots--;
+        _bindlessStats.retiringSlots++;
+    }
+
+    void DescriptorManager::markSlotDirty(uint32_t slot) {
+        const uint32_t allFrames = (1u << _maxFrames) - 1;
+        for (uint32_t frame = 0; frame < _dirtySlots.size(); ++frame) {
+            if ((_slotDirtyFrames[slot] & (1u << frame)) == 0) {
+                _dirtySlots[frame].push_back(slot);
+            }
+        }
+        _slotDirtyFrames[slot] = allFrames;
+    }
+
+    void DescriptorManager::syncAssetTextures() {
+        if (!_assetManager) return;
+
+        // Looked up every time: a reloaded texture replaces the one in its slot, and
+        // streamed mips swap the view
+        const auto& textures = _assetManager->getAllTextures();
+        const uint32_t count = static_cast<uint32_t>(std::min<size_t>(textures.size(), _dynamicSlotBase));
+        if (count < textures.size()) {
+            static bool warned = false;
+            if (!warned) {
+                std::cerr << "DescriptorManager: " << textures.size() - count
+                    << " textures do not fit the bindless texture heap\n";
+                warned = true;
+            }
+        }
+        _assetSlotCount = std::max(_assetSlotCount, count);
+        _bindlessStats.assetSlots = _assetSlotCount;
+
+        for (uint32_t index = 0; index < count; ++index) {
+            const auto& tex = textures[index];
+            if (!tex || tex->IsCubemap()) {
+                // Evicted: forget the view so a new one reusing the handle still gets written
+                _slotInfos[index] = VkDescriptorImageInfo{};
+                continue;
+            }
+            setTextureSlot(index, tex->GetSampler(), tex->GetImageView());
+        }
+    }
+
+    void DescriptorManager::recycleRetiredSlots() {
+        // Released in frame order, so the oldest are at the front
+        while (!_retiringSlots.empty() && _retiringSlots.front().second <= _frameCounter) {
+            _freeSlots.push_back(_retiringSlots.front().first);
+            _retiringSlots.pop_front();
+            _bindlessStats.retiringSlots--;
+        }
+
+        bool recycledMaterials = false;
+        while (!_retiringMaterials.empty() && _retiringMaterials.front().reusableFrame <= _frameCounter) {
+            _freeMaterials.push_back(_retiringMaterials.front());
+            _retiringMaterials.pop_front();
+            recycledMaterials = true;
+        }
+        if (recycledMaterials) {
+            std::sort(_freeMaterials.begin(), _freeMaterials.end(),
+                [](const MaterialRange& a, const MaterialRange& b) { return a.first < b.first; });
+            std::vector<MaterialRange> merged;
+            for (const MaterialRange& range : _freeMaterials) {
+                if (!merged.empty() && merged.back().first + merged.back().count == range.first) {
+                    merged.back().count += range.count;
+                }
+                else {
+                    merged.push_back(range);
+                }
+            }
+            _freeMaterials = std::move(merged);
+        }
+    }
+
+    uint32_t DescriptorManager::allocateMaterials(uint32_t count) {
+        if (count == 0) return 0;
+        // First fit among recycled ranges, then the untouched tail
+        for (auto it = _freeMaterials.begin(); it != _freeMaterials.end(); ++it) {
+            if (it->count < count) continue;
+            const uint32_t first = it->first;
+            it->first += count;
+            it->count -= count;
+            if (it->count == 0) {
+                _freeMaterials.erase(it);
+            }
+            _bindlessStats.allocatedMaterials += count;
+            return first;
+        }
+        if (kMaxMaterials - _materialHead < count) {
+            return UINT32_MAX;
+        }
+        const uint32_t first = _materialHead;
+        _materialHead += count;
+        _bindlessStats.allocatedMaterials += count;
+        return first;
+    }
+
+    void DescriptorManager::writeMaterial(uint32_t index, const GpuMaterial& material) {
+        GpuMaterial copy = material;
+        _materialBuffer->writeToIndex(&copy, static_cast<int>(index));
+    }
+
+    void DescriptorManager::releaseMaterials(uint32_t first, uint32_t count) {
+        if (count == 0) return;
+        _retiringMaterials.push_back({ first, count, _frameCounter + _maxFrames });
+        _bindlessStats.allocatedMaterials -= count;
+    }
+
+    bool DescriptorManager::registerModel(const std::shared_ptr<vkglTF::Model>& model) {
+        ModelBinding binding;
+        binding.model = model;
+        binding.materialCount = static_cast<uint32_t>(model->materials.size());
+        binding.firstMaterial = allocateMaterials(binding.materialCount);
+        if (binding.firstMaterial == UINT32_MAX) {
+            static bool warned = false;
+            if (!warned) {
+                std::cerr << "DescriptorManager: material buffer is full (" << kMaxMaterials
+                    << " entries), skipping " << model->path << "\n";
+                warned = true;
+            }
+            return false;
+        }
+
+        // A full heap leaves the texture out; the shaders treat it as absent
+        for (vkglTF::Texture& texture : model->textures) {
+            texture.bindlessSlot = allocateTextureSlot();
+            if (texture.bindlessSlot == GpuMaterial::NO_TEXTURE) continue;
+            setTextureSlot(texture.bindlessSlot, texture.sampler, texture.view);
+            binding.textureSlots.push_back(texture.bindlessSlot);
+        }
+
+        auto slotOf = [](const vkglTF::Texture* texture) {
+            return texture ? texture->bindlessSlot : GpuMaterial::NO_TEXTURE;
+        };
+        for (const vkglTF::Material& material : model->materials) {
+            GpuMaterial gpu;
+            gpu.baseColorFactor = material.baseColorFactor;
+            gpu.emissiveFactor = glm::vec4(material.emissiveFactor, 0.0f);
+            gpu.metallicFactor = material.metallicFactor;
+            gpu.roughnessFactor = material.roughnessFactor;
+            gpu.alphaCutoff = material.alphaCutoff;
+            gpu.alphaMode = static_cast<uint32_t>(material.alphaMode);
+            gpu.baseColorTexture = slotOf(material.baseColorTexture);
+            gpu.normalTexture = slotOf(material.normalTexture);
+            gpu.metallicRoughnessTexture = slotOf(material.metallicRoughnessTexture);
+            gpu.occlusionTexture = slotOf(material.occlusionTexture);
+            gpu.emissiveTexture = slotOf(material.emissiveTexture);
+            writeMaterial(binding.firstMaterial + material.index, gpu);
+        }
+        model->materialBase = binding.firstMaterial;
+
+        // The frame being recorded samples them already; update-after-bind allows
+        // the write until it is submitted
+        writeDirtySlots(_currentFrame);
+
+        _models.push_back(std::move(binding));
+        _bindlessStats.registeredModels++;
+        return true;
+    }
+
+    void DescriptorManager::releaseDestroyedModels() {
+        for (size_t i = 0; i < _models.size();) {
+            ModelBinding& binding = _models[i];
+            if (!binding.model.expired()) {
+                ++i;
+                continue;
+            }
+            for (uint32_t slot : binding.textureSlots) {
+                releaseTextureSlot(slot);
+            }
+            releaseMaterials(binding.firstMaterial, binding.materialCount);
+            _models[i] = std::move(_models.back());
+            _models.pop_back();
+            _bindlessStats.registeredModels--;
+        }
+    }
+
+    void DescriptorManager::printBindlessStats() const {
+        const BindlessStats& stats = _bindlessStats;
+        std::cout << "Bindless textures: " << stats.assetSlots << " asset + " << stats.allocatedSlots
+            << " allocated slots of " << stats.capacity << " (" << stats.retiringSlots << " retiring, "
+            << _freeSlots.size() << " free to reuse), " << stats.slotAllocations << " allocations, "
+            << stats.slotReleases << " releases, " << stats.descriptorWrites << " descriptor writes in "
+            << stats.updateCalls << " updates; " << stats.allocatedMaterials << " of " << stats.materialCapacity
+            << " materials in use by " << stats.registeredModels << " glTF models\n";
+    }
+
     std::vector<VkDescriptorSet> DescriptorManager::createFrameUniformSets() {
         std::vector<VkDescriptorSet> sets(_maxFrames);
         for (uint32_t i = 0; i < _maxFrames; i++) {
@@ -182,8 +490,8 @@ namespace vkc {
         return _frameDescriptorSets;
     }
 
-    VkDescriptorSet DescriptorManager::getTextureDescriptorSet() const {
-        return _textureDescriptorSet;
+    VkDescriptorSet DescriptorManager::getTextureDescriptorSet(uint32_t frameIndex) const {
+        return _textureDescriptorSets[frameIndex];
     }
     VkDescriptorSet DescriptorManager::getSkyboxDescriptorSet() const {
         return _skyboxDescriptorSet;
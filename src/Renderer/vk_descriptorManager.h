@@ -1,9 +1,13 @@
 #pragma once
 #include "VK_abstraction/vk_descriptors.h"
 #include "VK_abstraction/vk_buffer.h"
+#include "VK_abstraction/vk_frameInfo.h"
 #include "Game/vk_scene.h"
 #include "AppCore/vk_assetManager.h"
 
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <vector>
 
 namespace vkc {
@@ -36,6 +40,60 @@ namespace vkc {
 
         void createDescriptorSets();
 
+        // Brings this frame slot's bindless set up to date: picks up textures the
+        // asset manager loaded or swapped (streamed mips, hot reload), recycles
+        // released heap slots and writes only the entries that changed since the
+        // set was last used. Call once per frame, after the slot's previous frame
+        // has finished and before recording.
+        void refreshTextureDescriptors(uint32_t frameIndex);
+
+        // === Bindless texture heap ===
+        // Asset manager textures keep their texture index as their heap slot, so
+        // shaders index the array with it directly. Everything else (materials,
+        // render target views, ...) takes a slot from the top of the heap down.
+        // Main thread only.
+
+        // Free slot, or UINT32_MAX when the heap is full
+        uint32_t allocateTextureSlot();
+        // Points the slot at a texture; written into each frame's set by its next refresh
+        void setTextureSlot(uint32_t slot, VkSampler sampler, VkImageView view);
+        // The slot is handed out again only once every frame in flight that could
+        // still sample it has retired
+        void releaseTextureSlot(uint32_t slot);
+
+        // === Material buffer ===
+        // Binding 1 of the bindless set: GpuMaterial entries in one host-visible
+        // buffer of fixed capacity. Entries only change while unused, so every
+        // frame in flight shares the buffer; released ranges are recycled like
+        // texture slots. Main thread only.
+
+        // First of count consecutive entries, or UINT32_MAX when the buffer is full
+        uint32_t allocateMaterials(uint32_t count);
+        void writeMaterial(uint32_t index, const GpuMaterial& material);
+        void releaseMaterials(uint32_t first, uint32_t count);
+
+        // Gives a glTF model's images bindless slots and its materials entries in
+        // the material buffer (Model::materialBase), written into the current
+        // frame's set right away. Both are released once the model is destroyed.
+        // False, with nothing allocated, when the material buffer is full.
+        bool registerModel(const std::shared_ptr<vkglTF::Model>& model);
+
+        struct BindlessStats {
+            uint32_t capacity = 0;
+            uint32_t assetSlots = 0;          // reserved by asset manager textures
+            uint32_t allocatedSlots = 0;      // handed out by allocateTextureSlot, not yet released
+            uint32_t retiringSlots = 0;       // released, waiting for the frames in flight
+            uint64_t slotAllocations = 0;
+            uint64_t slotReleases = 0;
+            uint64_t descriptorWrites = 0;    // individual array elements written
+            uint64_t updateCalls = 0;         // vkUpdateDescriptorSets calls
+            uint32_t materialCapacity = 0;
+            uint32_t allocatedMaterials = 0;
+            uint32_t registeredModels = 0;
+        };
+        const BindlessStats& getBindlessStats() const { return _bindlessStats; }
+        void printBindlessStats() const;
+
         std::vector<VkDescriptorSet> createFrameUniformSets();
         VkDescriptorSet              createTextureSet(
             const std::vector<VkDescriptorImageInfo>& infos);
@@ -47,7 +105,9 @@ namespace vkc {
 
         const std::vector<VkDescriptorSet>& getGlobalDescriptorSets() const;
 
-        VkDescriptorSet getTextureDescriptorSet() const;
+        // One bindless set per frame in flight, so streaming can update one slot
+        // while the other is still in use
+        VkDescriptorSet getTextureDescriptorSet(uint32_t frameIndex) const;
         VkDescriptorSet getSkyboxDescriptorSet() const;
 
         const std::vector<std::unique_ptr<VkcBuffer>>& getUboBuffers() const;
@@ -59,16 +119,60 @@ namespace vkc {
         std::unique_ptr<VkcDescriptorSetLayout>              _textureLayout;
         std::unique_ptr<VkcDescriptorSetLayout>              _skyboxLayout;
 
+        // Upper bound of the heap; clamped to the device's update-after-bind limits
+        static constexpr uint32_t kMaxBindlessTextures = 16384;
+        static constexpr uint32_t kMaxMaterials = 4096;
+
+        void markSlotDirty(uint32_t slot);
+        void writeDirtySlots(uint32_t frameIndex);
+        void syncAssetTextures();
+        void releaseDestroyedModels();
+        void recycleRetiredSlots();
+
         size_t                                               _uboSize           = 0;
         uint32_t                                             _maxFrames         = 0;
-        uint32_t                                             _maxTextures       = 1000;
+        uint32_t                                             _maxTextures       = 0;
 
         // Owned resources
         std::vector<std::unique_ptr<VkcBuffer>>                         _uboBuffers;
         std::vector<VkDescriptorSet>                           _frameDescriptorSets;
-        VkDescriptorSet                     _textureDescriptorSet{ VK_NULL_HANDLE };
-        std::vector<VkDescriptorImageInfo>                              _imageInfos;
-        
+        std::vector<VkDescriptorSet>                           _textureDescriptorSets;
+        const AssetManager*                                    _assetManager      = nullptr;
+
+        // Bindless heap: what each array element should hold, and which elements
+        // each frame's set still has to be written with
+        std::vector<VkDescriptorImageInfo>                     _slotInfos;
+        std::vector<uint32_t>                                  _slotDirtyFrames;      // bit per frame set
+        std::vector<std::vector<uint32_t>>                     _dirtySlots;           // per frame set
+        std::vector<uint32_t>                                  _freeSlots;
+        std::deque<std::pair<uint32_t, uint64_t>>              _retiringSlots;        // slot, reusable from frame
+        uint32_t                                               _assetSlotCount    = 0;    // [0, count) mirror asset textures
+        uint32_t                                               _dynamicSlotBase   = 0;    // [base, capacity) handed out so far
+        uint64_t                                               _frameCounter      = 0;
+        uint32_t                                               _currentFrame      = 0;
+
+        // Material buffer: free ranges are kept sorted and merged
+        struct MaterialRange {
+            uint32_t first = 0;
+            uint32_t count = 0;
+            uint64_t reusableFrame = 0;
+        };
+        std::unique_ptr<VkcBuffer>                             _materialBuffer;
+        std::vector<MaterialRange>                             _freeMaterials;
+        std::deque<MaterialRange>                              _retiringMaterials;
+        uint32_t                                               _materialHead      = 0;
+
+        // Bindless resources of registered glTF models, released when they expire
+        struct ModelBinding {
+            std::weak_ptr<vkglTF::Model> model;
+            std::vector<uint32_t>        textureSlots;
+            uint32_t                     firstMaterial = 0;
+            uint32_t                     materialCount = 0;
+        };
+        std::vector<ModelBinding>                              _models;
+        BindlessStats                                          _bindlessStats;
+
+
         VkDescriptorSet                                        _skyboxDescriptorSet;
         VkDescriptorImageInfo                                      _skyboxImageInfo;
     };
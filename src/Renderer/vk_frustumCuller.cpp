@@ -0,0 +1,130 @@
+// vk_frustumCuller.cpp
+#include "vk_frustumCuller.h"
+
+// External
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VKC_FRUSTUM_SSE 1
+#include <emmintrin.h>
+#endif
+
+// STD
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+namespace vkc
+{
+	Frustum Frustum::fromViewProjection(const glm::mat4& viewProjection)
+	{
+		auto row = [&](int i) {
+			return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		};
+		Frustum frustum;
+		frustum.planes[0] = row(3) + row(0);
+		frustum.planes[1] = row(3) - row(0);
+		frustum.planes[2] = row(3) + row(1);
+		frustum.planes[3] = row(3) - row(1);
+		frustum.planes[4] = row(2);
+		frustum.planes[5] = row(3) - row(2);
+		for (glm::vec4& plane : frustum.planes) {
+			const float length = glm::length(glm::vec3(plane));
+			plane = length > 1e-6f ? plane / length : glm::vec4(0.f, 0.f, 0.f, 1.f);
+		}
+		return frustum;
+	}
+
+	bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+	{
+		for (const glm::vec4& plane : planes) {
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+				return false;
+		}
+		return true;
+	}
+
+	glm::vec4 transformSphere(const glm::mat4& transform, const glm::vec4& sphere)
+	{
+		const float scale = std::max({ glm::length(glm::vec3(transform[0])),
+			glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+		const glm::vec3 center = glm::vec3(transform * glm::vec4(glm::vec3(sphere), 1.f));
+		return glm::vec4(center, sphere.w * scale);
+	}
+
+	void VkcFrustumCuller::begin(const Frustum& newFrustum)
+	{
+		frustum = newFrustum;
+		centerX.clear();
+		centerY.clear();
+		centerZ.clear();
+		radius.clear();
+		visibility.clear();
+		stats = Stats{};
+	}
+
+	uint32_t VkcFrustumCuller::add(const glm::vec4& sphere)
+	{
+		centerX.push_back(sphere.x);
+		centerY.push_back(sphere.y);
+		centerZ.push_back(sphere.z);
+		radius.push_back(sphere.w);
+		return static_cast<uint32_t>(radius.size() - 1);
+	}
+
+	void VkcFrustumCuller::run()
+	{
+		const size_t count = radius.size();
+		visibility.assign(count, 0);
+
+		size_t first = 0;
+#if VKC_FRUSTUM_SSE
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; p++) {
+			planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+			planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+			planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+			planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+		}
+		// Four spheres per iteration: a lane stays set while its sphere is not
+		// entirely behind any plane
+		for (; first + 4 <= count; first += 4) {
+			const __m128 x = _mm_loadu_ps(centerX.data() + first);
+			const __m128 y = _mm_loadu_ps(centerY.data() + first);
+			const __m128 z = _mm_loadu_ps(centerZ.data() + first);
+			const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius.data() + first));
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				const __m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p])),
+					_mm_add_ps(_mm_mul_ps(z, planeZ[p]), planeW[p]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+			}
+			const int mask = _mm_movemask_ps(inside);
+			visibility[first + 0] = static_cast<uint8_t>(mask & 1);
+			visibility[first + 1] = static_cast<uint8_t>((mask >> 1) & 1);
+			visibility[first + 2] = static_cast<uint8_t>((mask >> 2) & 1);
+			visibility[first + 3] = static_cast<uint8_t>((mask >> 3) & 1);
+		}
+#endif
+		runScalar(first, count - first);
+
+		stats.tested = static_cast<uint32_t>(count);
+		stats.visible = static_cast<uint32_t>(std::count(visibility.begin(), visibility.end(), uint8_t(1)));
+	}
+
+	void VkcFrustumCuller::runScalar(size_t first, size_t count)
+	{
+		for (size_t i = first; i < first + count; i++) {
+			visibility[i] = frustum.intersectsSphere(glm::vec3(centerX[i], centerY[i], centerZ[i]), radius[i]) ? 1 : 0;
+		}
+	}
+
+	void VkcFrustumCuller::printStats(const std::string& label) const
+	{
+		const uint32_t culled = stats.tested - stats.visible;
+		const double culledPercent = stats.tested > 0 ? 100.0 * culled / stats.tested : 0.0;
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << label << ": " << stats.visible << " visible, " << culled << " culled of "
+			<< stats.tested << " (" << culledPercent << "%)\n";
+		std::cout.unsetf(std::ios::floatfield);
+	}
+}
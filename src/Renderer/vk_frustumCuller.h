@@ -0,0 +1,70 @@
+// vk_frustumCuller.h
+#pragma once
+
+// External
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// STD
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vkc
+{
+	// World-space view frustum: six planes with normals pointing inwards, so a
+	// point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them
+	struct Frustum {
+		glm::vec4 planes[6];
+
+		// From projection * view, with depth in [0, 1]. An infinite far plane
+		// comes out as (0, 0, 0, 1) and culls nothing.
+		static Frustum fromViewProjection(const glm::mat4& viewProjection);
+
+		bool intersectsSphere(const glm::vec3& center, float radius) const;
+	};
+
+	// Model-space bounding sphere (xyz centre, w radius) placed by transform; the
+	// radius grows with the transform's largest axis scale
+	glm::vec4 transformSphere(const glm::mat4& transform, const glm::vec4& sphere);
+
+	// Tests batches of world-space bounding spheres against a frustum. Render
+	// systems add() the bounds of everything they could draw this frame, run()
+	// once, then draw only what isVisible(). Spheres are kept as separate x, y, z
+	// and radius arrays so run() tests four at a time with SSE where available.
+	//
+	// Stats cover the last batch. Not thread-safe.
+	class VkcFrustumCuller
+	{
+	public:
+		struct Stats {
+			uint32_t tested = 0;
+			uint32_t visible = 0;
+		};
+
+		// Starts a new, empty batch against frustum
+		void begin(const Frustum& frustum);
+		// Index of the sphere in the batch
+		uint32_t add(const glm::vec4& sphere);
+		void run();
+
+		bool isVisible(uint32_t index) const { return visibility[index] != 0; }
+		uint32_t size() const { return static_cast<uint32_t>(radius.size()); }
+
+		const Stats& getStats() const { return stats; }
+		// One line, prefixed with label
+		void printStats(const std::string& label) const;
+
+	private:
+		void runScalar(size_t first, size_t count);
+
+		Frustum frustum{};
+		std::vector<float> centerX;
+		std::vector<float> centerY;
+		std::vector<float> centerZ;
+		std::vector<float> radius;
+		std::vector<uint8_t> visibility;
+		Stats stats;
+	};
+}
@@ -0,0 +1,360 @@
+// vk_gpuScene.cpp
+#include "vk_gpuScene.h"
+#include "VK_abstraction/vk_device.h"
+#include "VK_abstraction/vk_geometryArena.h"
+#include "Game/vk_scene.h"
+#include "Game/Camera/vk_camera.h"
+#include "Renderer/vk_frustumCuller.h"
+#include "Renderer/vk_lodSelector.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace vkc
+{
+	namespace {
+		constexpr uint32_t kNoMesh = ~0u;
+		constexpr uint32_t kCullGroupSize = 64;	// local_size_x of cull.comp
+
+		// Push constants of cull.comp
+		struct CullConstants {
+			glm::vec4 frustumPlanes[6];
+			glm::vec4 cameraPosition;	// w: pixels covered by one world unit at a distance of one unit
+			uint32_t  instanceCount = 0;
+			float     maxPixelError = 0.f;	// negative keeps every instance at level 0
+			uint32_t  _pad0 = 0, _pad1 = 0;
+		};
+		static_assert(sizeof(CullConstants) <= 128, "cull push constants exceed the guaranteed minimum");
+
+		std::string cullShaderPath()
+		{
+			return std::string(PROJECT_ROOT_DIR) + "/res/shaders/SpirV/cull.comp.spv";
+		}
+	}
+
+	VkcGpuScene::VkcGpuScene(VkcDevice& device, uint32_t frameCount)
+		: device{ device }, frames(frameCount)
+	{
+		createLayouts();
+		for (Frame& frame : frames) {
+			if (!descriptorPool->allocateDescriptor(setLayout->getDescriptorSetLayout(), frame.set, 0)) {
+				throw std::runtime_error("VkcGpuScene: failed to allocate descriptor set");
+			}
+			createFrameBuffers(frame, 1024, 64);
+		}
+	}
+
+	VkcGpuScene::~VkcGpuScene()
+	{
+		for (Frame& frame : frames) {
+			destroyFrameBuffers(frame);
+		}
+		cullPipeline.reset();
+		vkDestroyPipelineLayout(device.device(), cullLayout, nullptr);
+	}
+
+	bool VkcGpuScene::isSupported(const VkcDevice& device)
+	{
+		if (!device.drawIndirectCountSupported) {
+			std::cout << "VkcGpuScene: disabled, the device lacks drawIndirectCount, multiDrawIndirect or drawIndirectFirstInstance\n";
+			return false;
+		}
+		if (!std::filesystem::exists(cullShaderPath())) {
+			std::cout << "VkcGpuScene: disabled, " << cullShaderPath() << " not found (is the CompileShaders target built?)\n";
+			return false;
+		}
+		return true;
+	}
+
+	void VkcGpuScene::createLayouts()
+	{
+		setLayout = VkcDescriptorSetLayout::Builder(device)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.build();
+
+		// Set layouts are created update-after-bind, so their pools have to be too
+		const uint32_t frameCount = static_cast<uint32_t>(frames.size());
+		descriptorPool = VkcDescriptorPool::Builder(device)
+			.setMaxSets(frameCount)
+			.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * frameCount)
+			.build();
+
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(CullConstants);
+
+		VkDescriptorSetLayout layout = setLayout->getDescriptorSetLayout();
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &layout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &cullLayout) != VK_SUCCESS) {
+			throw std::runtime_error("VkcGpuScene: failed to create pipeline layout");
+		}
+
+		cullPipeline = std::make_unique<VkcPipeline>(device, cullShaderPath(), cullLayout);
+	}
+
+	void VkcGpuScene::createFrameBuffers(Frame& frame, uint32_t instanceCapacity, uint32_t meshCapacity)
+	{
+		device.createBuffer(
+			sizeof(GpuInstance) * instanceCapacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.instanceBuffer, frame.instanceAllocation);
+		VK_CHECK_RESULT(device.allocator().map(frame.instanceAllocation, &frame.instanceMapped));
+		frame.instanceCapacity = instanceCapacity;
+
+		device.createBuffer(
+			sizeof(GpuMesh) * meshCapacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.meshBuffer, frame.meshAllocation);
+		VK_CHECK_RESULT(device.allocator().map(frame.meshAllocation, &frame.meshMapped));
+		frame.meshCapacity = meshCapacity;
+
+		// At most one draw per instance
+		device.createBuffer(
+			sizeof(VkDrawIndexedIndirectCommand) * instanceCapacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			frame.drawBuffer, frame.drawAllocation);
+
+		// Host visible so the counts of a finished frame can be read back for stats
+		device.createBuffer(
+			sizeof(uint32_t) * BucketCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.countBuffer, frame.countAllocation);
+		void* countMapped = nullptr;
+		VK_CHECK_RESULT(device.allocator().map(frame.countAllocation, &countMapped));
+		frame.countMapped = static_cast<const uint32_t*>(countMapped);
+		frame.culled = false;
+
+		VkDescriptorBufferInfo instanceInfo{ frame.instanceBuffer, 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo meshInfo{ frame.meshBuffer, 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo drawInfo{ frame.drawBuffer, 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo countInfo{ frame.countBuffer, 0, VK_WHOLE_SIZE };
+		VkcDescriptorWriter(*setLayout, *descriptorPool)
+			.writeBuffer(0, &instanceInfo)
+			.writeBuffer(1, &meshInfo)
+			.writeBuffer(2, &drawInfo)
+			.writeBuffer(3, &countInfo)
+			.overwrite(frame.set);
+	}
+
+	void VkcGpuScene::destroyFrameBuffers(Frame& frame)
+	{
+		if (frame.instanceBuffer == VK_NULL_HANDLE)
+			return;
+		device.allocator().unmap(frame.instanceAllocation);
+		device.allocator().unmap(frame.meshAllocation);
+		device.allocator().unmap(frame.countAllocation);
+		device.destroyBuffer(frame.instanceBuffer, frame.instanceAllocation);
+		device.destroyBuffer(frame.meshBuffer, frame.meshAllocation);
+		device.destroyBuffer(frame.drawBuffer, frame.drawAllocation);
+		device.destroyBuffer(frame.countBuffer, frame.countAllocation);
+
+		const VkDescriptorSet set = frame.set;
+		frame = Frame{};
+		frame.set = set;
+	}
+
+	void VkcGpuScene::rebuild(Scene& scene)
+	{
+		instances.clear();
+		meshes.clear();
+		meshModels.clear();
+		fallbackObjects.clear();
+
+		std::unordered_map<const IModel*, uint32_t> meshIndex;
+		std::array<uint32_t, BucketCount> counts{};
+
+		for (auto& [id, obj] : scene.getGameObjects()) {
+			if (!obj.model || obj.isSkybox)
+				continue;
+
+			auto found = meshIndex.find(obj.model.get());
+			if (found == meshIndex.end()) {
+				const IModel& model = *obj.model;
+				IModel::IndexedDraw draw;
+				if (!model.getIndexedDraw(0, draw)) {
+					found = meshIndex.emplace(&model, kNoMesh).first;
+				}
+				else {
+					GpuMesh mesh;
+					const bool packed = model.hasPackedVertices();
+					if (packed) {
+						mesh.positionDecode = model.getPositionDecode();
+					}
+					mesh.boundingSphere = model.getBoundingSphere();
+					mesh.vertexOffset = draw.vertexOffset;
+					mesh.bucket = (packed ? Packed32 : Unpacked32) + (draw.indexType == VK_INDEX_TYPE_UINT16 ? 1u : 0u);
+					mesh.lodCount = std::min(model.getLodCount(), MAX_LODS);
+					for (uint32_t level = 0; level < mesh.lodCount; level++) {
+						model.getIndexedDraw(level, draw);
+						mesh.lods[level].firstIndex = draw.firstIndex;
+						mesh.lods[level].indexCount = draw.indexCount;
+						mesh.lods[level].error = model.getLodError(level);
+					}
+					found = meshIndex.emplace(&model, static_cast<uint32_t>(meshes.size())).first;
+					meshes.push_back(mesh);
+					meshModels.push_back(obj.model);
+				}
+			}
+			if (found->second == kNoMesh) {
+				fallbackObjects.push_back(id);
+				continue;
+			}
+
+			GpuInstance instance;
+			instance.modelMatrix = obj.transform.mat4();
+			instance.normalMatrix = glm::mat4(obj.transform.normalMatrix());
+			instance.mesh = found->second;
+			instance.textureIndex = obj.textureIndex;
+			instances.push_back(instance);
+			counts[meshes[instance.mesh].bucket]++;
+		}
+
+		// Each bucket owns a contiguous run of draw commands, one per instance
+		uint32_t base = 0;
+		for (uint32_t bucket = 0; bucket < BucketCount; bucket++) {
+			bucketBase[bucket] = base;
+			bucketCapacity[bucket] = counts[bucket];
+			base += counts[bucket];
+		}
+		for (GpuMesh& mesh : meshes) {
+			mesh.drawBase = bucketBase[mesh.bucket];
+		}
+
+		sceneVersion = scene.getObjectsVersion();
+		arenaVersion = device.geometryArena().getVersion();
+		builtScene = &scene;
+		contentVersion++;
+
+		stats.instances = static_cast<uint32_t>(instances.size());
+		stats.meshes = static_cast<uint32_t>(meshes.size());
+		stats.fallbackObjects = static_cast<uint32_t>(fallbackObjects.size());
+		stats.rebuilds++;
+	}
+
+	void VkcGpuScene::uploadFrame(Frame& frame)
+	{
+		// Only called for a frame slot whose fence has signalled
+		const uint32_t instanceCount = static_cast<uint32_t>(instances.size());
+		const uint32_t meshCount = static_cast<uint32_t>(meshes.size());
+		if (instanceCount > frame.instanceCapacity || meshCount > frame.meshCapacity) {
+			const uint32_t instanceCapacity = std::max(instanceCount, frame.instanceCapacity * 2);
+			const uint32_t meshCapacity = std::max(meshCount, frame.meshCapacity * 2);
+			destroyFrameBuffers(frame);
+			createFrameBuffers(frame, instanceCapacity, meshCapacity);
+		}
+		if (instanceCount > 0) {
+			std::memcpy(frame.instanceMapped, instances.data(), sizeof(GpuInstance) * instanceCount);
+		}
+		if (meshCount > 0) {
+			std::memcpy(frame.meshMapped, meshes.data(), sizeof(GpuMesh) * meshCount);
+		}
+		frame.contentVersion = contentVersion;
+	}
+
+	void VkcGpuScene::cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, Scene& scene,
+		const VkcCamera& camera, const VkcLodSelector& lodSelector)
+	{
+		if (&scene != builtScene || scene.getObjectsVersion() != sceneVersion ||
+			device.geometryArena().getVersion() != arenaVersion) {
+			rebuild(scene);
+		}
+
+		Frame& frame = frames[frameIndex];
+		// The previous frame in this slot has finished, so its counts are final
+		if (frame.culled) {
+			stats.drawn = 0;
+			for (uint32_t bucket = 0; bucket < BucketCount; bucket++) {
+				stats.drawn += frame.countMapped[bucket];
+			}
+		}
+		if (frame.contentVersion != contentVersion) {
+			uploadFrame(frame);
+		}
+		frame.culled = false;
+		if (instances.empty())
+			return;
+
+		vkCmdFillBuffer(commandBuffer, frame.countBuffer, 0, sizeof(uint32_t) * BucketCount, 0);
+		VkMemoryBarrier clearBarrier{};
+		clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+		CullConstants constants{};
+		const glm::mat4 viewProjection = camera.getProjection() * camera.getView();
+		if (settings.frustumCulling) {
+			const Frustum frustum = Frustum::fromViewProjection(viewProjection);
+			std::copy(std::begin(frustum.planes), std::end(frustum.planes), std::begin(constants.frustumPlanes));
+		}
+		else {
+			std::fill(std::begin(constants.frustumPlanes), std::end(constants.frustumPlanes), glm::vec4(0.f, 0.f, 0.f, 1.f));
+		}
+		constants.cameraPosition = glm::vec4(camera.getPosition(),
+			0.5f * lodSelector.getViewportHeight() * std::abs(camera.getProjection()[1][1]));
+		constants.instanceCount = static_cast<uint32_t>(instances.size());
+		constants.maxPixelError = lodSelector.settings.enabled ? lodSelector.settings.maxPixelError : -1.f;
+
+		cullPipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullLayout, 0, 1, &frame.set, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+		vkCmdDispatch(commandBuffer, (constants.instanceCount + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+
+		// Draw commands and counts for the indirect draws, counts also for the stats readback
+		VkMemoryBarrier cullBarrier{};
+		cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+			0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+		frame.culled = true;
+	}
+
+	void VkcGpuScene::drawBucket(VkCommandBuffer commandBuffer, uint32_t frameIndex, Bucket bucket)
+	{
+		const Frame& frame = frames[frameIndex];
+		if (!frame.culled || bucketCapacity[bucket] == 0)
+			return;
+
+		const bool index16 = bucket == Unpacked16 || bucket == Packed16;
+		device.geometryArena().bindIndexType(commandBuffer, index16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexedIndirectCount(
+			commandBuffer,
+			frame.drawBuffer,
+			sizeof(VkDrawIndexedIndirectCommand) * bucketBase[bucket],
+			frame.countBuffer,
+			sizeof(uint32_t) * bucket,
+			bucketCapacity[bucket],
+			sizeof(VkDrawIndexedIndirectCommand));
+	}
+
+	void VkcGpuScene::printStats() const
+	{
+		std::cout << "GPU scene (" << (settings.enabled ? "on" : "off") << "): " << stats.instances
+			<< " instances of " << stats.meshes << " meshes, " << stats.drawn << " drawn in the last finished frame, "
+			<< stats.fallbackObjects << " objects on the CPU path, " << stats.rebuilds << " rebuilds\n";
+	}
+}
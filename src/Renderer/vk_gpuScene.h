@@ -0,0 +1,178 @@
+// vk_gpuScene.h
+#pragma once
+#include "VK_abstraction/vk_IModel.hpp"
+#include "VK_abstraction/vk_descriptors.h"
+#include "VK_abstraction/vk_pipeline.h"
+#include "Game/vk_gameObject.h"
+
+// External
+#include <vk_mem_alloc.h>
+
+// STD
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace vkc
+{
+	class VkcCamera;
+	class VkcDevice;
+	class VkcLodSelector;
+	class Scene;
+
+	// GPU-driven drawing of the scene's meshes. Every object whose model reports
+	// an IModel::IndexedDraw gets an entry in a persistent instance buffer, and
+	// every distinct model an entry in a mesh table with its bounds and LOD chain.
+	// Each frame a compute pass frustum-culls the instances, picks their level of
+	// detail and appends one VkDrawIndexedIndirectCommand per visible instance to
+	// its bucket; render systems then issue one vkCmdDrawIndexedIndirectCount per
+	// bucket with firstInstance as the instance index (gl_InstanceIndex).
+	//
+	// Buckets split draws by vertex layout (packed or not) and index type, the two
+	// things a single indirect draw can't vary. Objects whose models can't be
+	// drawn that way are listed by getFallbackObjects() for the CPU path.
+	//
+	// The buffers are rebuilt only when Scene::getObjectsVersion() or the geometry
+	// arena's version changes, so recording cost doesn't grow with the object
+	// count. LOD selection matches VkcLodSelector without its hysteresis, as no
+	// per-object history survives between frames.
+	//
+	// Descriptor set (set 2 of the pipelines that read it):
+	//  binding 0 instances, binding 1 mesh table, both vertex and compute;
+	//  binding 2 draw commands and binding 3 draw counts, compute only.
+	//
+	// Needs VkcDevice::drawIndirectCountSupported. Main (render) thread only, except
+	// drawBucket(), which only reads and may record on any thread.
+	class VkcGpuScene
+	{
+	public:
+		static constexpr uint32_t MAX_LODS = 8;
+
+		enum Bucket : uint32_t {
+			Unpacked32,
+			Unpacked16,
+			Packed32,
+			Packed16,
+			BucketCount
+		};
+
+		// std430 layouts shared with res/shaders/cull.comp and *_indirect.vert
+		struct GpuInstance {
+			glm::mat4 modelMatrix{ 1.f };
+			glm::mat4 normalMatrix{ 1.f };
+			uint32_t  mesh = 0;
+			int32_t   textureIndex = -1;
+			uint32_t  _pad0 = 0, _pad1 = 0;
+		};
+
+		struct GpuMeshLod {
+			uint32_t firstIndex = 0;		// in the arena, units of the mesh's index type
+			uint32_t indexCount = 0;
+			float    error = 0.f;
+			uint32_t _pad = 0;
+		};
+
+		struct GpuMesh {
+			glm::mat4  positionDecode{ 1.f };
+			glm::vec4  boundingSphere{ 0.f, 0.f, 0.f, 1.f };
+			int32_t    vertexOffset = 0;
+			uint32_t   bucket = 0;
+			uint32_t   drawBase = 0;		// first draw command of the bucket
+			uint32_t   lodCount = 1;
+			GpuMeshLod lods[MAX_LODS];
+		};
+
+		struct Settings {
+			bool enabled = true;
+			bool frustumCulling = true;
+		};
+
+		struct Stats {
+			uint32_t instances = 0;
+			uint32_t meshes = 0;
+			uint32_t fallbackObjects = 0;
+			uint32_t drawn = 0;		// visible instances, as counted by the GPU
+			uint64_t rebuilds = 0;
+		};
+
+		VkcGpuScene(VkcDevice& device, uint32_t frameCount);
+		~VkcGpuScene();
+
+		VkcGpuScene(const VkcGpuScene&) = delete;
+		VkcGpuScene& operator=(const VkcGpuScene&) = delete;
+
+		// Device support and the compiled cull shader; prints what is missing when false
+		static bool isSupported(const VkcDevice& device);
+
+		VkDescriptorSetLayout getDescriptorSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+		VkDescriptorSet getDescriptorSet(uint32_t frameIndex) const { return frames[frameIndex].set; }
+
+		// Before the render pass: brings the frame's buffers up to date with the scene
+		// and records the cull pass, with the LOD settings and viewport of lodSelector
+		void cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, Scene& scene,
+			const VkcCamera& camera, const VkcLodSelector& lodSelector);
+		// Inside the render pass, with the geometry arena bound and the bucket's pipeline
+		// and this frame's set bound. Rebinds the index buffer for the bucket's type.
+		void drawBucket(VkCommandBuffer commandBuffer, uint32_t frameIndex, Bucket bucket);
+
+		// Draws reserved for the bucket: its instances, visible or not
+		uint32_t getBucketCapacity(Bucket bucket) const { return bucketCapacity[bucket]; }
+		// Objects in the last cull() that the CPU path has to draw
+		const std::vector<VkcGameObject::id_t>& getFallbackObjects() const { return fallbackObjects; }
+
+		const Stats& getStats() const { return stats; }
+		void printStats() const;
+
+		Settings settings;
+
+	private:
+		struct Frame {
+			VkBuffer        instanceBuffer = VK_NULL_HANDLE;
+			VmaAllocation   instanceAllocation = VK_NULL_HANDLE;
+			void*           instanceMapped = nullptr;
+			uint32_t        instanceCapacity = 0;
+			VkBuffer        meshBuffer = VK_NULL_HANDLE;
+			VmaAllocation   meshAllocation = VK_NULL_HANDLE;
+			void*           meshMapped = nullptr;
+			uint32_t        meshCapacity = 0;
+			VkBuffer        drawBuffer = VK_NULL_HANDLE;
+			VmaAllocation   drawAllocation = VK_NULL_HANDLE;
+			VkBuffer        countBuffer = VK_NULL_HANDLE;
+			VmaAllocation   countAllocation = VK_NULL_HANDLE;
+			const uint32_t* countMapped = nullptr;
+			VkDescriptorSet set = VK_NULL_HANDLE;
+			uint64_t        contentVersion = 0;		// of the content copied into the buffers
+			bool            culled = false;			// counts hold a finished frame's result
+		};
+
+		void createLayouts();
+		void rebuild(Scene& scene);
+		void uploadFrame(Frame& frame);
+		void createFrameBuffers(Frame& frame, uint32_t instanceCapacity, uint32_t meshCapacity);
+		void destroyFrameBuffers(Frame& frame);
+
+		VkcDevice&         device;
+		std::vector<Frame> frames;
+
+		std::unique_ptr<VkcDescriptorSetLayout> setLayout;
+		std::unique_ptr<VkcDescriptorPool>      descriptorPool;
+		VkPipelineLayout                        cullLayout = VK_NULL_HANDLE;
+		std::unique_ptr<VkcPipeline>            cullPipeline;
+
+		// CPU copy of the buffers' content and what it was built from
+		std::vector<GpuInstance>                  instances;
+		std::vector<GpuMesh>                      meshes;
+		std::vector<std::shared_ptr<IModel>>      meshModels;	// keeps the arena ranges alive
+		std::vector<VkcGameObject::id_t>          fallbackObjects;
+		std::array<uint32_t, BucketCount>         bucketBase{};
+		std::array<uint32_t, BucketCount>         bucketCapacity{};
+		uint64_t sceneVersion = ~0ull;
+		uint64_t arenaVersion = ~0ull;
+		const Scene* builtScene = nullptr;
+		uint64_t contentVersion = 0;
+
+		Stats stats;
+	};
+}
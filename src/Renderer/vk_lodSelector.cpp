@@ -0,0 +1,67 @@
+// vk_lodSelector.cpp
+#include "vk_lodSelector.h"
+#include "Game/Camera/vk_camera.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+namespace vkc
+{
+	void VkcLodSelector::beginFrame(float height)
+	{
+		viewportHeight = height;
+		lastFrame = currentFrame;
+		currentFrame = {};
+	}
+
+	uint32_t VkcLodSelector::select(const IModel& model, const glm::mat4& transform, const VkcCamera& camera, uint32_t& lodLevel) const
+	{
+		const uint32_t levels = model.getLodCount();
+		if (!settings.enabled || levels <= 1) {
+			lodLevel = 0;
+			return 0;
+		}
+
+		// Largest axis scale turns model-space error and radius into world units
+		const float scale = std::max({ glm::length(glm::vec3(transform[0])),
+			glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+		const glm::vec4 sphere = model.getBoundingSphere();
+		const glm::vec3 center = glm::vec3(transform * glm::vec4(glm::vec3(sphere), 1.0f));
+		const float distance = std::max(glm::length(center - camera.getPosition()) - sphere.w * scale, 0.1f);
+		// Pixels covered by one world unit at that distance
+		const float pixelsPerUnit = 0.5f * viewportHeight * std::abs(camera.getProjection()[1][1]) / distance;
+		auto pixelError = [&](uint32_t level) { return model.getLodError(level) * scale * pixelsPerUnit; };
+
+		uint32_t level = std::min(lodLevel, levels - 1);
+		while (level > 0 && pixelError(level) > settings.maxPixelError) {
+			level--;
+		}
+		const float coarserLimit = settings.maxPixelError * (1.0f - settings.hysteresis);
+		while (level + 1 < levels && pixelError(level + 1) <= coarserLimit) {
+			level++;
+		}
+		lodLevel = level;
+		return level;
+	}
+
+	void VkcLodSelector::recordDraw(const IModel& model, uint32_t level)
+	{
+		currentFrame.objects++;
+		currentFrame.triangles += model.getLodTriangles(level);
+		currentFrame.fullDetailTriangles += model.getLodTriangles(0);
+	}
+
+	void VkcLodSelector::printStats() const
+	{
+		const double ratio = lastFrame.fullDetailTriangles > 0
+			? 100.0 * static_cast<double>(lastFrame.triangles) / static_cast<double>(lastFrame.fullDetailTriangles)
+			: 100.0;
+		std::cout << std::fixed << std::setprecision(1)
+			<< "LOD: " << lastFrame.objects << " objects, " << lastFrame.triangles << " triangles submitted, "
+			<< lastFrame.fullDetailTriangles << " at full detail (" << ratio << "%)\n";
+		std::cout.unsetf(std::ios::floatfield);
+	}
+}
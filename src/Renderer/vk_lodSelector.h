@@ -0,0 +1,55 @@
+// vk_lodSelector.h
+#pragma once
+#include "VK_abstraction/vk_IModel.hpp"
+
+// STD
+#include <cstdint>
+
+namespace vkc
+{
+	class VkcCamera;
+
+	// Picks a model's level of detail from the screen-space size of its LOD error:
+	// the coarsest level whose error projects to at most maxPixelError pixels at the
+	// nearest point of the bounding sphere. The level drawn last frame only gets
+	// coarser once the next level clears the limit by the hysteresis margin, and
+	// gets finer as soon as it exceeds the limit, so objects near a threshold don't
+	// pop back and forth.
+	//
+	// Also counts the triangles submitted each frame against what level 0 would
+	// have cost. Main (render) thread only; render systems use it from prepare().
+	class VkcLodSelector
+	{
+	public:
+		struct Settings {
+			float maxPixelError = 1.0f;
+			float hysteresis = 0.25f;	// share of maxPixelError a coarser level must stay under
+			bool  enabled = true;
+		};
+
+		struct Stats {
+			uint64_t objects = 0;
+			uint64_t triangles = 0;				// as submitted
+			uint64_t fullDetailTriangles = 0;	// had every object drawn level 0
+		};
+
+		// Once per frame, before recording; viewportHeight in pixels
+		void beginFrame(float viewportHeight);
+
+		// lodLevel holds the level the object drew last frame and is updated
+		uint32_t select(const IModel& model, const glm::mat4& transform, const VkcCamera& camera, uint32_t& lodLevel) const;
+		// Adds one draw of the model at level to this frame's counts
+		void recordDraw(const IModel& model, uint32_t level);
+
+		float getViewportHeight() const { return viewportHeight; }
+		const Stats& getLastFrameStats() const { return lastFrame; }
+		void printStats() const;
+
+		Settings settings;
+
+	private:
+		float viewportHeight = 1.0f;
+		Stats currentFrame;
+		Stats lastFrame;
+	};
+}
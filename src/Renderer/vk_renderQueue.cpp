@@ -0,0 +1,173 @@
+// vk_renderQueue.cpp
+#include "vk_renderQueue.h"
+#include "VK_abstraction/vk_geometryArena.h"
+
+// STD
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace vkc
+{
+	namespace {
+		constexpr uint32_t kNoPush = ~0u;
+
+		// Non-negative floats order like their bit patterns, which are below 2^31
+		uint32_t depthBits(float depth)
+		{
+			depth = std::max(depth, 0.f);
+			uint32_t bits;
+			std::memcpy(&bits, &depth, sizeof(bits));
+			return bits;
+		}
+	}
+
+	VkcRenderQueue::VkcRenderQueue(uint32_t materialSetIndex)
+		: materialSetIndex{ materialSetIndex }
+	{
+	}
+
+	uint64_t VkcRenderQueue::makeKey(MaterialPass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+	{
+		const uint64_t passBits = static_cast<uint64_t>(static_cast<uint8_t>(pass) & 0x3) << 62;
+		const uint32_t bits = depthBits(depth);
+		if (pass == MaterialPass::Transparent) {
+			// 2 pass | 24 depth, far first | 10 pipeline | 16 material | 12 mesh
+			const uint64_t farFirst = 0xFFFFFFu - (bits >> 7);
+			return passBits | farFirst << 38 |
+				static_cast<uint64_t>(pipeline & 0x3FF) << 28 |
+				static_cast<uint64_t>(material & 0xFFFF) << 12 |
+				static_cast<uint64_t>(mesh & 0xFFF);
+		}
+		// 2 pass | 10 pipeline | 16 material | 16 mesh | 20 depth, near first
+		return passBits |
+			static_cast<uint64_t>(pipeline & 0x3FF) << 52 |
+			static_cast<uint64_t>(material & 0xFFFF) << 36 |
+			static_cast<uint64_t>(mesh & 0xFFFF) << 20 |
+			static_cast<uint64_t>(bits >> 11);
+	}
+
+	uint32_t VkcRenderQueue::pipelineId(const MaterialPipeline* pipeline)
+	{
+		auto [it, inserted] = pipelineIds.try_emplace(pipeline, static_cast<uint32_t>(pipelineIds.size()));
+		return it->second;
+	}
+
+	uint32_t VkcRenderQueue::meshId(const void* mesh)
+	{
+		// Fold the pointer so the low key bits still tell most meshes apart
+		const uint64_t address = reinterpret_cast<uintptr_t>(mesh);
+		return static_cast<uint32_t>((address >> 4) ^ (address >> 20));
+	}
+
+	void VkcRenderQueue::clear()
+	{
+		items.clear();
+	}
+
+	void VkcRenderQueue::sort()
+	{
+		const size_t count = items.size();
+		stats = Stats{};
+		stats.items = static_cast<uint32_t>(count);
+
+		// Binds the push order would have needed, for comparison
+		const MaterialPipeline* lastPipeline = nullptr;
+		VkDescriptorSet lastSet = VK_NULL_HANDLE;
+		for (const Item& item : items) {
+			if (item.material.pipeline != lastPipeline) {
+				stats.unsortedPipelineBinds++;
+				lastPipeline = item.material.pipeline;
+			}
+			if (item.material.materialSet != VK_NULL_HANDLE && item.material.materialSet != lastSet) {
+				stats.unsortedDescriptorBinds++;
+				lastSet = item.material.materialSet;
+			}
+		}
+
+		order.resize(count);
+		orderScratch.resize(count);
+		keys.resize(count);
+		keyScratch.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			order[i] = static_cast<uint32_t>(i);
+			keys[i] = items[i].key;
+		}
+		if (count < 2)
+			return;
+
+		// Least significant byte first; each pass is stable, so earlier bytes stay ordered
+		for (uint32_t shift = 0; shift < 64; shift += 8) {
+			uint32_t histogram[256] = {};
+			for (uint64_t key : keys) {
+				histogram[(key >> shift) & 0xFF]++;
+			}
+			// A byte every key shares leaves the order as it is
+			if (histogram[(keys[0] >> shift) & 0xFF] == count)
+				continue;
+
+			uint32_t offset = 0;
+			for (uint32_t& bucket : histogram) {
+				const uint32_t bucketCount = bucket;
+				bucket = offset;
+				offset += bucketCount;
+			}
+			for (size_t i = 0; i < count; i++) {
+				const uint32_t destination = histogram[(keys[i] >> shift) & 0xFF]++;
+				keyScratch[destination] = keys[i];
+				orderScratch[destination] = order[i];
+			}
+			keys.swap(keyScratch);
+			order.swap(orderScratch);
+		}
+	}
+
+	void VkcRenderQueue::execute(VkCommandBuffer commandBuffer, VkcGeometryArena& arena)
+	{
+		const MaterialPipeline* boundPipeline = nullptr;
+		VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+		VkDescriptorSet boundSet = VK_NULL_HANDLE;
+		uint32_t pushed[2] = { kNoPush, kNoPush };
+
+		for (uint32_t index : order) {
+			const Item& item = items[index];
+			const MaterialPipeline* pipeline = item.material.pipeline;
+			if (pipeline != boundPipeline) {
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->pipeline);
+				stats.pipelineBinds++;
+				boundPipeline = pipeline;
+				// A different layout may not keep the set or push constants
+				if (pipeline->layout != boundLayout) {
+					boundLayout = pipeline->layout;
+					boundSet = VK_NULL_HANDLE;
+					pushed[0] = pushed[1] = kNoPush;
+				}
+			}
+			if (item.material.materialSet != VK_NULL_HANDLE && item.material.materialSet != boundSet) {
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundLayout,
+					materialSetIndex, 1, &item.material.materialSet, 0, nullptr);
+				stats.descriptorBinds++;
+				boundSet = item.material.materialSet;
+			}
+			if (item.objectIndex != pushed[0] || item.materialIndex != pushed[1]) {
+				pushed[0] = item.objectIndex;
+				pushed[1] = item.materialIndex;
+				vkCmdPushConstants(commandBuffer, boundLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+					0, sizeof(pushed), pushed);
+				stats.pushConstantUpdates++;
+			}
+
+			arena.bindIndexType(commandBuffer, item.draw.indexType);
+			vkCmdDrawIndexed(commandBuffer, item.draw.indexCount, item.instanceCount, item.draw.firstIndex, item.draw.vertexOffset, 0);
+			stats.draws++;
+		}
+	}
+
+	void VkcRenderQueue::printStats(const char* label) const
+	{
+		std::cout << label << ": " << stats.items << " items, " << stats.draws << " draws, "
+			<< stats.pipelineBinds << " pipeline binds (" << stats.unsortedPipelineBinds << " unsorted), "
+			<< stats.descriptorBinds << " descriptor binds (" << stats.unsortedDescriptorBinds << " unsorted), "
+			<< stats.pushConstantUpdates << " push constant updates\n";
+	}
+}
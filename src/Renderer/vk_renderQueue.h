@@ -0,0 +1,85 @@
+// vk_renderQueue.h
+#pragma once
+#include "Common/vkc_types.h"
+#include "VK_abstraction/vk_IModel.hpp"
+
+// STD
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace vkc
+{
+	class VkcGeometryArena;
+
+	// One frame's draws of a render system, recorded in the order of a 64-bit
+	// sort key instead of the order they were pushed in. Keys put the pass first
+	// (MaterialPass order), then:
+	//  - MainColor and Other: pipeline, material, mesh, then depth front to back,
+	//    so state changes as rarely as possible and near objects occlude early;
+	//  - Transparent: depth back to front, then the same state fields, as
+	//    blending needs the order more than it needs fewer binds.
+	// Fields wider than their bits are truncated; that only costs extra binds.
+	//
+	// execute() binds an item's pipeline only when it differs from the previous
+	// item's, its material set (at materialSetIndex) only when that differs, and
+	// pushes { objectIndex, materialIndex } at offset 0 of the pipeline's layout
+	// (the layout of vkglTF::DrawConstants) only when those change.
+	//
+	// Filled and sorted on the main (render) thread; execute() may then record from
+	// any one thread, as long as the queue is left alone until it returns.
+	class VkcRenderQueue
+	{
+	public:
+		struct Item {
+			uint64_t            key = 0;
+			MaterialInstance    material{};
+			uint32_t            objectIndex = 0;
+			uint32_t            materialIndex = 0;
+			uint32_t            instanceCount = 1;		// drawn from instance 0
+			IModel::IndexedDraw draw;
+		};
+
+		struct Stats {
+			uint32_t items = 0;
+			uint32_t pipelineBinds = 0;
+			uint32_t descriptorBinds = 0;
+			uint32_t pushConstantUpdates = 0;
+			uint32_t draws = 0;
+			// What recording in push order would have cost
+			uint32_t unsortedPipelineBinds = 0;
+			uint32_t unsortedDescriptorBinds = 0;
+		};
+
+		explicit VkcRenderQueue(uint32_t materialSetIndex);
+
+		// depth is the distance from the camera, negative values count as 0
+		static uint64_t makeKey(MaterialPass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+		// Small ids for the key's pipeline field, stable for the queue's lifetime
+		uint32_t pipelineId(const MaterialPipeline* pipeline);
+		// Key field for any per-mesh pointer; equal meshes get equal values
+		static uint32_t meshId(const void* mesh);
+
+		void clear();
+		void push(const Item& item) { items.push_back(item); }
+		// Radix sort of the keys, stable for equal ones
+		void sort();
+		// Records every item in the order of the last sort(). The arena's buffers must be bound.
+		void execute(VkCommandBuffer commandBuffer, VkcGeometryArena& arena);
+
+		uint32_t size() const { return static_cast<uint32_t>(items.size()); }
+		const Stats& getStats() const { return stats; }
+		// One line, prefixed with label
+		void printStats(const char* label) const;
+
+	private:
+		uint32_t materialSetIndex;
+		std::vector<Item>     items;
+		std::vector<uint64_t> keys;
+		std::vector<uint64_t> keyScratch;
+		std::vector<uint32_t> order;		// into items, sorted by key
+		std::vector<uint32_t> orderScratch;
+		std::unordered_map<const MaterialPipeline*, uint32_t> pipelineIds;
+		Stats stats;
+	};
+}
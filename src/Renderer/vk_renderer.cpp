@@ -1,8 +1,10 @@
 #include "vk_renderer.h"
+#include "VK_abstraction/vk_geometryArena.h"
 
 
 #include <array>
 #include <cassert>
+#include <iostream>
 #include <stdexcept>
 
 
@@ -11,6 +13,14 @@ namespace vkc {
 	Renderer::Renderer(VkWindow& window, VkcDevice& device) : vkcWindow{ window }, vkcDevice{ device } 
 	{
 		recreateSwapchain();
+		frameAllocator = std::make_unique<VkcFrameAllocator>(vkcDevice, VkcSwapChain::MAX_FRAMES_IN_FLIGHT);
+		if (VkcGpuScene::isSupported(vkcDevice)) {
+			gpuScene = std::make_unique<VkcGpuScene>(vkcDevice, VkcSwapChain::MAX_FRAMES_IN_FLIGHT);
+		}
+		else {
+			std::cout << "Renderer: no GPU scene, meshes are drawn on the CPU path\n";
+		}
+		commandRecorder = std::make_unique<VkcCommandRecorder>(vkcDevice, VkcSwapChain::MAX_FRAMES_IN_FLIGHT);
 	}
 
 	Renderer::~Renderer() 
@@ -86,6 +96,9 @@ namespace vkc {
 		}
 
 		isFrameStarted = true;
+		// acquireNextImage waited for this frame slot's fence
+		frameAllocator->beginFrame(currentFrameIndex);
+		lodSelector.beginFrame(static_cast<float>(vkcSwapChain->getSwapChainExtent().height));
 
 		auto commandBuffer = getCurrentCommandBuffer();
 
@@ -96,6 +109,7 @@ namespace vkc {
 		{
 			throw std::runtime_error("failed to begin recording command buffer!");
 		}
+		VkcGeometryArena::resetBinding();
 		return commandBuffer;
 	}
 
@@ -143,6 +157,14 @@ namespace vkc {
 		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 		renderPassInfo.pClearValues = clearValues.data();
 
+		// Secondary buffers set their own viewport and scissor; the primary may only execute them
+		if (commandRecorder->settings.enabled) {
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			commandRecorder->beginPass(static_cast<uint32_t>(currentFrameIndex), renderPassInfo.renderPass,
+				renderPassInfo.framebuffer, renderPassInfo.renderArea.extent);
+			return;
+		}
+
 		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 		VkViewport viewport{};
 		viewport.x = 0.0f;
@@ -162,6 +184,9 @@ namespace vkc {
 		assert(
 			commandBuffer == getCurrentCommandBuffer() &&
 			"Can't end render pass on command buffer from a different frame");
+		if (commandRecorder->isRecordingPass()) {
+			commandRecorder->endPass(commandBuffer);
+		}
 		vkCmdEndRenderPass(commandBuffer);
 	}
 
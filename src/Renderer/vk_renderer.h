@@ -2,7 +2,11 @@
  
 #include "AppCore/vk_window.h"
 #include "VK_abstraction/vk_device.h"
+#include "VK_abstraction/vk_frameAllocator.h"
 #include "VK_abstraction/vk_swapchain.h"
+#include "Renderer/vk_commandRecorder.h"
+#include "Renderer/vk_gpuScene.h"
+#include "Renderer/vk_lodSelector.h"
 
 
 
@@ -38,8 +42,19 @@ namespace vkc
 			return currentFrameIndex;
 		}
 
+		// Per-draw uniform data for the frame being recorded
+		VkcFrameAllocator& getFrameAllocator() { return *frameAllocator; }
+		// Level-of-detail choice and triangle counts for the frame being recorded
+		VkcLodSelector& getLodSelector() { return lodSelector; }
+		// Null when the device or the compiled shaders don't allow the GPU-driven path
+		VkcGpuScene* getGpuScene() { return gpuScene.get(); }
+		// Secondary command buffers for the swap chain render pass, recorded in parallel
+		VkcCommandRecorder& getCommandRecorder() { return *commandRecorder; }
+
 		VkCommandBuffer beginFrame();
 		void endFrame();
+		// With the command recorder enabled the pass takes secondary command buffers
+		// only, recorded through it until endSwapChainRenderPass executes them
 		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
 		void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 	private:
@@ -55,6 +70,10 @@ namespace vkc
 
 		std::unique_ptr<VkcSwapChain> vkcSwapChain;
 		std::vector<VkCommandBuffer> commandBuffers;
+		std::unique_ptr<VkcFrameAllocator> frameAllocator;
+		VkcLodSelector lodSelector;
+		std::unique_ptr<VkcGpuScene> gpuScene;
+		std::unique_ptr<VkcCommandRecorder> commandRecorder;
 
 		uint32_t currentImageIndex;
 		int currentFrameIndex = 0;
@@ -0,0 +1,67 @@
+// sceneExporter.cpp
+//
+// Converts a JSON scene (res/scenes/*.json) into the binary .vkscene form.
+// Scene::loadSceneData loads a .vkscene directly when no JSON of the same
+// name exists next to it.
+//
+// usage: SceneExporter <scene.json> [out.vkscene]
+
+// Project headers
+#include "Utils/vkc_sceneBinary.h"
+
+// External
+#include "json.hpp"
+
+// STD
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h") {
+        std::cout << "usage: SceneExporter <scene.json> [out.vkscene]\n";
+        return argc < 2 ? 1 : 0;
+    }
+
+    const std::string input = argv[1];
+    const std::string output = argc > 2 ? argv[2] : fs::path(input).replace_extension(".vkscene").string();
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::ifstream file(input);
+    if (!file) {
+        std::cerr << "cannot open " << input << "\n";
+        return 1;
+    }
+    nlohmann::json sceneJson = nlohmann::json::parse(file, nullptr, false);
+    if (sceneJson.is_discarded() || !sceneJson.contains("objects")) {
+        std::cerr << "not a scene file: " << input << "\n";
+        return 1;
+    }
+
+    vkc::SceneData scene;
+    try {
+        scene = vkc::sceneDataFromJson(sceneJson);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "invalid scene " << input << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    // Stand-alone files carry no source stamp
+    std::string error;
+    if (!vkc::writeBinaryScene(output, scene, "", error)) {
+        std::cerr << "failed: " << error << "\n";
+        return 1;
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "wrote " << output << ": " << scene.objects.size() << " objects, "
+        << scene.assetNames.size() << " assets in " << static_cast<int>(ms) << " ms\n";
+    return 0;
+}
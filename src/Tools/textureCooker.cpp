@@ -0,0 +1,182 @@
+// textureCooker.cpp
+//
+// Offline texture cooker. Converts the images under res/textures and the
+// images referenced by glTF files under res/models into block-compressed KTX
+// files with a full mip chain, written below res/cache/textures where
+// AssetManager and the glTF loader pick them up.
+//
+// usage: TextureCooker [--force] [res directory]
+
+// Project headers
+#include "Utils/vkc_textureCache.h"
+#include "Utils/vkc_textureCooker.h"
+#include "Utils/vkc_threadPool.h"
+
+// External
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "json.hpp"
+
+// STD
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    const char* formatName(vkc::bc::Format format)
+    {
+        switch (format) {
+        case vkc::bc::Format::BC1: return "BC1";
+        case vkc::bc::Format::BC3: return "BC3";
+        case vkc::bc::Format::BC5: return "BC5";
+        case vkc::bc::Format::BC7: return "BC7";
+        }
+        return "?";
+    }
+
+    bool isImageFile(const fs::path& path)
+    {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".tga" || ext == ".bmp";
+    }
+
+    // Adds the external images of a .gltf file, classified by the material slots that use them
+    void collectglTFImages(const fs::path& gltfPath, std::map<std::string, vkc::TextureUsage>& jobs)
+    {
+        std::ifstream file(gltfPath);
+        nlohmann::json doc = nlohmann::json::parse(file, nullptr, false);
+        if (doc.is_discarded() || !doc.contains("images")) {
+            return;
+        }
+
+        const auto& images = doc["images"];
+        const auto& textures = doc.value("textures", nlohmann::json::array());
+        std::vector<vkc::TextureUsage> usage(images.size(), vkc::TextureUsage::Color);
+        std::vector<bool> classified(images.size(), false);
+
+        auto classify = [&](const nlohmann::json& textureInfo, vkc::TextureUsage slotUsage) {
+            if (!textureInfo.is_object() || !textureInfo.contains("index")) {
+                return;
+            }
+            const size_t textureIndex = textureInfo["index"].get<size_t>();
+            if (textureIndex >= textures.size() || !textures[textureIndex].contains("source")) {
+                return;
+            }
+            const size_t imageIndex = textures[textureIndex]["source"].get<size_t>();
+            // Colour wins if an image is shared between slots
+            if (imageIndex < usage.size() && (!classified[imageIndex] || slotUsage == vkc::TextureUsage::Color)) {
+                usage[imageIndex] = slotUsage;
+                classified[imageIndex] = true;
+            }
+        };
+
+        for (const auto& material : doc.value("materials", nlohmann::json::array())) {
+            classify(material.value("normalTexture", nlohmann::json()), vkc::TextureUsage::NormalMap);
+            classify(material.value("occlusionTexture", nlohmann::json()), vkc::TextureUsage::Data);
+            classify(material.value("emissiveTexture", nlohmann::json()), vkc::TextureUsage::Color);
+            const auto pbr = material.value("pbrMetallicRoughness", nlohmann::json::object());
+            classify(pbr.value("baseColorTexture", nlohmann::json()), vkc::TextureUsage::Color);
+            classify(pbr.value("metallicRoughnessTexture", nlohmann::json()), vkc::TextureUsage::Data);
+        }
+
+        for (size_t i = 0; i < images.size(); ++i) {
+            const std::string uri = images[i].value("uri", std::string());
+            // Embedded (data URI or bufferView) images have no source file to cook
+            if (uri.empty() || uri.rfind("data:", 0) == 0) {
+                continue;
+            }
+            const fs::path imagePath = gltfPath.parent_path() / uri;
+            if (isImageFile(imagePath)) {
+                jobs[imagePath.generic_string()] = classified[i] ? usage[i] : vkc::guessTextureUsage(uri);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool force = false;
+    std::string resDir = PROJECT_ROOT_DIR "/res";
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--force") {
+            force = true;
+        }
+        else if (arg == "--help" || arg == "-h") {
+            std::cout << "usage: TextureCooker [--force] [res directory]\n";
+            return 0;
+        }
+        else {
+            resDir = arg;
+        }
+    }
+
+    const vkc::TextureCache cache(resDir, resDir + "/cache/textures");
+
+    std::map<std::string, vkc::TextureUsage> jobs;
+    std::error_code ec;
+    for (const auto& entry : fs::recursive_directory_iterator(resDir + "/textures", ec)) {
+        if (entry.is_regular_file() && isImageFile(entry.path())) {
+            jobs[entry.path().generic_string()] = vkc::guessTextureUsage(entry.path().string());
+        }
+    }
+    for (const auto& entry : fs::recursive_directory_iterator(resDir + "/models", ec)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".gltf") {
+            collectglTFImages(entry.path(), jobs);
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    vkc::ThreadPool pool;
+    std::mutex outputMutex;
+    std::vector<std::future<bool>> results;
+    uint32_t skipped = 0;
+
+    for (const auto& [source, usage] : jobs) {
+        std::string cooked;
+        if (!force && cache.findCooked(source, cooked)) {
+            skipped++;
+            continue;
+        }
+        results.push_back(pool.submit([&cache, &outputMutex, source = source, usage = usage]() {
+            auto begin = std::chrono::high_resolution_clock::now();
+            std::string error;
+            vkc::CookedTextureInfo info;
+            const bool ok = vkc::cookTexture(source, cache.cookedPath(source), usage, error, &info);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (ok) {
+                std::cout << formatName(info.format) << (info.srgb ? " sRGB " : "      ")
+                    << info.width << "x" << info.height << " " << info.mipLevels << " mips "
+                    << (info.bytes >> 10) << " KiB " << static_cast<int>(ms) << " ms  " << source << "\n";
+            }
+            else {
+                std::cerr << "failed: " << source << ": " << error << "\n";
+            }
+            return ok;
+        }));
+    }
+
+    uint32_t failed = 0;
+    for (auto& result : results) {
+        failed += result.get() ? 0 : 1;
+    }
+
+    const double totalMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "cooked " << (results.size() - failed) << ", up to date " << skipped << ", failed " << failed
+        << " in " << static_cast<int>(totalMs) << " ms\n";
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,407 @@
+// vkc_blockCompression.cpp
+#include "vkc_blockCompression.h"
+
+// STD
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace vkc {
+namespace bc {
+
+    namespace {
+        constexpr int kBC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        struct BitWriter {
+            uint8_t* out;
+            uint32_t pos = 0;
+
+            void put(uint32_t value, uint32_t bits)
+            {
+                for (uint32_t b = 0; b < bits; ++b, ++pos) {
+                    if ((value >> b) & 1u) {
+                        out[pos >> 3] |= static_cast<uint8_t>(1u << (pos & 7));
+                    }
+                }
+            }
+        };
+
+        // Mean and principal axis of a block, by power iteration on the covariance matrix
+        void principalAxis(const float (*points)[4], int channels, float mean[4], float axis[4])
+        {
+            for (int c = 0; c < 4; ++c) {
+                mean[c] = 0.0f;
+                axis[c] = 0.0f;
+            }
+            for (int i = 0; i < 16; ++i) {
+                for (int c = 0; c < channels; ++c) {
+                    mean[c] += points[i][c] / 16.0f;
+                }
+            }
+
+            float cov[4][4] = {};
+            for (int i = 0; i < 16; ++i) {
+                float d[4];
+                for (int c = 0; c < channels; ++c) {
+                    d[c] = points[i][c] - mean[c];
+                }
+                for (int r = 0; r < channels; ++r) {
+                    for (int c = 0; c < channels; ++c) {
+                        cov[r][c] += d[r] * d[c];
+                    }
+                }
+            }
+
+            float v[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+            for (int iter = 0; iter < 8; ++iter) {
+                float w[4] = {};
+                float largest = 0.0f;
+                for (int r = 0; r < channels; ++r) {
+                    for (int c = 0; c < channels; ++c) {
+                        w[r] += cov[r][c] * v[c];
+                    }
+                    largest = std::max(largest, std::fabs(w[r]));
+                }
+                if (largest < 1e-6f) {
+                    break;
+                }
+                for (int c = 0; c < channels; ++c) {
+                    v[c] = w[c] / largest;
+                }
+            }
+
+            float length = 0.0f;
+            for (int c = 0; c < channels; ++c) {
+                length += v[c] * v[c];
+            }
+            length = std::sqrt(length);
+            for (int c = 0; c < channels; ++c) {
+                axis[c] = length > 0.0f ? v[c] / length : 1.0f / std::sqrt(static_cast<float>(channels));
+            }
+        }
+
+        // Endpoints on the principal axis spanning the projected texels
+        void axisEndpoints(const float (*points)[4], int channels, float inset, float lo[4], float hi[4])
+        {
+            float mean[4], axis[4];
+            principalAxis(points, channels, mean, axis);
+
+            float minT = FLT_MAX, maxT = -FLT_MAX;
+            for (int i = 0; i < 16; ++i) {
+                float t = 0.0f;
+                for (int c = 0; c < channels; ++c) {
+                    t += (points[i][c] - mean[c]) * axis[c];
+                }
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+            const float shrink = (maxT - minT) * inset;
+            minT += shrink;
+            maxT -= shrink;
+
+            for (int c = 0; c < 4; ++c) {
+                lo[c] = c < channels ? std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f) : 0.0f;
+                hi[c] = c < channels ? std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f) : 0.0f;
+            }
+        }
+
+        uint16_t packRGB565(const float c[3])
+        {
+            const int r = std::clamp(static_cast<int>(std::lround(c[0] * 31.0f / 255.0f)), 0, 31);
+            const int g = std::clamp(static_cast<int>(std::lround(c[1] * 63.0f / 255.0f)), 0, 63);
+            const int b = std::clamp(static_cast<int>(std::lround(c[2] * 31.0f / 255.0f)), 0, 31);
+            return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+        }
+
+        void unpackRGB565(uint16_t v, int out[3])
+        {
+            const int r = (v >> 11) & 31;
+            const int g = (v >> 5) & 63;
+            const int b = v & 31;
+            out[0] = (r << 3) | (r >> 2);
+            out[1] = (g << 2) | (g >> 4);
+            out[2] = (b << 3) | (b >> 2);
+        }
+
+        void writeLE(uint8_t* out, uint64_t value, int bytes)
+        {
+            for (int i = 0; i < bytes; ++i) {
+                out[i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+
+        // Single channel block (BC4 layout), used for BC3 alpha and both BC5 channels
+        void encodeChannel(const uint8_t* rgba, int channel, uint8_t* out)
+        {
+            int lo = 255, hi = 0;
+            for (int i = 0; i < 16; ++i) {
+                lo = std::min(lo, static_cast<int>(rgba[i * 4 + channel]));
+                hi = std::max(hi, static_cast<int>(rgba[i * 4 + channel]));
+            }
+            out[0] = static_cast<uint8_t>(hi);
+            out[1] = static_cast<uint8_t>(lo);
+
+            uint64_t bits = 0;
+            if (hi > lo) {
+                int palette[8] = { hi, lo };
+                for (int i = 2; i < 8; ++i) {
+                    palette[i] = ((8 - i) * hi + (i - 1) * lo) / 7;
+                }
+                for (int t = 0; t < 16; ++t) {
+                    const int v = rgba[t * 4 + channel];
+                    int best = 0;
+                    for (int i = 1; i < 8; ++i) {
+                        if (std::abs(palette[i] - v) < std::abs(palette[best] - v)) {
+                            best = i;
+                        }
+                    }
+                    bits |= static_cast<uint64_t>(best) << (3 * t);
+                }
+            }
+            writeLE(out + 2, bits, 6);
+        }
+
+        struct BC7Endpoint {
+            int q[4];   // 7 bit values
+            int pbit;
+
+            int value(int c) const { return (q[c] << 1) | pbit; }
+        };
+
+        BC7Endpoint quantizeBC7(const float v[4])
+        {
+            BC7Endpoint best{};
+            float bestError = FLT_MAX;
+            for (int p = 0; p < 2; ++p) {
+                BC7Endpoint e{};
+                e.pbit = p;
+                float error = 0.0f;
+                for (int c = 0; c < 4; ++c) {
+                    e.q[c] = std::clamp(static_cast<int>(std::lround((v[c] - p) * 0.5f)), 0, 127);
+                    const float d = static_cast<float>(e.value(c)) - v[c];
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    best = e;
+                }
+            }
+            return best;
+        }
+
+        int fitBC7Indices(const uint8_t* rgba, const BC7Endpoint& e0, const BC7Endpoint& e1, int indices[16])
+        {
+            int palette[16][4];
+            for (int i = 0; i < 16; ++i) {
+                for (int c = 0; c < 4; ++c) {
+                    palette[i][c] = ((64 - kBC7Weights4[i]) * e0.value(c) + kBC7Weights4[i] * e1.value(c) + 32) >> 6;
+                }
+            }
+
+            int total = 0;
+            for (int t = 0; t < 16; ++t) {
+                int bestError = INT32_MAX;
+                for (int i = 0; i < 16; ++i) {
+                    int error = 0;
+                    for (int c = 0; c < 4; ++c) {
+                        const int d = palette[i][c] - rgba[t * 4 + c];
+                        error += d * d;
+                    }
+                    if (error < bestError) {
+                        bestError = error;
+                        indices[t] = i;
+                    }
+                }
+                total += bestError;
+            }
+            return total;
+        }
+
+        // Least squares endpoints for fixed indices. Returns false if the system is degenerate.
+        bool refineBC7(const uint8_t* rgba, const int indices[16], float lo[4], float hi[4])
+        {
+            float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+            float ax[4] = {}, bx[4] = {};
+            for (int t = 0; t < 16; ++t) {
+                const float w = kBC7Weights4[indices[t]] / 64.0f;
+                const float a = 1.0f - w;
+                aa += a * a;
+                ab += a * w;
+                bb += w * w;
+                for (int c = 0; c < 4; ++c) {
+                    ax[c] += a * rgba[t * 4 + c];
+                    bx[c] += w * rgba[t * 4 + c];
+                }
+            }
+            const float det = aa * bb - ab * ab;
+            if (std::fabs(det) < 1e-6f) {
+                return false;
+            }
+            for (int c = 0; c < 4; ++c) {
+                lo[c] = std::clamp((bb * ax[c] - ab * bx[c]) / det, 0.0f, 255.0f);
+                hi[c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.0f, 255.0f);
+            }
+            return true;
+        }
+    }
+
+    size_t blockSize(Format format)
+    {
+        return format == Format::BC1 ? 8 : 16;
+    }
+
+    void encodeBC1(const uint8_t* rgba, uint8_t* out)
+    {
+        float points[16][4];
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 4; ++c) {
+                points[i][c] = c < 3 ? static_cast<float>(rgba[i * 4 + c]) : 0.0f;
+            }
+        }
+
+        // Pulling the endpoints in slightly lowers the error of the interpolated colors
+        float lo[4], hi[4];
+        axisEndpoints(points, 3, 1.0f / 16.0f, lo, hi);
+
+        uint16_t c0 = packRGB565(hi);
+        uint16_t c1 = packRGB565(lo);
+        // c0 > c1 selects the four color (opaque) mode
+        if (c0 < c1) {
+            std::swap(c0, c1);
+        }
+
+        uint32_t indices = 0;
+        if (c0 != c1) {
+            int palette[4][3];
+            unpackRGB565(c0, palette[0]);
+            unpackRGB565(c1, palette[1]);
+            for (int c = 0; c < 3; ++c) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            for (int t = 0; t < 16; ++t) {
+                int best = 0;
+                int bestError = INT32_MAX;
+                for (int i = 0; i < 4; ++i) {
+                    int error = 0;
+                    for (int c = 0; c < 3; ++c) {
+                        const int d = palette[i][c] - rgba[t * 4 + c];
+                        error += d * d;
+                    }
+                    if (error < bestError) {
+                        bestError = error;
+                        best = i;
+                    }
+                }
+                indices |= static_cast<uint32_t>(best) << (2 * t);
+            }
+        }
+
+        writeLE(out, c0, 2);
+        writeLE(out + 2, c1, 2);
+        writeLE(out + 4, indices, 4);
+    }
+
+    void encodeBC3(const uint8_t* rgba, uint8_t* out)
+    {
+        encodeChannel(rgba, 3, out);
+        encodeBC1(rgba, out + 8);
+    }
+
+    void encodeBC5(const uint8_t* rgba, uint8_t* out)
+    {
+        encodeChannel(rgba, 0, out);
+        encodeChannel(rgba, 1, out + 8);
+    }
+
+    void encodeBC7(const uint8_t* rgba, uint8_t* out)
+    {
+        float points[16][4];
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 4; ++c) {
+                points[i][c] = static_cast<float>(rgba[i * 4 + c]);
+            }
+        }
+
+        float lo[4], hi[4];
+        axisEndpoints(points, 4, 0.0f, lo, hi);
+
+        BC7Endpoint e0 = quantizeBC7(lo);
+        BC7Endpoint e1 = quantizeBC7(hi);
+        int indices[16];
+        int error = fitBC7Indices(rgba, e0, e1, indices);
+
+        for (int iter = 0; iter < 2 && error > 0; ++iter) {
+            if (!refineBC7(rgba, indices, lo, hi)) {
+                break;
+            }
+            BC7Endpoint r0 = quantizeBC7(lo);
+            BC7Endpoint r1 = quantizeBC7(hi);
+            int refined[16];
+            const int refinedError = fitBC7Indices(rgba, r0, r1, refined);
+            if (refinedError >= error) {
+                break;
+            }
+            e0 = r0;
+            e1 = r1;
+            error = refinedError;
+            std::memcpy(indices, refined, sizeof(indices));
+        }
+
+        // The anchor texel's index is stored without its top bit
+        if (indices[0] & 8) {
+            std::swap(e0, e1);
+            for (int& index : indices) {
+                index = 15 - index;
+            }
+        }
+
+        std::memset(out, 0, 16);
+        BitWriter bits{ out };
+        bits.put(1u << 6, 7);   // mode 6
+        for (int c = 0; c < 4; ++c) {
+            bits.put(static_cast<uint32_t>(e0.q[c]), 7);
+            bits.put(static_cast<uint32_t>(e1.q[c]), 7);
+        }
+        bits.put(static_cast<uint32_t>(e0.pbit), 1);
+        bits.put(static_cast<uint32_t>(e1.pbit), 1);
+        bits.put(static_cast<uint32_t>(indices[0]), 3);
+        for (int t = 1; t < 16; ++t) {
+            bits.put(static_cast<uint32_t>(indices[t]), 4);
+        }
+    }
+
+    std::vector<uint8_t> compressImage(const uint8_t* rgba, uint32_t width, uint32_t height, Format format)
+    {
+        const uint32_t blocksX = (width + 3) / 4;
+        const uint32_t blocksY = (height + 3) / 4;
+        const size_t size = blockSize(format);
+        std::vector<uint8_t> result(static_cast<size_t>(blocksX) * blocksY * size);
+
+        uint8_t block[64];
+        uint8_t* dst = result.data();
+        for (uint32_t by = 0; by < blocksY; ++by) {
+            for (uint32_t bx = 0; bx < blocksX; ++bx) {
+                for (uint32_t y = 0; y < 4; ++y) {
+                    const uint32_t sy = std::min(by * 4 + y, height - 1);
+                    for (uint32_t x = 0; x < 4; ++x) {
+                        const uint32_t sx = std::min(bx * 4 + x, width - 1);
+                        std::memcpy(&block[(y * 4 + x) * 4], &rgba[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+                    }
+                }
+
+                switch (format) {
+                case Format::BC1: encodeBC1(block, dst); break;
+                case Format::BC3: encodeBC3(block, dst); break;
+                case Format::BC5: encodeBC5(block, dst); break;
+                case Format::BC7: encodeBC7(block, dst); break;
+                }
+                dst += size;
+            }
+        }
+        return result;
+    }
+
+} // namespace bc
+} // namespace vkc
@@ -0,0 +1,36 @@
+// vkc_blockCompression.h
+#pragma once
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vkc {
+
+    // CPU encoders for the BCn formats the texture cooker emits. Every encoder
+    // takes one 4x4 block of RGBA8 texels in row-major order (64 bytes).
+    namespace bc {
+
+        enum class Format {
+            BC1,    // RGB, 8 bytes per block
+            BC3,    // RGB + interpolated alpha, 16 bytes per block
+            BC5,    // two independent channels (RG), 16 bytes per block
+            BC7     // RGBA, 16 bytes per block
+        };
+
+        size_t blockSize(Format format);
+
+        void encodeBC1(const uint8_t* rgba, uint8_t* out);
+        void encodeBC3(const uint8_t* rgba, uint8_t* out);
+        void encodeBC5(const uint8_t* rgba, uint8_t* out);
+        // Mode 6 only (one subset, RGBA endpoints with p-bits, 4 bit indices)
+        void encodeBC7(const uint8_t* rgba, uint8_t* out);
+
+        // Compresses a whole RGBA8 image. Partial blocks at the right/bottom edge
+        // repeat the last row/column.
+        std::vector<uint8_t> compressImage(const uint8_t* rgba, uint32_t width, uint32_t height, Format format);
+
+    } // namespace bc
+
+} // namespace vkc
@@ -0,0 +1,121 @@
+// vkc_fileWatcher.cpp
+#include "vkc_fileWatcher.h"
+
+// STD
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace vkc {
+
+    namespace {
+        std::string normalize(const fs::path& path)
+        {
+            return path.lexically_normal().generic_string();
+        }
+    }
+
+    FileWatcher::FileWatcher(std::string rootDir, std::vector<std::string> ignoredDirs)
+        : _rootDir(normalize(rootDir))
+    {
+        for (const auto& dir : ignoredDirs) {
+            _ignoredDirs.push_back(normalize(fs::path(_rootDir) / dir));
+        }
+
+#if defined(__linux__)
+        _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (_fd < 0) {
+            std::cerr << "FileWatcher: inotify_init1 failed, hot reload disabled\n";
+            return;
+        }
+        watchTree(_rootDir);
+#endif
+    }
+
+    FileWatcher::~FileWatcher()
+    {
+#if defined(__linux__)
+        if (_fd >= 0) {
+            ::close(_fd);
+        }
+#endif
+    }
+
+    bool FileWatcher::isIgnored(const std::string& dir) const
+    {
+        return std::find(_ignoredDirs.begin(), _ignoredDirs.end(), dir) != _ignoredDirs.end();
+    }
+
+    void FileWatcher::watchTree(const std::string& dir)
+    {
+#if defined(__linux__)
+        if (isIgnored(dir))
+            return;
+
+        const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+        int wd = inotify_add_watch(_fd, dir.c_str(), mask);
+        if (wd < 0) {
+            std::cerr << "FileWatcher: cannot watch " << dir << "\n";
+            return;
+        }
+        _watchDirs[wd] = dir;
+
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(dir, ec)) {
+            if (entry.is_directory(ec)) {
+                watchTree(normalize(entry.path()));
+            }
+        }
+#else
+        (void)dir;
+#endif
+    }
+
+    std::vector<std::string> FileWatcher::poll()
+    {
+        std::vector<std::string> changed;
+#if defined(__linux__)
+        if (_fd < 0)
+            return changed;
+
+        alignas(inotify_event) char buffer[16 * 1024];
+        for (;;) {
+            const ssize_t length = ::read(_fd, buffer, sizeof(buffer));
+            if (length <= 0)
+                break;  // EAGAIN: nothing more queued
+
+            for (char* ptr = buffer; ptr < buffer + length;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                auto dir = _watchDirs.find(event->wd);
+                if (dir == _watchDirs.end() || event->len == 0)
+                    continue;
+                const std::string path = normalize(fs::path(dir->second) / event->name);
+
+                if (event->mask & IN_ISDIR) {
+                    // New directories start being watched as well
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                        watchTree(path);
+                    }
+                    continue;
+                }
+                if ((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) &&
+                    std::find(changed.begin(), changed.end(), path) == changed.end()) {
+                    changed.push_back(path);
+                }
+            }
+        }
+#endif
+        return changed;
+    }
+
+} // namespace vkc
@@ -0,0 +1,39 @@
+// vkc_fileWatcher.h
+#pragma once
+
+// STD
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vkc {
+
+    // Recursive watch of a directory tree for files that were written or moved
+    // into place (editors often save through a rename). Uses inotify on Linux;
+    // elsewhere it watches nothing and poll() always comes back empty.
+    class FileWatcher {
+    public:
+        // Subdirectories of rootDir listed in ignoredDirs (relative paths) are not watched
+        explicit FileWatcher(std::string rootDir, std::vector<std::string> ignoredDirs = {});
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        bool isWatching() const { return _fd >= 0; }
+
+        // Normalized paths of the files changed since the last call, without
+        // duplicates. Never blocks.
+        std::vector<std::string> poll();
+
+    private:
+        void watchTree(const std::string& dir);
+        bool isIgnored(const std::string& dir) const;
+
+        std::string                          _rootDir;
+        std::vector<std::string>             _ignoredDirs;   // normalized absolute paths
+        int                                  _fd = -1;
+        std::unordered_map<int, std::string> _watchDirs;     // watch descriptor → directory
+    };
+
+} // namespace vkc
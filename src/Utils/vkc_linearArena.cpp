@@ -0,0 +1,60 @@
+// vkc_linearArena.cpp
+#include "vkc_linearArena.h"
+
+// STD
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace vkc {
+
+    void LinearArena::reserve(size_t bytes)
+    {
+        if (!_blocks.empty() && _blocks.back().size - _offset >= bytes)
+            return;
+        addBlock(bytes);
+    }
+
+    const char* LinearArena::copyString(const std::string& text)
+    {
+        char* copy = static_cast<char*>(allocateBytes(text.size() + 1, 1));
+        std::memcpy(copy, text.c_str(), text.size() + 1);
+        return copy;
+    }
+
+    void LinearArena::release()
+    {
+        _blocks.clear();
+        _offset = 0;
+        _bytesAllocated = 0;
+        _bytesUsed = 0;
+    }
+
+    void* LinearArena::allocateBytes(size_t size, size_t alignment)
+    {
+        if (!_blocks.empty()) {
+            const size_t aligned = (_offset + alignment - 1) & ~(alignment - 1);
+            if (aligned + size <= _blocks.back().size) {
+                _offset = aligned + size;
+                _bytesUsed += size;
+                return _blocks.back().memory.get() + aligned;
+            }
+        }
+        // new[] memory is aligned for any fundamental type
+        addBlock(size);
+        _offset = size;
+        _bytesUsed += size;
+        return _blocks.back().memory.get();
+    }
+
+    void LinearArena::addBlock(size_t minimumSize)
+    {
+        Block block;
+        block.size = std::max(minimumSize, _blockSize);
+        block.memory.reset(new unsigned char[block.size]);
+        _bytesAllocated += block.size;
+        _blocks.push_back(std::move(block));
+        _offset = 0;
+    }
+
+} // namespace vkc
@@ -0,0 +1,86 @@
+// vkc_linearArena.h
+#pragma once
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace vkc {
+
+    // Contiguous run of objects owned by someone else, usually a LinearArena
+    template<typename T>
+    struct Span {
+        T*       data = nullptr;
+        uint32_t count = 0;
+
+        T* begin() const { return data; }
+        T* end() const { return data + count; }
+        T& operator[](size_t i) const { return data[i]; }
+        T& front() const { return data[0]; }
+        T& back() const { return data[count - 1]; }
+        uint32_t size() const { return count; }
+        bool empty() const { return count == 0; }
+    };
+
+    // Bump allocator for objects that live exactly as long as their owner, e.g. the
+    // node tree of a loaded model. Each allocate() call is one contiguous array;
+    // nothing is freed individually, release() drops everything at once without
+    // running destructors, so only trivially destructible types are allowed.
+    // Not thread-safe.
+    class LinearArena {
+    public:
+        explicit LinearArena(size_t blockSize = 64 * 1024) : _blockSize(blockSize) {}
+
+        LinearArena(const LinearArena&) = delete;
+        LinearArena& operator=(const LinearArena&) = delete;
+
+        // Makes the next allocations up to bytes come from a single block. Loaders
+        // that know their totals call this first so the arena is one allocation.
+        void reserve(size_t bytes);
+
+        // count value-initialized objects
+        template<typename T>
+        Span<T> allocate(size_t count)
+        {
+            static_assert(std::is_trivially_destructible<T>::value, "LinearArena never runs destructors");
+            Span<T> span;
+            if (count == 0)
+                return span;
+            span.data = static_cast<T*>(allocateBytes(sizeof(T) * count, alignof(T)));
+            for (size_t i = 0; i < count; i++) {
+                new (span.data + i) T();
+            }
+            span.count = static_cast<uint32_t>(count);
+            return span;
+        }
+
+        // Copy of a string, zero-terminated
+        const char* copyString(const std::string& text);
+
+        void release();
+
+        size_t bytesAllocated() const { return _bytesAllocated; }
+        size_t bytesUsed() const { return _bytesUsed; }
+
+    private:
+        struct Block {
+            std::unique_ptr<unsigned char[]> memory;
+            size_t size = 0;
+        };
+
+        void* allocateBytes(size_t size, size_t alignment);
+        void  addBlock(size_t minimumSize);
+
+        std::vector<Block> _blocks;
+        size_t _blockSize;
+        size_t _offset = 0;           // into _blocks.back()
+        size_t _bytesAllocated = 0;
+        size_t _bytesUsed = 0;
+    };
+
+} // namespace vkc
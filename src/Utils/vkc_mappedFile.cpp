@@ -0,0 +1,143 @@
+// vkc_mappedFile.cpp
+#include "vkc_mappedFile.h"
+
+// STD
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#  define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vkc {
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other) {
+            close();
+            std::swap(_data, other._data);
+            std::swap(_size, other._size);
+#if defined(_WIN32)
+            std::swap(_file, other._file);
+            std::swap(_mapping, other._mapping);
+#else
+            std::swap(_fd, other._fd);
+#endif
+        }
+        return *this;
+    }
+
+#if defined(_WIN32)
+    bool MappedFile::open(const std::string& path)
+    {
+        close();
+
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            CloseHandle(file);
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        _file = file;
+        _mapping = mapping;
+        _data = static_cast<const uint8_t*>(view);
+        _size = static_cast<size_t>(fileSize.QuadPart);
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if (_data) {
+            UnmapViewOfFile(_data);
+        }
+        if (_mapping) {
+            CloseHandle(static_cast<HANDLE>(_mapping));
+        }
+        if (_file) {
+            CloseHandle(static_cast<HANDLE>(_file));
+        }
+        _data = nullptr;
+        _size = 0;
+        _mapping = nullptr;
+        _file = nullptr;
+    }
+#else
+    bool MappedFile::open(const std::string& path)
+    {
+        close();
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st {};
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+        _fd = fd;
+        _data = static_cast<const uint8_t*>(view);
+        _size = static_cast<size_t>(st.st_size);
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if (_data) {
+            munmap(const_cast<uint8_t*>(_data), _size);
+        }
+        if (_fd >= 0) {
+            ::close(_fd);
+        }
+        _data = nullptr;
+        _size = 0;
+        _fd = -1;
+    }
+#endif
+
+} // namespace vkc
@@ -0,0 +1,42 @@
+// vkc_mappedFile.h
+#pragma once
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vkc {
+
+    // Read-only memory mapping of a whole file. The mapping lives as long as the
+    // object, so pointers into data() can be handed straight to staging uploads.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        // Returns false if the file does not exist or cannot be mapped
+        bool open(const std::string& path);
+        void close();
+
+        bool isOpen() const { return _data != nullptr; }
+        const uint8_t* data() const { return _data; }
+        size_t size() const { return _size; }
+
+    private:
+        const uint8_t* _data = nullptr;
+        size_t         _size = 0;
+#if defined(_WIN32)
+        void*          _file = nullptr;
+        void*          _mapping = nullptr;
+#else
+        int            _fd = -1;
+#endif
+    };
+
+} // namespace vkc
@@ -0,0 +1,311 @@
+// vkc_meshOptimizer.cpp
+#include "vkc_meshOptimizer.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace vkc {
+namespace meshopt {
+
+    namespace {
+
+        // FIFO cache by timestamps: a vertex is resident while fewer than cacheSize
+        // other vertices have been inserted since its own insertion
+        struct CacheSim {
+            std::vector<uint32_t> stamps;
+            uint32_t time;
+            uint32_t size;
+
+            CacheSim(size_t vertexCount, uint32_t cacheSize)
+                : stamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+            // Returns 1 on a miss
+            uint32_t touch(uint32_t v)
+            {
+                if (time - stamps[v] > size) {
+                    stamps[v] = time++;
+                    return 1;
+                }
+                return 0;
+            }
+
+            void flush() { time += size + 1; }
+        };
+
+        // Triangles adjacent to each vertex, as offsets into one flat array
+        struct Adjacency {
+            std::vector<uint32_t> offsets;
+            std::vector<uint32_t> counts;
+            std::vector<uint32_t> triangles;
+
+            Adjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+                : offsets(vertexCount + 1, 0), counts(vertexCount, 0), triangles(indexCount)
+            {
+                for (size_t i = 0; i < indexCount; i++) {
+                    counts[indices[i]]++;
+                }
+                for (size_t v = 0; v < vertexCount; v++) {
+                    offsets[v + 1] = offsets[v] + counts[v];
+                }
+                std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+                for (size_t i = 0; i < indexCount; i++) {
+                    triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+                }
+            }
+        };
+
+        const float* attribute(const float* base, size_t byteStride, uint32_t v)
+        {
+            return reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(base) + byteStride * v);
+        }
+
+    }  // namespace
+
+    CacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+    {
+        CacheStats stats;
+        if (indexCount < 3 || vertexCount == 0)
+            return stats;
+
+        CacheSim cache(vertexCount, cacheSize);
+        std::vector<bool> referenced(vertexCount, false);
+        size_t misses = 0;
+        size_t unique = 0;
+        for (size_t i = 0; i < indexCount; i++) {
+            misses += cache.touch(indices[i]);
+            if (!referenced[indices[i]]) {
+                referenced[indices[i]] = true;
+                unique++;
+            }
+        }
+        stats.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+        stats.atvr = static_cast<float>(misses) / static_cast<float>(unique);
+        return stats;
+    }
+
+    // Tipsify: Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality
+    // and Reduced Overdraw" (2007). Fans around one vertex at a time, then moves to
+    // the candidate that will still be in the cache when all its triangles are out.
+    void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+    {
+        if (indexCount < 3 || indexCount % 3 != 0 || vertexCount == 0)
+            return;
+
+        const size_t triangleCount = indexCount / 3;
+        Adjacency adjacency(indices, indexCount, vertexCount);
+        std::vector<uint32_t> live = adjacency.counts;
+        std::vector<uint32_t> stamps(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> deadEnd;
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> result;
+        result.reserve(indexCount);
+
+        uint32_t time = cacheSize + 1;
+        uint32_t cursor = 0;
+        int64_t fanning = indices[0];
+
+        while (fanning >= 0) {
+            candidates.clear();
+            const uint32_t f = static_cast<uint32_t>(fanning);
+            for (uint32_t a = adjacency.offsets[f]; a < adjacency.offsets[f + 1]; a++) {
+                const uint32_t t = adjacency.triangles[a];
+                if (emitted[t])
+                    continue;
+                emitted[t] = true;
+                for (int k = 0; k < 3; k++) {
+                    const uint32_t v = indices[t * 3 + k];
+                    result.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - stamps[v] > cacheSize) {
+                        stamps[v] = time++;
+                    }
+                }
+            }
+
+            // Prefer the oldest candidate that stays resident while its fan is emitted
+            fanning = -1;
+            int64_t bestPriority = -1;
+            for (uint32_t v : candidates) {
+                if (live[v] == 0)
+                    continue;
+                int64_t priority = 0;
+                if (time - stamps[v] + 2 * live[v] <= cacheSize) {
+                    priority = time - stamps[v];
+                }
+                if (priority > bestPriority) {
+                    bestPriority = priority;
+                    fanning = v;
+                }
+            }
+
+            // Dead end: recently used vertices first, then the next unfinished one in input order
+            while (fanning < 0 && !deadEnd.empty()) {
+                const uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) fanning = v;
+            }
+            while (fanning < 0 && cursor < vertexCount) {
+                if (live[cursor] > 0) fanning = cursor;
+                cursor++;
+            }
+        }
+
+        std::memcpy(indices, result.data(), result.size() * sizeof(uint32_t));
+    }
+
+    void optimizeOverdraw(
+        uint32_t* indices, size_t indexCount, size_t vertexCount,
+        const float* positions, const float* normals, size_t byteStride,
+        float threshold)
+    {
+        if (indexCount < 3 || indexCount % 3 != 0 || vertexCount == 0 || !positions)
+            return;
+
+        const size_t triangleCount = indexCount / 3;
+        const float meshAcmr = analyzeVertexCache(indices, indexCount, vertexCount).acmr;
+
+        // Hard boundaries: triangles where the cache has nothing left of the previous fan
+        std::vector<uint32_t> hard;
+        {
+            CacheSim cache(vertexCount, CACHE_SIZE);
+            for (size_t t = 0; t < triangleCount; t++) {
+                uint32_t misses = 0;
+                for (int k = 0; k < 3; k++) misses += cache.touch(indices[t * 3 + k]);
+                if (t == 0 || misses == 3) hard.push_back(static_cast<uint32_t>(t));
+            }
+            hard.push_back(static_cast<uint32_t>(triangleCount));
+        }
+
+        // Soft boundaries: split a hard cluster once its ACMR, with a cold cache, is
+        // back within threshold of the mesh's, so moving it costs little
+        std::vector<uint32_t> clusters;
+        {
+            CacheSim cache(vertexCount, CACHE_SIZE);
+            const float limit = meshAcmr * threshold;
+            for (size_t h = 0; h + 1 < hard.size(); h++) {
+                uint32_t start = hard[h];
+                uint32_t misses = 0;
+                cache.flush();
+                clusters.push_back(start);
+                for (uint32_t t = hard[h]; t < hard[h + 1]; t++) {
+                    for (int k = 0; k < 3; k++) misses += cache.touch(indices[t * 3 + k]);
+                    const uint32_t count = t - start + 1;
+                    if (t + 1 < hard[h + 1] && static_cast<float>(misses) <= limit * static_cast<float>(count)) {
+                        start = t + 1;
+                        misses = 0;
+                        cache.flush();
+                        clusters.push_back(start);
+                    }
+                }
+            }
+            clusters.push_back(static_cast<uint32_t>(triangleCount));
+        }
+        const size_t clusterCount = clusters.size() - 1;
+        if (clusterCount < 2)
+            return;
+
+        float meshCentroid[3] = { 0.f, 0.f, 0.f };
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            const float* p = attribute(positions, byteStride, v);
+            for (int c = 0; c < 3; c++) meshCentroid[c] += p[c] / static_cast<float>(vertexCount);
+        }
+
+        // Clusters facing away from the mesh centre occlude the rest, so draw them first
+        std::vector<float> sortKeys(clusterCount);
+        for (size_t c = 0; c < clusterCount; c++) {
+            float centroid[3] = { 0.f, 0.f, 0.f };
+            float normal[3] = { 0.f, 0.f, 0.f };
+            for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++) {
+                const float* p0 = attribute(positions, byteStride, indices[t * 3 + 0]);
+                const float* p1 = attribute(positions, byteStride, indices[t * 3 + 1]);
+                const float* p2 = attribute(positions, byteStride, indices[t * 3 + 2]);
+                float triNormal[3] = { 0.f, 0.f, 0.f };
+                if (normals) {
+                    for (int k = 0; k < 3; k++) {
+                        const float* n = attribute(normals, byteStride, indices[t * 3 + k]);
+                        for (int i = 0; i < 3; i++) triNormal[i] += n[i];
+                    }
+                }
+                if (!normals || triNormal[0] * triNormal[0] + triNormal[1] * triNormal[1] + triNormal[2] * triNormal[2] == 0.f) {
+                    const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                    const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+                    triNormal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+                    triNormal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+                    triNormal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+                }
+                for (int i = 0; i < 3; i++) {
+                    centroid[i] += p0[i] + p1[i] + p2[i];
+                    normal[i] += triNormal[i];
+                }
+            }
+            const float count = 3.f * static_cast<float>(clusters[c + 1] - clusters[c]);
+            const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            float key = 0.f;
+            if (length > 0.f) {
+                for (int i = 0; i < 3; i++) {
+                    key += (centroid[i] / count - meshCentroid[i]) * normal[i] / length;
+                }
+            }
+            sortKeys[c] = key;
+        }
+
+        std::vector<uint32_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(),
+            [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+        std::vector<uint32_t> result;
+        result.reserve(indexCount);
+        for (uint32_t c : order) {
+            result.insert(result.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+        }
+        std::memcpy(indices, result.data(), indexCount * sizeof(uint32_t));
+    }
+
+    std::vector<uint32_t> optimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount)
+    {
+        constexpr uint32_t unassigned = ~0u;
+        std::vector<uint32_t> remap(vertexCount, unassigned);   // old -> new
+        std::vector<uint32_t> order;                            // new -> old
+        order.reserve(vertexCount);
+
+        for (size_t i = 0; i < indexCount; i++) {
+            uint32_t& mapped = remap[indices[i]];
+            if (mapped == unassigned) {
+                mapped = static_cast<uint32_t>(order.size());
+                order.push_back(indices[i]);
+            }
+            indices[i] = mapped;
+        }
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            if (remap[v] == unassigned) {
+                order.push_back(v);
+            }
+        }
+        return order;
+    }
+
+    Result optimizeMesh(
+        uint32_t* indices, size_t indexCount, size_t vertexCount,
+        const float* positions, const float* normals, size_t byteStride,
+        float overdrawThreshold)
+    {
+        Result result;
+        result.before = analyzeVertexCache(indices, indexCount, vertexCount);
+        optimizeVertexCache(indices, indexCount, vertexCount);
+        if (overdrawThreshold > 0.f) {
+            optimizeOverdraw(indices, indexCount, vertexCount, positions, normals, byteStride, overdrawThreshold);
+        }
+        result.vertexOrder = optimizeVertexFetch(indices, indexCount, vertexCount);
+        result.after = analyzeVertexCache(indices, indexCount, vertexCount);
+        return result;
+    }
+
+} // namespace meshopt
+} // namespace vkc
@@ -0,0 +1,74 @@
+// vkc_meshOptimizer.h
+#pragma once
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vkc {
+
+    // Load-time reordering of indexed triangle lists for the GPU:
+    //  1. triangle order for the post-transform vertex cache (Tipsify),
+    //  2. optionally, clusters of that order sorted front-to-back from the
+    //     mesh's normals to cut overdraw, at a bounded cache cost,
+    //  3. vertices renumbered in first-use order for fetch locality.
+    // Indices are per-mesh (0..vertexCount-1). Pure CPU, safe on worker threads.
+    namespace meshopt {
+
+        // Post-transform cache size the orderings are tuned for
+        constexpr uint32_t CACHE_SIZE = 16;
+
+        struct CacheStats {
+            float acmr = 0.f;   // transformed vertices per triangle; 0.5 ideal, 3 worst
+            float atvr = 0.f;   // transformed vertices per referenced vertex; 1 ideal
+        };
+
+        // Simulates a FIFO cache of cacheSize entries
+        CacheStats analyzeVertexCache(
+            const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+
+        // Reorders triangles in place for vertex cache locality
+        void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+
+        // Reorders the clusters of a cache-optimized list so outward-facing ones come
+        // first. Clusters are split where the cache ACMR stays within threshold times
+        // the mesh's (1.05 costs at most ~5%). Positions and normals are float3 at
+        // byteStride; normals may be null, then face normals are used.
+        void optimizeOverdraw(
+            uint32_t* indices, size_t indexCount, size_t vertexCount,
+            const float* positions, const float* normals, size_t byteStride,
+            float threshold = 1.05f);
+
+        // Renumbers vertices in first-use order and rewrites the indices. Returns
+        // new -> old vertex indices; unreferenced vertices go last, so the vertex
+        // count doesn't change.
+        std::vector<uint32_t> optimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+        // Reorders an array of vertices by the table optimizeVertexFetch returned
+        template<typename T>
+        void applyVertexOrder(std::vector<T>& vertices, const std::vector<uint32_t>& order)
+        {
+            std::vector<T> reordered;
+            reordered.reserve(order.size());
+            for (uint32_t old : order) {
+                reordered.push_back(vertices[old]);
+            }
+            vertices.swap(reordered);
+        }
+
+        struct Result {
+            std::vector<uint32_t> vertexOrder;  // new -> old, see optimizeVertexFetch
+            CacheStats before;
+            CacheStats after;
+        };
+
+        // All three passes. overdrawThreshold <= 0 skips the overdraw pass.
+        Result optimizeMesh(
+            uint32_t* indices, size_t indexCount, size_t vertexCount,
+            const float* positions, const float* normals, size_t byteStride,
+            float overdrawThreshold = 1.05f);
+
+    } // namespace meshopt
+
+} // namespace vkc
@@ -0,0 +1,489 @@
+// vkc_meshSimplifier.cpp
+#include "vkc_meshSimplifier.h"
+#include "vkc_meshOptimizer.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace vkc {
+namespace meshopt {
+
+    namespace {
+
+        // Triangles with fewer indices than this don't get LODs
+        constexpr size_t kMinLodIndices = 3 * 64;
+        // A level has to drop at least this share of the previous one's triangles
+        constexpr float kMinLodReduction = 0.15f;
+        // Border edges resist being moved more than interior ones
+        constexpr double kBorderWeight = 10.0;
+
+        enum class VertexKind : uint8_t { Manifold, Border, Seam, Locked };
+
+        struct Vec3 {
+            double x, y, z;
+        };
+
+        Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+        double dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+        Vec3 cross(const Vec3& a, const Vec3& b)
+        {
+            return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+        }
+
+        // Sum of weighted squared distances to a set of planes
+        struct Quadric {
+            double a00 = 0, a11 = 0, a22 = 0, a10 = 0, a20 = 0, a21 = 0;
+            double b0 = 0, b1 = 0, b2 = 0, c = 0;
+            double weight = 0;
+
+            // n must be unit length
+            void addPlane(const Vec3& n, double d, double w)
+            {
+                a00 += w * n.x * n.x; a11 += w * n.y * n.y; a22 += w * n.z * n.z;
+                a10 += w * n.y * n.x; a20 += w * n.z * n.x; a21 += w * n.z * n.y;
+                b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+                c += w * d * d;
+                weight += w;
+            }
+
+            void add(const Quadric& q)
+            {
+                a00 += q.a00; a11 += q.a11; a22 += q.a22;
+                a10 += q.a10; a20 += q.a20; a21 += q.a21;
+                b0 += q.b0; b1 += q.b1; b2 += q.b2;
+                c += q.c;
+                weight += q.weight;
+            }
+
+            // Mean squared distance of p to the planes
+            double error(const Vec3& p) const
+            {
+                const double rx = a00 * p.x + a10 * p.y + a20 * p.z + b0;
+                const double ry = a10 * p.x + a11 * p.y + a21 * p.z + b1;
+                const double rz = a20 * p.x + a21 * p.y + a22 * p.z + b2;
+                const double r = rx * p.x + ry * p.y + rz * p.z + b0 * p.x + b1 * p.y + b2 * p.z + c;
+                return weight > 0 ? std::abs(r) / weight : 0.0;
+            }
+        };
+
+        // Outgoing half-edges (v -> next corner of the triangle) per vertex
+        struct EdgeAdjacency {
+            std::vector<uint32_t> offsets;
+            std::vector<uint32_t> targets;
+
+            void build(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+            {
+                offsets.assign(vertexCount + 1, 0);
+                targets.resize(indexCount);
+                for (size_t i = 0; i < indexCount; i++) {
+                    offsets[indices[i] + 1]++;
+                }
+                for (size_t v = 0; v < vertexCount; v++) {
+                    offsets[v + 1] += offsets[v];
+                }
+                std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+                for (size_t t = 0; t < indexCount / 3; t++) {
+                    for (int k = 0; k < 3; k++) {
+                        const uint32_t a = indices[t * 3 + k];
+                        targets[fill[a]++] = indices[t * 3 + (k + 1) % 3];
+                    }
+                }
+            }
+
+            bool has(uint32_t a, uint32_t b) const
+            {
+                for (uint32_t i = offsets[a]; i < offsets[a + 1]; i++) {
+                    if (targets[i] == b) return true;
+                }
+                return false;
+            }
+        };
+
+        struct PositionKey {
+            float p[3];
+            bool operator==(const PositionKey& other) const { return std::memcmp(p, other.p, sizeof(p)) == 0; }
+        };
+
+        struct PositionKeyHash {
+            size_t operator()(const PositionKey& key) const
+            {
+                uint32_t bits[3];
+                std::memcpy(bits, key.p, sizeof(bits));
+                return (size_t(bits[0]) * 73856093u) ^ (size_t(bits[1]) * 19349663u) ^ (size_t(bits[2]) * 83492791u);
+            }
+        };
+
+        class Simplifier {
+        public:
+            Simplifier(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t byteStride)
+                : indexCount(indexCount), vertexCount(vertexCount), remap(vertexCount), wedge(vertexCount),
+                  kinds(vertexCount, VertexKind::Locked), quadrics(vertexCount), points(vertexCount)
+            {
+                for (size_t v = 0; v < vertexCount; v++) {
+                    const float* p = reinterpret_cast<const float*>(
+                        reinterpret_cast<const unsigned char*>(positions) + byteStride * v);
+                    points[v] = { p[0], p[1], p[2] };
+                }
+                buildWedges(positions, byteStride);
+                adjacency.build(indices, indexCount, vertexCount);
+                classify();
+                buildQuadrics(indices);
+            }
+
+            double extent() const
+            {
+                if (vertexCount == 0) return 0.0;
+                Vec3 lo = points[0], hi = points[0];
+                for (const Vec3& p : points) {
+                    lo = { std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z) };
+                    hi = { std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z) };
+                }
+                return std::max({ hi.x - lo.x, hi.y - lo.y, hi.z - lo.z });
+            }
+
+            size_t run(uint32_t* result, size_t targetIndexCount, double maxErrorSq, double& worstErrorSq)
+            {
+                size_t count = indexCount;
+                std::vector<uint32_t> collapse(vertexCount);
+                std::vector<bool> locked(vertexCount);
+
+                while (count > targetIndexCount) {
+                    adjacency.build(result, count, vertexCount);
+                    buildFans(result, count);
+
+                    // Candidate collapses u -> v along every edge, in both directions
+                    candidates.clear();
+                    for (size_t t = 0; t < count / 3; t++) {
+                        for (int k = 0; k < 3; k++) {
+                            const uint32_t a = result[t * 3 + k];
+                            const uint32_t b = result[t * 3 + (k + 1) % 3];
+                            addCandidate(a, b);
+                            addCandidate(b, a);
+                        }
+                    }
+                    std::sort(candidates.begin(), candidates.end(),
+                        [](const Candidate& x, const Candidate& y) { return x.cost < y.cost; });
+
+                    // Each collapse removes about two triangles; don't overshoot the target
+                    const size_t collapseLimit = (count - targetIndexCount) / 6 + 1;
+                    size_t collapses = 0;
+                    for (size_t v = 0; v < vertexCount; v++) collapse[v] = static_cast<uint32_t>(v);
+                    std::fill(locked.begin(), locked.end(), false);
+
+                    for (const Candidate& candidate : candidates) {
+                        if (candidate.cost > maxErrorSq || collapses >= collapseLimit)
+                            break;
+                        const uint32_t ru = remap[candidate.u];
+                        const uint32_t rv = remap[candidate.v];
+                        if (locked[ru] || locked[rv])
+                            continue;
+                        if (flips(ru, rv, points[candidate.v]))
+                            continue;
+
+                        collapse[candidate.u] = candidate.v;
+                        if (candidate.u2 != candidate.u) {
+                            collapse[candidate.u2] = candidate.v2;
+                        }
+                        quadrics[rv].add(quadrics[ru]);
+
+                        // The fan around u changes shape, so nothing in it moves again this pass
+                        for (uint32_t f = fanOffsets[ru]; f < fanOffsets[ru + 1]; f++) {
+                            const uint32_t t = fanTriangles[f];
+                            for (int k = 0; k < 3; k++) locked[remap[result[t * 3 + k]]] = true;
+                        }
+                        locked[ru] = locked[rv] = true;
+                        worstErrorSq = std::max(worstErrorSq, candidate.cost);
+                        collapses++;
+                    }
+                    if (collapses == 0)
+                        break;
+
+                    // Apply, dropping triangles that collapsed to a line
+                    size_t written = 0;
+                    for (size_t t = 0; t < count / 3; t++) {
+                        const uint32_t a = collapse[result[t * 3 + 0]];
+                        const uint32_t b = collapse[result[t * 3 + 1]];
+                        const uint32_t c = collapse[result[t * 3 + 2]];
+                        if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a])
+                            continue;
+                        result[written++] = a;
+                        result[written++] = b;
+                        result[written++] = c;
+                    }
+                    count = written;
+                }
+                return count;
+            }
+
+        private:
+            struct Candidate {
+                uint32_t u, v;      // u collapses onto v
+                uint32_t u2, v2;    // the other side of a seam, or u2 == u
+                double   cost;
+            };
+
+            void buildWedges(const float* positions, size_t byteStride)
+            {
+                std::unordered_map<PositionKey, uint32_t, PositionKeyHash> first;
+                first.reserve(vertexCount);
+                for (uint32_t v = 0; v < vertexCount; v++) {
+                    PositionKey key;
+                    std::memcpy(key.p, reinterpret_cast<const unsigned char*>(positions) + byteStride * v, sizeof(key.p));
+                    auto [it, inserted] = first.emplace(key, v);
+                    remap[v] = it->second;
+                    wedge[v] = v;
+                    if (!inserted) {
+                        // Splice into the canonical vertex's ring
+                        wedge[v] = wedge[it->second];
+                        wedge[it->second] = v;
+                    }
+                }
+            }
+
+            // Edge a -> b exists between any vertices at these two positions
+            bool hasPositionEdge(uint32_t a, uint32_t b) const
+            {
+                const uint32_t rb = remap[b];
+                uint32_t w = a;
+                do {
+                    for (uint32_t i = adjacency.offsets[w]; i < adjacency.offsets[w + 1]; i++) {
+                        if (remap[adjacency.targets[i]] == rb) return true;
+                    }
+                    w = wedge[w];
+                } while (w != a);
+                return false;
+            }
+
+            void classify()
+            {
+                std::vector<uint32_t> openOut(vertexCount, 0), openIn(vertexCount, 0);
+                std::vector<uint32_t> seamOut(vertexCount, 0), seamIn(vertexCount, 0);
+                for (uint32_t a = 0; a < vertexCount; a++) {
+                    for (uint32_t i = adjacency.offsets[a]; i < adjacency.offsets[a + 1]; i++) {
+                        const uint32_t b = adjacency.targets[i];
+                        if (!hasPositionEdge(b, a)) {
+                            openOut[remap[a]]++;
+                            openIn[remap[b]]++;
+                        }
+                        else if (!adjacency.has(b, a)) {
+                            seamOut[a]++;
+                            seamIn[b]++;
+                        }
+                    }
+                }
+
+                for (uint32_t v = 0; v < vertexCount; v++) {
+                    if (remap[v] != v)
+                        continue;
+                    uint32_t wedgeSize = 1;
+                    for (uint32_t w = wedge[v]; w != v; w = wedge[w]) wedgeSize++;
+
+                    VertexKind kind = VertexKind::Locked;
+                    if (wedgeSize == 1 && seamOut[v] == 0 && seamIn[v] == 0) {
+                        if (openOut[v] == 0 && openIn[v] == 0) kind = VertexKind::Manifold;
+                        else if (openOut[v] == 1 && openIn[v] == 1) kind = VertexKind::Border;
+                    }
+                    else if (wedgeSize == 2 && openOut[v] == 0 && openIn[v] == 0) {
+                        const uint32_t v2 = wedge[v];
+                        if (seamOut[v] == 1 && seamIn[v] == 1 && seamOut[v2] == 1 && seamIn[v2] == 1)
+                            kind = VertexKind::Seam;
+                    }
+
+                    uint32_t w = v;
+                    do {
+                        kinds[w] = kind;
+                        w = wedge[w];
+                    } while (w != v);
+                }
+            }
+
+            void buildQuadrics(const uint32_t* indices)
+            {
+                for (size_t t = 0; t < indexCount / 3; t++) {
+                    const uint32_t i[3] = { indices[t * 3 + 0], indices[t * 3 + 1], indices[t * 3 + 2] };
+                    const Vec3& p0 = points[i[0]];
+                    Vec3 n = cross(points[i[1]] - p0, points[i[2]] - p0);
+                    const double length = std::sqrt(dot(n, n));
+                    if (length <= 0.0)
+                        continue;
+                    n = { n.x / length, n.y / length, n.z / length };
+                    const double area = 0.5 * length;
+                    for (int k = 0; k < 3; k++) {
+                        quadrics[remap[i[k]]].addPlane(n, -dot(n, p0), area);
+                    }
+
+                    // Planes through open and seam edges, perpendicular to the face, keep
+                    // those edges where they are
+                    for (int k = 0; k < 3; k++) {
+                        const uint32_t a = i[k];
+                        const uint32_t b = i[(k + 1) % 3];
+                        const bool border = !hasPositionEdge(b, a);
+                        const bool seam = !border && !adjacency.has(b, a);
+                        if (!border && !seam)
+                            continue;
+                        const Vec3 edge = points[b] - points[a];
+                        Vec3 en = cross(edge, n);
+                        const double enLength = std::sqrt(dot(en, en));
+                        if (enLength <= 0.0)
+                            continue;
+                        en = { en.x / enLength, en.y / enLength, en.z / enLength };
+                        const double w = dot(edge, edge) * (border ? kBorderWeight : 1.0);
+                        const double d = -dot(en, points[a]);
+                        quadrics[remap[a]].addPlane(en, d, w);
+                        quadrics[remap[b]].addPlane(en, d, w);
+                    }
+                }
+            }
+
+            // Triangles around each position
+            void buildFans(const uint32_t* result, size_t count)
+            {
+                fanOffsets.assign(vertexCount + 1, 0);
+                fanTriangles.resize(count);
+                for (size_t i = 0; i < count; i++) {
+                    fanOffsets[remap[result[i]] + 1]++;
+                }
+                for (size_t v = 0; v < vertexCount; v++) {
+                    fanOffsets[v + 1] += fanOffsets[v];
+                }
+                std::vector<uint32_t> fill(fanOffsets.begin(), fanOffsets.end() - 1);
+                for (size_t i = 0; i < count; i++) {
+                    fanTriangles[fill[remap[result[i]]]++] = static_cast<uint32_t>(i / 3);
+                }
+                fanSource = result;
+            }
+
+            bool isSeamEdge(uint32_t a, uint32_t b) const
+            {
+                return adjacency.has(a, b) != adjacency.has(b, a);
+            }
+
+            void addCandidate(uint32_t u, uint32_t v)
+            {
+                if (remap[u] == remap[v])
+                    return;
+
+                Candidate candidate{ u, v, u, v, 0.0 };
+                switch (kinds[u]) {
+                case VertexKind::Manifold:
+                    break;
+                case VertexKind::Border:
+                    if (hasPositionEdge(u, v) && hasPositionEdge(v, u))
+                        return;
+                    break;
+                case VertexKind::Seam: {
+                    if (!isSeamEdge(u, v))
+                        return;
+                    // The other side of u follows onto whichever vertex at v's position it shares an edge with
+                    candidate.u2 = wedge[u];
+                    candidate.v2 = candidate.u2;
+                    for (uint32_t w = wedge[v]; w != v; w = wedge[w]) {
+                        if (adjacency.has(candidate.u2, w) || adjacency.has(w, candidate.u2)) {
+                            candidate.v2 = w;
+                            break;
+                        }
+                    }
+                    if (candidate.v2 == candidate.u2)
+                        return;
+                    break;
+                }
+                default:
+                    return;
+                }
+
+                candidate.cost = quadrics[remap[u]].error(points[v]);
+                candidates.push_back(candidate);
+            }
+
+            // Moving position ru to target turns a remaining triangle around
+            bool flips(uint32_t ru, uint32_t rv, const Vec3& target) const
+            {
+                for (uint32_t f = fanOffsets[ru]; f < fanOffsets[ru + 1]; f++) {
+                    const uint32_t t = fanTriangles[f];
+                    Vec3 before[3], after[3];
+                    bool containsV = false;
+                    for (int k = 0; k < 3; k++) {
+                        const uint32_t r = remap[fanSource[t * 3 + k]];
+                        containsV = containsV || r == rv;
+                        before[k] = points[r];
+                        after[k] = r == ru ? target : before[k];
+                    }
+                    if (containsV)
+                        continue;
+                    const Vec3 n0 = cross(before[1] - before[0], before[2] - before[0]);
+                    const Vec3 n1 = cross(after[1] - after[0], after[2] - after[0]);
+                    if (dot(n0, n1) <= 0.0)
+                        return true;
+                }
+                return false;
+            }
+
+            size_t indexCount;
+            size_t vertexCount;
+            std::vector<uint32_t>   remap;      // first vertex with the same position
+            std::vector<uint32_t>   wedge;      // ring of vertices sharing a position
+            std::vector<VertexKind> kinds;
+            std::vector<Quadric>    quadrics;   // per position (remap)
+            std::vector<Vec3>       points;
+            EdgeAdjacency           adjacency;
+            std::vector<uint32_t>   fanOffsets;
+            std::vector<uint32_t>   fanTriangles;
+            const uint32_t*         fanSource = nullptr;
+            std::vector<Candidate>  candidates;
+        };
+
+    }  // namespace
+
+    size_t simplify(
+        uint32_t* destination, const uint32_t* indices, size_t indexCount,
+        const float* positions, size_t vertexCount, size_t byteStride,
+        size_t targetIndexCount, float targetError, float* resultError)
+    {
+        std::memcpy(destination, indices, indexCount * sizeof(uint32_t));
+        if (resultError) *resultError = 0.f;
+        if (indexCount < 3 || indexCount % 3 != 0 || targetIndexCount >= indexCount)
+            return indexCount;
+
+        Simplifier simplifier(indices, indexCount, positions, vertexCount, byteStride);
+        const double maxError = static_cast<double>(targetError) * simplifier.extent();
+        double worstErrorSq = 0.0;
+        const size_t count = simplifier.run(destination, targetIndexCount, maxError * maxError, worstErrorSq);
+        if (resultError) *resultError = static_cast<float>(std::sqrt(worstErrorSq));
+        return count;
+    }
+
+    std::vector<Lod> generateLods(
+        std::vector<uint32_t>& indices,
+        const float* positions, size_t vertexCount, size_t byteStride,
+        uint32_t maxLevels, float maxError)
+    {
+        std::vector<Lod> lods;
+        lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.f });
+
+        std::vector<uint32_t> level;
+        for (uint32_t l = 1; l <= maxLevels; l++) {
+            const Lod previous = lods.back();
+            if (previous.indexCount < kMinLodIndices)
+                break;
+
+            // Simplify the previous level; its error adds up
+            level.resize(previous.indexCount);
+            const size_t target = (previous.indexCount / 6) * 3;
+            float error = 0.f;
+            const size_t count = simplify(level.data(), indices.data() + previous.firstIndex, previous.indexCount,
+                positions, vertexCount, byteStride, target, maxError, &error);
+            if (count == 0 || static_cast<float>(count) > static_cast<float>(previous.indexCount) * (1.f - kMinLodReduction))
+                break;
+
+            optimizeVertexCache(level.data(), count, vertexCount);
+            lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(count), previous.error + error });
+            indices.insert(indices.end(), level.begin(), level.begin() + count);
+        }
+        return lods;
+    }
+
+} // namespace meshopt
+} // namespace vkc
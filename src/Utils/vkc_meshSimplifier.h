@@ -0,0 +1,47 @@
+// vkc_meshSimplifier.h
+#pragma once
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vkc {
+
+    namespace meshopt {
+
+        // One level of detail: a range of a mesh's index list. Every level indexes the
+        // same vertices, so LODs only cost index memory.
+        struct Lod {
+            uint32_t firstIndex = 0;
+            uint32_t indexCount = 0;
+            float    error = 0.f;     // object-space deviation from level 0
+        };
+
+        // Quadric error metric edge collapse (Garland and Heckbert 1997). Vertices only
+        // collapse onto their neighbours, never move, so the result indexes the input
+        // vertices. Borders collapse only along the border and attribute seams (same
+        // position, different vertices) only along the seam with both sides together;
+        // vertices where that can't be done are locked.
+        //
+        // Writes at most indexCount indices to destination and returns how many. Stops at
+        // targetIndexCount or when the next collapse would deviate by more than
+        // targetError times the mesh extent. resultError gets the largest deviation in
+        // object space. Positions are float3 at byteStride.
+        size_t simplify(
+            uint32_t* destination, const uint32_t* indices, size_t indexCount,
+            const float* positions, size_t vertexCount, size_t byteStride,
+            size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+        // Appends up to maxLevels coarser index lists to indices, each about half the
+        // triangles of the one before and cache-optimized. indices initially holds only
+        // level 0. Returns every level, level 0 first; stops early once a level no
+        // longer pays for itself.
+        std::vector<Lod> generateLods(
+            std::vector<uint32_t>& indices,
+            const float* positions, size_t vertexCount, size_t byteStride,
+            uint32_t maxLevels = 3, float maxError = 0.05f);
+
+    } // namespace meshopt
+
+} // namespace vkc
@@ -0,0 +1,278 @@
+// vkc_sceneBinary.cpp
+
+// Project headers
+#include "vkc_sceneBinary.h"
+
+// External
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace vkc {
+
+    namespace {
+
+        constexpr uint32_t kSceneMagic = 0x43534B56; // "VKSC"
+        constexpr uint32_t kSceneVersion = 1;
+        constexpr uint64_t kRecordAlignment = 16;
+
+        struct SceneFileHeader {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t sourceSize;     // 0 for stand-alone files
+            int64_t  sourceMtime;
+            uint32_t assetCount;
+            uint32_t objectCount;
+            uint64_t stringBytes;
+            uint64_t objectsOffset;
+        };
+
+        bool stampSource(const std::string& sourcePath, uint64_t& size, int64_t& mtime)
+        {
+            std::error_code ec;
+            auto fileSize = fs::file_size(sourcePath, ec);
+            if (ec) return false;
+            auto writeTime = fs::last_write_time(sourcePath, ec);
+            if (ec) return false;
+
+            size = static_cast<uint64_t>(fileSize);
+            mtime = static_cast<int64_t>(writeTime.time_since_epoch().count());
+            return true;
+        }
+
+        uint64_t alignUp(uint64_t value, uint64_t alignment)
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        void readVec3(const nlohmann::json& objJson, const char* key, const float fallback[3], float out[3])
+        {
+            auto it = objJson.find(key);
+            for (int i = 0; i < 3; ++i) {
+                out[i] = (it != objJson.end() && it->is_array() && it->size() > static_cast<size_t>(i))
+                    ? (*it)[i].get<float>() : fallback[i];
+            }
+        }
+    }
+
+    uint32_t SceneData::internAsset(const std::string& name)
+    {
+        auto [it, inserted] = _assetLookup.emplace(name, static_cast<uint32_t>(assetNames.size()));
+        if (inserted) {
+            assetNames.push_back(name);
+        }
+        return it->second;
+    }
+
+    void appendSceneRecords(const nlohmann::json& objJson, SceneData& scene)
+    {
+        // Spinning point lights, spread evenly on a circle
+        if (objJson.value("special", "") == "lights") {
+            int count = objJson.value("count", 1);
+            float radius = objJson.value("radius", 4.8f);
+            float height = objJson.value("height", -2.5f);
+            float intensity = objJson.value("intensity", 15.8f);
+            const auto& colorsJson = objJson.at("colors");
+
+            glm::vec3 basePosition = glm::normalize(glm::vec3(-1.f, 0.f, -1.f)) * radius;
+            for (int i = 0; i < count; i++) {
+                SceneRecord record;
+                record.flags = SceneRecord::PointLight;
+                record.lightIntensity = intensity;
+                // Matches VkcGameObject::makePointLight
+                record.scale[0] = 0.1f;
+
+                const auto& c = colorsJson[i % colorsJson.size()];
+                for (int k = 0; k < 3; ++k) {
+                    record.color[k] = c[k].get<float>();
+                }
+
+                float angle = (i * glm::two_pi<float>()) / count;
+                glm::mat4 rot = glm::rotate(glm::mat4(1.f), angle, glm::vec3(0.f, -1.f, 0.f));
+                glm::vec3 pos = glm::vec3(rot * glm::vec4(basePosition, 1.f));
+                pos.y = height;
+                record.translation[0] = pos.x;
+                record.translation[1] = pos.y;
+                record.translation[2] = pos.z;
+
+                scene.objects.push_back(record);
+            }
+            return;
+        }
+
+        SceneRecord record;
+        if (auto it = objJson.find("model"); it != objJson.end()) {
+            record.model = scene.internAsset(it->get<std::string>());
+        }
+        if (auto it = objJson.find("textureName"); it != objJson.end()) {
+            record.texture = scene.internAsset(it->get<std::string>());
+        }
+        if (objJson.value("isSkybox", false)) {
+            record.flags |= SceneRecord::Skybox;
+        }
+
+        static const float kZero[3] = { 0.f, 0.f, 0.f };
+        static const float kOne[3] = { 1.f, 1.f, 1.f };
+        readVec3(objJson, "position", kZero, record.translation);
+        readVec3(objJson, "rotation", kZero, record.rotation);
+        readVec3(objJson, "scale", kOne, record.scale);
+
+        // Copies of the object on a square grid in the XZ plane, starting at its position
+        if (objJson.value("special", "") == "grid") {
+            const int count = objJson.value("count", 1);
+            const float spacing = objJson.value("spacing", 2.f);
+            const int columns = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count)))));
+            const float origin[2] = { record.translation[0], record.translation[2] };
+            scene.objects.reserve(scene.objects.size() + std::max(count, 0));
+            for (int i = 0; i < count; i++) {
+                record.translation[0] = origin[0] + spacing * static_cast<float>(i % columns);
+                record.translation[2] = origin[1] + spacing * static_cast<float>(i / columns);
+                scene.objects.push_back(record);
+            }
+            return;
+        }
+
+        scene.objects.push_back(record);
+    }
+
+    SceneData sceneDataFromJson(const nlohmann::json& sceneJson)
+    {
+        SceneData scene;
+        for (const auto& objJson : sceneJson.at("objects")) {
+            appendSceneRecords(objJson, scene);
+        }
+        return scene;
+    }
+
+    bool writeBinaryScene(const std::string& path, const SceneData& scene,
+        const std::string& sourcePath, std::string& error)
+    {
+        SceneFileHeader header{};
+        header.magic = kSceneMagic;
+        header.version = kSceneVersion;
+        if (!sourcePath.empty() && !stampSource(sourcePath, header.sourceSize, header.sourceMtime)) {
+            error = "cannot stat " + sourcePath;
+            return false;
+        }
+
+        std::vector<uint32_t> offsets;
+        offsets.reserve(scene.assetNames.size() + 1);
+        uint64_t stringBytes = 0;
+        for (const auto& name : scene.assetNames) {
+            offsets.push_back(static_cast<uint32_t>(stringBytes));
+            stringBytes += name.size();
+        }
+        offsets.push_back(static_cast<uint32_t>(stringBytes));
+
+        header.assetCount = static_cast<uint32_t>(scene.assetNames.size());
+        header.objectCount = static_cast<uint32_t>(scene.objects.size());
+        header.stringBytes = stringBytes;
+        const uint64_t tableEnd = sizeof(SceneFileHeader) + offsets.size() * sizeof(uint32_t) + stringBytes;
+        header.objectsOffset = alignUp(tableEnd, kRecordAlignment);
+
+        std::error_code ec;
+        if (fs::path(path).has_parent_path()) {
+            fs::create_directories(fs::path(path).parent_path(), ec);
+        }
+
+        // Write to a temporary file and rename so a crash never leaves a half-written scene
+        const std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                error = "could not write " + tmpPath;
+                return false;
+            }
+
+            static const char padding[kRecordAlignment] = {};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint32_t));
+            for (const auto& name : scene.assetNames) {
+                out.write(name.data(), name.size());
+            }
+            out.write(padding, header.objectsOffset - tableEnd);
+            out.write(reinterpret_cast<const char*>(scene.objects.data()), scene.objects.size() * sizeof(SceneRecord));
+            if (!out) {
+                error = "failed writing " + tmpPath;
+                return false;
+            }
+        }
+
+        fs::rename(tmpPath, path, ec);
+        if (ec) {
+            fs::remove(tmpPath, ec);
+            error = "could not replace " + path;
+            return false;
+        }
+        return true;
+    }
+
+    bool BinaryScene::open(const std::string& path, const std::string& sourcePath)
+    {
+        MappedFile file;
+        if (!file.open(path) || file.size() < sizeof(SceneFileHeader)) {
+            return false;
+        }
+
+        SceneFileHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (header.magic != kSceneMagic || header.version != kSceneVersion) {
+            return false;
+        }
+
+        if (!sourcePath.empty()) {
+            uint64_t size = 0;
+            int64_t mtime = 0;
+            if (!stampSource(sourcePath, size, mtime) || header.sourceSize != size || header.sourceMtime != mtime) {
+                return false;
+            }
+        }
+
+        const uint64_t offsetsBytes = (uint64_t(header.assetCount) + 1) * sizeof(uint32_t);
+        const uint64_t objectsBytes = uint64_t(header.objectCount) * sizeof(SceneRecord);
+        if (sizeof(SceneFileHeader) + offsetsBytes + header.stringBytes > header.objectsOffset ||
+            header.objectsOffset % kRecordAlignment != 0 ||
+            header.objectsOffset + objectsBytes > file.size()) {
+            return false;
+        }
+
+        // Names are read straight from the mapping, so every offset has to stay inside the string table
+        const auto* stringOffsets = reinterpret_cast<const uint32_t*>(file.data() + sizeof(SceneFileHeader));
+        if (stringOffsets[header.assetCount] != header.stringBytes) {
+            return false;
+        }
+        for (uint32_t i = 0; i < header.assetCount; i++) {
+            if (stringOffsets[i] > stringOffsets[i + 1] || stringOffsets[i] > header.stringBytes) {
+                return false;
+            }
+        }
+
+        _assetCount = header.assetCount;
+        _stringOffsets = stringOffsets;
+        _strings = reinterpret_cast<const char*>(file.data() + sizeof(SceneFileHeader) + offsetsBytes);
+        _objectCount = header.objectCount;
+        _objects = reinterpret_cast<const SceneRecord*>(file.data() + header.objectsOffset);
+        _file = std::move(file);
+        return true;
+    }
+
+    std::string_view BinaryScene::assetName(uint32_t index) const
+    {
+        // open() checked the offsets are ascending and end at the string table's size
+        if (index >= _assetCount) {
+            return {};
+        }
+        return std::string_view(_strings + _stringOffsets[index], _stringOffsets[index + 1] - _stringOffsets[index]);
+    }
+
+} // namespace vkc
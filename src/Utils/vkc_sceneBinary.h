@@ -0,0 +1,96 @@
+// vkc_sceneBinary.h
+#pragma once
+
+// Project headers
+#include "Utils/vkc_mappedFile.h"
+
+// External
+#include <json.hpp>
+
+// STD
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace vkc {
+
+    // Compact binary form of a scene file (.vkscene). Asset names live once in a
+    // string table and every object is a fixed-size record that refers to them
+    // by index, so a scene of any size loads with one file mapping and one pass
+    // over the records. The JSON form stays the authoring format; the loader
+    // keeps a compiled copy under res/cache/scenes, and SceneExporter writes
+    // stand-alone files.
+    //
+    // File layout (little endian, all offsets from the start of the file):
+    //   SceneFileHeader
+    //   uint32_t stringOffsets[assetCount + 1]   into the string bytes
+    //   char     strings[]                        not null terminated
+    //   SceneRecord objects[objectCount]          16-byte aligned
+    struct SceneRecord {
+        static constexpr uint32_t kNoAsset = 0xFFFFFFFFu;
+
+        enum Flags : uint32_t {
+            None = 0x0,
+            Skybox = 0x1,
+            PointLight = 0x2
+        };
+
+        uint32_t model = kNoAsset;     // string table index
+        uint32_t texture = kNoAsset;   // string table index
+        uint32_t flags = None;
+        float    lightIntensity = 0.f;
+        float    translation[3] = { 0.f, 0.f, 0.f };
+        float    rotation[3] = { 0.f, 0.f, 0.f };
+        float    scale[3] = { 1.f, 1.f, 1.f };
+        float    color[3] = { 0.f, 0.f, 0.f };
+    };
+    static_assert(sizeof(SceneRecord) == 64, "SceneRecord is written to disk as is");
+
+    // A scene in memory, as built from JSON and written by writeBinaryScene()
+    struct SceneData {
+        std::vector<std::string> assetNames;
+        std::vector<SceneRecord> objects;
+
+        // Index of name in assetNames, added if new
+        uint32_t internAsset(const std::string& name);
+
+    private:
+        std::unordered_map<std::string, uint32_t> _assetLookup;
+    };
+
+    // Appends the records described by one entry of a JSON scene's "objects"
+    // array: one record for a plain object, the ring of point lights of a
+    // "special": "lights" entry, or the "count" copies spaced "spacing" apart
+    // of a "special": "grid" entry.
+    void appendSceneRecords(const nlohmann::json& objJson, SceneData& scene);
+    SceneData sceneDataFromJson(const nlohmann::json& sceneJson);
+
+    // Writes scene to path. If sourcePath is not empty its size and mtime are
+    // stored, and BinaryScene::open() only accepts the file while they match.
+    bool writeBinaryScene(const std::string& path, const SceneData& scene,
+        const std::string& sourcePath, std::string& error);
+
+    // Read-only view of a mapped .vkscene file
+    class BinaryScene {
+    public:
+        // Returns false if the file is missing, malformed, or stale against sourcePath
+        bool open(const std::string& path, const std::string& sourcePath = "");
+
+        uint32_t assetCount() const { return _assetCount; }
+        std::string_view assetName(uint32_t index) const;
+
+        uint32_t objectCount() const { return _objectCount; }
+        const SceneRecord* objects() const { return _objects; }
+
+    private:
+        MappedFile         _file;
+        uint32_t           _assetCount = 0;
+        const uint32_t*    _stringOffsets = nullptr;
+        const char*        _strings = nullptr;
+        uint32_t           _objectCount = 0;
+        const SceneRecord* _objects = nullptr;
+    };
+
+} // namespace vkc
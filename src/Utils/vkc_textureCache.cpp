@@ -0,0 +1,49 @@
+// vkc_textureCache.cpp
+#include "vkc_textureCache.h"
+
+// STD
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace vkc {
+
+    TextureCache::TextureCache(std::string sourceRoot, std::string cacheDir)
+        : _sourceRoot(std::move(sourceRoot)), _cacheDir(std::move(cacheDir))
+    {
+    }
+
+    std::string TextureCache::cookedPath(const std::string& sourcePath) const
+    {
+        const fs::path relative = fs::path(sourcePath).lexically_normal()
+            .lexically_relative(fs::path(_sourceRoot).lexically_normal());
+        if (relative.empty() || *relative.begin() == "..") {
+            return {};
+        }
+        return (fs::path(_cacheDir) / relative).generic_string() + ".ktx";
+    }
+
+    bool TextureCache::findCooked(const std::string& sourcePath, std::string& outPath) const
+    {
+        const std::string cooked = cookedPath(sourcePath);
+        if (cooked.empty()) {
+            return false;
+        }
+
+        std::error_code ec;
+        const auto cookedTime = fs::last_write_time(cooked, ec);
+        if (ec) {
+            return false;
+        }
+        const auto sourceTime = fs::last_write_time(sourcePath, ec);
+        if (ec || cookedTime < sourceTime) {
+            return false;
+        }
+
+        outPath = cooked;
+        return true;
+    }
+
+} // namespace vkc
@@ -0,0 +1,28 @@
+// vkc_textureCache.h
+#pragma once
+
+// STD
+#include <string>
+
+namespace vkc {
+
+    // Maps source images under a resource root to the KTX files the texture
+    // cooker writes for them, mirroring the source tree below cacheDir
+    // (res/textures/foo.png -> res/cache/textures/textures/foo.png.ktx).
+    // Stateless apart from the two roots, so it can be used from any thread.
+    class TextureCache {
+    public:
+        TextureCache(std::string sourceRoot, std::string cacheDir);
+
+        // Empty if the source is not below the source root
+        std::string cookedPath(const std::string& sourcePath) const;
+
+        // True if a cooked file exists and is at least as new as the source
+        bool findCooked(const std::string& sourcePath, std::string& outPath) const;
+
+    private:
+        std::string _sourceRoot;
+        std::string _cacheDir;
+    };
+
+} // namespace vkc
@@ -0,0 +1,247 @@
+// vkc_textureCooker.cpp
+#include "vkc_textureCooker.h"
+
+// External
+#include <ktx.h>
+#include "stb_image.h"
+
+// STD
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace vkc {
+
+    namespace {
+
+        // glInternalformat values of the KTX 1 container
+        constexpr uint32_t kGlBC1 = 0x83F0;      // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+        constexpr uint32_t kGlBC1Srgb = 0x8C4C;  // GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+        constexpr uint32_t kGlBC3 = 0x83F3;      // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+        constexpr uint32_t kGlBC3Srgb = 0x8C4F;  // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+        constexpr uint32_t kGlBC5 = 0x8DBD;      // GL_COMPRESSED_RG_RGTC2
+        constexpr uint32_t kGlBC7 = 0x8E8C;      // GL_COMPRESSED_RGBA_BPTC_UNORM
+        constexpr uint32_t kGlBC7Srgb = 0x8E8D;  // GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+
+        uint32_t glInternalFormat(bc::Format format, bool srgb)
+        {
+            switch (format) {
+            case bc::Format::BC1: return srgb ? kGlBC1Srgb : kGlBC1;
+            case bc::Format::BC3: return srgb ? kGlBC3Srgb : kGlBC3;
+            case bc::Format::BC5: return kGlBC5;
+            case bc::Format::BC7: return srgb ? kGlBC7Srgb : kGlBC7;
+            }
+            return kGlBC7;
+        }
+
+        const std::array<float, 256>& srgbToLinearTable()
+        {
+            static const std::array<float, 256> table = []() {
+                std::array<float, 256> t{};
+                for (int i = 0; i < 256; ++i) {
+                    const float s = i / 255.0f;
+                    t[i] = s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+                }
+                return t;
+            }();
+            return table;
+        }
+
+        uint8_t linearToSrgb(float v)
+        {
+            v = std::clamp(v, 0.0f, 1.0f);
+            const float s = v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+            return static_cast<uint8_t>(std::lround(s * 255.0f));
+        }
+
+        // Halves an RGBA8 level with a 2x2 box filter; odd edges reuse the last texel.
+        // Colour is averaged in linear space and normals are renormalized.
+        std::vector<uint8_t> downsample(const std::vector<uint8_t>& src, uint32_t width, uint32_t height, TextureUsage usage)
+        {
+            const uint32_t dstWidth = std::max(1u, width / 2);
+            const uint32_t dstHeight = std::max(1u, height / 2);
+            std::vector<uint8_t> dst(static_cast<size_t>(dstWidth) * dstHeight * 4);
+            const auto& toLinear = srgbToLinearTable();
+
+            for (uint32_t y = 0; y < dstHeight; ++y) {
+                const uint32_t y0 = std::min(2 * y, height - 1);
+                const uint32_t y1 = std::min(2 * y + 1, height - 1);
+                for (uint32_t x = 0; x < dstWidth; ++x) {
+                    const uint32_t x0 = std::min(2 * x, width - 1);
+                    const uint32_t x1 = std::min(2 * x + 1, width - 1);
+                    const uint8_t* texels[4] = {
+                        &src[(static_cast<size_t>(y0) * width + x0) * 4],
+                        &src[(static_cast<size_t>(y0) * width + x1) * 4],
+                        &src[(static_cast<size_t>(y1) * width + x0) * 4],
+                        &src[(static_cast<size_t>(y1) * width + x1) * 4],
+                    };
+                    uint8_t* out = &dst[(static_cast<size_t>(y) * dstWidth + x) * 4];
+
+                    switch (usage) {
+                    case TextureUsage::Color:
+                        for (int c = 0; c < 3; ++c) {
+                            float sum = 0.0f;
+                            for (const uint8_t* t : texels) sum += toLinear[t[c]];
+                            out[c] = linearToSrgb(sum * 0.25f);
+                        }
+                        break;
+                    case TextureUsage::NormalMap: {
+                        float n[3] = {};
+                        for (const uint8_t* t : texels) {
+                            for (int c = 0; c < 3; ++c) n[c] += t[c] / 127.5f - 1.0f;
+                        }
+                        const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                        if (length > 1e-6f) {
+                            for (float& v : n) v /= length;
+                        }
+                        else {
+                            n[0] = n[1] = 0.0f;
+                            n[2] = 1.0f;
+                        }
+                        for (int c = 0; c < 3; ++c) {
+                            out[c] = static_cast<uint8_t>(std::lround(std::clamp((n[c] * 0.5f + 0.5f) * 255.0f, 0.0f, 255.0f)));
+                        }
+                        break;
+                    }
+                    case TextureUsage::Data:
+                        for (int c = 0; c < 3; ++c) {
+                            out[c] = static_cast<uint8_t>((texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+                        }
+                        break;
+                    }
+                    out[3] = static_cast<uint8_t>((texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3] + 2) / 4);
+                }
+            }
+            return dst;
+        }
+    }
+
+    bc::Format chooseTextureFormat(TextureUsage usage, bool hasAlpha)
+    {
+        switch (usage) {
+        case TextureUsage::NormalMap: return bc::Format::BC5;
+        case TextureUsage::Color:     return bc::Format::BC7;
+        case TextureUsage::Data:      return hasAlpha ? bc::Format::BC3 : bc::Format::BC1;
+        }
+        return bc::Format::BC7;
+    }
+
+    TextureUsage guessTextureUsage(const std::string& path)
+    {
+        std::string name = fs::path(path).stem().string();
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+        auto endsWith = [&name](const char* suffix) {
+            const std::string s(suffix);
+            return name.size() >= s.size() && name.compare(name.size() - s.size(), s.size(), s) == 0;
+        };
+
+        if (name.find("normal") != std::string::npos || endsWith("_n") || endsWith("_nrm")) {
+            return TextureUsage::NormalMap;
+        }
+        for (const char* token : { "rough", "metal", "specular", "occlusion", "_ao", "_orm", "height", "mask" }) {
+            if (name.find(token) != std::string::npos) {
+                return TextureUsage::Data;
+            }
+        }
+        return TextureUsage::Color;
+    }
+
+    bool cookTexture(
+        const std::string& sourcePath,
+        const std::string& outputPath,
+        TextureUsage usage,
+        std::string& error,
+        CookedTextureInfo* info)
+    {
+        int width = 0, height = 0, channels = 0;
+        stbi_uc* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels) {
+            error = std::string("failed to decode: ") + stbi_failure_reason();
+            return false;
+        }
+        std::vector<uint8_t> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+
+        bool hasAlpha = false;
+        for (size_t i = 3; i < level.size() && !hasAlpha; i += 4) {
+            hasAlpha = level[i] != 255;
+        }
+
+        CookedTextureInfo cooked;
+        cooked.format = chooseTextureFormat(usage, hasAlpha);
+        cooked.srgb = usage == TextureUsage::Color;
+        cooked.width = static_cast<uint32_t>(width);
+        cooked.height = static_cast<uint32_t>(height);
+        cooked.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+
+        ktxTextureCreateInfo createInfo{};
+        createInfo.glInternalformat = glInternalFormat(cooked.format, cooked.srgb);
+        createInfo.baseWidth = cooked.width;
+        createInfo.baseHeight = cooked.height;
+        createInfo.baseDepth = 1;
+        createInfo.numDimensions = 2;
+        createInfo.numLevels = cooked.mipLevels;
+        createInfo.numLayers = 1;
+        createInfo.numFaces = 1;
+        createInfo.isArray = KTX_FALSE;
+        createInfo.generateMipmaps = KTX_FALSE;
+
+        ktxTexture* texture = nullptr;
+        KTX_error_code result = ktxTexture_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &texture);
+        if (result != KTX_SUCCESS) {
+            error = std::string("ktxTexture_Create: ") + ktxErrorString(result);
+            return false;
+        }
+
+        uint32_t levelWidth = cooked.width;
+        uint32_t levelHeight = cooked.height;
+        for (uint32_t mip = 0; mip < cooked.mipLevels; ++mip) {
+            if (mip > 0) {
+                level = downsample(level, levelWidth, levelHeight, usage);
+                levelWidth = std::max(1u, levelWidth / 2);
+                levelHeight = std::max(1u, levelHeight / 2);
+            }
+
+            std::vector<uint8_t> blocks = bc::compressImage(level.data(), levelWidth, levelHeight, cooked.format);
+            result = ktxTexture_SetImageFromMemory(texture, mip, 0, 0, blocks.data(), blocks.size());
+            if (result != KTX_SUCCESS) {
+                ktxTexture_Destroy(texture);
+                error = std::string("ktxTexture_SetImageFromMemory: ") + ktxErrorString(result);
+                return false;
+            }
+            cooked.bytes += blocks.size();
+        }
+
+        std::error_code ec;
+        fs::create_directories(fs::path(outputPath).parent_path(), ec);
+
+        // Write to a temporary file and rename so the runtime never sees a half-written texture
+        const std::string tmpPath = outputPath + ".tmp";
+        result = ktxTexture_WriteToNamedFile(texture, tmpPath.c_str());
+        ktxTexture_Destroy(texture);
+        if (result != KTX_SUCCESS) {
+            fs::remove(tmpPath, ec);
+            error = std::string("ktxTexture_WriteToNamedFile: ") + ktxErrorString(result);
+            return false;
+        }
+        fs::rename(tmpPath, outputPath, ec);
+        if (ec) {
+            fs::remove(tmpPath, ec);
+            error = "could not move " + tmpPath + " into place";
+            return false;
+        }
+
+        if (info) {
+            *info = cooked;
+        }
+        return true;
+    }
+
+} // namespace vkc
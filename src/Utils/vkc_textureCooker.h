@@ -0,0 +1,45 @@
+// vkc_textureCooker.h
+#pragma once
+
+// Project headers
+#include "vkc_blockCompression.h"
+
+// STD
+#include <cstdint>
+#include <string>
+
+namespace vkc {
+
+    // How a texture is sampled, which decides its block format and how the mip
+    // chain is filtered
+    enum class TextureUsage {
+        Color,      // sRGB colour (albedo, emissive)
+        Data,       // linear data (metallic/roughness, occlusion, masks)
+        NormalMap   // tangent space normals, only XY are stored
+    };
+
+    struct CookedTextureInfo {
+        bc::Format format = bc::Format::BC7;
+        bool       srgb = false;
+        uint32_t   width = 0;
+        uint32_t   height = 0;
+        uint32_t   mipLevels = 0;
+        size_t     bytes = 0;
+    };
+
+    // Normal maps -> BC5, colour -> BC7, linear data -> BC1 or BC3 when alpha is used
+    bc::Format chooseTextureFormat(TextureUsage usage, bool hasAlpha);
+
+    // Best guess from the file name, for images that no material describes
+    TextureUsage guessTextureUsage(const std::string& path);
+
+    // Decodes sourcePath, builds the full mip chain, block compresses every level
+    // and writes a KTX file to outputPath. CPU only; safe to call from several threads.
+    bool cookTexture(
+        const std::string& sourcePath,
+        const std::string& outputPath,
+        TextureUsage usage,
+        std::string& error,
+        CookedTextureInfo* info = nullptr);
+
+} // namespace vkc
@@ -0,0 +1,52 @@
+// vkc_threadPool.cpp
+#include "vkc_threadPool.h"
+
+// STD
+#include <algorithm>
+
+namespace vkc {
+
+    ThreadPool::ThreadPool(uint32_t threadCount)
+    {
+        if (threadCount == 0) {
+            uint32_t hw = std::thread::hardware_concurrency();
+            threadCount = std::max(1u, hw > 1 ? hw - 1 : 1u);
+        }
+
+        _workers.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; ++i) {
+            _workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _condition.notify_all();
+        for (auto& worker : _workers) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+                // Drain the queue before exiting so outstanding futures are always satisfied
+                if (_tasks.empty()) {
+                    return;
+                }
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+} // namespace vkc
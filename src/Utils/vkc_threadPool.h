@@ -0,0 +1,57 @@
+// vkc_threadPool.h
+#pragma once
+
+// STD
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vkc {
+
+    // Fixed-size pool of worker threads fed from a single FIFO queue.
+    // Intended for CPU-only work (file I/O, decoding, parsing). Tasks never submit
+    // Vulkan commands, and only record them into command buffers from a pool no
+    // other thread uses meanwhile, as VkcCommandRecorder arranges.
+    class ThreadPool {
+    public:
+        // threadCount == 0 picks hardware_concurrency - 1 (at least one worker)
+        explicit ThreadPool(uint32_t threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        template <typename F>
+        auto submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+        {
+            using Result = std::invoke_result_t<std::decay_t<F>>;
+            auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+            std::future<Result> future = packaged->get_future();
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _tasks.emplace_back([packaged]() { (*packaged)(); });
+            }
+            _condition.notify_one();
+            return future;
+        }
+
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(_workers.size()); }
+
+    private:
+        void workerLoop();
+
+        std::vector<std::thread>          _workers;
+        std::deque<std::function<void()>> _tasks;
+        std::mutex                        _mutex;
+        std::condition_variable           _condition;
+        bool                              _stopping = false;
+    };
+
+} // namespace vkc
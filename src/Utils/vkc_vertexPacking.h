@@ -0,0 +1,95 @@
+// vkc_vertexPacking.h
+#pragma once
+
+// External
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+// STD
+#include <cmath>
+#include <cstdint>
+
+namespace vkc {
+
+    // Encoders for the packed vertex formats. The matching decoders live in the
+    // *_packed.vert shaders; keep the two in sync.
+    namespace packing {
+
+        // Meshes up to this many vertices get 16-bit indices
+        constexpr uint32_t MAX_UINT16_VERTICES = 65536;
+
+        inline bool fitsUint16Indices(uint32_t vertexCount)
+        {
+            return vertexCount <= MAX_UINT16_VERTICES;
+        }
+
+        // Positions are stored as UNORM16 relative to the mesh bounds
+        struct PositionQuantizer {
+            glm::vec3 min{ 0.f };
+            glm::vec3 extent{ 1.f };
+
+            void fit(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+            {
+                min = boundsMin;
+                // Flat axes still need a non-zero scale
+                extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+            }
+
+            void encode(const glm::vec3& position, uint16_t out[3]) const
+            {
+                const glm::vec3 t = glm::clamp((position - min) / extent, 0.f, 1.f);
+                for (int i = 0; i < 3; i++) {
+                    out[i] = static_cast<uint16_t>(std::lround(t[i] * 65535.f));
+                }
+            }
+
+            // Object-space position = decodeMatrix() * vec4(unorm, 1). Folded into the
+            // model matrix, so the shaders need no extra uniform.
+            glm::mat4 decodeMatrix() const
+            {
+                glm::mat4 m{ 1.f };
+                m[0][0] = extent.x;
+                m[1][1] = extent.y;
+                m[2][2] = extent.z;
+                m[3] = glm::vec4(min, 1.f);
+                return m;
+            }
+        };
+
+        // Octahedral mapping of a unit vector to [-1, 1]^2
+        inline glm::vec2 octEncode(const glm::vec3& v)
+        {
+            const float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+            if (l1 <= 0.f)
+                return glm::vec2(0.f);
+            glm::vec2 p = glm::vec2(v.x, v.y) / l1;
+            if (v.z < 0.f) {
+                const glm::vec2 folded = 1.f - glm::abs(glm::vec2(p.y, p.x));
+                p = glm::vec2(p.x >= 0.f ? folded.x : -folded.x, p.y >= 0.f ? folded.y : -folded.y);
+            }
+            return p;
+        }
+
+        // R16G16_SNORM
+        inline uint32_t packDirection(const glm::vec3& v)
+        {
+            return glm::packSnorm2x16(octEncode(v));
+        }
+
+        // R16G16_SFLOAT
+        inline uint32_t packUV(const glm::vec2& uv)
+        {
+            return glm::packHalf2x16(uv);
+        }
+
+        // R8G8B8A8_UNORM
+        inline uint32_t packColor(const glm::vec4& color)
+        {
+            return glm::packUnorm4x8(glm::clamp(color, 0.f, 1.f));
+        }
+
+    } // namespace packing
+
+} // namespace vkc
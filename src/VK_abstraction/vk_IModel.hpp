@@ -1,5 +1,8 @@
 #pragma once
 #include <vulkan/vulkan.h>
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
 
 
 namespace vkc
@@ -9,5 +12,49 @@ namespace vkc
 		virtual ~IModel() = default;
 		virtual void bind(VkCommandBuffer commandBuffer) = 0;
 		virtual void draw(VkCommandBuffer commandBuffer) = 0;
+
+		// Device memory owned by the model: vertex/index buffers and any images it loaded itself
+		struct MemoryUsage {
+			VkDeviceSize geometryBytes = 0;
+			VkDeviceSize imageBytes = 0;
+			// What the geometry would take as float vertices and 32-bit indices
+			VkDeviceSize unpackedGeometryBytes = 0;
+		};
+		virtual MemoryUsage getMemoryUsage() const { return {}; }
+
+		// Packed vertices (see Utils/vkc_vertexPacking.h) need the *_packed shader
+		// variants, and the model matrix multiplied by getPositionDecode()
+		virtual bool hasPackedVertices() const { return false; }
+		virtual glm::mat4 getPositionDecode() const { return glm::mat4{ 1.f }; }
+
+		// Levels of detail share the model's vertices. Level 0 is the full mesh; each
+		// coarser level deviates from it by up to getLodError() in model space.
+		virtual uint32_t getLodCount() const { return 1; }
+		virtual float getLodError(uint32_t level) const { return 0.f; }
+		virtual uint64_t getLodTriangles(uint32_t level) const { return 0; }
+		virtual void drawLod(VkCommandBuffer commandBuffer, uint32_t level) { draw(commandBuffer); }
+
+		// What drawLod() records, for models drawn with a single vkCmdDrawIndexed from
+		// the geometry arena. Models that need anything else return false and are
+		// drawn through drawLod() only. Offsets move when the arena is compacted.
+		struct IndexedDraw {
+			uint32_t    indexCount = 0;
+			uint32_t    firstIndex = 0;		// in units of indexType
+			int32_t     vertexOffset = 0;
+			VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		};
+		virtual bool getIndexedDraw(uint32_t level, IndexedDraw& draw) const { return false; }
+		// Model-space bounding sphere: xyz centre, w radius
+		virtual glm::vec4 getBoundingSphere() const { return glm::vec4{ 0.f, 0.f, 0.f, 1.f }; }
+		// Model-space axis-aligned bounds; by default the box around the sphere
+		struct Bounds {
+			glm::vec3 min{ -1.f };
+			glm::vec3 max{ 1.f };
+		};
+		virtual Bounds getBounds() const
+		{
+			const glm::vec4 sphere = getBoundingSphere();
+			return { glm::vec3(sphere) - sphere.w, glm::vec3(sphere) + sphere.w };
+		}
 	};
 }
\ No newline at end of file
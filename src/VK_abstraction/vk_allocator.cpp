@@ -0,0 +1,346 @@
+// vk_allocator.cpp
+#include <cstdio>
+
+// Resources still alive at shutdown are reported instead of asserting
+#define VMA_ASSERT_LEAK(expr) \
+    do { if (!(expr)) std::fputs("VkcAllocator: allocations leaked at shutdown\n", stderr); } while (false)
+#define VMA_IMPLEMENTATION
+#include "vk_allocator.h"
+#include "vk_tools.h"
+
+// STD
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace vkc
+{
+    namespace {
+        constexpr VkMemoryPropertyFlags kStagingProperties =
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+        VkcAllocator::PoolStats toPoolStats(const VmaStatistics& statistics)
+        {
+            VkcAllocator::PoolStats stats;
+            stats.blockCount = statistics.blockCount;
+            stats.allocationCount = statistics.allocationCount;
+            stats.blockBytes = statistics.blockBytes;
+            stats.allocationBytes = statistics.allocationBytes;
+            return stats;
+        }
+    }
+
+    const char* memoryPoolName(MemoryPool pool)
+    {
+        switch (pool) {
+        case MemoryPool::Default:        return "default";
+        case MemoryPool::Staging:        return "staging";
+        case MemoryPool::StaticGeometry: return "static geometry";
+        case MemoryPool::Textures:       return "textures";
+        case MemoryPool::RenderTargets:  return "render targets";
+        default:                         return "unknown";
+        }
+    }
+
+    VkcAllocator::VkcAllocator(
+        VkInstance instance,
+        VkPhysicalDevice physicalDevice,
+        VkDevice device,
+        bool memoryBudget)
+    {
+        VmaAllocatorCreateInfo createInfo{};
+        createInfo.instance = instance;
+        createInfo.physicalDevice = physicalDevice;
+        createInfo.device = device;
+        createInfo.vulkanApiVersion = VK_API_VERSION_1_3;
+        if (memoryBudget) {
+            // Lets VMA track usage against the driver's budget instead of heap sizes
+            createInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+        }
+        VK_CHECK_RESULT(vmaCreateAllocator(&createInfo, &allocator));
+
+        createPools();
+    }
+
+    VkcAllocator::~VkcAllocator()
+    {
+        for (VmaPool pool : pools) {
+            if (pool != VK_NULL_HANDLE) {
+                vmaDestroyPool(allocator, pool);
+            }
+        }
+        vmaDestroyAllocator(allocator);
+    }
+
+    void VkcAllocator::createPools()
+    {
+        // Each pool is tied to one memory type, found from a representative resource
+        auto makePool = [&](MemoryPool pool, VkResult findResult, uint32_t memoryTypeIndex) {
+            if (findResult != VK_SUCCESS) {
+                std::cerr << "VkcAllocator: no memory type for the " << memoryPoolName(pool)
+                    << " pool, using the default pool\n";
+                return;
+            }
+            VmaPoolCreateInfo poolInfo{};
+            poolInfo.memoryTypeIndex = memoryTypeIndex;
+            VmaPool& handle = pools[static_cast<size_t>(pool)];
+            VK_CHECK_RESULT(vmaCreatePool(allocator, &poolInfo, &handle));
+            vmaSetPoolName(allocator, handle, memoryPoolName(pool));
+        };
+
+        VmaAllocationCreateInfo allocInfo{};
+        uint32_t memoryTypeIndex = 0;
+
+        VkBufferCreateInfo bufferInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+        bufferInfo.size = 65536;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        allocInfo.requiredFlags = kStagingProperties;
+        makePool(MemoryPool::Staging,
+            vmaFindMemoryTypeIndexForBufferInfo(allocator, &bufferInfo, &allocInfo, &memoryTypeIndex),
+            memoryTypeIndex);
+
+        bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        makePool(MemoryPool::StaticGeometry,
+            vmaFindMemoryTypeIndexForBufferInfo(allocator, &bufferInfo, &allocInfo, &memoryTypeIndex),
+            memoryTypeIndex);
+
+        VkImageCreateInfo imageInfo{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        imageInfo.extent = { 256, 256, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        makePool(MemoryPool::Textures,
+            vmaFindMemoryTypeIndexForImageInfo(allocator, &imageInfo, &allocInfo, &memoryTypeIndex),
+            memoryTypeIndex);
+
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        makePool(MemoryPool::RenderTargets,
+            vmaFindMemoryTypeIndexForImageInfo(allocator, &imageInfo, &allocInfo, &memoryTypeIndex),
+            memoryTypeIndex);
+    }
+
+    MemoryPool VkcAllocator::poolForBuffer(VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+    {
+        if ((properties & kStagingProperties) == kStagingProperties && usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT) {
+            return MemoryPool::Staging;
+        }
+        if (properties == VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT &&
+            (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT))) {
+            return MemoryPool::StaticGeometry;
+        }
+        return MemoryPool::Default;
+    }
+
+    MemoryPool VkcAllocator::poolForImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties)
+    {
+        if (properties != VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT || imageInfo.tiling != VK_IMAGE_TILING_OPTIMAL) {
+            return MemoryPool::Default;
+        }
+        const VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+        if (imageInfo.usage & attachmentUsage) {
+            return MemoryPool::RenderTargets;
+        }
+        if (imageInfo.usage & VK_IMAGE_USAGE_SAMPLED_BIT) {
+            return MemoryPool::Textures;
+        }
+        return MemoryPool::Default;
+    }
+
+    VmaAllocationCreateInfo VkcAllocator::allocationInfo(MemoryPool pool, VkMemoryPropertyFlags properties) const
+    {
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.requiredFlags = properties;
+        allocInfo.pool = pools[static_cast<size_t>(pool)];
+        return allocInfo;
+    }
+
+    VkResult VkcAllocator::createBuffer(
+        const VkBufferCreateInfo& bufferInfo,
+        VkMemoryPropertyFlags properties,
+        VkBuffer& buffer,
+        VmaAllocation& allocation)
+    {
+        const MemoryPool pool = poolForBuffer(bufferInfo.usage, properties);
+        VmaAllocationCreateInfo allocInfo = allocationInfo(pool, properties);
+        VkResult result = vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr);
+        if (result != VK_SUCCESS && allocInfo.pool != VK_NULL_HANDLE) {
+            allocInfo = allocationInfo(MemoryPool::Default, properties);
+            result = vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr);
+        }
+        return result;
+    }
+
+    VkResult VkcAllocator::createImage(
+        const VkImageCreateInfo& imageInfo,
+        VkMemoryPropertyFlags properties,
+        VkImage& image,
+        VmaAllocation& allocation)
+    {
+        const MemoryPool pool = poolForImage(imageInfo, properties);
+        VmaAllocationCreateInfo allocInfo = allocationInfo(pool, properties);
+        VkResult result = vmaCreateImage(allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr);
+        if (result != VK_SUCCESS && allocInfo.pool != VK_NULL_HANDLE) {
+            allocInfo = allocationInfo(MemoryPool::Default, properties);
+            result = vmaCreateImage(allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr);
+        }
+        return result;
+    }
+
+    void VkcAllocator::destroyBuffer(VkBuffer buffer, VmaAllocation allocation)
+    {
+        vmaDestroyBuffer(allocator, buffer, allocation);
+    }
+
+    void VkcAllocator::destroyImage(VkImage image, VmaAllocation allocation)
+    {
+        vmaDestroyImage(allocator, image, allocation);
+    }
+
+    VkResult VkcAllocator::allocateMemory(
+        const VkMemoryRequirements& requirements,
+        MemoryPool pool,
+        VkMemoryPropertyFlags properties,
+        VmaAllocation& allocation)
+    {
+        VmaAllocationCreateInfo allocInfo = allocationInfo(pool, properties);
+        VkResult result = vmaAllocateMemory(allocator, &requirements, &allocInfo, &allocation, nullptr);
+        if (result != VK_SUCCESS && allocInfo.pool != VK_NULL_HANDLE) {
+            allocInfo = allocationInfo(MemoryPool::Default, properties);
+            result = vmaAllocateMemory(allocator, &requirements, &allocInfo, &allocation, nullptr);
+        }
+        return result;
+    }
+
+    VkResult VkcAllocator::bindImageMemory(VmaAllocation allocation, VkDeviceSize offset, VkImage image)
+    {
+        return vmaBindImageMemory2(allocator, allocation, offset, image, nullptr);
+    }
+
+    void VkcAllocator::freeMemory(VmaAllocation allocation)
+    {
+        vmaFreeMemory(allocator, allocation);
+    }
+
+    bool VkcAllocator::hasLazilyAllocatedMemory() const
+    {
+        const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+        vmaGetMemoryProperties(allocator, &memoryProperties);
+        for (uint32_t type = 0; type < memoryProperties->memoryTypeCount; ++type) {
+            if (memoryProperties->memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    VkResult VkcAllocator::map(VmaAllocation allocation, void** data)
+    {
+        return vmaMapMemory(allocator, allocation, data);
+    }
+
+    void VkcAllocator::unmap(VmaAllocation allocation)
+    {
+        vmaUnmapMemory(allocator, allocation);
+    }
+
+    VkResult VkcAllocator::flush(VmaAllocation allocation, VkDeviceSize offset, VkDeviceSize size)
+    {
+        return vmaFlushAllocation(allocator, allocation, offset, size);
+    }
+
+    VkResult VkcAllocator::invalidate(VmaAllocation allocation, VkDeviceSize offset, VkDeviceSize size)
+    {
+        return vmaInvalidateAllocation(allocator, allocation, offset, size);
+    }
+
+    VkDeviceSize VkcAllocator::allocationSize(VmaAllocation allocation) const
+    {
+        VmaAllocationInfo info{};
+        vmaGetAllocationInfo(allocator, allocation, &info);
+        return info.size;
+    }
+
+    VkcAllocator::Stats VkcAllocator::getStats() const
+    {
+        Stats stats;
+
+        VmaTotalStatistics total{};
+        vmaCalculateStatistics(allocator, &total);
+        stats.total = toPoolStats(total.total.statistics);
+
+        // Whatever the named pools don't hold is in the default pool
+        PoolStats& defaultPool = stats.pools[static_cast<size_t>(MemoryPool::Default)];
+        defaultPool = stats.total;
+        for (size_t i = 0; i < pools.size(); ++i) {
+            if (pools[i] == VK_NULL_HANDLE)
+                continue;
+            VmaDetailedStatistics poolStats{};
+            vmaCalculatePoolStatistics(allocator, pools[i], &poolStats);
+            stats.pools[i] = toPoolStats(poolStats.statistics);
+            defaultPool.blockCount -= stats.pools[i].blockCount;
+            defaultPool.allocationCount -= stats.pools[i].allocationCount;
+            defaultPool.blockBytes -= stats.pools[i].blockBytes;
+            defaultPool.allocationBytes -= stats.pools[i].allocationBytes;
+        }
+
+        const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+        vmaGetMemoryProperties(allocator, &memoryProperties);
+        VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+        vmaGetHeapBudgets(allocator, budgets);
+        for (uint32_t heap = 0; heap < memoryProperties->memoryHeapCount; ++heap) {
+            if (memoryProperties->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                stats.deviceLocalBudget += budgets[heap].budget;
+                stats.deviceLocalUsage += budgets[heap].usage;
+            }
+        }
+        return stats;
+    }
+
+    void VkcAllocator::printStats() const
+    {
+        const Stats stats = getStats();
+        std::cout << "VkcAllocator: " << stats.total.allocationCount << " allocations in "
+            << stats.total.blockCount << " blocks, " << (stats.total.allocationBytes >> 20) << " / "
+            << (stats.total.blockBytes >> 20) << " MiB used, device local "
+            << (stats.deviceLocalUsage >> 20) << " / " << (stats.deviceLocalBudget >> 20) << " MiB\n";
+        for (size_t i = 0; i < stats.pools.size(); ++i) {
+            const PoolStats& pool = stats.pools[i];
+            std::cout << "  " << memoryPoolName(static_cast<MemoryPool>(i)) << ": "
+                << pool.allocationCount << " allocations, " << pool.blockCount << " blocks, "
+                << (pool.allocationBytes >> 20) << " / " << (pool.blockBytes >> 20) << " MiB\n";
+        }
+    }
+
+    std::string VkcAllocator::statsJson(bool detailed) const
+    {
+        char* json = nullptr;
+        vmaBuildStatsString(allocator, &json, detailed ? VK_TRUE : VK_FALSE);
+        std::string result = json ? json : "";
+        vmaFreeStatsString(allocator, json);
+        return result;
+    }
+
+    bool VkcAllocator::writeStatsJson(const std::string& path, bool detailed) const
+    {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out) {
+            std::cerr << "VkcAllocator: could not write " << path << "\n";
+            return false;
+        }
+        out << statsJson(detailed);
+        return static_cast<bool>(out);
+    }
+
+}  // namespace vkc
@@ -0,0 +1,121 @@
+// vk_allocator.h
+#pragma once
+#include "vulkan/vulkan.h"
+
+// External
+#include <vk_mem_alloc.h>
+
+// STD
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace vkc
+{
+    // Named VMA pools. Every buffer and image lands in one of them, picked from
+    // its usage and memory properties, so statistics can be read per kind of
+    // resource and each kind gets its own blocks instead of fragmenting the
+    // others.
+    enum class MemoryPool : uint32_t {
+        Default,         // uniform buffers, linear images, anything not below
+        Staging,         // host-visible transfer sources
+        StaticGeometry,  // device-local vertex and index buffers
+        Textures,        // device-local sampled images
+        RenderTargets,   // attachments: depth, G-buffer, offscreen targets
+        Count
+    };
+
+    const char* memoryPoolName(MemoryPool pool);
+
+    // Owns the VmaAllocator every buffer and image of a VkcDevice is allocated
+    // from. VMA sub-allocates from large blocks, so the number of live
+    // VkDeviceMemory objects stays small no matter how many resources exist.
+    // VMA is internally synchronized; the allocator can be used from any thread.
+    class VkcAllocator
+    {
+    public:
+        struct PoolStats {
+            uint32_t     blockCount = 0;       // VkDeviceMemory blocks owned by the pool
+            uint32_t     allocationCount = 0;
+            VkDeviceSize blockBytes = 0;
+            VkDeviceSize allocationBytes = 0;  // blockBytes minus free space
+        };
+
+        struct Stats {
+            std::array<PoolStats, static_cast<size_t>(MemoryPool::Count)> pools{};
+            PoolStats    total;                // includes dedicated allocations
+            VkDeviceSize deviceLocalBudget = 0;
+            VkDeviceSize deviceLocalUsage = 0;
+        };
+
+        VkcAllocator(
+            VkInstance instance,
+            VkPhysicalDevice physicalDevice,
+            VkDevice device,
+            bool memoryBudget);
+        ~VkcAllocator();
+
+        VkcAllocator(const VkcAllocator&) = delete;
+        VkcAllocator& operator=(const VkcAllocator&) = delete;
+
+        VmaAllocator handle() const { return allocator; }
+
+        // Creates the resource and binds memory matching properties from the pool
+        // chosen for it. Falls back to the default pool when the pool's memory type
+        // cannot back the resource.
+        VkResult createBuffer(
+            const VkBufferCreateInfo& bufferInfo,
+            VkMemoryPropertyFlags properties,
+            VkBuffer& buffer,
+            VmaAllocation& allocation);
+        VkResult createImage(
+            const VkImageCreateInfo& imageInfo,
+            VkMemoryPropertyFlags properties,
+            VkImage& image,
+            VmaAllocation& allocation);
+        void destroyBuffer(VkBuffer buffer, VmaAllocation allocation);
+        void destroyImage(VkImage image, VmaAllocation allocation);
+
+        // Memory not tied to one resource, for images that alias each other. Bind
+        // any number of images to it; destroy them with vkDestroyImage before
+        // freeMemory.
+        VkResult allocateMemory(
+            const VkMemoryRequirements& requirements,
+            MemoryPool pool,
+            VkMemoryPropertyFlags properties,
+            VmaAllocation& allocation);
+        VkResult bindImageMemory(VmaAllocation allocation, VkDeviceSize offset, VkImage image);
+        void freeMemory(VmaAllocation allocation);
+
+        // True if the device has a memory type that is only backed on demand, as
+        // tile-based GPUs do for transient attachments
+        bool hasLazilyAllocatedMemory() const;
+
+        // Mapping is reference counted by VMA, so separate parts of a block can be
+        // mapped at the same time
+        VkResult map(VmaAllocation allocation, void** data);
+        void unmap(VmaAllocation allocation);
+        // Offsets are relative to the allocation. No-ops on host-coherent memory.
+        VkResult flush(VmaAllocation allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+        VkResult invalidate(VmaAllocation allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+        VkDeviceSize allocationSize(VmaAllocation allocation) const;
+
+        static MemoryPool poolForBuffer(VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+        static MemoryPool poolForImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties);
+
+        Stats getStats() const;
+        void printStats() const;
+        // VMA's JSON statistics dump; detailed adds every block and allocation
+        std::string statsJson(bool detailed = false) const;
+        bool writeStatsJson(const std::string& path, bool detailed = true) const;
+
+    private:
+        void createPools();
+        VmaAllocationCreateInfo allocationInfo(MemoryPool pool, VkMemoryPropertyFlags properties) const;
+
+        VmaAllocator allocator = VK_NULL_HANDLE;
+        std::array<VmaPool, static_cast<size_t>(MemoryPool::Count)> pools{};
+    };
+
+}  // namespace vkc
@@ -43,15 +43,13 @@ namespace vkc {
         memoryPropertyFlags{ memoryPropertyFlags } {
         alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
         bufferSize = alignmentSize * instanceCount;
-        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, allocation);
     }
 
     VkcBuffer::~VkcBuffer() {
         unmap();
 
-        vkDestroyBuffer(vkcDevice.device(), buffer, nullptr);
-        vkFreeMemory(vkcDevice.device(), memory, nullptr);
-     
+        vkcDevice.destroyBuffer(buffer, allocation);
     }
 
     /**
@@ -61,21 +59,29 @@ namespace vkc {
      * buffer range.
      * @param offset (Optional) Byte offset from beginning
      *
+     * @note VMA always maps the whole allocation; mapped points offset bytes into it
+     *
      * @return VkResult of the buffer mapping call
      */
     VkResult VkcBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-        assert(buffer && memory && "Called map on buffer before create");
-        return vkMapMemory(vkcDevice.device(), memory, offset, size, 0, &mapped);
+        assert(buffer && allocation && "Called map on buffer before create");
+        (void)size;
+        void* data = nullptr;
+        VkResult result = vkcDevice.allocator().map(allocation, &data);
+        if (result == VK_SUCCESS) {
+            mapped = static_cast<char*>(data) + offset;
+        }
+        return result;
     }
 
     /**
      * Unmap a mapped memory range
      *
-     * @note Does not return a result as vkUnmapMemory can't fail
+     * @note Does not return a result as vmaUnmapMemory can't fail
      */
     void VkcBuffer::unmap() {
         if (mapped) {
-            vkUnmapMemory(vkcDevice.device(), memory);
+            vkcDevice.allocator().unmap(allocation);
             mapped = nullptr;
         }
     }
@@ -114,12 +120,7 @@ namespace vkc {
      * @return VkResult of the flush call
      */
     VkResult VkcBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkFlushMappedMemoryRanges(vkcDevice.device(), 1, &mappedRange);
+        return vkcDevice.allocator().flush(allocation, offset, size);
     }
 
     /**
@@ -134,12 +135,7 @@ namespace vkc {
      * @return VkResult of the invalidate call
      */
     VkResult VkcBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkInvalidateMappedMemoryRanges(vkcDevice.device(), 1, &mappedRange);
+        return vkcDevice.allocator().invalidate(allocation, offset, size);
     }
 
     /**
@@ -46,7 +46,7 @@ namespace vkc {
         VkcDevice& vkcDevice;
         void* mapped = nullptr;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
 
         VkDeviceSize bufferSize;
         uint32_t instanceCount;
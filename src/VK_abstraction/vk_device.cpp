@@ -1,5 +1,7 @@
 #pragma once
 #include "vk_device.h"
+#include "vk_geometryArena.h"
+#include "vk_uploadBatcher.h"
 
 // std headers
 #include <cstring>
@@ -55,9 +57,28 @@ namespace vkc {
         pickPhysicalDevice();
         createLogicalDevice();
         createCommandPool();
+
+        allocator_ = std::make_unique<VkcAllocator>(instance, physicalDevice, logicalDevice, memoryBudgetSupported);
+
+        QueueFamilyIndices indices = findPhysicalQueueFamilies();
+        uploadBatcher_ = std::make_unique<VkcUploadBatcher>(
+            *this, graphicsQueue_, indices.graphicsFamily, transferQueue_, indices.transferFamily);
+        std::cout << "uploads: "
+            << (indices.hasDedicatedTransfer() ? "dedicated transfer queue family " : "graphics queue family ")
+            << indices.transferFamily << std::endl;
+
+        geometryArena_ = std::make_unique<VkcGeometryArena>(*this);
     }
 
     VkcDevice::~VkcDevice() {
+        // Uploads may still target the arena
+        uploadBatcher_->waitIdle();
+        geometryArena_.reset();
+        // Waits for outstanding uploads, so it has to go before the device
+        uploadBatcher_.reset();
+        // Every resource has to be released by now
+        allocator_.reset();
+
         vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
         vkDestroyDevice(logicalDevice, nullptr);
 
@@ -134,6 +155,13 @@ namespace vkc {
         vkGetPhysicalDeviceProperties(physicalDevice, &properties);
         std::cout << "physical device: " << properties.deviceName << std::endl;
 
+        // Update-after-bind limits bound the size of the bindless texture heap
+        descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &descriptorIndexingProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
         vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
     }
 
@@ -141,7 +169,7 @@ namespace vkc {
         QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+        std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily, indices.transferFamily };
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -153,14 +181,24 @@ namespace vkc {
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
-        // Descriptor Indexing Features
-        VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
-        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
-        indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
-        indexingFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;
-        indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
-        indexingFeatures.runtimeDescriptorArray = VK_TRUE;
-        indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        // Optional features, enabled when present
+        VkPhysicalDeviceVulkan12Features supported12{};
+        supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 supportedFeatures2{};
+        supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedFeatures2.pNext = &supported12;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+
+        // Vulkan 1.2 Features: descriptor indexing, and the draw count buffer of the GPU-driven path
+        VkPhysicalDeviceVulkan12Features vulkan12Features{};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12Features.descriptorIndexing = VK_TRUE;
+        vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+        vulkan12Features.descriptorBindingVariableDescriptorCount = VK_TRUE;
+        vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+        vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        vulkan12Features.drawIndirectCount = supported12.drawIndirectCount;
 
         // Vulkan 1.3 Features
         VkPhysicalDeviceVulkan13Features vulkan13Features{};
@@ -170,20 +208,34 @@ namespace vkc {
         vulkan13Features.maintenance4 = VK_TRUE;
         vulkan13Features.robustImageAccess = VK_TRUE;
 
-        indexingFeatures.pNext = &vulkan13Features;
+        vulkan12Features.pNext = &vulkan13Features;
 
         VkPhysicalDeviceFeatures2 features2{};
         features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
         features2.features.samplerAnisotropy = VK_TRUE;
-        features2.pNext = &indexingFeatures;
+
+        // Cooked textures are BCn; without support the loaders fall back to the source images
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+        features2.features.textureCompressionBC = supportedFeatures.textureCompressionBC;
+        features2.features.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        features2.features.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+        features2.pNext = &vulkan12Features;
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
         createInfo.pNext = &features2;
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+        // Optional: lets AssetManager size its budget from what the driver reports
+        std::vector<const char*> enabledExtensions = deviceExtensions;
+        memoryBudgetSupported = isDeviceExtensionAvailable(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        if (memoryBudgetSupported) {
+            enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         if (enableValidationLayers) {
             createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -195,6 +247,8 @@ namespace vkc {
 
         createInfo.pEnabledFeatures = nullptr;
         enabledFeatures = features2.features;
+        drawIndirectCountSupported = vulkan12Features.drawIndirectCount &&
+            enabledFeatures.multiDrawIndirect && enabledFeatures.drawIndirectFirstInstance;
 
         if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &logicalDevice) != VK_SUCCESS) {
             throw std::runtime_error("failed to create logical device!");
@@ -202,6 +256,7 @@ namespace vkc {
 
         vkGetDeviceQueue(logicalDevice, indices.graphicsFamily, 0, &graphicsQueue_);
         vkGetDeviceQueue(logicalDevice, indices.presentFamily, 0, &presentQueue_);
+        vkGetDeviceQueue(logicalDevice, indices.transferFamily, 0, &transferQueue_);
     }
 
     void VkcDevice::createCommandPool() {
@@ -309,6 +364,42 @@ namespace vkc {
         }
     }
 
+    bool VkcDevice::isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName) {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+        for (const auto& extension : availableExtensions) {
+            if (strcmp(extension.extensionName, extensionName) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool VkcDevice::queryDeviceLocalBudget(VkDeviceSize& budget, VkDeviceSize& usage) const {
+        if (!memoryBudgetSupported) {
+            return false;
+        }
+
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties2.pNext = &budgetProperties;
+        vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties2);
+
+        budget = 0;
+        usage = 0;
+        for (uint32_t i = 0; i < properties2.memoryProperties.memoryHeapCount; ++i) {
+            if (properties2.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                budget += budgetProperties.heapBudget[i];
+                usage += budgetProperties.heapUsage[i];
+            }
+        }
+        return true;
+    }
+
     bool VkcDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
         uint32_t extensionCount;
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -342,6 +433,26 @@ namespace vkc {
             }
             if (indices.isComplete()) break;
         }
+
+        // Prefer a transfer-only family (DMA engine), then any non-graphics family
+        // with transfer support, and fall back to the graphics family
+        int bestScore = -1;
+        for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+            const VkQueueFlags flags = queueFamilies[i].queueFlags;
+            if (queueFamilies[i].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {
+                continue;
+            }
+            int score = (flags & VK_QUEUE_COMPUTE_BIT) ? 1 : 2;
+            if (score > bestScore) {
+                bestScore = score;
+                indices.transferFamily = i;
+                indices.transferFamilyHasValue = true;
+            }
+        }
+        if (!indices.transferFamilyHasValue && indices.graphicsFamilyHasValue) {
+            indices.transferFamily = indices.graphicsFamily;
+            indices.transferFamilyHasValue = true;
+        }
         return indices;
     }
 
@@ -399,77 +510,48 @@ namespace vkc {
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer& buffer,
-        VkDeviceMemory& bufferMemory) {
+        VmaAllocation& bufferAllocation) {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
         bufferInfo.usage = usage;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        if (vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create vertex buffer!");
-        }
-
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(logicalDevice, buffer, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate vertex buffer memory!");
+        if (allocator_->createBuffer(bufferInfo, properties, buffer, bufferAllocation) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create buffer!");
         }
-
-        vkBindBufferMemory(logicalDevice, buffer, bufferMemory, 0);
     }
-    VkResult VkcDevice::createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBuffer* buffer, VkDeviceMemory* memory, void* data)
+    VkResult VkcDevice::createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBuffer* buffer, VmaAllocation* allocation, void* data)
     {
-        // Create the buffer handle
+        // Create the buffer handle and the memory backing it
         VkBufferCreateInfo bufferCreateInfo = vkc::vkinit::bufferCreateInfo(usageFlags, size);
         bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &bufferCreateInfo, nullptr, buffer));
-
-        // Create the memory backing up the buffer handle
-        VkMemoryRequirements memReqs;
-        VkMemoryAllocateInfo memAlloc = vkc::vkinit::memoryAllocateInfo();
-        vkGetBufferMemoryRequirements(logicalDevice, *buffer, &memReqs);
-        memAlloc.allocationSize = memReqs.size;
-        // Find a memory type index that fits the properties of the buffer
-        memAlloc.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags);
-        // If the buffer has VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT set we also need to enable the appropriate flag during allocation
-        VkMemoryAllocateFlagsInfoKHR allocFlagsInfo{};
-        if (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
-            allocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO_KHR;
-            allocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
-            memAlloc.pNext = &allocFlagsInfo;
-        }
-        VK_CHECK_RESULT(vkAllocateMemory(logicalDevice, &memAlloc, nullptr, memory));
+        VK_CHECK_RESULT(allocator_->createBuffer(bufferCreateInfo, memoryPropertyFlags, *buffer, *allocation));
 
         // If a pointer to the buffer data has been passed, map the buffer and copy over the data
         if (data != nullptr)
         {
             void* mapped;
-            VK_CHECK_RESULT(vkMapMemory(logicalDevice, *memory, 0, size, 0, &mapped));
+            VK_CHECK_RESULT(allocator_->map(*allocation, &mapped));
             memcpy(mapped, data, size);
             // If host coherency hasn't been requested, do a manual flush to make writes visible
             if ((memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
             {
-                VkMappedMemoryRange mappedRange = vkc::vkinit::mappedMemoryRange();
-                mappedRange.memory = *memory;
-                mappedRange.offset = 0;
-                mappedRange.size = size;
-                vkFlushMappedMemoryRanges(logicalDevice, 1, &mappedRange);
+                allocator_->flush(*allocation, 0, size);
             }
-            vkUnmapMemory(logicalDevice, *memory);
+            allocator_->unmap(*allocation);
         }
 
-        // Attach the memory to the buffer object
-        VK_CHECK_RESULT(vkBindBufferMemory(logicalDevice, *buffer, *memory, 0));
-
         return VK_SUCCESS;
     }
+    void VkcDevice::destroyBuffer(VkBuffer buffer, VmaAllocation allocation) {
+        allocator_->destroyBuffer(buffer, allocation);
+    }
+
+    void VkcDevice::destroyImage(VkImage image, VmaAllocation allocation) {
+        allocator_->destroyImage(image, allocation);
+    }
+
     VkCommandBuffer VkcDevice::beginSingleTimeCommands() {
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -550,26 +632,10 @@ namespace vkc {
         const VkImageCreateInfo& imageInfo,
         VkMemoryPropertyFlags properties,
         VkImage& image,
-        VkDeviceMemory& imageMemory) {
-        if (vkCreateImage(logicalDevice, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+        VmaAllocation& imageAllocation) {
+        if (allocator_->createImage(imageInfo, properties, image, imageAllocation) != VK_SUCCESS) {
             throw std::runtime_error("failed to create image!");
         }
-
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(logicalDevice, image, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
-
-        if (vkBindImageMemory(logicalDevice, image, imageMemory, 0) != VK_SUCCESS) {
-            throw std::runtime_error("failed to bind image memory!");
-        }
     }
 
     void VkcDevice::transitionImageLayout(
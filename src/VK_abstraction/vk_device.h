@@ -1,15 +1,19 @@
 //vk_device.h
 #pragma once
 #include "AppCore/vk_window.h"
+#include "vk_allocator.h"
 #include "vk_initializers.h"
 #include "VK_abstraction/vk_tools.h"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace vkc
 {
+    class VkcGeometryArena;
+    class VkcUploadBatcher;
 
     struct SwapChainSupportDetails 
     {
@@ -22,9 +26,13 @@ namespace vkc
     {
         uint32_t graphicsFamily;
         uint32_t presentFamily;
+        uint32_t transferFamily;
         bool graphicsFamilyHasValue = false;
         bool presentFamilyHasValue = false;
+        bool transferFamilyHasValue = false;
         bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
+        // Transfer-capable family other than the graphics one (DMA engine)
+        bool hasDedicatedTransfer() { return transferFamilyHasValue && transferFamily != graphicsFamily; }
     };
 
     class VkcDevice
@@ -54,6 +62,8 @@ namespace vkc
         VkSurfaceKHR surface() { return surface_; }
         VkQueue graphicsQueue() { return graphicsQueue_; }
         VkQueue presentQueue() { return presentQueue_; }
+        // Same as graphicsQueue() when the device has no separate transfer family
+        VkQueue transferQueue() { return transferQueue_; }
 
         SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -67,7 +77,7 @@ namespace vkc
             VkBufferUsageFlags usage,
             VkMemoryPropertyFlags properties,
             VkBuffer& buffer,
-            VkDeviceMemory& bufferMemory);
+            VmaAllocation& bufferAllocation);
         VkCommandBuffer beginSingleTimeCommands();
         void endSingleTimeCommands(VkCommandBuffer commandBuffer);
         void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -78,7 +88,9 @@ namespace vkc
             const VkImageCreateInfo& imageInfo,
             VkMemoryPropertyFlags properties,
             VkImage& image,
-            VkDeviceMemory& imageMemory);
+            VmaAllocation& imageAllocation);
+        void destroyBuffer(VkBuffer buffer, VmaAllocation allocation);
+        void destroyImage(VkImage image, VmaAllocation allocation);
 
         void transitionImageLayout(
             VkImage image,
@@ -94,13 +106,33 @@ namespace vkc
         /// Ends, submits and frees a one‑time command buffer
         void flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue);
 
+        /// Every buffer and image is allocated through this (see vk_allocator.h)
+        VkcAllocator& allocator() { return *allocator_; }
+
+        /// Batched staging uploads for buffers and textures (see vk_uploadBatcher.h)
+        VkcUploadBatcher& uploadBatcher() { return *uploadBatcher_; }
+
+        /// Vertex and index buffer shared by every model (see vk_geometryArena.h)
+        VkcGeometryArena& geometryArena() { return *geometryArena_; }
+
 
         VkPhysicalDeviceProperties properties;
+        VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};
 
         VkPhysicalDeviceMemoryProperties memoryProperties;
         VkPhysicalDeviceFeatures enabledFeatures{};
+
+        // vkCmdDrawIndexedIndirectCount with several draws and a nonzero firstInstance,
+        // as the GPU-driven path needs (see Renderer/vk_gpuScene.h)
+        bool drawIndirectCountSupported = false;
+
+        // VK_EXT_memory_budget is enabled when the device supports it
+        bool memoryBudgetSupported = false;
+        // Sums budget and current usage over the device-local heaps. Returns false
+        // without VK_EXT_memory_budget.
+        bool queryDeviceLocalBudget(VkDeviceSize& budget, VkDeviceSize& usage) const;
         
-        VkResult createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBuffer* buffer, VkDeviceMemory* memory, void* data = nullptr);
+        VkResult createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBuffer* buffer, VmaAllocation* allocation, void* data = nullptr);
     private:
         void createInstance();
         void setupDebugMessenger();
@@ -117,6 +149,7 @@ namespace vkc
         void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
         void hasGflwRequiredInstanceExtensions();
         bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+        bool isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName);
         SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
         bool hasStencilComponent(VkFormat format);
         VkInstance instance;
@@ -134,6 +167,11 @@ namespace vkc
         VkSurfaceKHR surface_;
         VkQueue graphicsQueue_;
         VkQueue presentQueue_;
+        VkQueue transferQueue_;
+
+        std::unique_ptr<VkcAllocator> allocator_;
+        std::unique_ptr<VkcUploadBatcher> uploadBatcher_;
+        std::unique_ptr<VkcGeometryArena> geometryArena_;
 
         const std::vector<const char*> validationLayers = { 
             "VK_LAYER_KHRONOS_validation"
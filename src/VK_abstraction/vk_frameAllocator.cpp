@@ -0,0 +1,127 @@
+// vk_frameAllocator.cpp
+#include "vk_frameAllocator.h"
+#include "vk_device.h"
+
+// STD
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace vkc
+{
+    VkcFrameAllocator::VkcFrameAllocator(VkcDevice& device, uint32_t frameCount, VkDeviceSize frameCapacity)
+        : device{ device }, frames(frameCount)
+    {
+        const VkPhysicalDeviceLimits& limits = device.properties.limits;
+        offsetAlignment = std::max({ offsetAlignment,
+            limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment });
+
+        for (Frame& frame : frames) {
+            createFrameBuffer(frame, frameCapacity);
+        }
+    }
+
+    VkcFrameAllocator::~VkcFrameAllocator()
+    {
+        for (Frame& frame : frames) {
+            destroyFrameBuffer(frame);
+            for (auto& [buffer, allocation] : frame.retired) {
+                device.allocator().unmap(allocation);
+                device.destroyBuffer(buffer, allocation);
+            }
+        }
+    }
+
+    void VkcFrameAllocator::createFrameBuffer(Frame& frame, VkDeviceSize capacity)
+    {
+        device.createBuffer(
+            capacity,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            frame.buffer,
+            frame.allocation);
+        void* mapped = nullptr;
+        VK_CHECK_RESULT(device.allocator().map(frame.allocation, &mapped));
+        frame.mapped = static_cast<unsigned char*>(mapped);
+        frame.capacity = capacity;
+        frame.version++;
+    }
+
+    void VkcFrameAllocator::destroyFrameBuffer(Frame& frame)
+    {
+        if (frame.buffer == VK_NULL_HANDLE)
+            return;
+        device.allocator().unmap(frame.allocation);
+        device.destroyBuffer(frame.buffer, frame.allocation);
+        frame.buffer = VK_NULL_HANDLE;
+        frame.allocation = VK_NULL_HANDLE;
+        frame.mapped = nullptr;
+    }
+
+    void VkcFrameAllocator::beginFrame(uint32_t frameIndex)
+    {
+        assert(frameIndex < frames.size());
+        current = frameIndex;
+        Frame& frame = frames[current];
+
+        // The GPU is done with this buffer and any it replaced, so they can go
+        for (auto& [buffer, allocation] : frame.retired) {
+            device.allocator().unmap(allocation);
+            device.destroyBuffer(buffer, allocation);
+        }
+        frame.retired.clear();
+
+        // Replace the buffer if it overflowed last time round
+        if (frame.head > frame.capacity) {
+            VkDeviceSize capacity = frame.capacity;
+            while (capacity < frame.head) capacity *= 2;
+            std::cout << "VkcFrameAllocator: growing frame " << frameIndex << " to "
+                << (capacity >> 10) << " KiB\n";
+            destroyFrameBuffer(frame);
+            createFrameBuffer(frame, capacity);
+        }
+        frame.head = 0;
+    }
+
+    void VkcFrameAllocator::reserve(VkDeviceSize size)
+    {
+        Frame& frame = frames[current];
+        const VkDeviceSize head = (frame.head + offsetAlignment - 1) & ~(offsetAlignment - 1);
+        if (head + size <= frame.capacity)
+            return;
+        // A head already past capacity means earlier slices were dropped; nothing to keep then
+        const VkDeviceSize used = std::min(frame.head, frame.capacity);
+
+        VkDeviceSize capacity = frame.capacity;
+        while (capacity < head + size) capacity *= 2;
+        std::cout << "VkcFrameAllocator: growing frame " << current << " to "
+            << (capacity >> 10) << " KiB mid-frame\n";
+
+        // Slices taken so far keep their offsets in the new buffer
+        Frame grown;
+        createFrameBuffer(grown, capacity);
+        std::memcpy(grown.mapped, frame.mapped, used);
+        frame.retired.emplace_back(frame.buffer, frame.allocation);
+        frame.buffer = grown.buffer;
+        frame.allocation = grown.allocation;
+        frame.mapped = grown.mapped;
+        frame.capacity = capacity;
+        frame.version++;
+    }
+
+    VkcFrameAllocator::Allocation VkcFrameAllocator::allocate(VkDeviceSize size)
+    {
+        Frame& frame = frames[current];
+        const VkDeviceSize offset = (frame.head + offsetAlignment - 1) & ~(offsetAlignment - 1);
+        frame.head = offset + size;
+        if (frame.head > frame.capacity) {
+            return {};
+        }
+
+        Allocation allocation;
+        allocation.mapped = frame.mapped + offset;
+        allocation.offset = static_cast<uint32_t>(offset);
+        return allocation;
+    }
+
+}  // namespace vkc
@@ -0,0 +1,93 @@
+// vk_frameAllocator.h
+#pragma once
+#include "vulkan/vulkan.h"
+#include <vk_mem_alloc.h>
+
+// STD
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace vkc
+{
+    class VkcDevice;
+
+    // Linear allocator for per-draw uniform data. Each frame in flight owns one
+    // persistently mapped, host-coherent buffer; allocations bump a head pointer
+    // and the whole buffer is recycled by beginFrame() once that frame's fence
+    // has signalled. Slices are bound with dynamic offsets, so a single
+    // descriptor set per frame covers every draw.
+    //
+    // A frame that runs out of space gets null allocations; the buffer is grown
+    // to the observed demand the next time that frame slot begins. Callers that
+    // can't drop draws size their allocations up front with reserve(), which
+    // grows the current buffer on the spot. Descriptors pointing at a frame
+    // buffer must be rewritten when version() changes; VkcFrameAllocatorSet
+    // keeps such a set per frame.
+    //
+    // Main (render) thread only.
+    class VkcFrameAllocator
+    {
+    public:
+        static constexpr VkDeviceSize DEFAULT_FRAME_CAPACITY = 4ull * 1024 * 1024;
+
+        struct Allocation {
+            void*    mapped = nullptr;   // null when the frame buffer is full
+            uint32_t offset = 0;         // dynamic offset into buffer(frameIndex)
+        };
+
+        VkcFrameAllocator(
+            VkcDevice& device,
+            uint32_t frameCount,
+            VkDeviceSize frameCapacity = DEFAULT_FRAME_CAPACITY);
+        ~VkcFrameAllocator();
+
+        VkcFrameAllocator(const VkcFrameAllocator&) = delete;
+        VkcFrameAllocator& operator=(const VkcFrameAllocator&) = delete;
+
+        // Recycles the frame's buffer; the caller has waited for the frame's fence
+        void beginFrame(uint32_t frameIndex);
+
+        // Makes the next allocations of up to size bytes in total (alignment padding
+        // included) succeed. A buffer that is too small is replaced by a larger copy;
+        // the old one stays alive until the frame slot comes round again, so sets
+        // already written for it remain valid for the slices taken from it so far.
+        void reserve(VkDeviceSize size);
+        Allocation allocate(VkDeviceSize size);
+        template<typename T>
+        Allocation push(const T& value)
+        {
+            Allocation allocation = allocate(sizeof(T));
+            if (allocation.mapped) {
+                std::memcpy(allocation.mapped, &value, sizeof(T));
+            }
+            return allocation;
+        }
+
+        VkBuffer buffer(uint32_t frameIndex) const { return frames[frameIndex].buffer; }
+        // Bumped whenever the frame's buffer is recreated
+        uint32_t version(uint32_t frameIndex) const { return frames[frameIndex].version; }
+        VkDeviceSize alignment() const { return offsetAlignment; }
+
+    private:
+        struct Frame {
+            VkBuffer      buffer = VK_NULL_HANDLE;
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            unsigned char* mapped = nullptr;
+            VkDeviceSize  capacity = 0;
+            VkDeviceSize  head = 0;      // keeps counting past capacity, to size the next buffer
+            uint32_t      version = 0;
+            std::vector<std::pair<VkBuffer, VmaAllocation>> retired;   // replaced by reserve() this frame
+        };
+
+        void createFrameBuffer(Frame& frame, VkDeviceSize capacity);
+        void destroyFrameBuffer(Frame& frame);
+
+        VkcDevice&         device;
+        std::vector<Frame> frames;
+        uint32_t           current = 0;
+        VkDeviceSize       offsetAlignment = 256;
+    };
+
+}  // namespace vkc
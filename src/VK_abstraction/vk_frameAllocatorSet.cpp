@@ -0,0 +1,44 @@
+// vk_frameAllocatorSet.cpp
+#include "vk_frameAllocatorSet.h"
+#include "vk_device.h"
+#include "vk_frameAllocator.h"
+
+// STD
+#include <stdexcept>
+
+namespace vkc
+{
+    VkcFrameAllocatorSet::VkcFrameAllocatorSet(VkcDevice& device, uint32_t frameCount, VkShaderStageFlags stages)
+    {
+        setLayout = VkcDescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stages)
+            .build();
+        // Layouts are created for update-after-bind pools
+        pool = VkcDescriptorPool::Builder(device)
+            .setMaxSets(frameCount)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frameCount)
+            .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+            .build();
+
+        sets.resize(frameCount);
+        versions.assign(frameCount, 0);
+        for (auto& set : sets) {
+            if (!pool->allocateDescriptor(setLayout->getDescriptorSetLayout(), set, 0)) {
+                throw std::runtime_error("VkcFrameAllocatorSet: failed to allocate descriptor set");
+            }
+        }
+    }
+
+    VkDescriptorSet VkcFrameAllocatorSet::get(const VkcFrameAllocator& allocator, uint32_t frameIndex)
+    {
+        if (versions[frameIndex] != allocator.version(frameIndex)) {
+            VkDescriptorBufferInfo bufferInfo{ allocator.buffer(frameIndex), 0, VK_WHOLE_SIZE };
+            VkcDescriptorWriter(*setLayout, *pool)
+                .writeBuffer(0, &bufferInfo)
+                .overwrite(sets[frameIndex]);
+            versions[frameIndex] = allocator.version(frameIndex);
+        }
+        return sets[frameIndex];
+    }
+
+}  // namespace vkc
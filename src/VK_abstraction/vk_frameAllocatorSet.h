@@ -0,0 +1,42 @@
+// vk_frameAllocatorSet.h
+#pragma once
+#include "vk_descriptors.h"
+#include "vulkan/vulkan.h"
+
+// STD
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vkc
+{
+    class VkcDevice;
+    class VkcFrameAllocator;
+
+    // One descriptor set per frame in flight with the frame allocator's buffer as
+    // a storage buffer at binding 0. Draws index their slice from the shader (the
+    // slice offset is in the push constants or firstInstance), so the set never
+    // changes within a frame. A set is rewritten only when the allocator replaced
+    // its frame's buffer, which version() reports.
+    //
+    // Main (render) thread only.
+    class VkcFrameAllocatorSet
+    {
+    public:
+        VkcFrameAllocatorSet(VkcDevice& device, uint32_t frameCount, VkShaderStageFlags stages);
+
+        VkcFrameAllocatorSet(const VkcFrameAllocatorSet&) = delete;
+        VkcFrameAllocatorSet& operator=(const VkcFrameAllocatorSet&) = delete;
+
+        VkDescriptorSetLayout getLayout() const { return setLayout->getDescriptorSetLayout(); }
+        // The frame's set, pointing at the allocator's current buffer for that frame
+        VkDescriptorSet get(const VkcFrameAllocator& allocator, uint32_t frameIndex);
+
+    private:
+        std::unique_ptr<VkcDescriptorSetLayout> setLayout;
+        std::unique_ptr<VkcDescriptorPool>      pool;
+        std::vector<VkDescriptorSet> sets;       // one per frame in flight
+        std::vector<uint32_t>        versions;   // frame allocator version each set points at
+    };
+
+}  // namespace vkc
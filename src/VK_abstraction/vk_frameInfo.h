@@ -16,6 +16,26 @@ namespace vkc {
 		uint32_t textureIndex;
 	};
 
+	// One entry of the material buffer, binding 1 of the bindless texture set
+	// (std430). Texture members are bindless slots, NO_TEXTURE when absent.
+	struct GpuMaterial
+	{
+		static constexpr uint32_t NO_TEXTURE = ~0u;
+
+		glm::vec4 baseColorFactor{ 1.f };
+		glm::vec4 emissiveFactor{ 0.f };	// w unused
+		float metallicFactor = 1.f;
+		float roughnessFactor = 1.f;
+		float alphaCutoff = 0.5f;
+		uint32_t alphaMode = 0;				// vkglTF::Material::AlphaMode
+		uint32_t baseColorTexture = NO_TEXTURE;
+		uint32_t normalTexture = NO_TEXTURE;
+		uint32_t metallicRoughnessTexture = NO_TEXTURE;
+		uint32_t occlusionTexture = NO_TEXTURE;
+		uint32_t emissiveTexture = NO_TEXTURE;
+		uint32_t _pad0 = 0, _pad1 = 0, _pad2 = 0;
+	};
+
 	struct PointLight 
 	{
 		glm::vec4 position{};
@@ -37,6 +57,10 @@ namespace vkc {
 	};
 
 	class Scene;
+	class VkcFrameAllocator;
+	class VkcLodSelector;
+	class VkcGpuScene;
+	class VkcCommandRecorder;
 
 	struct FrameInfo 
 	{
@@ -49,5 +73,9 @@ namespace vkc {
 		VkDescriptorSet skyboxDescriptorSet;
 		VkcGameObject::Map &gameObjects;
 		Scene* scene;
+		VkcFrameAllocator& frameAllocator;
+		VkcLodSelector& lodSelector;
+		VkcGpuScene* gpuScene;		// null without GPU-driven drawing
+		VkcCommandRecorder* commandRecorder;	// null records the render pass inline
 	};
 }// namespace vkc
\ No newline at end of file
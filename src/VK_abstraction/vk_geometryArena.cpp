@@ -0,0 +1,365 @@
+// vk_geometryArena.cpp
+#include "vk_geometryArena.h"
+#include "vk_device.h"
+#include "vk_swapchain.h"
+#include "vk_uploadBatcher.h"
+
+// STD
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace vkc
+{
+    namespace {
+        // Freed ranges stay untouched until every frame that may draw from them has retired
+        constexpr uint64_t kRetireFrames = VkcSwapChain::MAX_FRAMES_IN_FLIGHT + 1;
+        // update() only compacts once this much has been freed since the last compaction
+        constexpr VkDeviceSize kCompactMinFreed = 16ull * 1024 * 1024;
+
+        constexpr VkBufferUsageFlags kVertexUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        constexpr VkBufferUsageFlags kIndexUsage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+        // Index buffer binding last recorded by this thread, for bindIndexType()
+        struct BoundIndexBuffer {
+            const VkcGeometryArena* arena = nullptr;
+            VkCommandBuffer         commandBuffer = VK_NULL_HANDLE;
+            VkIndexType             indexType = VK_INDEX_TYPE_UINT32;
+        };
+        thread_local BoundIndexBuffer boundIndexBuffer;
+
+        // Vertex strides need not be powers of two
+        VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        bool fragmented(VkDeviceSize freeBytes, VkDeviceSize largestFree)
+        {
+            return freeBytes > 0 && largestFree < freeBytes / 2;
+        }
+    }
+
+    void VkcGeometryArena::RangeList::reset(VkDeviceSize newCapacity, VkDeviceSize used)
+    {
+        capacity = newCapacity;
+        freeRanges.clear();
+        if (used < capacity) {
+            freeRanges.emplace(used, capacity - used);
+        }
+    }
+
+    bool VkcGeometryArena::RangeList::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+    {
+        for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+            const VkDeviceSize start = it->first;
+            const VkDeviceSize end = start + it->second;
+            const VkDeviceSize aligned = alignUp(start, alignment);
+            if (aligned + size > end)
+                continue;
+
+            freeRanges.erase(it);
+            if (aligned > start) {
+                freeRanges.emplace(start, aligned - start);
+            }
+            if (aligned + size < end) {
+                freeRanges.emplace(aligned + size, end - (aligned + size));
+            }
+            offset = aligned;
+            return true;
+        }
+        return false;
+    }
+
+    void VkcGeometryArena::RangeList::release(VkDeviceSize offset, VkDeviceSize size)
+    {
+        auto it = freeRanges.emplace(offset, size).first;
+
+        // Merge with the following range
+        auto next = std::next(it);
+        if (next != freeRanges.end() && it->first + it->second == next->first) {
+            it->second += next->second;
+            freeRanges.erase(next);
+        }
+        // and with the preceding one
+        if (it != freeRanges.begin()) {
+            auto prev = std::prev(it);
+            if (prev->first + prev->second == it->first) {
+                prev->second += it->second;
+                freeRanges.erase(it);
+            }
+        }
+    }
+
+    VkDeviceSize VkcGeometryArena::RangeList::freeBytes() const
+    {
+        VkDeviceSize total = 0;
+        for (const auto& [offset, size] : freeRanges) {
+            total += size;
+        }
+        return total;
+    }
+
+    VkDeviceSize VkcGeometryArena::RangeList::largestFree() const
+    {
+        VkDeviceSize largest = 0;
+        for (const auto& [offset, size] : freeRanges) {
+            largest = std::max(largest, size);
+        }
+        return largest;
+    }
+
+    VkcGeometryArena::VkcGeometryArena(VkcDevice& device, VkDeviceSize vertexCapacity, VkDeviceSize indexCapacity)
+        : device{ device }
+    {
+        vertexArena = createBuffer(vertexCapacity, kVertexUsage);
+        indexArena = createBuffer(indexCapacity, kIndexUsage);
+        stats.vertexCapacity = vertexCapacity;
+        stats.indexCapacity = indexCapacity;
+    }
+
+    VkcGeometryArena::~VkcGeometryArena()
+    {
+        device.destroyBuffer(vertexArena.buffer, vertexArena.allocation);
+        device.destroyBuffer(indexArena.buffer, indexArena.allocation);
+    }
+
+    VkcGeometryArena::Buffer VkcGeometryArena::createBuffer(VkDeviceSize capacity, VkBufferUsageFlags usage)
+    {
+        Buffer buffer;
+        device.createBuffer(capacity, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer.buffer, buffer.allocation);
+        buffer.ranges.reset(capacity, 0);
+        return buffer;
+    }
+
+    bool VkcGeometryArena::tryPlace(Mesh& mesh)
+    {
+        VkDeviceSize vertexOffset = 0;
+        if (!vertexArena.ranges.allocate(mesh.vertexBytes, mesh.vertexStride, vertexOffset)) {
+            return false;
+        }
+        VkDeviceSize indexOffset = 0;
+        if (mesh.indexBytes > 0 && !indexArena.ranges.allocate(mesh.indexBytes, sizeof(uint32_t), indexOffset)) {
+            vertexArena.ranges.release(vertexOffset, mesh.vertexBytes);
+            return false;
+        }
+
+        mesh.range.vertexByteOffset = vertexOffset;
+        mesh.range.indexByteOffset = indexOffset;
+        mesh.range.firstVertex = static_cast<uint32_t>(vertexOffset / mesh.vertexStride);
+        mesh.range.firstIndex = static_cast<uint32_t>(indexOffset / mesh.indexSize);
+        return true;
+    }
+
+    uint32_t VkcGeometryArena::allocate(uint32_t vertexStride, uint32_t vertexCount, uint32_t indexCount, VkIndexType indexType)
+    {
+        assert(vertexStride > 0 && vertexCount > 0);
+        assert(indexType == VK_INDEX_TYPE_UINT32 || indexType == VK_INDEX_TYPE_UINT16);
+
+        Mesh mesh;
+        mesh.vertexStride = vertexStride;
+        mesh.indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        mesh.vertexBytes = static_cast<VkDeviceSize>(vertexStride) * vertexCount;
+        mesh.indexBytes = static_cast<VkDeviceSize>(indexCount) * mesh.indexSize;
+        mesh.range.indexType = indexType;
+        mesh.live = true;
+
+        if (!tryPlace(mesh)) {
+            // Size the live meshes would take packed, plus this one
+            VkDeviceSize vertexEnd = 0;
+            VkDeviceSize indexEnd = 0;
+            for (const Mesh& other : meshes) {
+                if (!other.live) continue;
+                vertexEnd = alignUp(vertexEnd, other.vertexStride) + other.vertexBytes;
+                indexEnd = alignUp(indexEnd, sizeof(uint32_t)) + other.indexBytes;
+            }
+            vertexEnd = alignUp(vertexEnd, mesh.vertexStride) + mesh.vertexBytes;
+            indexEnd = alignUp(indexEnd, sizeof(uint32_t)) + mesh.indexBytes;
+
+            VkDeviceSize vertexCapacity = vertexArena.ranges.capacity;
+            VkDeviceSize indexCapacity = indexArena.ranges.capacity;
+            while (vertexCapacity < vertexEnd) vertexCapacity *= 2;
+            while (indexCapacity < indexEnd) indexCapacity *= 2;
+            if (vertexCapacity != vertexArena.ranges.capacity || indexCapacity != indexArena.ranges.capacity) {
+                stats.growths++;
+            }
+
+            relocate(vertexCapacity, indexCapacity);
+            if (!tryPlace(mesh)) {
+                throw std::runtime_error("geometry arena: allocation does not fit after compaction");
+            }
+        }
+
+        uint32_t handle;
+        if (!freeHandles.empty()) {
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+            meshes[handle] = mesh;
+        }
+        else {
+            handle = static_cast<uint32_t>(meshes.size());
+            meshes.push_back(mesh);
+        }
+        return handle;
+    }
+
+    void VkcGeometryArena::free(uint32_t mesh)
+    {
+        if (mesh == INVALID_MESH || !meshes[mesh].live)
+            return;
+        meshes[mesh].live = false;
+        retired.push_back({ mesh, frame + kRetireFrames });
+    }
+
+    void VkcGeometryArena::releaseRanges(Mesh& mesh)
+    {
+        vertexArena.ranges.release(mesh.range.vertexByteOffset, mesh.vertexBytes);
+        if (mesh.indexBytes > 0) {
+            indexArena.ranges.release(mesh.range.indexByteOffset, mesh.indexBytes);
+        }
+        freedSinceCompaction += mesh.vertexBytes + mesh.indexBytes;
+        mesh = Mesh{};
+    }
+
+    void VkcGeometryArena::update()
+    {
+        frame++;
+        while (!retired.empty() && retired.front().frame <= frame) {
+            releaseRanges(meshes[retired.front().mesh]);
+            freeHandles.push_back(retired.front().mesh);
+            retired.pop_front();
+        }
+
+        if (freedSinceCompaction >= kCompactMinFreed &&
+            (fragmented(vertexArena.ranges.freeBytes(), vertexArena.ranges.largestFree()) ||
+             fragmented(indexArena.ranges.freeBytes(), indexArena.ranges.largestFree()))) {
+            compact();
+        }
+    }
+
+    void VkcGeometryArena::compact()
+    {
+        relocate(vertexArena.ranges.capacity, indexArena.ranges.capacity);
+    }
+
+    void VkcGeometryArena::relocate(VkDeviceSize vertexCapacity, VkDeviceSize indexCapacity)
+    {
+        // Uploads still in flight may target the old buffers
+        device.uploadBatcher().waitIdle();
+
+        Buffer newVertex = createBuffer(vertexCapacity, kVertexUsage);
+        Buffer newIndex = createBuffer(indexCapacity, kIndexUsage);
+
+        // The copy below waits for the graphics queue, so nothing reads retired ranges afterwards
+        for (const Retired& entry : retired) {
+            meshes[entry.mesh] = Mesh{};
+            freeHandles.push_back(entry.mesh);
+        }
+        retired.clear();
+
+        std::vector<VkBufferCopy> vertexCopies;
+        std::vector<VkBufferCopy> indexCopies;
+        VkDeviceSize vertexEnd = 0;
+        VkDeviceSize indexEnd = 0;
+        for (Mesh& mesh : meshes) {
+            if (!mesh.live) continue;
+
+            const VkDeviceSize vertexOffset = alignUp(vertexEnd, mesh.vertexStride);
+            vertexCopies.push_back({ mesh.range.vertexByteOffset, vertexOffset, mesh.vertexBytes });
+            vertexEnd = vertexOffset + mesh.vertexBytes;
+            mesh.range.vertexByteOffset = vertexOffset;
+            mesh.range.firstVertex = static_cast<uint32_t>(vertexOffset / mesh.vertexStride);
+
+            if (mesh.indexBytes > 0) {
+                // 4-byte aligned, so the offset is a whole number of either index type
+                const VkDeviceSize indexOffset = alignUp(indexEnd, sizeof(uint32_t));
+                indexCopies.push_back({ mesh.range.indexByteOffset, indexOffset, mesh.indexBytes });
+                mesh.range.indexByteOffset = indexOffset;
+                mesh.range.firstIndex = static_cast<uint32_t>(indexOffset / mesh.indexSize);
+                indexEnd = indexOffset + mesh.indexBytes;
+            }
+        }
+        newVertex.ranges.reset(vertexCapacity, vertexEnd);
+        newIndex.ranges.reset(indexCapacity, indexEnd);
+
+        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+        if (!vertexCopies.empty()) {
+            vkCmdCopyBuffer(commandBuffer, vertexArena.buffer, newVertex.buffer,
+                static_cast<uint32_t>(vertexCopies.size()), vertexCopies.data());
+        }
+        if (!indexCopies.empty()) {
+            vkCmdCopyBuffer(commandBuffer, indexArena.buffer, newIndex.buffer,
+                static_cast<uint32_t>(indexCopies.size()), indexCopies.data());
+        }
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
+        // Submits and waits for the graphics queue, which also drains frames in flight
+        device.endSingleTimeCommands(commandBuffer);
+
+        device.destroyBuffer(vertexArena.buffer, vertexArena.allocation);
+        device.destroyBuffer(indexArena.buffer, indexArena.allocation);
+        vertexArena = std::move(newVertex);
+        indexArena = std::move(newIndex);
+
+        stats.vertexCapacity = vertexCapacity;
+        stats.indexCapacity = indexCapacity;
+        stats.compactions++;
+        freedSinceCompaction = 0;
+        version++;
+    }
+
+    void VkcGeometryArena::bind(VkCommandBuffer commandBuffer)
+    {
+        const VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexArena.buffer, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, indexArena.buffer, 0, VK_INDEX_TYPE_UINT32);
+        boundIndexBuffer = { this, commandBuffer, VK_INDEX_TYPE_UINT32 };
+    }
+
+    void VkcGeometryArena::bindIndexType(VkCommandBuffer commandBuffer, VkIndexType indexType)
+    {
+        if (boundIndexBuffer.arena == this && boundIndexBuffer.commandBuffer == commandBuffer &&
+            boundIndexBuffer.indexType == indexType)
+            return;
+        vkCmdBindIndexBuffer(commandBuffer, indexArena.buffer, 0, indexType);
+        boundIndexBuffer = { this, commandBuffer, indexType };
+    }
+
+    void VkcGeometryArena::resetBinding()
+    {
+        boundIndexBuffer = {};
+    }
+
+    VkcGeometryArena::Stats VkcGeometryArena::getStats() const
+    {
+        Stats result = stats;
+        for (const Mesh& mesh : meshes) {
+            if (!mesh.live) continue;
+            result.meshes++;
+            result.vertexBytesUsed += mesh.vertexBytes;
+            result.indexBytesUsed += mesh.indexBytes;
+        }
+        for (const Retired& entry : retired) {
+            result.retiringBytes += meshes[entry.mesh].vertexBytes + meshes[entry.mesh].indexBytes;
+        }
+        return result;
+    }
+
+    void VkcGeometryArena::printStats() const
+    {
+        const Stats s = getStats();
+        std::cout << "VkcGeometryArena: " << s.meshes << " meshes, vertices "
+            << (s.vertexBytesUsed >> 20) << " / " << (s.vertexCapacity >> 20) << " MiB, indices "
+            << (s.indexBytesUsed >> 20) << " / " << (s.indexCapacity >> 20) << " MiB, "
+            << (s.retiringBytes >> 20) << " MiB retiring, " << s.compactions << " compactions ("
+            << s.growths << " growths)\n";
+    }
+
+}  // namespace vkc
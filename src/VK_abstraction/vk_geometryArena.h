@@ -0,0 +1,157 @@
+// vk_geometryArena.h
+#pragma once
+#include "vulkan/vulkan.h"
+#include <vk_mem_alloc.h>
+
+// STD
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace vkc
+{
+    class VkcDevice;
+
+    // One device-local vertex buffer and one index buffer shared by every model.
+    // Loaders reserve a range per mesh and upload into it; a mesh then only
+    // carries a handle, and render systems bind the two buffers once and draw
+    // with firstIndex / vertexOffset.
+    //
+    // Vertex ranges are aligned to the mesh's vertex stride, so meshes with
+    // different vertex layouts share the buffer and vertexOffset is a plain
+    // vertex index. Indices are relative to the mesh's first vertex and either
+    // uint32 or uint16 per mesh; draws of 16-bit meshes call bindIndexType().
+    //
+    // Freed ranges are reused once the frames that may still read them have
+    // retired. When the free space is fragmented, or an allocation doesn't
+    // fit, the live meshes are copied tightly packed into new buffers; their
+    // offsets change, so look them up with range() when recording draws.
+    // Compaction waits for the GPU and runs from update() or allocate() only.
+    //
+    // Main (upload) thread only.
+    class VkcGeometryArena
+    {
+    public:
+        static constexpr VkDeviceSize DEFAULT_VERTEX_CAPACITY = 128ull * 1024 * 1024;
+        static constexpr VkDeviceSize DEFAULT_INDEX_CAPACITY = 64ull * 1024 * 1024;
+        static constexpr uint32_t     INVALID_MESH = ~0u;
+
+        // Where a mesh currently lives
+        struct MeshRange {
+            uint32_t     firstVertex = 0;      // in units of the mesh's vertex stride
+            uint32_t     firstIndex = 0;       // in units of indexType
+            VkIndexType  indexType = VK_INDEX_TYPE_UINT32;
+            VkDeviceSize vertexByteOffset = 0;
+            VkDeviceSize indexByteOffset = 0;
+        };
+
+        struct Stats {
+            uint32_t     meshes = 0;
+            VkDeviceSize vertexCapacity = 0;
+            VkDeviceSize vertexBytesUsed = 0;
+            VkDeviceSize indexCapacity = 0;
+            VkDeviceSize indexBytesUsed = 0;
+            VkDeviceSize retiringBytes = 0;    // freed, waiting for frames in flight
+            uint64_t     compactions = 0;
+            uint64_t     growths = 0;
+        };
+
+        VkcGeometryArena(
+            VkcDevice& device,
+            VkDeviceSize vertexCapacity = DEFAULT_VERTEX_CAPACITY,
+            VkDeviceSize indexCapacity = DEFAULT_INDEX_CAPACITY);
+        ~VkcGeometryArena();
+
+        VkcGeometryArena(const VkcGeometryArena&) = delete;
+        VkcGeometryArena& operator=(const VkcGeometryArena&) = delete;
+
+        // Reserves vertexCount vertices of vertexStride bytes and indexCount indices,
+        // growing the arena if needed. Upload into vertexBuffer()/indexBuffer() at the
+        // returned byte offsets before the next allocate() or update(), which may move them.
+        uint32_t allocate(
+            uint32_t vertexStride,
+            uint32_t vertexCount,
+            uint32_t indexCount,
+            VkIndexType indexType = VK_INDEX_TYPE_UINT32);
+        // The range stays valid for frames already recorded
+        void free(uint32_t mesh);
+        const MeshRange& range(uint32_t mesh) const { return meshes[mesh].range; }
+
+        VkBuffer vertexBuffer() const { return vertexArena.buffer; }
+        VkBuffer indexBuffer() const { return indexArena.buffer; }
+        // Binds both buffers, the index buffer as uint32
+        void bind(VkCommandBuffer commandBuffer);
+        // Rebinds the index buffer for the given index type unless the last bind()
+        // or bindIndexType() on this command buffer already used it. The binding is
+        // remembered per thread, so threads may record their own command buffers.
+        void bindIndexType(VkCommandBuffer commandBuffer, VkIndexType indexType);
+        // Forgets the calling thread's binding. Call right after vkBeginCommandBuffer:
+        // a buffer from a reset pool can come back with the handle of one recorded before.
+        static void resetBinding();
+
+        // Once per frame, before recording: recycles retired ranges and compacts
+        // when the free space is badly fragmented
+        void update();
+        // Packs every live mesh to the start of the buffers. Blocks until the GPU is idle.
+        void compact();
+
+        // Bumped whenever live meshes move; copies of range() made earlier are stale
+        uint64_t getVersion() const { return version; }
+
+        Stats getStats() const;
+        void printStats() const;
+
+    private:
+        // First-fit free list over [0, capacity), coalescing on release
+        struct RangeList {
+            VkDeviceSize capacity = 0;
+            std::map<VkDeviceSize, VkDeviceSize> freeRanges;   // offset -> size
+
+            void reset(VkDeviceSize newCapacity, VkDeviceSize used);
+            bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+            void release(VkDeviceSize offset, VkDeviceSize size);
+            VkDeviceSize freeBytes() const;
+            VkDeviceSize largestFree() const;
+        };
+
+        struct Buffer {
+            VkBuffer      buffer = VK_NULL_HANDLE;
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            RangeList     ranges;
+        };
+
+        struct Mesh {
+            uint32_t     vertexStride = 0;
+            uint32_t     indexSize = sizeof(uint32_t);
+            VkDeviceSize vertexBytes = 0;
+            VkDeviceSize indexBytes = 0;
+            MeshRange    range;
+            bool         live = false;
+        };
+
+        struct Retired {
+            uint32_t mesh;
+            uint64_t frame;     // frame after which the range may be reused
+        };
+
+        Buffer createBuffer(VkDeviceSize capacity, VkBufferUsageFlags usage);
+        bool tryPlace(Mesh& mesh);
+        // Copies the live meshes packed into new buffers of the given capacities
+        void relocate(VkDeviceSize vertexCapacity, VkDeviceSize indexCapacity);
+        void releaseRanges(Mesh& mesh);
+
+        VkcDevice&            device;
+        Buffer                vertexArena;
+        Buffer                indexArena;
+        std::vector<Mesh>     meshes;
+        std::vector<uint32_t> freeHandles;
+        std::deque<Retired>   retired;
+        uint64_t              frame = 0;
+        VkDeviceSize          freedSinceCompaction = 0;
+        uint64_t              version = 0;
+
+        Stats stats;
+    };
+
+}  // namespace vkc
@@ -19,14 +19,22 @@
 #define TINYGLTF_NO_STB_IMAGE_WRITE
 
 #include "vk_glTFModel.h"
+#include "VK_abstraction/vk_geometryArena.h"
 #include "VK_abstraction/vk_tools.h"
+#include "VK_abstraction/vk_uploadBatcher.h"
+#include "Utils/vkc_vertexPacking.h"
+
+#include <algorithm>
+#include <cctype>
 
 
-VkDescriptorSetLayout vkglTF::descriptorSetLayoutImage = VK_NULL_HANDLE;
-VkDescriptorSetLayout vkglTF::descriptorSetLayoutIbl = VK_NULL_HANDLE;
 VkDescriptorSetLayout vkglTF::descriptorSetLayoutUbo = VK_NULL_HANDLE;
 VkMemoryPropertyFlags vkglTF::memoryPropertyFlags = 0;
-uint32_t vkglTF::descriptorBindingFlags = vkglTF::DescriptorBindingFlags::ImageBaseColor | vkglTF::DescriptorBindingFlags::ImageNormalMap;
+
+struct ImageLoaderContext {
+	std::string baseDir;
+	const vkc::TextureCache* cookedTextures = nullptr;
+};
 
 /*
 	We use a custom image loading function with tinyglTF, so we can do custom stuff loading ktx textures
@@ -40,6 +48,14 @@ bool loadImageDataFunc(tinygltf::Image* image, const int imageIndex, std::string
 		}
 	}
 
+	// So will images that have been cooked, leave them undecoded
+	const ImageLoaderContext* context = static_cast<const ImageLoaderContext*>(userData);
+	std::string cooked;
+	if (context && context->cookedTextures && !image->uri.empty() &&
+		context->cookedTextures->findCooked(context->baseDir + "/" + image->uri, cooked)) {
+		return true;
+	}
+
 	return tinygltf::LoadImageData(image, imageIndex, error, warning, req_width, req_height, bytes, size, userData);
 }
 
@@ -49,6 +65,97 @@ bool loadImageDataFuncEmpty(tinygltf::Image* image, const int imageIndex, std::s
 	return true;
 }
 
+static bool isBinaryglTF(const std::string& filename)
+{
+	size_t pos = filename.find_last_of('.');
+	if (pos == std::string::npos) {
+		return false;
+	}
+	std::string ext = filename.substr(pos + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return ext == "glb";
+}
+
+/*
+	GLB layout: 12 byte header followed by a JSON chunk and an optional BIN chunk.
+	Each chunk is a uint32 length, a uint32 type and the (4 byte padded) payload.
+*/
+static const unsigned char* findBinaryChunk(const uint8_t* data, size_t size)
+{
+	const uint32_t chunkTypeBIN = 0x004E4942;
+	if (size < 20) {
+		return nullptr;
+	}
+	uint32_t jsonLength;
+	memcpy(&jsonLength, data + 12, sizeof(uint32_t));
+	const size_t binHeader = 20 + static_cast<size_t>(jsonLength);
+	if (binHeader + 8 > size) {
+		return nullptr;
+	}
+	uint32_t binLength, binType;
+	memcpy(&binLength, data + binHeader, sizeof(uint32_t));
+	memcpy(&binType, data + binHeader + 4, sizeof(uint32_t));
+	if (binType != chunkTypeBIN || binHeader + 8 + binLength > size) {
+		return nullptr;
+	}
+	return data + binHeader + 8;
+}
+
+// The optimized order of a primitive, if optimizeGeometry ran for this file and still matches it
+static const vkglTF::PrimitiveOrder* findPrimitiveOrder(const vkglTF::GeometryOrder* order, const tinygltf::Model& model, int mesh, size_t primitive)
+{
+	if (!order || mesh < 0 || static_cast<size_t>(mesh) >= order->meshes.size() || primitive >= order->meshes[mesh].size()) {
+		return nullptr;
+	}
+	const vkglTF::PrimitiveOrder& candidate = order->meshes[mesh][primitive];
+	const tinygltf::Primitive& source = model.meshes[mesh].primitives[primitive];
+	auto position = source.attributes.find("POSITION");
+	if (candidate.lods.empty() || source.indices < 0 || position == source.attributes.end()) {
+		return nullptr;
+	}
+	if (candidate.vertexOrder.size() != model.accessors[position->second].count ||
+		candidate.lods[0].indexCount != model.accessors[source.indices].count) {
+		return nullptr;
+	}
+	return &candidate;
+}
+
+// Vertex and index totals of a node hierarchy, so geometry can be written to its final location in one pass
+static void countNodeGeometry(const tinygltf::Model& model, const tinygltf::Node& node, const vkglTF::GeometryOrder* order, size_t& vertexCount, size_t& indexCount)
+{
+	for (int child : node.children) {
+		countNodeGeometry(model, model.nodes[child], order, vertexCount, indexCount);
+	}
+	if (node.mesh > -1) {
+		const std::vector<tinygltf::Primitive>& primitives = model.meshes[node.mesh].primitives;
+		for (size_t p = 0; p < primitives.size(); p++) {
+			const tinygltf::Primitive& primitive = primitives[p];
+			auto position = primitive.attributes.find("POSITION");
+			if (primitive.indices < 0 || position == primitive.attributes.end()) {
+				continue;
+			}
+			vertexCount += model.accessors[position->second].count;
+			// LODs follow level 0 in the index buffer
+			const vkglTF::PrimitiveOrder* primitiveOrder = findPrimitiveOrder(order, model, node.mesh, p);
+			indexCount += primitiveOrder ? primitiveOrder->indices.size() : model.accessors[primitive.indices].count;
+		}
+	}
+}
+
+// Nodes of a scene in depth-first order, parents before children, with the position of each one's parent in that order
+struct SceneNode {
+	int node;
+	int32_t parent;
+};
+
+static void collectSceneNodes(const tinygltf::Model& model, int node, int32_t parent, std::vector<SceneNode>& order)
+{
+	const int32_t slot = static_cast<int32_t>(order.size());
+	order.push_back({ node, parent });
+	for (int child : model.nodes[node].children) {
+		collectSceneNodes(model, child, slot, order);
+	}
+}
 
 /*
 	glTF texture loading class
@@ -66,17 +173,16 @@ void vkglTF::Texture::destroy()
 	if (device)
 	{
 		vkDestroyImageView(device->logicalDevice, view, nullptr);
-		vkDestroyImage(device->logicalDevice, image, nullptr);
-		vkFreeMemory(device->logicalDevice, deviceMemory, nullptr);
+		device->destroyImage(image, allocation);
 		vkDestroySampler(device->logicalDevice, sampler, nullptr);
 	}
 }
 
-void vkglTF::Texture::fromglTfImage(tinygltf::Image& gltfimage, std::string path, vkc::VkcDevice* device, VkQueue copyQueue, bool isSrgb)
+void vkglTF::Texture::fromglTfImage(tinygltf::Image& gltfimage, std::string path, vkc::VkcDevice* device, VkQueue copyQueue, bool isSrgb, const std::string& ktxFilename)
 {
 	this->device = device;
 
-	bool isKtx = false;
+	bool isKtx = !ktxFilename.empty();
 	// Image points to an external ktx file
 	if (gltfimage.uri.find_last_of(".") != std::string::npos) {
 		if (gltfimage.uri.substr(gltfimage.uri.find_last_of(".") + 1) == "ktx") {
@@ -89,30 +195,6 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image& gltfimage, std::string path
 	if (!isKtx) {
 		// Texture was loaded using STB_Image
 
-		unsigned char* buffer = nullptr;
-		VkDeviceSize bufferSize = 0;
-		bool deleteBuffer = false;
-		if (gltfimage.component == 3) {
-			// Most devices don't support RGB only on Vulkan so convert if necessary
-			// TODO: Check actual format support and transform only if required
-			bufferSize = gltfimage.width * gltfimage.height * 4;
-			buffer = new unsigned char[bufferSize];
-			unsigned char* rgba = buffer;
-			unsigned char* rgb = &gltfimage.image[0];
-			for (size_t i = 0; i < gltfimage.width * gltfimage.height; ++i) {
-				for (int32_t j = 0; j < 3; ++j) {
-					rgba[j] = rgb[j];
-				}
-				rgba += 4;
-				rgb += 3;
-			}
-			deleteBuffer = true;
-		}
-		else {
-			buffer = &gltfimage.image[0];
-			bufferSize = gltfimage.image.size();
-		}
-
 		format = isSrgb
 			? VK_FORMAT_R8G8B8A8_SRGB
 			: VK_FORMAT_R8G8B8A8_UNORM;
@@ -127,30 +209,6 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image& gltfimage, std::string path
 		assert(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT);
 		assert(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT);
 
-		VkMemoryAllocateInfo memAllocInfo{};
-		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		VkMemoryRequirements memReqs{};
-
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo{};
-		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferCreateInfo.size = bufferSize;
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-		vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-		uint8_t* data;
-		VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-		memcpy(data, buffer, bufferSize);
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
-
 		VkImageCreateInfo imageCreateInfo{};
 		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -164,31 +222,36 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image& gltfimage, std::string path
 		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		imageCreateInfo.extent = { width, height, 1 };
 		imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
-		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+		device->createImageWithInfo(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, allocation);
+		deviceMemorySize = device->allocator().allocationSize(allocation);
 
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		// Stage the base level straight into the upload ring
+		vkc::VkcUploadBatcher& batcher = device->uploadBatcher();
+		VkDeviceSize bufferSize = VkDeviceSize(gltfimage.width) * gltfimage.height * 4;
+		vkc::VkcUploadBatcher::Staging staging = batcher.allocate(bufferSize);
+		if (gltfimage.component == 3) {
+			// Most devices don't support RGB only on Vulkan so convert if necessary
+			// TODO: Check actual format support and transform only if required
+			unsigned char* rgba = static_cast<unsigned char*>(staging.mapped);
+			unsigned char* rgb = &gltfimage.image[0];
+			for (size_t i = 0; i < gltfimage.width * gltfimage.height; ++i) {
+				for (int32_t j = 0; j < 3; ++j) {
+					rgba[j] = rgb[j];
+				}
+				rgba[3] = 255;
+				rgba += 4;
+				rgb += 3;
+			}
+		}
+		else {
+			memcpy(staging.mapped, &gltfimage.image[0], static_cast<size_t>(bufferSize));
+		}
 
 		VkImageSubresourceRange subresourceRange = {};
 		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		subresourceRange.levelCount = 1;
 		subresourceRange.layerCount = 1;
 
-		VkImageMemoryBarrier imageMemoryBarrier{};
-
-		imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		imageMemoryBarrier.srcAccessMask = 0;
-		imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		imageMemoryBarrier.image = image;
-		imageMemoryBarrier.subresourceRange = subresourceRange;
-		vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-
 		VkBufferImageCopy bufferCopyRegion = {};
 		bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		bufferCopyRegion.imageSubresource.mipLevel = 0;
@@ -198,95 +261,16 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image& gltfimage, std::string path
 		bufferCopyRegion.imageExtent.height = height;
 		bufferCopyRegion.imageExtent.depth = 1;
 
-		vkCmdCopyBufferToImage(copyCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
-
-		imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		imageMemoryBarrier.image = image;
-		imageMemoryBarrier.subresourceRange = subresourceRange;
-		vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-
-		device->flushCommandBuffer(copyCmd, copyQueue);
-
-		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
+		// Level 0 stays a transfer destination as the source of the mip chain blits
+		batcher.uploadImage(staging, image, subresourceRange, { bufferCopyRegion }, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
 		// Generate the mip chain (glTF uses jpg and png, so we need to create this manually)
-		VkCommandBuffer blitCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		for (uint32_t i = 1; i < mipLevels; i++) {
-			VkImageBlit imageBlit{};
-
-			imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageBlit.srcSubresource.layerCount = 1;
-			imageBlit.srcSubresource.mipLevel = i - 1;
-			imageBlit.srcOffsets[1].x = int32_t(width >> (i - 1));
-			imageBlit.srcOffsets[1].y = int32_t(height >> (i - 1));
-			imageBlit.srcOffsets[1].z = 1;
-
-			imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageBlit.dstSubresource.layerCount = 1;
-			imageBlit.dstSubresource.mipLevel = i;
-			imageBlit.dstOffsets[1].x = int32_t(width >> i);
-			imageBlit.dstOffsets[1].y = int32_t(height >> i);
-			imageBlit.dstOffsets[1].z = 1;
-
-			VkImageSubresourceRange mipSubRange = {};
-			mipSubRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			mipSubRange.baseMipLevel = i;
-			mipSubRange.levelCount = 1;
-			mipSubRange.layerCount = 1;
-
-			{
-				VkImageMemoryBarrier imageMemoryBarrier{};
-				imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-				imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-				imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-				imageMemoryBarrier.srcAccessMask = 0;
-				imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-				imageMemoryBarrier.image = image;
-				imageMemoryBarrier.subresourceRange = mipSubRange;
-				vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-			}
-
-			vkCmdBlitImage(blitCmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, VK_FILTER_LINEAR);
-
-			{
-				VkImageMemoryBarrier imageMemoryBarrier{};
-				imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-				imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-				imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-				imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-				imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-				imageMemoryBarrier.image = image;
-				imageMemoryBarrier.subresourceRange = mipSubRange;
-				vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-			}
-		}
-
-		subresourceRange.levelCount = mipLevels;
 		imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-		imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		imageMemoryBarrier.image = image;
-		imageMemoryBarrier.subresourceRange = subresourceRange;
-		vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-
-		if (deleteBuffer) {
-			delete[] buffer;
-		}
-
-		device->flushCommandBuffer(blitCmd, copyQueue);
+		batcher.generateMipmaps(image, width, height, mipLevels, 1, imageLayout);
 	}
 	else {
 		// Texture is stored in an external ktx file
-		std::string filename = path + "/" + gltfimage.uri;
+		std::string filename = ktxFilename.empty() ? path + "/" + gltfimage.uri : ktxFilename;
 
 		ktxTexture* ktxTexture;
 
@@ -324,30 +308,6 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image& gltfimage, std::string path
 		VkFormatProperties formatProperties;
 		vkGetPhysicalDeviceFormatProperties(device->physicalDevice, format, &formatProperties);
 
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo = vkc::vkinit::bufferCreateInfo();
-		bufferCreateInfo.size = ktxTextureSize;
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-		VkMemoryAllocateInfo memAllocInfo = vkc::vkinit::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
-		vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-		uint8_t* data;
-		VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-		memcpy(data, ktxTextureData, ktxTextureSize);
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
-
 		std::vector<VkBufferImageCopy> bufferCopyRegions;
 		for (uint32_t i = 0; i < mipLevels; i++)
 		{
@@ -378,13 +338,8 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image& gltfimage, std::string path
 		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		imageCreateInfo.extent = { width, height, 1 };
 		imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
-
-		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+		device->createImageWithInfo(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, allocation);
+		deviceMemorySize = device->allocator().allocationSize(allocation);
 
 		VkImageSubresourceRange subresourceRange = {};
 		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -392,15 +347,9 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image& gltfimage, std::string path
 		subresourceRange.levelCount = mipLevels;
 		subresourceRange.layerCount = 1;
 
-		vkc::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
-		vkCmdCopyBufferToImage(copyCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()), bufferCopyRegions.data());
-		vkc::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
-		device->flushCommandBuffer(copyCmd, copyQueue);
+		device->uploadBatcher().uploadImage(ktxTextureData, ktxTextureSize, image, subresourceRange, bufferCopyRegions, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 		this->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-
 		ktxTexture_Destroy(ktxTexture);
 	}
 
@@ -436,73 +385,6 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image& gltfimage, std::string path
 	descriptor.imageLayout = imageLayout;
 }
 
-/*
-	glTF material
-*/
-void vkglTF::Material::createDescriptorSet(
-	VkDescriptorPool descriptorPool,
-	VkDescriptorSetLayout descriptorSetLayout,
-	uint32_t descriptorBindingFlags,
-	vkglTF::Texture* fallbackTexture
-) {
-	// Allocate descriptor set
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = 1;
-	allocInfo.pSetLayouts = &descriptorSetLayout;
-	VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &allocInfo, &descriptorSet));
-
-	std::vector<VkWriteDescriptorSet> writeDescriptorSets;
-
-	// Base Color Texture
-	if ((descriptorBindingFlags & vkglTF::DescriptorBindingFlags::ImageBaseColor) && baseColorTexture) {
-		VkDescriptorImageInfo baseColorImageInfo = baseColorTexture->descriptor;
-		writeDescriptorSets.push_back({
-			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,       // sType
-			nullptr,                                      // pNext
-			descriptorSet,                                // dstSet
-			0,                                            // dstBinding (base color = 0)
-			0,                                            // dstArrayElement
-			1,                                            // descriptorCount
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,    // descriptorType
-			&baseColorImageInfo,                          // pImageInfo
-			nullptr, nullptr                              // pBufferInfo, pTexelBufferView
-			});
-	}
-
-	// Normal Map Texture
-	if (descriptorBindingFlags & vkglTF::DescriptorBindingFlags::ImageNormalMap) {
-		// Always bind something
-		vkglTF::Texture* tex = (normalTexture != nullptr) ? normalTexture : fallbackTexture;
-		VkDescriptorImageInfo normalImageInfo = tex->descriptor;
-
-		writeDescriptorSets.push_back({
-			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			nullptr,
-			descriptorSet,
-			1,  // binding = 1 for normal map
-			0,
-			1,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			&normalImageInfo,
-			nullptr, nullptr
-			});
-	}
-
-	// Update descriptors
-	if (!writeDescriptorSets.empty()) {
-		vkUpdateDescriptorSets(
-			device->logicalDevice,
-			static_cast<uint32_t>(writeDescriptorSets.size()),
-			writeDescriptorSets.data(),
-			0, nullptr
-		);
-	}
-}
-
-
-
 /*
 	glTF primitive
 */
@@ -514,84 +396,13 @@ void vkglTF::Primitive::setDimensions(glm::vec3 min, glm::vec3 max) {
 	dimensions.radius = glm::distance(min, max) / 2.0f;
 }
 
-/*
-	glTF mesh
-*/
-vkglTF::Mesh::Mesh(vkc::VkcDevice* device, glm::mat4 matrix) {
-	this->device = device;
-	this->uniformBlock.matrix = matrix;
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		sizeof(uniformBlock),
-		&uniformBuffer.buffer,
-		&uniformBuffer.memory,
-		&uniformBlock));
-	VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, uniformBuffer.memory, 0, sizeof(uniformBlock), 0, &uniformBuffer.mapped));
-	uniformBuffer.descriptor = { uniformBuffer.buffer, 0, sizeof(uniformBlock) };
-};
-
-vkglTF::Mesh::~Mesh() {
-	vkDestroyBuffer(device->logicalDevice, uniformBuffer.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, uniformBuffer.memory, nullptr);
-	for (auto primitive : primitives)
-	{
-		delete primitive;
-	}
-}
-
 /*
 	glTF node
 */
-glm::mat4 vkglTF::Node::localMatrix() {
+glm::mat4 vkglTF::Node::localMatrix() const {
 	return glm::translate(glm::mat4(1.0f), translation) * glm::mat4(rotation) * glm::scale(glm::mat4(1.0f), scale) * matrix;
 }
 
-glm::mat4 vkglTF::Node::getMatrix() {
-	glm::mat4 m = localMatrix();
-	vkglTF::Node* p = parent;
-	while (p) {
-		m = p->localMatrix() * m;
-		p = p->parent;
-	}
-	return m;
-}
-
-void vkglTF::Node::update() {
-	if (mesh) {
-		glm::mat4 m = getMatrix();
-		if (skin) {
-			mesh->uniformBlock.matrix = m;
-			// Update join matrices
-			glm::mat4 inverseTransform = glm::inverse(m);
-			for (size_t i = 0; i < skin->joints.size(); i++) {
-				vkglTF::Node* jointNode = skin->joints[i];
-				glm::mat4 jointMat = jointNode->getMatrix() * skin->inverseBindMatrices[i];
-				jointMat = inverseTransform * jointMat;
-				mesh->uniformBlock.jointMatrix[i] = jointMat;
-			}
-			mesh->uniformBlock.jointcount = (float)skin->joints.size();
-			memcpy(mesh->uniformBuffer.mapped, &mesh->uniformBlock, sizeof(mesh->uniformBlock));
-		}
-		else {
-			memcpy(mesh->uniformBuffer.mapped, &m, sizeof(glm::mat4));
-		}
-	}
-
-	for (auto& child : children) {
-		child->update();
-	}
-}
-
-vkglTF::Node::~Node() {
-	if (mesh) {
-		delete mesh;
-	}
-	for (auto& child : children) {
-		delete child;
-	}
-}
-
 /*
 	glTF default vertex layout with easy Vulkan mapping functions
 */
@@ -668,30 +479,7 @@ void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
 	emptyTexture.mipLevels = 1;
 
 	size_t bufferSize = emptyTexture.width * emptyTexture.height * 4;
-	unsigned char* buffer = new unsigned char[bufferSize];
-	memset(buffer, 0, bufferSize);
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMemory;
-	VkBufferCreateInfo bufferCreateInfo = vkc::vkinit::bufferCreateInfo();
-	bufferCreateInfo.size = bufferSize;
-	// This buffer is used as a transfer source for the buffer copy
-	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-	VkMemoryAllocateInfo memAllocInfo = vkc::vkinit::memoryAllocateInfo();
-	VkMemoryRequirements memReqs;
-	vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-	memAllocInfo.allocationSize = memReqs.size;
-	memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-	VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-	// Copy texture data into staging buffer
-	uint8_t* data;
-	VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-	memcpy(data, buffer, bufferSize);
-	vkUnmapMemory(device->logicalDevice, stagingMemory);
+	std::vector<unsigned char> buffer(bufferSize, 0);
 
 	VkBufferImageCopy bufferCopyRegion = {};
 	bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -712,13 +500,8 @@ void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
 	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	imageCreateInfo.extent = { emptyTexture.width, emptyTexture.height, 1 };
 	imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-	VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &emptyTexture.image));
-
-	vkGetImageMemoryRequirements(device->logicalDevice, emptyTexture.image, &memReqs);
-	memAllocInfo.allocationSize = memReqs.size;
-	memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &emptyTexture.deviceMemory));
-	VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, emptyTexture.image, emptyTexture.deviceMemory, 0));
+	device->createImageWithInfo(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, emptyTexture.image, emptyTexture.allocation);
+	emptyTexture.deviceMemorySize = device->allocator().allocationSize(emptyTexture.allocation);
 
 	VkImageSubresourceRange subresourceRange{};
 	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -726,17 +509,9 @@ void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
 	subresourceRange.levelCount = 1;
 	subresourceRange.layerCount = 1;
 
-	VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-	vkc::tools::setImageLayout(copyCmd, emptyTexture.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
-	vkCmdCopyBufferToImage(copyCmd, stagingBuffer, emptyTexture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
-	vkc::tools::setImageLayout(copyCmd, emptyTexture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
-	device->flushCommandBuffer(copyCmd, transferQueue);
+	device->uploadBatcher().uploadImage(buffer.data(), bufferSize, emptyTexture.image, subresourceRange, { bufferCopyRegion }, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	emptyTexture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-	// Clean up staging resources
-	vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-
 	VkSamplerCreateInfo samplerCreateInfo = vkc::vkinit::samplerCreateInfo();
 	samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
 	samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
@@ -766,37 +541,76 @@ void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
 */
 vkglTF::Model::~Model()
 {
-	vkDestroyBuffer(device->logicalDevice, vertices.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, vertices.memory, nullptr);
-	vkDestroyBuffer(device->logicalDevice, indices.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, indices.memory, nullptr);
+	if (device) {
+		device->geometryArena().free(geometryHandle);
+	}
 	for (auto texture : textures) {
 		texture.destroy();
 	}
-	for (auto node : nodes) {
-		delete node;
-	}
-	for (auto skin : skins) {
-		delete skin;
+	if (meshUniformBuffer != VK_NULL_HANDLE) {
+		device->allocator().unmap(meshUniformAllocation);
+		device->destroyBuffer(meshUniformBuffer, meshUniformAllocation);
 	}
+	storage.release();
 	if (descriptorSetLayoutUbo != VK_NULL_HANDLE) {
 		vkDestroyDescriptorSetLayout(device->logicalDevice, descriptorSetLayoutUbo, nullptr);
 		descriptorSetLayoutUbo = VK_NULL_HANDLE;
 	}
-	if (descriptorSetLayoutImage != VK_NULL_HANDLE) {
-		vkDestroyDescriptorSetLayout(device->logicalDevice, descriptorSetLayoutImage, nullptr);
-		descriptorSetLayoutImage = VK_NULL_HANDLE;
-	}
 	vkDestroyDescriptorPool(device->logicalDevice, descriptorPool, nullptr);
 	emptyTexture.destroy();
 }
 
-void vkglTF::Model::loadNode(vkglTF::Node* parent, const tinygltf::Node& node, uint32_t nodeIndex, const tinygltf::Model& model, std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer, float globalscale)
+static const unsigned char* accessorBytes(const tinygltf::Model& model, const tinygltf::Accessor& accessor, const unsigned char* binaryChunk)
+{
+	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+	const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+	const size_t offset = accessor.byteOffset + bufferView.byteOffset;
+	// The embedded buffer of a .glb is read straight from the file mapping
+	if (buffer.data.empty() && binaryChunk) {
+		return binaryChunk + offset;
+	}
+	return &buffer.data[offset];
+}
+
+// Widens an index accessor to uint32, adding base. False for unsupported component types.
+static bool readIndices(const unsigned char* data, const tinygltf::Accessor& accessor, uint32_t base, uint32_t* out)
+{
+	switch (accessor.componentType) {
+	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
+		const uint32_t* buf = reinterpret_cast<const uint32_t*>(data);
+		for (size_t index = 0; index < accessor.count; index++) {
+			out[index] = buf[index] + base;
+		}
+		return true;
+	}
+	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
+		const uint16_t* buf = reinterpret_cast<const uint16_t*>(data);
+		for (size_t index = 0; index < accessor.count; index++) {
+			out[index] = buf[index] + base;
+		}
+		return true;
+	}
+	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
+		const uint8_t* buf = data;
+		for (size_t index = 0; index < accessor.count; index++) {
+			out[index] = buf[index] + base;
+		}
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+const unsigned char* vkglTF::Model::accessorData(const tinygltf::Model& model, const tinygltf::Accessor& accessor) const
 {
-	vkglTF::Node* newNode = new Node{};
-	newNode->index = nodeIndex;
-	newNode->parent = parent;
-	newNode->name = node.name;
+	return accessorBytes(model, accessor, binaryChunk);
+}
+
+void vkglTF::Model::loadNode(uint32_t slot, const tinygltf::Node& node, const tinygltf::Model& model, GeometryTarget& geometry, Mesh*& nextMesh, Primitive*& nextPrimitive, float globalscale)
+{
+	vkglTF::Node* newNode = &nodes[slot];
+	newNode->name = storage.copyString(node.name);
 	newNode->skinIndex = node.skin;
 	newNode->matrix = glm::mat4(1.0f);
 
@@ -823,30 +637,26 @@ void vkglTF::Model::loadNode(vkglTF::Node* parent, const tinygltf::Node& node, u
 		}
 	};
 
-	// Node with children
-	if (node.children.size() > 0) {
-		for (auto i = 0; i < node.children.size(); i++) {
-			loadNode(newNode, model.nodes[node.children[i]], node.children[i], model, indexBuffer, vertexBuffer, globalscale);
-		}
-	}
-
 	// Node contains mesh data
 	if (node.mesh > -1) {
-		const tinygltf::Mesh mesh = model.meshes[node.mesh];
-		Mesh* newMesh = new Mesh(device, newNode->matrix);
-		newMesh->name = mesh.name;
+		const tinygltf::Mesh& mesh = model.meshes[node.mesh];
+		Mesh* newMesh = nextMesh++;
+		newMesh->name = storage.copyString(mesh.name);
+		newMesh->primitives.data = nextPrimitive;
+		newNode->mesh = newMesh;
 		for (size_t j = 0; j < mesh.primitives.size(); j++) {
 			const tinygltf::Primitive& primitive = mesh.primitives[j];
 			if (primitive.indices < 0) {
 				continue;
 			}
-			uint32_t indexStart = static_cast<uint32_t>(indexBuffer.size());
-			uint32_t vertexStart = static_cast<uint32_t>(vertexBuffer.size());
+			uint32_t indexStart = geometry.indexCount;
+			uint32_t vertexStart = geometry.vertexCount;
 			uint32_t indexCount = 0;
 			uint32_t vertexCount = 0;
 			glm::vec3 posMin{};
 			glm::vec3 posMax{};
 			bool hasSkin = false;
+			const PrimitiveOrder* order = nullptr;
 			// Vertices
 			{
 				const float* bufferPos = nullptr;
@@ -863,20 +673,20 @@ void vkglTF::Model::loadNode(vkglTF::Node* parent, const tinygltf::Node& node, u
 
 				const tinygltf::Accessor& posAccessor = model.accessors[primitive.attributes.find("POSITION")->second];
 				const tinygltf::BufferView& posView = model.bufferViews[posAccessor.bufferView];
-				bufferPos = reinterpret_cast<const float*>(&(model.buffers[posView.buffer].data[posAccessor.byteOffset + posView.byteOffset]));
+				bufferPos = reinterpret_cast<const float*>(accessorData(model, posAccessor));
 				posMin = glm::vec3(posAccessor.minValues[0], posAccessor.minValues[1], posAccessor.minValues[2]);
 				posMax = glm::vec3(posAccessor.maxValues[0], posAccessor.maxValues[1], posAccessor.maxValues[2]);
 
 				if (primitive.attributes.find("NORMAL") != primitive.attributes.end()) {
 					const tinygltf::Accessor& normAccessor = model.accessors[primitive.attributes.find("NORMAL")->second];
 					const tinygltf::BufferView& normView = model.bufferViews[normAccessor.bufferView];
-					bufferNormals = reinterpret_cast<const float*>(&(model.buffers[normView.buffer].data[normAccessor.byteOffset + normView.byteOffset]));
+					bufferNormals = reinterpret_cast<const float*>(accessorData(model, normAccessor));
 				}
 
 				if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end()) {
 					const tinygltf::Accessor& uvAccessor = model.accessors[primitive.attributes.find("TEXCOORD_0")->second];
 					const tinygltf::BufferView& uvView = model.bufferViews[uvAccessor.bufferView];
-					bufferTexCoords = reinterpret_cast<const float*>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
+					bufferTexCoords = reinterpret_cast<const float*>(accessorData(model, uvAccessor));
 				}
 
 				if (primitive.attributes.find("COLOR_0") != primitive.attributes.end())
@@ -885,14 +695,14 @@ void vkglTF::Model::loadNode(vkglTF::Node* parent, const tinygltf::Node& node, u
 					const tinygltf::BufferView& colorView = model.bufferViews[colorAccessor.bufferView];
 					// Color buffer are either of type vec3 or vec4
 					numColorComponents = colorAccessor.type == TINYGLTF_PARAMETER_TYPE_FLOAT_VEC3 ? 3 : 4;
-					bufferColors = reinterpret_cast<const float*>(&(model.buffers[colorView.buffer].data[colorAccessor.byteOffset + colorView.byteOffset]));
+					bufferColors = reinterpret_cast<const float*>(accessorData(model, colorAccessor));
 				}
 
 				if (primitive.attributes.find("TANGENT") != primitive.attributes.end())
 				{
 					const tinygltf::Accessor& tangentAccessor = model.accessors[primitive.attributes.find("TANGENT")->second];
 					const tinygltf::BufferView& tangentView = model.bufferViews[tangentAccessor.bufferView];
-					bufferTangents = reinterpret_cast<const float*>(&(model.buffers[tangentView.buffer].data[tangentAccessor.byteOffset + tangentView.byteOffset]));
+					bufferTangents = reinterpret_cast<const float*>(accessorData(model, tangentAccessor));
 				}
 
 				// Skinning
@@ -900,138 +710,166 @@ void vkglTF::Model::loadNode(vkglTF::Node* parent, const tinygltf::Node& node, u
 				if (primitive.attributes.find("JOINTS_0") != primitive.attributes.end()) {
 					const tinygltf::Accessor& jointAccessor = model.accessors[primitive.attributes.find("JOINTS_0")->second];
 					const tinygltf::BufferView& jointView = model.bufferViews[jointAccessor.bufferView];
-					bufferJoints = reinterpret_cast<const uint16_t*>(&(model.buffers[jointView.buffer].data[jointAccessor.byteOffset + jointView.byteOffset]));
+					bufferJoints = reinterpret_cast<const uint16_t*>(accessorData(model, jointAccessor));
 				}
 
 				if (primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end()) {
 					const tinygltf::Accessor& uvAccessor = model.accessors[primitive.attributes.find("WEIGHTS_0")->second];
 					const tinygltf::BufferView& uvView = model.bufferViews[uvAccessor.bufferView];
-					bufferWeights = reinterpret_cast<const float*>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
+					bufferWeights = reinterpret_cast<const float*>(accessorData(model, uvAccessor));
 				}
 
 				hasSkin = (bufferJoints && bufferWeights);
 
 				vertexCount = static_cast<uint32_t>(posAccessor.count);
 
+				order = findPrimitiveOrder(geometryOrder, model, node.mesh, j);
+
 				for (size_t v = 0; v < posAccessor.count; v++) {
+					const size_t s = order ? order->vertexOrder[v] : v;
 					Vertex vert{};
-					vert.pos = glm::vec4(glm::make_vec3(&bufferPos[v * 3]), 1.0f);
-					vert.normal = glm::normalize(glm::vec3(bufferNormals ? glm::make_vec3(&bufferNormals[v * 3]) : glm::vec3(0.0f)));
-					vert.uv = bufferTexCoords ? glm::make_vec2(&bufferTexCoords[v * 2]) : glm::vec3(0.0f);
+					vert.pos = glm::vec4(glm::make_vec3(&bufferPos[s * 3]), 1.0f);
+					vert.normal = glm::normalize(glm::vec3(bufferNormals ? glm::make_vec3(&bufferNormals[s * 3]) : glm::vec3(0.0f)));
+					vert.uv = bufferTexCoords ? glm::make_vec2(&bufferTexCoords[s * 2]) : glm::vec3(0.0f);
 					if (bufferColors) {
 						switch (numColorComponents) {
 						case 3:
-							vert.color = glm::vec4(glm::make_vec3(&bufferColors[v * 3]), 1.0f);
+							vert.color = glm::vec4(glm::make_vec3(&bufferColors[s * 3]), 1.0f);
+							break;
 						case 4:
-							vert.color = glm::make_vec4(&bufferColors[v * 4]);
+							vert.color = glm::make_vec4(&bufferColors[s * 4]);
 						}
 					}
 					else {
 						vert.color = glm::vec4(1.0f);
 					}
-					vert.tangent = bufferTangents ? glm::vec4(glm::make_vec4(&bufferTangents[v * 4])) : glm::vec4(0.0f);
-					vert.joint0 = hasSkin ? glm::vec4(glm::make_vec4(&bufferJoints[v * 4])) : glm::vec4(0.0f);
-					vert.weight0 = hasSkin ? glm::make_vec4(&bufferWeights[v * 4]) : glm::vec4(0.0f);
-					vertexBuffer.push_back(vert);
+					vert.tangent = bufferTangents ? glm::vec4(glm::make_vec4(&bufferTangents[s * 4])) : glm::vec4(0.0f);
+					vert.joint0 = hasSkin ? glm::vec4(glm::make_vec4(&bufferJoints[s * 4])) : glm::vec4(0.0f);
+					vert.weight0 = hasSkin ? glm::make_vec4(&bufferWeights[s * 4]) : glm::vec4(0.0f);
+					geometry.vertices[geometry.vertexCount++] = vert;
 				}
 			}
 			// Indices
 			{
 				const tinygltf::Accessor& accessor = model.accessors[primitive.indices];
-				const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+				const unsigned char* data = accessorData(model, accessor);
 
 				indexCount = static_cast<uint32_t>(accessor.count);
 
-				switch (accessor.componentType) {
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-					uint32_t* buf = new uint32_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint32_t));
-					for (size_t index = 0; index < accessor.count; index++) {
-						indexBuffer.push_back(buf[index] + vertexStart);
+				if (order) {
+					for (uint32_t index : order->indices) {
+						geometry.indices[geometry.indexCount++] = index + vertexStart;
 					}
-					delete[] buf;
-					break;
-				}
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-					uint16_t* buf = new uint16_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint16_t));
-					for (size_t index = 0; index < accessor.count; index++) {
-						indexBuffer.push_back(buf[index] + vertexStart);
-					}
-					delete[] buf;
-					break;
 				}
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
-					uint8_t* buf = new uint8_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint8_t));
-					for (size_t index = 0; index < accessor.count; index++) {
-						indexBuffer.push_back(buf[index] + vertexStart);
-					}
-					delete[] buf;
-					break;
+				else if (readIndices(data, accessor, vertexStart, geometry.indices + geometry.indexCount)) {
+					geometry.indexCount += indexCount;
 				}
-				default:
+				else {
 					std::cerr << "Index component type " << accessor.componentType << " not supported!" << std::endl;
 					return;
 				}
 			}
-			Primitive* newPrimitive = new Primitive(indexStart, indexCount, primitive.material > -1 ? materials[primitive.material] : materials.back());
+			Primitive* newPrimitive = nextPrimitive++;
+			newMesh->primitives.count++;
+			newPrimitive->firstIndex = indexStart;
+			newPrimitive->indexCount = indexCount;
 			newPrimitive->firstVertex = vertexStart;
 			newPrimitive->vertexCount = vertexCount;
+			newPrimitive->material = primitive.material > -1 ? &materials[primitive.material] : &materials.back();
 			newPrimitive->setDimensions(posMin, posMax);
-			newMesh->primitives.push_back(newPrimitive);
+			if (order) {
+				newPrimitive->lods = storage.allocate<vkc::meshopt::Lod>(order->lods.size());
+				for (size_t level = 0; level < order->lods.size(); level++) {
+					const vkc::meshopt::Lod& lod = order->lods[level];
+					newPrimitive->lods[level] = { indexStart + lod.firstIndex, lod.indexCount, lod.error };
+				}
+			}
+			else {
+				newPrimitive->lods = storage.allocate<vkc::meshopt::Lod>(1);
+				newPrimitive->lods[0] = { indexStart, indexCount, 0.0f };
+			}
 		}
-		newNode->mesh = newMesh;
-	}
-	if (parent) {
-		parent->children.push_back(newNode);
+		// Materials are stored in an array, so this groups primitives by material
+		std::stable_sort(newMesh->primitives.begin(), newMesh->primitives.end(),
+			[](const Primitive& a, const Primitive& b) { return a.material < b.material; });
 	}
-	else {
-		nodes.push_back(newNode);
-	}
-	linearNodes.push_back(newNode);
 }
 
 void vkglTF::Model::loadSkins(tinygltf::Model& gltfModel)
 {
-	for (tinygltf::Skin& source : gltfModel.skins) {
-		Skin* newSkin = new Skin{};
-		newSkin->name = source.name;
+	skins = storage.allocate<Skin>(gltfModel.skins.size());
+	for (size_t s = 0; s < gltfModel.skins.size(); s++) {
+		const tinygltf::Skin& source = gltfModel.skins[s];
+		Skin& newSkin = skins[s];
+		newSkin.name = storage.copyString(source.name);
 
 		// Find skeleton root node
-		if (source.skeleton > -1) {
-			newSkin->skeletonRoot = nodeFromIndex(source.skeleton);
+		if (source.skeleton > -1 && nodeFromIndex(source.skeleton)) {
+			newSkin.skeletonRoot = nodeLookup[source.skeleton];
 		}
 
 		// Find joint nodes
+		uint32_t jointCount = 0;
+		for (int jointIndex : source.joints) {
+			if (nodeFromIndex(jointIndex)) {
+				jointCount++;
+			}
+		}
+		newSkin.joints = storage.allocate<uint32_t>(jointCount);
+		jointCount = 0;
 		for (int jointIndex : source.joints) {
-			Node* node = nodeFromIndex(jointIndex);
-			if (node) {
-				newSkin->joints.push_back(nodeFromIndex(jointIndex));
+			if (nodeFromIndex(jointIndex)) {
+				newSkin.joints[jointCount++] = static_cast<uint32_t>(nodeLookup[jointIndex]);
 			}
 		}
 
 		// Get inverse bind matrices from buffer
 		if (source.inverseBindMatrices > -1) {
 			const tinygltf::Accessor& accessor = gltfModel.accessors[source.inverseBindMatrices];
-			const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
-			const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
-			newSkin->inverseBindMatrices.resize(accessor.count);
-			memcpy(newSkin->inverseBindMatrices.data(), &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::mat4));
+			newSkin.inverseBindMatrices = storage.allocate<glm::mat4>(accessor.count);
+			memcpy(newSkin.inverseBindMatrices.data, accessorData(gltfModel, accessor), accessor.count * sizeof(glm::mat4));
 		}
+	}
+}
 
-		skins.push_back(newSkin);
+void vkglTF::Model::createMeshUniforms()
+{
+	if (meshes.empty()) {
+		return;
+	}
+	// One buffer for every mesh, each slice aligned to be usable as a descriptor range
+	const VkDeviceSize alignment = std::max<VkDeviceSize>(device->properties.limits.minUniformBufferOffsetAlignment, 1);
+	const VkDeviceSize stride = (sizeof(Mesh::UniformBlock) + alignment - 1) / alignment * alignment;
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stride * meshes.size(),
+		&meshUniformBuffer,
+		&meshUniformAllocation));
+	void* mapped = nullptr;
+	VK_CHECK_RESULT(device->allocator().map(meshUniformAllocation, &mapped));
+	for (uint32_t m = 0; m < meshes.size(); m++) {
+		Mesh& mesh = meshes[m];
+		mesh.uniformBuffer.descriptor = { meshUniformBuffer, stride * m, sizeof(Mesh::UniformBlock) };
+		mesh.uniformBuffer.mapped = static_cast<unsigned char*>(mapped) + stride * m;
 	}
 }
 
-void vkglTF::Model::loadImages(tinygltf::Model& gltfModel, vkc::VkcDevice* device, VkQueue transferQueue)
+void vkglTF::Model::loadImages(tinygltf::Model& gltfModel, vkc::VkcDevice* device, VkQueue transferQueue, const vkc::TextureCache* cookedTextures)
 {
 	for (tinygltf::Image& image : gltfModel.images) {
+		// The image loader left cooked images undecoded
+		std::string cooked;
+		if (cookedTextures && image.image.empty() && !image.uri.empty()) {
+			cooked = cookedTextures->cookedPath(path + "/" + image.uri);
+		}
+
 		vkglTF::Texture texture;
-		texture.fromglTfImage(image, path, device, transferQueue, false);
+		texture.fromglTfImage(image, path, device, transferQueue, false, cooked);
 		texture.index = static_cast<uint32_t>(textures.size());
 		textures.push_back(texture);
+		// Pixels are in staging memory now, don't hold the decoded copy until the parse result goes away
+		std::vector<unsigned char>().swap(image.image);
 	}
 	// Create an empty texture to be used for empty material images
 	createEmptyTexture(transferQueue);
@@ -1041,6 +879,7 @@ void vkglTF::Model::loadMaterials(tinygltf::Model& gltfModel)
 {
 	for (tinygltf::Material& mat : gltfModel.materials) {
 		vkglTF::Material material(device);
+		material.index = static_cast<uint32_t>(materials.size());
 		if (mat.values.find("baseColorTexture") != mat.values.end()) {
 			material.baseColorTexture = getTexture(gltfModel.textures[mat.values["baseColorTexture"].TextureIndex()].source);
 		}
@@ -1060,12 +899,12 @@ void vkglTF::Model::loadMaterials(tinygltf::Model& gltfModel)
 		if (mat.additionalValues.find("normalTexture") != mat.additionalValues.end()) {
 			material.normalTexture = getTexture(gltfModel.textures[mat.additionalValues["normalTexture"].TextureIndex()].source);
 		}
-		else {
-			material.normalTexture = &emptyTexture;
-		}
 		if (mat.additionalValues.find("emissiveTexture") != mat.additionalValues.end()) {
 			material.emissiveTexture = getTexture(gltfModel.textures[mat.additionalValues["emissiveTexture"].TextureIndex()].source);
 		}
+		if (mat.additionalValues.find("emissiveFactor") != mat.additionalValues.end()) {
+			material.emissiveFactor = glm::make_vec3(mat.additionalValues["emissiveFactor"].ColorFactor().data());
+		}
 		if (mat.additionalValues.find("occlusionTexture") != mat.additionalValues.end()) {
 			material.occlusionTexture = getTexture(gltfModel.textures[mat.additionalValues["occlusionTexture"].TextureIndex()].source);
 		}
@@ -1090,70 +929,287 @@ void vkglTF::Model::loadMaterials(tinygltf::Model& gltfModel)
 	}
 	// Push a default material at the end of the list for meshes with no material assigned
 	materials.push_back(Material(device));
+	materials.back().index = static_cast<uint32_t>(materials.size() - 1);
 }
 
 
 
 
 
-void vkglTF::Model::loadFromFile(std::string filename, vkc::VkcDevice* device, VkQueue transferQueue, uint32_t fileLoadingFlags, float scale)
+vkglTF::Model::ParsedFile vkglTF::Model::parseFile(const std::string& filename, uint32_t fileLoadingFlags, const vkc::TextureCache* cookedTextures)
 {
-	tinygltf::Model gltfModel;
+	ParsedFile parsed;
+	parsed.filename = filename;
+	parsed.cookedTextures = cookedTextures;
+
 	tinygltf::TinyGLTF gltfContext;
 
+	ImageLoaderContext imageLoaderContext;
+	imageLoaderContext.baseDir = filename.substr(0, filename.find_last_of('/'));
+	imageLoaderContext.cookedTextures = cookedTextures;
+
 	if (fileLoadingFlags & FileLoadingFlags::DontLoadImages) {
 		gltfContext.SetImageLoader(loadImageDataFuncEmpty, nullptr);
 	}
 	else {
-		gltfContext.SetImageLoader(loadImageDataFunc, nullptr);
+		gltfContext.SetImageLoader(loadImageDataFunc, &imageLoaderContext);
 	}
 #if defined(__ANDROID__)
 	// On Android all assets are packed with the apk in a compressed form, so we need to open them using the asset manager
 	// We let tinygltf handle this, by passing the asset manager of our app
 	tinygltf::asset_manager = androidApp->activity->assetManager;
 #endif
+	if (!isBinaryglTF(filename)) {
+		parsed.loaded = gltfContext.LoadASCIIFromFile(&parsed.gltfModel, &parsed.error, &parsed.warning, filename);
+		return parsed;
+	}
+#if defined(__ANDROID__)
+	parsed.loaded = gltfContext.LoadBinaryFromFile(&parsed.gltfModel, &parsed.error, &parsed.warning, filename);
+#else
+	if (!parsed.mapping.open(filename)) {
+		parsed.error = "could not map file";
+		return parsed;
+	}
+	const size_t pos = filename.find_last_of('/');
+	const std::string baseDir = pos == std::string::npos ? std::string(".") : filename.substr(0, pos);
+	parsed.loaded = gltfContext.LoadBinaryFromMemory(&parsed.gltfModel, &parsed.error, &parsed.warning,
+		parsed.mapping.data(), static_cast<unsigned int>(parsed.mapping.size()), baseDir);
+
+	// tinygltf copies the BIN chunk into the buffer (and decodes embedded images from it while parsing).
+	// Drop that copy again; accessors are read from the mapping.
+	parsed.binaryChunk = parsed.loaded ? findBinaryChunk(parsed.mapping.data(), parsed.mapping.size()) : nullptr;
+	if (parsed.binaryChunk) {
+		for (tinygltf::Buffer& buffer : parsed.gltfModel.buffers) {
+			if (buffer.uri.empty()) {
+				std::vector<unsigned char>().swap(buffer.data);
+			}
+		}
+	}
+#endif
+	return parsed;
+}
+
+void vkglTF::Model::optimizeGeometry(ParsedFile& parsed)
+{
+	GeometryOrder& result = parsed.geometryOrder;
+	result = GeometryOrder{};
+	if (!parsed.loaded) {
+		return;
+	}
+
+	const tinygltf::Model& model = parsed.gltfModel;
+	result.meshes.resize(model.meshes.size());
+	// Totals weighted by triangles (ACMR) and vertices (ATVR)
+	double triangles = 0.0, vertices = 0.0;
+	double acmrBefore = 0.0, acmrAfter = 0.0, atvrBefore = 0.0, atvrAfter = 0.0;
+
+	for (size_t m = 0; m < model.meshes.size(); m++) {
+		const std::vector<tinygltf::Primitive>& primitives = model.meshes[m].primitives;
+		result.meshes[m].resize(primitives.size());
+		for (size_t p = 0; p < primitives.size(); p++) {
+			const tinygltf::Primitive& primitive = primitives[p];
+			auto position = primitive.attributes.find("POSITION");
+			const bool triangleList = primitive.mode == TINYGLTF_MODE_TRIANGLES || primitive.mode == -1;
+			if (primitive.indices < 0 || position == primitive.attributes.end() || !triangleList) {
+				continue;
+			}
+
+			const tinygltf::Accessor& indexAccessor = model.accessors[primitive.indices];
+			const tinygltf::Accessor& posAccessor = model.accessors[position->second];
+			std::vector<uint32_t> indices(indexAccessor.count);
+			if (indices.size() % 3 != 0 ||
+				!readIndices(accessorBytes(model, indexAccessor, parsed.binaryChunk), indexAccessor, 0, indices.data())) {
+				continue;
+			}
+
+			const float* positions = reinterpret_cast<const float*>(accessorBytes(model, posAccessor, parsed.binaryChunk));
+			const float* normals = nullptr;
+			auto normal = primitive.attributes.find("NORMAL");
+			if (normal != primitive.attributes.end()) {
+				normals = reinterpret_cast<const float*>(accessorBytes(model, model.accessors[normal->second], parsed.binaryChunk));
+			}
+
+			vkc::meshopt::Result optimized = vkc::meshopt::optimizeMesh(
+				indices.data(), indices.size(), posAccessor.count, positions, normals, sizeof(float) * 3);
+
+			// Simplify against the positions in their new order; the levels are appended to indices
+			std::vector<float> orderedPositions(posAccessor.count * 3);
+			for (size_t v = 0; v < posAccessor.count; v++) {
+				memcpy(&orderedPositions[v * 3], &positions[optimized.vertexOrder[v] * 3], sizeof(float) * 3);
+			}
+			const size_t baseIndexCount = indices.size();
+			result.meshes[m][p].lods = vkc::meshopt::generateLods(
+				indices, orderedPositions.data(), posAccessor.count, sizeof(float) * 3);
+
+			const double primitiveTriangles = static_cast<double>(baseIndexCount / 3);
+			const double primitiveVertices = static_cast<double>(posAccessor.count);
+			triangles += primitiveTriangles;
+			vertices += primitiveVertices;
+			acmrBefore += optimized.before.acmr * primitiveTriangles;
+			acmrAfter += optimized.after.acmr * primitiveTriangles;
+			atvrBefore += optimized.before.atvr * primitiveVertices;
+			atvrAfter += optimized.after.atvr * primitiveVertices;
+
+			result.meshes[m][p].vertexOrder = std::move(optimized.vertexOrder);
+			result.meshes[m][p].indices = std::move(indices);
+		}
+	}
+
+	if (triangles > 0.0) {
+		result.before.acmr = static_cast<float>(acmrBefore / triangles);
+		result.after.acmr = static_cast<float>(acmrAfter / triangles);
+		result.before.atvr = static_cast<float>(atvrBefore / vertices);
+		result.after.atvr = static_cast<float>(atvrAfter / vertices);
+	}
+}
+
+void vkglTF::Model::loadFromFile(std::string filename, vkc::VkcDevice* device, VkQueue transferQueue, uint32_t fileLoadingFlags, float scale)
+{
+	ParsedFile parsed = parseFile(filename, fileLoadingFlags);
+	loadFromParsed(parsed, device, transferQueue, fileLoadingFlags, scale);
+}
+
+void vkglTF::Model::loadFromParsed(ParsedFile& parsed, vkc::VkcDevice* device, VkQueue transferQueue, uint32_t fileLoadingFlags, float scale)
+{
+	const std::string& filename = parsed.filename;
+	tinygltf::Model& gltfModel = parsed.gltfModel;
+	const std::string& error = parsed.error;
+	const bool fileLoaded = parsed.loaded;
+
 	size_t pos = filename.find_last_of('/');
 	path = filename.substr(0, pos);
 
-	std::string error, warning;
-
 	this->device = device;
 
-#if defined(__ANDROID__)
-	// On Android all assets are packed with the apk in a compressed form, so we need to open them using the asset manager
-	// We let tinygltf handle this, by passing the asset manager of our app
-	tinygltf::asset_manager = androidApp->activity->assetManager;
-#endif
-	bool fileLoaded = gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, filename);
-
+	// Geometry is written straight into upload staging memory. Vertices that get transformed on
+	// the CPU go through arrays first, as staging memory is slow to read back.
+	const bool cpuTransform = fileLoadingFlags & (FileLoadingFlags::PreTransformVertices | FileLoadingFlags::PreMultiplyVertexColors | FileLoadingFlags::FlipY);
+	// Likewise for vertices that get packed and indices narrowed to 16 bit
+	bool verticesOnCpu = cpuTransform;
+	bool indicesOnCpu = false;
 	std::vector<uint32_t> indexBuffer;
 	std::vector<Vertex> vertexBuffer;
+	vkc::VkcUploadBatcher::Staging geometryStaging{};
+	VkDeviceSize indexStagingOffset = 0;
+	GeometryTarget geometry;
 
 	if (fileLoaded) {
+		binaryChunk = parsed.binaryChunk;
+		geometryOrder = &parsed.geometryOrder;
 		if (!(fileLoadingFlags & FileLoadingFlags::DontLoadImages)) {
-			loadImages(gltfModel, device, transferQueue);
+			loadImages(gltfModel, device, transferQueue, parsed.cookedTextures);
 		}
 		loadMaterials(gltfModel);
 		const tinygltf::Scene& scene = gltfModel.scenes[gltfModel.defaultScene > -1 ? gltfModel.defaultScene : 0];
-		for (size_t i = 0; i < scene.nodes.size(); i++) {
-			const tinygltf::Node node = gltfModel.nodes[scene.nodes[i]];
-			loadNode(nullptr, node, scene.nodes[i], gltfModel, indexBuffer, vertexBuffer, scale);
+
+		size_t vertexTotal = 0;
+		size_t indexTotal = 0;
+		std::vector<SceneNode> sceneNodes;
+		for (int nodeIndex : scene.nodes) {
+			countNodeGeometry(gltfModel, gltfModel.nodes[nodeIndex], &parsed.geometryOrder, vertexTotal, indexTotal);
+			collectSceneNodes(gltfModel, nodeIndex, -1, sceneNodes);
+		}
+		// Joints and weights have no packed form
+		packedVertices = (fileLoadingFlags & FileLoadingFlags::PackVertices) && gltfModel.skins.empty();
+		verticesOnCpu = cpuTransform || packedVertices;
+		vertexStride = packedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
+		if (vkc::packing::fitsUint16Indices(static_cast<uint32_t>(vertexTotal))) {
+			indicesOnCpu = true;
+			indexType = VK_INDEX_TYPE_UINT16;
+		}
+
+		// Reserve the arena range first: growing the arena waits for the upload batcher,
+		// which would recycle staging memory handed out below
+		if (vertexTotal > 0 && indexTotal > 0) {
+			geometryHandle = device->geometryArena().allocate(vertexStride,
+				static_cast<uint32_t>(vertexTotal), static_cast<uint32_t>(indexTotal), indexType);
+		}
+
+		// One staging allocation for whatever is written directly, the batcher only
+		// guarantees the most recent one until its copy is recorded
+		indexStagingOffset = verticesOnCpu ? 0 : vertexTotal * sizeof(Vertex);
+		const VkDeviceSize stagingSize = indexStagingOffset + (indicesOnCpu ? 0 : indexTotal * sizeof(uint32_t));
+		if (stagingSize > 0) {
+			geometryStaging = device->uploadBatcher().allocate(stagingSize);
+		}
+		if (verticesOnCpu) {
+			vertexBuffer.resize(vertexTotal);
+			geometry.vertices = vertexBuffer.data();
+		}
+		else {
+			geometry.vertices = static_cast<Vertex*>(geometryStaging.mapped);
+		}
+		if (indicesOnCpu) {
+			indexBuffer.resize(indexTotal);
+			geometry.indices = indexBuffer.data();
+		}
+		else {
+			geometry.indices = reinterpret_cast<uint32_t*>(static_cast<unsigned char*>(geometryStaging.mapped) + indexStagingOffset);
 		}
+
+		// Size the arena for the flat node, mesh and primitive arrays and what they point to,
+		// so a model is normally one block
+		size_t meshTotal = 0;
+		size_t primitiveTotal = 0;
+		size_t arenaBytes = gltfModel.nodes.size() * sizeof(int32_t);
+		for (const SceneNode& sceneNode : sceneNodes) {
+			const tinygltf::Node& node = gltfModel.nodes[sceneNode.node];
+			arenaBytes += sizeof(Node) + node.name.size() + 1;
+			if (node.mesh < 0) {
+				continue;
+			}
+			const tinygltf::Mesh& mesh = gltfModel.meshes[node.mesh];
+			meshTotal++;
+			arenaBytes += sizeof(Mesh) + mesh.name.size() + 1;
+			for (size_t p = 0; p < mesh.primitives.size(); p++) {
+				if (mesh.primitives[p].indices < 0) {
+					continue;
+				}
+				primitiveTotal++;
+				const PrimitiveOrder* order = findPrimitiveOrder(&parsed.geometryOrder, gltfModel, node.mesh, p);
+				arenaBytes += sizeof(Primitive) + (order ? order->lods.size() : 1) * sizeof(vkc::meshopt::Lod) + alignof(vkc::meshopt::Lod);
+			}
+		}
+		for (const tinygltf::Skin& skin : gltfModel.skins) {
+			arenaBytes += sizeof(Skin) + skin.name.size() + 1 + skin.joints.size() * sizeof(uint32_t) + 2 * alignof(glm::mat4);
+			if (skin.inverseBindMatrices > -1) {
+				arenaBytes += gltfModel.accessors[skin.inverseBindMatrices].count * sizeof(glm::mat4);
+			}
+		}
+		storage.reserve(arenaBytes + 4 * alignof(glm::mat4));
+
+		nodes = storage.allocate<Node>(sceneNodes.size());
+		meshes = storage.allocate<Mesh>(meshTotal);
+		primitives = storage.allocate<Primitive>(primitiveTotal);
+		nodeLookup = storage.allocate<int32_t>(gltfModel.nodes.size());
+		std::fill(nodeLookup.begin(), nodeLookup.end(), -1);
+
+		Mesh* nextMesh = meshes.data;
+		Primitive* nextPrimitive = primitives.data;
+		for (uint32_t slot = 0; slot < sceneNodes.size(); slot++) {
+			nodes[slot].parent = sceneNodes[slot].parent;
+			nodes[slot].index = static_cast<uint32_t>(sceneNodes[slot].node);
+			nodeLookup[sceneNodes[slot].node] = static_cast<int32_t>(slot);
+			loadNode(slot, gltfModel.nodes[sceneNodes[slot].node], gltfModel, geometry, nextMesh, nextPrimitive, scale);
+		}
+		// Primitives with unsupported indices were left out
+		primitives.count = static_cast<uint32_t>(nextPrimitive - primitives.data);
 		if (gltfModel.animations.size() > 0) {
 			loadAnimations(gltfModel);
 		}
 		loadSkins(gltfModel);
+		binaryChunk = nullptr;
+		geometryOrder = nullptr;
 
-		for (auto node : linearNodes) {
-			// Assign skins
-			if (node->skinIndex > -1) {
-				node->skin = skins[node->skinIndex];
-			}
-			// Initial pose
-			if (node->mesh) {
-				node->update();
+		// Assign skins
+		for (Node& node : nodes) {
+			if (node.skinIndex > -1 && static_cast<uint32_t>(node.skinIndex) < skins.size()) {
+				node.skin = &skins[node.skinIndex];
 			}
 		}
+		createMeshUniforms();
+		// Initial pose
+		updateNodes();
 	}
 	else {
 		vkc::tools::exitFatal("Could not load glTF file \"" + filename + "\": " + error, -1);
@@ -1165,12 +1221,12 @@ void vkglTF::Model::loadFromFile(std::string filename, vkc::VkcDevice* device, V
 		const bool preTransform = fileLoadingFlags & FileLoadingFlags::PreTransformVertices;
 		const bool preMultiplyColor = fileLoadingFlags & FileLoadingFlags::PreMultiplyVertexColors;
 		const bool flipY = fileLoadingFlags & FileLoadingFlags::FlipY;
-		for (Node* node : linearNodes) {
-			if (node->mesh) {
-				const glm::mat4 localMatrix = node->getMatrix();
-				for (Primitive* primitive : node->mesh->primitives) {
-					for (uint32_t i = 0; i < primitive->vertexCount; i++) {
-						Vertex& vertex = vertexBuffer[primitive->firstVertex + i];
+		for (const Node& node : nodes) {
+			if (node.mesh) {
+				const glm::mat4 localMatrix = node.getMatrix();
+				for (const Primitive& primitive : node.mesh->primitives) {
+					for (uint32_t i = 0; i < primitive.vertexCount; i++) {
+						Vertex& vertex = vertexBuffer[primitive.firstVertex + i];
 						// Pre-transform vertex positions by node-hierarchy
 						if (preTransform) {
 							vertex.pos = glm::vec3(localMatrix * glm::vec4(vertex.pos, 1.0f));
@@ -1183,7 +1239,7 @@ void vkglTF::Model::loadFromFile(std::string filename, vkc::VkcDevice* device, V
 						}
 						// Pre-Multiply vertex colors with material base color
 						if (preMultiplyColor) {
-							vertex.color = primitive->material.baseColorFactor * vertex.color;
+							vertex.color = primitive.material->baseColorFactor * vertex.color;
 						}
 					}
 				}
@@ -1198,190 +1254,125 @@ void vkglTF::Model::loadFromFile(std::string filename, vkc::VkcDevice* device, V
 		}
 	}
 
-	size_t vertexBufferSize = vertexBuffer.size() * sizeof(Vertex);
-	size_t indexBufferSize = indexBuffer.size() * sizeof(uint32_t);
-	indices.count = static_cast<uint32_t>(indexBuffer.size());
-	vertices.count = static_cast<uint32_t>(vertexBuffer.size());
+	size_t vertexBufferSize = geometry.vertexCount * sizeof(Vertex);
+	size_t indexBufferSize = geometry.indexCount * sizeof(uint32_t);
+	indices.count = static_cast<int>(geometry.indexCount);
+	vertices.count = static_cast<int>(geometry.vertexCount);
 
 	assert((vertexBufferSize > 0) && (indexBufferSize > 0));
+	assert(geometryHandle != vkc::VkcGeometryArena::INVALID_MESH);
+
+	// Copy vertex and index data into the shared geometry arena as part of the current upload batch.
+	// Copies out of geometryStaging go first, before uploadBuffer hands out more staging memory.
+	vkc::VkcGeometryArena& arena = device->geometryArena();
+	const vkc::VkcGeometryArena::MeshRange& range = arena.range(geometryHandle);
+	if (!verticesOnCpu) {
+		device->uploadBatcher().copyBuffer(geometryStaging, arena.vertexBuffer(), vertexBufferSize, range.vertexByteOffset);
+	}
+	if (!indicesOnCpu) {
+		vkc::VkcUploadBatcher::Staging indexStaging = geometryStaging;
+		indexStaging.offset += indexStagingOffset;
+		device->uploadBatcher().copyBuffer(indexStaging, arena.indexBuffer(), indexBufferSize, range.indexByteOffset);
+	}
 
-	struct StagingBuffer {
-		VkBuffer buffer;
-		VkDeviceMemory memory;
-	} vertexStaging, indexStaging;
-
-
-	// Create staging buffers
-	// Vertex data
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		vertexBufferSize,
-		&vertexStaging.buffer,
-		&vertexStaging.memory,
-		vertexBuffer.data()));
-	// Index data
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		indexBufferSize,
-		&indexStaging.buffer,
-		&indexStaging.memory,
-		indexBuffer.data()));
-
-	// Create device local buffers
-	// Vertex buffer
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		vertexBufferSize,
-		&vertices.buffer,
-		&vertices.memory));
-	// Index buffer
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		indexBufferSize,
-		&indices.buffer,
-		&indices.memory));
-
-
-	// Copy from staging buffers
-	VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-	VkBufferCopy copyRegion = {};
-
-	copyRegion.size = vertexBufferSize;
-	vkCmdCopyBuffer(copyCmd, vertexStaging.buffer, vertices.buffer, 1, &copyRegion);
-
-	copyRegion.size = indexBufferSize;
-	vkCmdCopyBuffer(copyCmd, indexStaging.buffer, indices.buffer, 1, &copyRegion);
-
-	device->flushCommandBuffer(copyCmd, transferQueue);
-
-	vkDestroyBuffer(device->logicalDevice, vertexStaging.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, vertexStaging.memory, nullptr);
-	vkDestroyBuffer(device->logicalDevice, indexStaging.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, indexStaging.memory, nullptr);
-
-	getSceneDimensions();
-
-	// Setup descriptors
-	uint32_t uboCount{ 0 };
-	uint32_t imageCount{ 0 };
-	for (auto node : linearNodes) {
-		if (node->mesh) {
-			uboCount++;
+	if (packedVertices) {
+		glm::vec3 minPos = vertexBuffer[0].pos;
+		glm::vec3 maxPos = vertexBuffer[0].pos;
+		for (const Vertex& vertex : vertexBuffer) {
+			minPos = glm::min(minPos, vertex.pos);
+			maxPos = glm::max(maxPos, vertex.pos);
 		}
-	}
-	for (auto material : materials) {
-		if (material.baseColorTexture != nullptr) {
-			imageCount++;
+		vkc::packing::PositionQuantizer quantizer;
+		quantizer.fit(minPos, maxPos);
+		positionDecode = quantizer.decodeMatrix();
+
+		std::vector<PackedVertex> packed(vertexBuffer.size());
+		for (size_t i = 0; i < vertexBuffer.size(); i++) {
+			const Vertex& vertex = vertexBuffer[i];
+			PackedVertex& out = packed[i];
+			quantizer.encode(vertex.pos, out.pos);
+			out.pos[3] = vertex.tangent.w < 0.0f ? 0 : 65535;
+			out.normal = vkc::packing::packDirection(vertex.normal);
+			out.uv = vkc::packing::packUV(vertex.uv);
+			out.color = vkc::packing::packColor(vertex.color);
+			out.tangent = vkc::packing::packDirection(glm::vec3(vertex.tangent));
 		}
+		device->uploadBatcher().uploadBuffer(packed.data(), packed.size() * sizeof(PackedVertex), arena.vertexBuffer(), range.vertexByteOffset);
+	}
+	else if (verticesOnCpu) {
+		device->uploadBatcher().uploadBuffer(vertexBuffer.data(), vertexBufferSize, arena.vertexBuffer(), range.vertexByteOffset);
 	}
-	uint32_t materialCount = 0;
-	for (auto& m : materials) {
-		if (m.baseColorTexture) ++materialCount;
+	if (indicesOnCpu) {
+		const std::vector<uint16_t> shortIndices(indexBuffer.begin(), indexBuffer.end());
+		device->uploadBatcher().uploadBuffer(shortIndices.data(), shortIndices.size() * sizeof(uint16_t), arena.indexBuffer(), range.indexByteOffset);
 	}
 
-	std::vector<VkDescriptorPoolSize> poolSizes;
+	getSceneDimensions();
 
-	if (uboCount > 0) {
-		poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uboCount });
+	// LOD summary for screen-space selection
+	size_t lodLevels = 1;
+	for (const Primitive& primitive : primitives) {
+		lodLevels = std::max<size_t>(lodLevels, primitive.lods.size());
+	}
+	lodErrors.assign(lodLevels, 0.0f);
+	lodTriangles.assign(lodLevels, 0);
+	for (const Primitive& primitive : primitives) {
+		for (size_t level = 0; level < lodLevels && !primitive.lods.empty(); level++) {
+			const vkc::meshopt::Lod& lod = primitive.lods[std::min<size_t>(level, primitive.lods.size() - 1)];
+			lodErrors[level] = std::max(lodErrors[level], lod.error);
+			lodTriangles[level] += lod.indexCount / 3;
+		}
 	}
 
-	uint32_t samplerCount = materialCount * 2;  // baseColor + normal per material
-	if (samplerCount > 0) {
-		poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, samplerCount });
+	// Setup descriptors for the mesh uniform buffers; material images go into the
+	// global bindless array instead (DescriptorManager::registerModel)
+	const uint32_t uboCount = meshes.size();
+	if (uboCount == 0) {
+		return;
 	}
 
+	std::vector<VkDescriptorPoolSize> poolSizes = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uboCount }
+	};
+
 	VkDescriptorPoolCreateInfo descriptorPoolCI{};
 	descriptorPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	descriptorPoolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
 	descriptorPoolCI.pPoolSizes = poolSizes.data();
-	descriptorPoolCI.maxSets = uboCount + materialCount;
+	descriptorPoolCI.maxSets = uboCount;
 	VK_CHECK_RESULT(vkCreateDescriptorPool(device->logicalDevice, &descriptorPoolCI, nullptr, &descriptorPool));
 
 	// Descriptors for per-node uniform buffers
 	{
-		{
-			// Layout is global, so only create if it hasn't already been created before
-			if (descriptorSetLayoutUbo == VK_NULL_HANDLE) {
-				std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
-					vkc::vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
-				};
-				VkDescriptorSetLayoutCreateInfo descriptorLayoutCI{};
-				descriptorLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-				descriptorLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
-				descriptorLayoutCI.pBindings = setLayoutBindings.data();
-				VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayoutCI, nullptr, &descriptorSetLayoutUbo));
-			}
-			for (auto node : nodes) {
-				prepareNodeDescriptor(node, descriptorSetLayoutUbo);
-			}
+		// Layout is global, so only create if it hasn't already been created before
+		if (descriptorSetLayoutUbo == VK_NULL_HANDLE) {
+			std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+				vkc::vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
+			};
+			VkDescriptorSetLayoutCreateInfo descriptorLayoutCI{};
+			descriptorLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+			descriptorLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
+			descriptorLayoutCI.pBindings = setLayoutBindings.data();
+			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayoutCI, nullptr, &descriptorSetLayoutUbo));
 		}
-
-		// Descriptors for per-material images
-		{
-			// Layout is global, so only create if it hasn't already been created before
-			if (descriptorSetLayoutImage == VK_NULL_HANDLE) {
-				// Always push exactly two bindings:
-				//  • binding 0 = base-color sampler
-				//  • binding 1 = normal-map sampler
-				std::array<VkDescriptorSetLayoutBinding, 2> setLayoutBindings = {
-					// binding 0 → base-color
-					vkc::vkinit::descriptorSetLayoutBinding(
-						VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-						VK_SHADER_STAGE_FRAGMENT_BIT,
-						/*binding=*/ 0
-					),
-						// binding 1 → normal map
-						vkc::vkinit::descriptorSetLayoutBinding(
-							VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-							VK_SHADER_STAGE_FRAGMENT_BIT,
-							/*binding=*/ 1
-						)
-				};
-				//std::array<VkDescriptorSetLayoutBinding, 4> setLayoutBindings = {
-				//	// baseColor
-				//	vkc::vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
-				//	// normal
-				//	vkc::vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
-				//	// metallic-roughness
-				//	vkc::vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
-				//	// ambient occlusion
-				//	vkc::vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3)
-				//};
-
-				VkDescriptorSetLayoutCreateInfo descriptorLayoutCI{};
-				descriptorLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-				descriptorLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
-				descriptorLayoutCI.pBindings = setLayoutBindings.data();
-				VK_CHECK_RESULT(vkCreateDescriptorSetLayout(
-					device->logicalDevice,
-					&descriptorLayoutCI,
-					nullptr,
-					&descriptorSetLayoutImage
-				));
-			}
-
-			for (auto& material : materials) {
-				if (material.baseColorTexture != nullptr) {
-					material.createDescriptorSet(descriptorPool, vkglTF::descriptorSetLayoutImage, descriptorBindingFlags, &emptyTexture);
-				}
-			}
+		for (Mesh& mesh : meshes) {
+			prepareMeshDescriptor(mesh, descriptorSetLayoutUbo);
 		}
 	}
 }
 
 
 
-void vkglTF::Model::drawNode(Node* node, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
+void vkglTF::Model::drawNode(const Node* node, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t nodeIndex, uint32_t lod, uint32_t instanceCount)
 {
 	if (node->mesh) {
-		for (Primitive* primitive : node->mesh->primitives) {
+		// Primitive indices are relative to the model's range in the geometry arena
+		const vkc::VkcGeometryArena::MeshRange& range = device->geometryArena().range(geometryHandle);
+		device->geometryArena().bindIndexType(commandBuffer, range.indexType);
+		const vkglTF::Material* boundMaterial = nullptr;
+		for (const Primitive& primitive : node->mesh->primitives) {
 			bool skip = false;
-			const vkglTF::Material& material = primitive->material;
+			const vkglTF::Material& material = *primitive.material;
 			if (renderFlags & RenderFlags::RenderOpaqueNodes) {
 				skip = (material.alphaMode != Material::ALPHAMODE_OPAQUE);
 			}
@@ -1392,62 +1383,111 @@ void vkglTF::Model::drawNode(Node* node, VkCommandBuffer commandBuffer, uint32_t
 				skip = (material.alphaMode != Material::ALPHAMODE_BLEND);
 			}
 			if (!skip) {
-				if (renderFlags & RenderFlags::BindImages) {
-					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindImageSet, 1, &material.descriptorSet, 0, nullptr);
+				// Primitives are sorted by material, so runs of them share one push
+				if ((renderFlags & RenderFlags::PushMaterials) && boundMaterial != &material) {
+					const DrawConstants constants{ nodeIndex, materialBase + material.index };
+					vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(DrawConstants), &constants);
+					boundMaterial = &material;
 				}
-				vkCmdDrawIndexed(commandBuffer, primitive->indexCount, 1, primitive->firstIndex, 0, 0);
+				uint32_t firstIndex = primitive.firstIndex;
+				uint32_t indexCount = primitive.indexCount;
+				if (!primitive.lods.empty()) {
+					const vkc::meshopt::Lod& level = primitive.lods[std::min<size_t>(lod, primitive.lods.size() - 1)];
+					firstIndex = level.firstIndex;
+					indexCount = level.indexCount;
+				}
+				vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, range.firstIndex + firstIndex, static_cast<int32_t>(range.firstVertex), 0);
 			}
 		}
 	}
-	for (auto& child : node->children) {
-		drawNode(child, commandBuffer, renderFlags, pipelineLayout, bindImageSet);
+}
+void vkglTF::Model::getPrimitiveDraw(const Primitive& primitive, uint32_t lod, vkc::IModel::IndexedDraw& draw) const
+{
+	const vkc::VkcGeometryArena::MeshRange& range = device->geometryArena().range(geometryHandle);
+	draw.firstIndex = range.firstIndex + primitive.firstIndex;
+	draw.indexCount = primitive.indexCount;
+	if (!primitive.lods.empty()) {
+		const vkc::meshopt::Lod& level = primitive.lods[std::min<size_t>(lod, primitive.lods.size() - 1)];
+		draw.firstIndex = range.firstIndex + level.firstIndex;
+		draw.indexCount = level.indexCount;
+	}
+	draw.vertexOffset = static_cast<int32_t>(range.firstVertex);
+	draw.indexType = range.indexType;
+}
+float vkglTF::Model::getLodError(uint32_t level) const
+{
+	return lodErrors[std::min<size_t>(level, lodErrors.size() - 1)];
+}
+uint64_t vkglTF::Model::getLodTriangles(uint32_t level) const
+{
+	return lodTriangles[std::min<size_t>(level, lodTriangles.size() - 1)];
+}
+vkc::IModel::MemoryUsage vkglTF::Model::getMemoryUsage() const
+{
+	MemoryUsage usage;
+	const VkDeviceSize indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	usage.geometryBytes = static_cast<VkDeviceSize>(vertices.count) * vertexStride
+		+ static_cast<VkDeviceSize>(indices.count) * indexSize;
+	usage.unpackedGeometryBytes = static_cast<VkDeviceSize>(vertices.count) * sizeof(Vertex)
+		+ static_cast<VkDeviceSize>(indices.count) * sizeof(uint32_t);
+	usage.imageBytes = emptyTexture.deviceMemorySize;
+	for (const auto& texture : textures) {
+		usage.imageBytes += texture.deviceMemorySize;
 	}
+	return usage;
 }
 void vkglTF::Model::bind(VkCommandBuffer commandBuffer)
 {
-	const VkDeviceSize offsets[1] = { 0 };
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
-	vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+	device->geometryArena().bind(commandBuffer);
 	buffersBound = true;
 }
-void vkglTF::Model::draw(VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
+void vkglTF::Model::draw(VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout)
 {
 	if (!buffersBound) {
-		const VkDeviceSize offsets[1] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
-		vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		device->geometryArena().bind(commandBuffer);
 	}
-	for (auto& node : nodes) {
-		drawNode(node, commandBuffer, renderFlags, pipelineLayout, bindImageSet);
+	for (const Node& node : nodes) {
+		drawNode(&node, commandBuffer, renderFlags, pipelineLayout);
 	}
 }
 
 
-void vkglTF::Model::getNodeDimensions(Node* node, glm::vec3& min, glm::vec3& max)
+void vkglTF::Model::getNodeDimensions(const Node* node, glm::vec3& min, glm::vec3& max)
 {
 	if (node->mesh) {
-		for (Primitive* primitive : node->mesh->primitives) {
-			glm::vec4 locMin = glm::vec4(primitive->dimensions.min, 1.0f) * node->getMatrix();
-			glm::vec4 locMax = glm::vec4(primitive->dimensions.max, 1.0f) * node->getMatrix();
-			if (locMin.x < min.x) { min.x = locMin.x; }
-			if (locMin.y < min.y) { min.y = locMin.y; }
-			if (locMin.z < min.z) { min.z = locMin.z; }
-			if (locMax.x > max.x) { max.x = locMax.x; }
-			if (locMax.y > max.y) { max.y = locMax.y; }
-			if (locMax.z > max.z) { max.z = locMax.z; }
+		for (const Primitive& primitive : node->mesh->primitives) {
+			// All eight corners, as rotations can swap which one ends up outermost
+			for (uint32_t corner = 0; corner < 8; corner++) {
+				const glm::vec3 local(
+					(corner & 1) ? primitive.dimensions.max.x : primitive.dimensions.min.x,
+					(corner & 2) ? primitive.dimensions.max.y : primitive.dimensions.min.y,
+					(corner & 4) ? primitive.dimensions.max.z : primitive.dimensions.min.z);
+				const glm::vec3 world = glm::vec3(node->getMatrix() * glm::vec4(local, 1.0f));
+				min = glm::min(min, world);
+				max = glm::max(max, world);
+			}
 		}
 	}
-	for (auto child : node->children) {
-		getNodeDimensions(child, min, max);
-	}
 }
 
 void vkglTF::Model::getSceneDimensions()
 {
+	for (Mesh& mesh : meshes) {
+		glm::vec3 meshMin(FLT_MAX);
+		glm::vec3 meshMax(-FLT_MAX);
+		for (const Primitive& primitive : mesh.primitives) {
+			meshMin = glm::min(meshMin, primitive.dimensions.min);
+			meshMax = glm::max(meshMax, primitive.dimensions.max);
+		}
+		mesh.boundingSphere = mesh.primitives.empty()
+			? glm::vec4(0.f)
+			: glm::vec4((meshMin + meshMax) / 2.0f, glm::distance(meshMin, meshMax) / 2.0f);
+	}
+
 	dimensions.min = glm::vec3(FLT_MAX);
 	dimensions.max = glm::vec3(-FLT_MAX);
-	for (auto node : nodes) {
-		getNodeDimensions(node, dimensions.min, dimensions.max);
+	for (const Node& node : nodes) {
+		getNodeDimensions(&node, dimensions.min, dimensions.max);
 	}
 	dimensions.size = dimensions.max - dimensions.min;
 	dimensions.center = (dimensions.min + dimensions.max) / 2.0f;
@@ -1480,13 +1520,11 @@ void vkglTF::Model::loadAnimations(tinygltf::Model& gltfModel)
 			// Read sampler input time values
 			{
 				const tinygltf::Accessor& accessor = gltfModel.accessors[samp.input];
-				const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
 
 				assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
 
 				float* buf = new float[accessor.count];
-				memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(float));
+				memcpy(buf, accessorData(gltfModel, accessor), accessor.count * sizeof(float));
 				for (size_t index = 0; index < accessor.count; index++) {
 					sampler.inputs.push_back(buf[index]);
 				}
@@ -1504,15 +1542,13 @@ void vkglTF::Model::loadAnimations(tinygltf::Model& gltfModel)
 			// Read sampler output T/R/S values 
 			{
 				const tinygltf::Accessor& accessor = gltfModel.accessors[samp.output];
-				const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
 
 				assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
 
 				switch (accessor.type) {
 				case TINYGLTF_TYPE_VEC3: {
 					glm::vec3* buf = new glm::vec3[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::vec3));
+					memcpy(buf, accessorData(gltfModel, accessor), accessor.count * sizeof(glm::vec3));
 					for (size_t index = 0; index < accessor.count; index++) {
 						sampler.outputsVec4.push_back(glm::vec4(buf[index], 0.0f));
 					}
@@ -1521,7 +1557,7 @@ void vkglTF::Model::loadAnimations(tinygltf::Model& gltfModel)
 				}
 				case TINYGLTF_TYPE_VEC4: {
 					glm::vec4* buf = new glm::vec4[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::vec4));
+					memcpy(buf, accessorData(gltfModel, accessor), accessor.count * sizeof(glm::vec4));
 					for (size_t index = 0; index < accessor.count; index++) {
 						sampler.outputsVec4.push_back(buf[index]);
 					}
@@ -1619,60 +1655,67 @@ void vkglTF::Model::updateAnimation(uint32_t index, float time)
 		}
 	}
 	if (updated) {
-		for (auto& node : nodes) {
-			node->update();
-		}
+		updateNodes();
 	}
 }
 
-/*
-	Helper functions
-*/
-vkglTF::Node* vkglTF::Model::findNode(Node* parent, uint32_t index) {
-	Node* nodeFound = nullptr;
-	if (parent->index == index) {
-		return parent;
-	}
-	for (auto& child : parent->children) {
-		nodeFound = findNode(child, index);
-		if (nodeFound) {
-			break;
+void vkglTF::Model::updateNodes()
+{
+	// Parents come first, so their world matrix is always ready
+	for (Node& node : nodes) {
+		const glm::mat4 local = node.localMatrix();
+		node.worldMatrix = node.parent < 0 ? local : nodes[node.parent].worldMatrix * local;
+	}
+	for (Node& node : nodes) {
+		if (!node.mesh || !node.mesh->uniformBuffer.mapped) {
+			continue;
+		}
+		Mesh& mesh = *node.mesh;
+		if (node.skin) {
+			const Skin& skin = *node.skin;
+			mesh.uniformBlock.matrix = node.worldMatrix;
+			// Update joint matrices
+			const glm::mat4 inverseTransform = glm::inverse(node.worldMatrix);
+			const size_t jointCount = std::min<size_t>(skin.joints.size(), 64);
+			for (size_t i = 0; i < jointCount; i++) {
+				const glm::mat4 inverseBind = i < skin.inverseBindMatrices.size() ? skin.inverseBindMatrices[i] : glm::mat4(1.0f);
+				mesh.uniformBlock.jointMatrix[i] = inverseTransform * nodes[skin.joints[i]].worldMatrix * inverseBind;
+			}
+			mesh.uniformBlock.jointcount = (float)jointCount;
+			memcpy(mesh.uniformBuffer.mapped, &mesh.uniformBlock, sizeof(mesh.uniformBlock));
+		}
+		else {
+			mesh.uniformBlock.matrix = node.worldMatrix;
+			memcpy(mesh.uniformBuffer.mapped, &node.worldMatrix, sizeof(glm::mat4));
 		}
 	}
-	return nodeFound;
 }
 
+/*
+	Helper functions
+*/
 vkglTF::Node* vkglTF::Model::nodeFromIndex(uint32_t index) {
-	Node* nodeFound = nullptr;
-	for (auto& node : nodes) {
-		nodeFound = findNode(node, index);
-		if (nodeFound) {
-			break;
-		}
+	if (index >= nodeLookup.size() || nodeLookup[index] < 0) {
+		return nullptr;
 	}
-	return nodeFound;
+	return &nodes[nodeLookup[index]];
 }
 
-void vkglTF::Model::prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLayout descriptorSetLayout) {
-	if (node->mesh) {
-		VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
-		descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		descriptorSetAllocInfo.descriptorPool = descriptorPool;
-		descriptorSetAllocInfo.pSetLayouts = &descriptorSetLayout;
-		descriptorSetAllocInfo.descriptorSetCount = 1;
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &descriptorSetAllocInfo, &node->mesh->uniformBuffer.descriptorSet));
-
-		VkWriteDescriptorSet writeDescriptorSet{};
-		writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		writeDescriptorSet.descriptorCount = 1;
-		writeDescriptorSet.dstSet = node->mesh->uniformBuffer.descriptorSet;
-		writeDescriptorSet.dstBinding = 0;
-		writeDescriptorSet.pBufferInfo = &node->mesh->uniformBuffer.descriptor;
-
-		vkUpdateDescriptorSets(device->logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
-	}
-	for (auto& child : node->children) {
-		prepareNodeDescriptor(child, descriptorSetLayout);
-	}
+void vkglTF::Model::prepareMeshDescriptor(vkglTF::Mesh& mesh, VkDescriptorSetLayout descriptorSetLayout) {
+	VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
+	descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	descriptorSetAllocInfo.descriptorPool = descriptorPool;
+	descriptorSetAllocInfo.pSetLayouts = &descriptorSetLayout;
+	descriptorSetAllocInfo.descriptorSetCount = 1;
+	VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &descriptorSetAllocInfo, &mesh.uniformBuffer.descriptorSet));
+
+	VkWriteDescriptorSet writeDescriptorSet{};
+	writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	writeDescriptorSet.descriptorCount = 1;
+	writeDescriptorSet.dstSet = mesh.uniformBuffer.descriptorSet;
+	writeDescriptorSet.dstBinding = 0;
+	writeDescriptorSet.pBufferInfo = &mesh.uniformBuffer.descriptor;
+
+	vkUpdateDescriptorSets(device->logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
 }
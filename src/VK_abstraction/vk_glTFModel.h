@@ -9,7 +9,13 @@
 
 #include "vulkan/vulkan.h"
 #include "VK_abstraction/vk_device.h"
+#include "VK_abstraction/vk_geometryArena.h"
 #include "VK_abstraction/vk_IModel.hpp"
+#include "Utils/vkc_linearArena.h"
+#include "Utils/vkc_mappedFile.h"
+#include "Utils/vkc_meshOptimizer.h"
+#include "Utils/vkc_meshSimplifier.h"
+#include "Utils/vkc_textureCache.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -26,16 +32,8 @@
 
 namespace vkglTF
 {
-	enum DescriptorBindingFlags {
-		ImageBaseColor = 0x00000001,
-		ImageNormalMap = 0x00000002
-	};
-
-	extern VkDescriptorSetLayout descriptorSetLayoutImage;
 	extern VkDescriptorSetLayout descriptorSetLayoutUbo;
-	extern VkDescriptorSetLayout descriptorSetLayoutIbl;
 	extern VkMemoryPropertyFlags memoryPropertyFlags;
-	extern uint32_t descriptorBindingFlags;
 
 	struct Node;
 
@@ -47,7 +45,8 @@ namespace vkglTF
 		vkc::VkcDevice* device = nullptr;
 		VkImage image;
 		VkImageLayout imageLayout;
-		VkDeviceMemory deviceMemory;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+		VkDeviceSize deviceMemorySize = 0;
 		VkImageView view;
 		uint32_t width, height;
 		uint32_t mipLevels;
@@ -55,14 +54,19 @@ namespace vkglTF
 		VkDescriptorImageInfo descriptor;
 		VkSampler sampler;
 		uint32_t index;
+		// In the global bindless texture array, once the model is registered with it
+		uint32_t bindlessSlot = ~0u;
 		void updateDescriptor();
 		void destroy();
-		void fromglTfImage(tinygltf::Image& gltfimage, std::string path, vkc::VkcDevice* device, VkQueue copyQueue, bool isSrgb);
+		// ktxFilename overrides the image source, e.g. with a cooked texture
+		void fromglTfImage(tinygltf::Image& gltfimage, std::string path, vkc::VkcDevice* device, VkQueue copyQueue, bool isSrgb, const std::string& ktxFilename = "");
 	};
 
 
 	/*
-		glTF material class
+		glTF material class. Textures are sampled through the global bindless
+		array; the parameters live in the material buffer at
+		Model::materialBase + index.
 	*/
 	struct Material {
 		vkc::VkcDevice* device = nullptr;
@@ -72,6 +76,8 @@ namespace vkglTF
 		float metallicFactor = 1.0f;
 		float roughnessFactor = 1.0f;
 		glm::vec4 baseColorFactor = glm::vec4(1.0f);
+		glm::vec3 emissiveFactor = glm::vec3(0.0f);
+		uint32_t index = 0;		// in Model::materials
 		vkglTF::Texture* baseColorTexture = nullptr;
 		vkglTF::Texture* metallicRoughnessTexture = nullptr;
 		vkglTF::Texture* normalTexture = nullptr;
@@ -81,21 +87,20 @@ namespace vkglTF
 		vkglTF::Texture* specularGlossinessTexture;
 		vkglTF::Texture* diffuseTexture;
 
-		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-
 		Material(vkc::VkcDevice* device) : device(device) {};
-		void createDescriptorSet(VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags, vkglTF::Texture* fallbackTexture);
 	};
 
 	/*
 		glTF primitive
 	*/
 	struct Primitive {
-		uint32_t firstIndex;
-		uint32_t indexCount;
-		uint32_t firstVertex;
-		uint32_t vertexCount;
-		Material& material;
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		uint32_t firstVertex = 0;
+		uint32_t vertexCount = 0;
+		Material* material = nullptr;
+		// Level 0 is firstIndex/indexCount; coarser levels index the same vertices
+		vkc::Span<vkc::meshopt::Lod> lods;
 
 		struct Dimensions {
 			glm::vec3 min = glm::vec3(FLT_MAX);
@@ -106,24 +111,24 @@ namespace vkglTF
 		} dimensions;
 
 		void setDimensions(glm::vec3 min, glm::vec3 max);
-		Primitive(uint32_t firstIndex, uint32_t indexCount, Material& material) : firstIndex(firstIndex), indexCount(indexCount), material(material) {};
 	};
 
 	/*
 		glTF mesh
 	*/
 	struct Mesh {
-		vkc::VkcDevice* device;
-
-		std::vector<Primitive*> primitives;
-		std::string name;
-
+		// Sorted by material, so consecutive draws mostly share their push constants
+		vkc::Span<Primitive> primitives;
+		const char* name = "";
+		// Around all primitives, in the space of the node that draws the mesh: xyz
+		// centre, w radius. Set by Model::getSceneDimensions.
+		glm::vec4 boundingSphere{ 0.f };
+
+		// A slice of the model's mesh uniform buffer
 		struct UniformBuffer {
-			VkBuffer buffer;
-			VkDeviceMemory memory;
-			VkDescriptorBufferInfo descriptor;
+			VkDescriptorBufferInfo descriptor{};
 			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-			void* mapped;
+			void* mapped = nullptr;
 		} uniformBuffer;
 
 		struct UniformBlock {
@@ -131,40 +136,37 @@ namespace vkglTF
 			glm::mat4 jointMatrix[64]{};
 			float jointcount{ 0 };
 		} uniformBlock;
-
-		Mesh(vkc::VkcDevice* device, glm::mat4 matrix);
-		~Mesh();
 	};
 
 	/*
 		glTF skin
 	*/
 	struct Skin {
-		std::string name;
-		Node* skeletonRoot = nullptr;
-		std::vector<glm::mat4> inverseBindMatrices;
-		std::vector<Node*> joints;
+		const char* name = "";
+		int32_t skeletonRoot = -1;					// into Model::nodes
+		vkc::Span<glm::mat4> inverseBindMatrices;
+		vkc::Span<uint32_t> joints;					// into Model::nodes
 	};
 
 	/*
-		glTF node
+		glTF node. Nodes are stored in Model::nodes with parents before their
+		children, so hierarchies are resolved by one scan in array order.
 	*/
 	struct Node {
-		Node* parent;
-		uint32_t index;
-		std::vector<Node*> children;
-		glm::mat4 matrix;
-		std::string name;
-		Mesh* mesh;
-		Skin* skin;
+		int32_t parent = -1;		// into Model::nodes, always before this node
+		uint32_t index = 0;			// in the glTF file
+		glm::mat4 matrix{ 1.0f };
+		const char* name = "";
+		Mesh* mesh = nullptr;
+		Skin* skin = nullptr;
 		int32_t skinIndex = -1;
 		glm::vec3 translation{};
 		glm::vec3 scale{ 1.0f };
 		glm::quat rotation{};
-		glm::mat4 localMatrix();
-		glm::mat4 getMatrix();
-		void update();
-		~Node();
+		// Model space, written by Model::updateNodes
+		glm::mat4 worldMatrix{ 1.0f };
+		glm::mat4 localMatrix() const;
+		const glm::mat4& getMatrix() const { return worldMatrix; }
 	};
 
 	/*
@@ -221,21 +223,60 @@ namespace vkglTF
 		static VkPipelineVertexInputStateCreateInfo* getPipelineVertexInputState(const std::vector<VertexComponent> components);
 	};
 
+	/*
+		Packed layout for static meshes (FileLoadingFlags::PackVertices), 24 bytes:
+		position as UNORM16 within the model bounds, octahedral normal and tangent,
+		half-float UV and UNORM8 colour. Decoded by glTFvert_packed.vert.
+	*/
+	struct PackedVertex {
+		uint16_t pos[4];	// w: tangent handedness, 0 = -1, 65535 = +1
+		uint32_t normal;
+		uint32_t uv;
+		uint32_t color;
+		uint32_t tangent;
+	};
+
+	/*
+		Vertex and index order of one mesh primitive after Model::optimizeGeometry
+	*/
+	struct PrimitiveOrder {
+		std::vector<uint32_t> vertexOrder;	// new -> old vertex of the primitive's accessors
+		std::vector<uint32_t> indices;		// every level, relative to the primitive's first vertex
+		std::vector<vkc::meshopt::Lod> lods;	// ranges of indices, level 0 first
+	};
+
+	struct GeometryOrder {
+		std::vector<std::vector<PrimitiveOrder>> meshes;	// [mesh][primitive]; empty entries load as authored
+		vkc::meshopt::CacheStats before;
+		vkc::meshopt::CacheStats after;
+	};
+
 	enum FileLoadingFlags {
 		None = 0x00000000,
 		PreTransformVertices = 0x00000001,
 		PreMultiplyVertexColors = 0x00000002,
 		FlipY = 0x00000004,
-		DontLoadImages = 0x00000008
+		DontLoadImages = 0x00000008,
+		// Upload PackedVertex instead of Vertex; ignored for skinned models
+		PackVertices = 0x00000010
 	};
 
 	enum RenderFlags {
-		BindImages = 0x00000001,
+		PushMaterials = 0x00000001,
 		RenderOpaqueNodes = 0x00000002,
 		RenderAlphaMaskedNodes = 0x00000004,
 		RenderAlphaBlendedNodes = 0x00000008
 	};
 
+	/*
+		Push constants of the glTF pipelines: the node's first entry in the per-frame
+		node buffer (instances follow it) and the primitive's entry in the material buffer
+	*/
+	struct DrawConstants {
+		uint32_t nodeIndex;
+		uint32_t materialIndex;
+	};
+
 	/*
 		glTF model loading and rendering class
 	*/
@@ -244,28 +285,49 @@ namespace vkglTF
 		vkglTF::Texture* getTexture(uint32_t index);
 		vkglTF::Texture emptyTexture;
 		void createEmptyTexture(VkQueue transferQueue);
+
+		// BIN chunk of the .glb being loaded; only set during loadFromParsed
+		const unsigned char* binaryChunk = nullptr;
+		// Optimized order of the file being loaded; only set during loadFromParsed
+		const GeometryOrder* geometryOrder = nullptr;
+		const unsigned char* accessorData(const tinygltf::Model& model, const tinygltf::Accessor& accessor) const;
 	public:
-		vkc::VkcDevice* device;
-		VkDescriptorPool descriptorPool;
+		vkc::VkcDevice* device = nullptr;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
 		
 		struct Vertices {
 			int count;
-			VkBuffer buffer;
-			VkDeviceMemory memory;
 		} vertices;
 		struct Indices {
 			int count;
-			VkBuffer buffer;
-			VkDeviceMemory memory;
 		} indices;
-
-		std::vector<Node*> nodes;
-		std::vector<Node*> linearNodes;
-
-		std::vector<Skin*> skins;
+		// Vertices and indices live in device->geometryArena(). Indices are 16 bit
+		// when the model has at most 65536 vertices.
+		uint32_t geometryHandle = vkc::VkcGeometryArena::INVALID_MESH;
+		uint32_t vertexStride = sizeof(Vertex);
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		bool packedVertices = false;
+		glm::mat4 positionDecode = glm::mat4(1.0f);
+		// Per level, over every mesh node: the largest primitive error and the triangle total
+		std::vector<float> lodErrors{ 0.0f };
+		std::vector<uint64_t> lodTriangles{ 0 };
+
+		// Nodes, meshes, primitives, skins and everything they point to live in
+		// storage and are released with it
+		vkc::LinearArena storage;
+		vkc::Span<Node> nodes;			// parents first
+		vkc::Span<Mesh> meshes;
+		vkc::Span<Primitive> primitives;	// grouped by mesh
+		vkc::Span<Skin> skins;
+		vkc::Span<int32_t> nodeLookup;		// glTF node index -> nodes, -1 if not in the scene
+		// Every mesh's UniformBlock, one aligned slice each
+		VkBuffer meshUniformBuffer = VK_NULL_HANDLE;
+		VmaAllocation meshUniformAllocation = VK_NULL_HANDLE;
 
 		std::vector<Texture> textures;
 		std::vector<Material> materials;
+		// First entry of the material buffer, set by DescriptorManager::registerModel
+		uint32_t materialBase = ~0u;
 		std::vector<Animation> animations;
 
 		struct Dimensions {
@@ -282,32 +344,81 @@ namespace vkglTF
 
 		Model() {};
 		~Model();
-		void loadNode(vkglTF::Node* parent, const tinygltf::Node& node, uint32_t nodeIndex, const tinygltf::Model& model, std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer, float globalscale);
+		// Where loadNode writes vertices and indices: upload staging memory, or CPU
+		// arrays when the vertices are transformed before upload. Sized up front.
+		struct GeometryTarget {
+			Vertex* vertices = nullptr;
+			uint32_t* indices = nullptr;
+			uint32_t vertexCount = 0;
+			uint32_t indexCount = 0;
+		};
+		// Fills nodes[slot] and, if it has one, the next mesh and its primitives
+		void loadNode(uint32_t slot, const tinygltf::Node& node, const tinygltf::Model& model, GeometryTarget& geometry, Mesh*& nextMesh, Primitive*& nextPrimitive, float globalscale);
 		void loadSkins(tinygltf::Model& gltfModel);
-		void loadImages(tinygltf::Model& gltfModel, vkc::VkcDevice* device, VkQueue transferQueue);
+		void createMeshUniforms();
+		void loadImages(tinygltf::Model& gltfModel, vkc::VkcDevice* device, VkQueue transferQueue, const vkc::TextureCache* cookedTextures = nullptr);
 		void loadMaterials(tinygltf::Model& gltfModel);
 		void loadAnimations(tinygltf::Model& gltfModel);
 		
+		// Result of the CPU half of loading: the parsed glTF document with all
+		// non-KTX images already decoded. parseFile touches no Vulkan state, so it
+		// may run on a worker thread; loadFromParsed does the GPU work.
+		// Binary (.glb) files stay mapped and their embedded buffer is read from
+		// the mapping instead of a heap copy. With cookedTextures set, images that
+		// have an up to date cooked KTX are not decoded and load from that instead.
+		struct ParsedFile {
+			std::string filename;
+			tinygltf::Model gltfModel;
+			std::string error, warning;
+			bool loaded = false;
+			vkc::MappedFile mapping;
+			const unsigned char* binaryChunk = nullptr;
+			const vkc::TextureCache* cookedTextures = nullptr;
+			// Filled by optimizeGeometry() or from a cache; loadNode writes vertices and indices in this order
+			GeometryOrder geometryOrder;
+		};
+		static ParsedFile parseFile(const std::string& filename, uint32_t fileLoadingFlags = vkglTF::FileLoadingFlags::None, const vkc::TextureCache* cookedTextures = nullptr);
+		// Reorders every triangle primitive for the vertex cache, overdraw and vertex
+		// fetch (see vkc::meshopt) and stores the result in parsed.geometryOrder.
+		// CPU only; deterministic, so the result may be cached per source file.
+		static void optimizeGeometry(ParsedFile& parsed);
+		void loadFromParsed(ParsedFile& parsed, vkc::VkcDevice* device, VkQueue transferQueue, uint32_t fileLoadingFlags = vkglTF::FileLoadingFlags::None, float scale = 1.0f);
+
 		void loadFromFile(std::string filename, vkc::VkcDevice* device, VkQueue transferQueue, uint32_t fileLoadingFlags = vkglTF::FileLoadingFlags::None, float scale = 1.0f);
 
 		void bind(VkCommandBuffer commandBuffer)override;
 		void draw(VkCommandBuffer commandBuffer)override {}
+		MemoryUsage getMemoryUsage() const override;
+		bool hasPackedVertices() const override { return packedVertices; }
+		glm::mat4 getPositionDecode() const override { return positionDecode; }
+		uint32_t getLodCount() const override { return static_cast<uint32_t>(lodErrors.size()); }
+		float getLodError(uint32_t level) const override;
+		uint64_t getLodTriangles(uint32_t level) const override;
+		glm::vec4 getBoundingSphere() const override { return glm::vec4(dimensions.center, dimensions.radius); }
+		Bounds getBounds() const override { return { dimensions.min, dimensions.max }; }
 
 		void draw(
 			VkCommandBuffer commandBuffer,
 			uint32_t renderFlags = 0,
-			VkPipelineLayout pipelineLayout = VK_NULL_HANDLE,
-			uint32_t bindImageSet = 1
+			VkPipelineLayout pipelineLayout = VK_NULL_HANDLE
 		);
 
-		void drawNode(Node* node, VkCommandBuffer commandBuffer, uint32_t renderFlags = 0, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t bindImageSet = 1);
+		// Draws the node's own primitives, not its children. lod is clamped per primitive.
+		// With RenderFlags::PushMaterials, pushes DrawConstants{ nodeIndex, material } at
+		// offset 0 of pipelineLayout whenever the material changes. Each primitive is
+		// drawn instanceCount times, starting at instance 0.
+		void drawNode(const Node* node, VkCommandBuffer commandBuffer, uint32_t renderFlags = 0, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t nodeIndex = 0, uint32_t lod = 0, uint32_t instanceCount = 1);
+		// What drawNode() records for one of the model's primitives at lod (clamped)
+		void getPrimitiveDraw(const Primitive& primitive, uint32_t lod, vkc::IModel::IndexedDraw& draw) const;
 
 		
-		void getNodeDimensions(Node* node, glm::vec3& min, glm::vec3& max);
+		void getNodeDimensions(const Node* node, glm::vec3& min, glm::vec3& max);
 		void getSceneDimensions();
 		void updateAnimation(uint32_t index, float time);
-		Node* findNode(Node* parent, uint32_t index);
+		// World matrices, then mesh uniform blocks and joint matrices, in one pass each
+		void updateNodes();
+		// By glTF node index; nullptr if the node is not part of the loaded scene
 		Node* nodeFromIndex(uint32_t index);
-		void prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLayout descriptorSetLayout);
+		void prepareMeshDescriptor(vkglTF::Mesh& mesh, VkDescriptorSetLayout descriptorSetLayout);
 	};
 }
\ No newline at end of file
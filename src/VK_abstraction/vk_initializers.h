@@ -99,6 +99,28 @@ namespace vkc
             return commandBufferAllocateInfo;
         }
 
+        inline VkCommandPoolCreateInfo commandPoolCreateInfo()
+        {
+            VkCommandPoolCreateInfo cmdPoolCreateInfo{};
+            cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            return cmdPoolCreateInfo;
+        }
+
+        inline VkFenceCreateInfo fenceCreateInfo(VkFenceCreateFlags flags = 0)
+        {
+            VkFenceCreateInfo fenceCreateInfo{};
+            fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            fenceCreateInfo.flags = flags;
+            return fenceCreateInfo;
+        }
+
+        inline VkSubmitInfo submitInfo()
+        {
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            return submitInfo;
+        }
+
         inline VkImageCreateInfo imageCreateInfo()
         {
             VkImageCreateInfo imageCreateInfo{};
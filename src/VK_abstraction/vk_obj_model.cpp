@@ -2,7 +2,12 @@
 
 // Project headers
 #include "vk_obj_model.h"
+#include "vk_geometryArena.h"
+#include "vk_uploadBatcher.h"
+#include "Utils/vkc_meshOptimizer.h"
+#include "Utils/vkc_meshSimplifier.h"
 #include "Utils/vkc_utils.h"
+#include "Utils/vkc_vertexPacking.h"
 
 
 // External
@@ -19,8 +24,12 @@
 #include <glm/gtc/type_ptr.hpp>
 
 // STD
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
+#include <iomanip>
+#include <iostream>
 #include <stdexcept>
 #include <unordered_map>
 #include <unordered_set>
@@ -41,135 +50,215 @@ namespace std
 
 namespace vkc
 {
-    VkcOBJmodel::VkcOBJmodel(VkcDevice& device, const Builder& builder)
+    VkcOBJmodel::VkcOBJmodel(VkcDevice& device, const Builder& builder, bool packVertices)
         : vkcDevice{ device }, isSkyboxModel{ builder.isSkybox } {
 
         if (builder.isSkybox) {
-            createVertexBuffers(builder.skyboxVertices); 
+            createGeometry(builder.skyboxVertices.data(), sizeof(SkyboxVertex), static_cast<uint32_t>(builder.skyboxVertices.size()), nullptr, 0, false);
         }
         else {
-            createVertexBuffers(builder.vertices);
-            createIndexBuffers(builder.indices);
+            createGeometry(builder.vertices.data(), sizeof(Vertex), static_cast<uint32_t>(builder.vertices.size()),
+                builder.indices.data(), static_cast<uint32_t>(builder.indices.size()), packVertices);
+            setLods(builder.lods);
+            computeTextureDensity(builder.vertices.data(), static_cast<uint32_t>(builder.vertices.size()),
+                builder.indices.data(), lods.empty() ? 0u : lods[0].indexCount);
         }
       
     
     }
 
-    VkcOBJmodel::~VkcOBJmodel() {}
+    VkcOBJmodel::VkcOBJmodel(VkcDevice& device, const void* vertexData, uint32_t vertexStride, uint32_t vertexCount,
+        const uint32_t* indexData, uint32_t indexCount, bool isSkybox, bool packVertices,
+        const std::vector<meshopt::Lod>& lods)
+        : vkcDevice{ device }, isSkyboxModel{ isSkybox } {
 
-    std::shared_ptr<VkcOBJmodel> VkcOBJmodel::createModelFromFile(VkcDevice& device, const std::string& filepath, bool isSkybox)
-    {
-        Builder builder{};
-        builder.loadModel(filepath, isSkybox);
-        return std::make_shared<VkcOBJmodel>(device, builder);
+        assert(vertexStride == (isSkybox ? sizeof(SkyboxVertex) : sizeof(Vertex)) && "Vertex stride does not match model vertex layout");
+
+        createGeometry(vertexData, vertexStride, vertexCount, isSkybox ? nullptr : indexData, isSkybox ? 0 : indexCount,
+            packVertices && !isSkybox);
+        if (!isSkybox) {
+            setLods(lods);
+            computeTextureDensity(static_cast<const Vertex*>(vertexData), vertexCount, indexData,
+                this->lods.empty() ? 0u : this->lods[0].indexCount);
+        }
     }
 
-    void VkcOBJmodel::createVertexBuffers(const std::vector<Vertex>& vertices)
+    void VkcOBJmodel::setLods(const std::vector<meshopt::Lod>& levels)
     {
-        vertexCount = static_cast<uint32_t>(vertices.size());
-        assert(vertexCount >= 3 && "Vertex count must be at least 3");
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-        uint32_t vertexSize = sizeof(vertices[0]);
-
-        VkcBuffer stagingBuffer{
-            vkcDevice,
-            vertexSize,
-            vertexCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        };
+        lods = levels;
+        if (lods.empty() && hasIndexBuffer) {
+            lods.push_back({ 0, indexCount, 0.f });
+        }
+    }
 
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)vertices.data());
+    void VkcOBJmodel::computeTextureDensity(const Vertex* vertices, uint32_t count, const uint32_t* indices, uint32_t numIndices)
+    {
+        if (count == 0)
+            return;
 
-        vertexBuffer = std::make_unique<VkcBuffer>(
-            vkcDevice,
-            vertexSize,
-            vertexCount,
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        );
+        glm::vec3 minPos = vertices[0].position;
+        glm::vec3 maxPos = vertices[0].position;
+        for (uint32_t i = 1; i < count; i++) {
+            minPos = glm::min(minPos, vertices[i].position);
+            maxPos = glm::max(maxPos, vertices[i].position);
+        }
+        bounds = { minPos, maxPos };
+        boundingCenter = (minPos + maxPos) * 0.5f;
+        boundingRadius = glm::length(maxPos - minPos) * 0.5f;
+
+        double worldArea = 0.0;
+        double uvArea = 0.0;
+        for (uint32_t i = 0; i + 2 < numIndices; i += 3) {
+            const Vertex& a = vertices[indices[i]];
+            const Vertex& b = vertices[indices[i + 1]];
+            const Vertex& c = vertices[indices[i + 2]];
+            worldArea += 0.5 * glm::length(glm::cross(b.position - a.position, c.position - a.position));
+            const glm::vec2 e1 = b.uv - a.uv;
+            const glm::vec2 e2 = c.uv - a.uv;
+            uvArea += 0.5 * std::abs(e1.x * e2.y - e1.y * e2.x);
+        }
+        // Meshes without usable UVs behave as if the texture spans the bounds once
+        worldUnitsPerUV = uvArea > 0.0
+            ? static_cast<float>(std::sqrt(worldArea / uvArea))
+            : boundingRadius * 2.0f;
+    }
 
-        vkcDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+    VkcOBJmodel::~VkcOBJmodel()
+    {
+        vkcDevice.geometryArena().free(geometry);
     }
-    void VkcOBJmodel::createVertexBuffers(const std::vector<SkyboxVertex>& vertices) {
-        vertexCount = static_cast<uint32_t>(vertices.size());
-        assert(vertexCount >= 3 && "Skybox vertex count must be at least 3");
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-        uint32_t vertexSize = sizeof(vertices[0]);
-
-        VkcBuffer stagingBuffer{
-            vkcDevice,
-            vertexSize,
-            vertexCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        };
 
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)vertices.data()); 
-     
-        vertexBuffer = std::make_unique<VkcBuffer>(
-            vkcDevice,
-            vertexSize,
-            vertexCount,
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        );
-
-        vkcDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+    std::shared_ptr<VkcOBJmodel> VkcOBJmodel::createModelFromFile(VkcDevice& device, const std::string& filepath, bool isSkybox, bool packVertices)
+    {
+        Builder builder{};
+        builder.loadModel(filepath, isSkybox);
+        return std::make_shared<VkcOBJmodel>(device, builder, packVertices);
     }
 
-    void VkcOBJmodel::createIndexBuffers(const std::vector<uint32_t>& indices)
+    void VkcOBJmodel::createGeometry(const void* vertexData, uint32_t vertexSize, uint32_t count,
+        const uint32_t* indexData, uint32_t numIndices, bool packVertices)
     {
-        indexCount = static_cast<uint32_t>(indices.size());
+        vertexCount = count;
+        assert(vertexCount >= 3 && "Vertex count must be at least 3");
+        indexCount = numIndices;
         hasIndexBuffer = indexCount > 0;
-        if (!hasIndexBuffer) return;
-
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-        uint32_t indexSize = sizeof(indices[0]);
-
-        VkcBuffer stagingBuffer{
-            vkcDevice,
-            indexSize,
-            indexCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        };
+        vertexStride = vertexSize;
+        unpackedVertexStride = vertexSize;
+
+        std::vector<PackedVertex> packed;
+        if (packVertices) {
+            assert(vertexSize == sizeof(Vertex));
+            const Vertex* vertices = static_cast<const Vertex*>(vertexData);
+
+            glm::vec3 minPos = vertices[0].position;
+            glm::vec3 maxPos = vertices[0].position;
+            for (uint32_t i = 1; i < count; i++) {
+                minPos = glm::min(minPos, vertices[i].position);
+                maxPos = glm::max(maxPos, vertices[i].position);
+            }
+            packing::PositionQuantizer quantizer;
+            quantizer.fit(minPos, maxPos);
+
+            packed.resize(count);
+            for (uint32_t i = 0; i < count; i++) {
+                PackedVertex& out = packed[i];
+                quantizer.encode(vertices[i].position, out.position);
+                out.position[3] = 0;
+                out.color = packing::packColor(glm::vec4(vertices[i].color, 1.f));
+                out.normal = packing::packDirection(vertices[i].normal);
+                out.uv = packing::packUV(vertices[i].uv);
+            }
+            vertexData = packed.data();
+            vertexStride = sizeof(PackedVertex);
+            packedVertices = true;
+            positionDecode = quantizer.decodeMatrix();
+        }
 
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)indices.data());
+        // Indices are relative to the mesh's first vertex, so small meshes fit in 16 bits
+        std::vector<uint16_t> shortIndices;
+        const void* indices = indexData;
+        VkDeviceSize indexSize = sizeof(uint32_t);
+        if (hasIndexBuffer && packing::fitsUint16Indices(vertexCount)) {
+            shortIndices.assign(indexData, indexData + indexCount);
+            indices = shortIndices.data();
+            indexSize = sizeof(uint16_t);
+            indexType = VK_INDEX_TYPE_UINT16;
+        }
 
-        indexBuffer = std::make_unique<VkcBuffer>(
-            vkcDevice,
-            indexSize,
-            indexCount,
-            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VkcGeometryArena& arena = vkcDevice.geometryArena();
+        geometry = arena.allocate(vertexStride, vertexCount, indexCount, indexType);
+        const VkcGeometryArena::MeshRange& range = arena.range(geometry);
 
-        vkcDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+        vkcDevice.uploadBatcher().uploadBuffer(vertexData, static_cast<VkDeviceSize>(vertexStride) * vertexCount,
+            arena.vertexBuffer(), range.vertexByteOffset);
+        if (hasIndexBuffer) {
+            vkcDevice.uploadBatcher().uploadBuffer(indices, indexSize * indexCount,
+                arena.indexBuffer(), range.indexByteOffset);
+        }
     }
 
     void VkcOBJmodel::draw(VkCommandBuffer commandBuffer)
     {
+        drawLod(commandBuffer, 0);
+    }
+
+    void VkcOBJmodel::drawLod(VkCommandBuffer commandBuffer, uint32_t level)
+    {
+        // The arena may have been compacted since the last frame, so look the range up each time
+        const VkcGeometryArena::MeshRange& range = vkcDevice.geometryArena().range(geometry);
         if (hasIndexBuffer) {
-            vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+            const meshopt::Lod& lod = lods[std::min<size_t>(level, lods.size() - 1)];
+            vkcDevice.geometryArena().bindIndexType(commandBuffer, indexType);
+            vkCmdDrawIndexed(commandBuffer, lod.indexCount, 1, range.firstIndex + lod.firstIndex, static_cast<int32_t>(range.firstVertex), 0);
         }
         else {
-            vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+            vkCmdDraw(commandBuffer, vertexCount, 1, range.firstVertex, 0);
         }
     }
 
+    bool VkcOBJmodel::getIndexedDraw(uint32_t level, IndexedDraw& draw) const
+    {
+        if (!hasIndexBuffer)
+            return false;
+        const VkcGeometryArena::MeshRange& range = vkcDevice.geometryArena().range(geometry);
+        const meshopt::Lod& lod = lods[std::min<size_t>(level, lods.size() - 1)];
+        draw.indexCount = lod.indexCount;
+        draw.firstIndex = range.firstIndex + lod.firstIndex;
+        draw.vertexOffset = static_cast<int32_t>(range.firstVertex);
+        draw.indexType = indexType;
+        return true;
+    }
+
 
-    void VkcOBJmodel::bind(VkCommandBuffer commandBuffer)
+    float VkcOBJmodel::getLodError(uint32_t level) const
     {
-        VkBuffer buffers[] = { vertexBuffer->getBuffer() };
-        VkDeviceSize offsets[] = { 0 };
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+        return lods.empty() ? 0.f : lods[std::min<size_t>(level, lods.size() - 1)].error;
+    }
 
+    uint64_t VkcOBJmodel::getLodTriangles(uint32_t level) const
+    {
+        if (lods.empty())
+            return vertexCount / 3;
+        return lods[std::min<size_t>(level, lods.size() - 1)].indexCount / 3;
+    }
+
+    IModel::MemoryUsage VkcOBJmodel::getMemoryUsage() const
+    {
+        MemoryUsage usage;
+        usage.geometryBytes = static_cast<VkDeviceSize>(vertexStride) * vertexCount;
+        usage.unpackedGeometryBytes = static_cast<VkDeviceSize>(unpackedVertexStride) * vertexCount;
         if (hasIndexBuffer) {
-            vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            const VkDeviceSize indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+            usage.geometryBytes += indexSize * indexCount;
+            usage.unpackedGeometryBytes += static_cast<VkDeviceSize>(sizeof(uint32_t)) * indexCount;
         }
+        return usage;
+    }
+
+    void VkcOBJmodel::bind(VkCommandBuffer commandBuffer)
+    {
+        // Every model shares the arena; render systems normally bind it once per pass
+        vkcDevice.geometryArena().bind(commandBuffer);
     }
 
     std::vector<VkVertexInputBindingDescription> VkcOBJmodel::Vertex::getBindingDescriptions()
@@ -191,6 +280,26 @@ namespace vkc
         };
     }
 
+    std::vector<VkVertexInputBindingDescription> VkcOBJmodel::PackedVertex::getBindingDescriptions()
+    {
+        return {
+            VkVertexInputBindingDescription{
+                0, sizeof(PackedVertex), VK_VERTEX_INPUT_RATE_VERTEX
+            }
+        };
+    }
+
+    std::vector<VkVertexInputAttributeDescription> VkcOBJmodel::PackedVertex::getAttributeDescriptions()
+    {
+        // Same locations as Vertex; vert_packed.vert decodes the normal
+        return {
+            { 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position) },
+            { 1, 0, VK_FORMAT_R8G8B8A8_UNORM,     offsetof(PackedVertex, color) },
+            { 2, 0, VK_FORMAT_R16G16_SNORM,       offsetof(PackedVertex, normal) },
+            { 3, 0, VK_FORMAT_R16G16_SFLOAT,      offsetof(PackedVertex, uv) }
+        };
+    }
+
     std::vector<VkVertexInputBindingDescription> VkcOBJmodel::SkyboxVertex::getBindingDescriptions() {
         return { {
                 /*binding=*/0,
@@ -214,6 +323,7 @@ namespace vkc
         vertices.clear();
         skyboxVertices.clear();
         indices.clear();
+        lods.clear();
 
         // 1) Check extension
         auto lastDot = filepath.find_last_of('.');
@@ -289,6 +399,27 @@ namespace vkc
                         indices.push_back(uniqueVertices[vertex]);
                     }
                 }
+
+                // Cache, overdraw and fetch order; the mesh cache stores the result
+                if (!indices.empty()) {
+                    meshopt::Result optimized = meshopt::optimizeMesh(
+                        indices.data(), indices.size(), vertices.size(),
+                        &vertices[0].position.x, &vertices[0].normal.x, sizeof(Vertex));
+                    meshopt::applyVertexOrder(vertices, optimized.vertexOrder);
+                    std::cout << std::fixed << std::setprecision(3)
+                        << "MeshOptimizer: " << filepath
+                        << " ACMR " << optimized.before.acmr << " -> " << optimized.after.acmr
+                        << ", ATVR " << optimized.before.atvr << " -> " << optimized.after.atvr << "\n";
+                    std::cout.unsetf(std::ios::floatfield);
+
+                    // Coarser levels over the same vertices, appended to indices
+                    lods = meshopt::generateLods(indices, &vertices[0].position.x, vertices.size(), sizeof(Vertex));
+                    std::cout << "MeshSimplifier: " << filepath << " LOD triangles";
+                    for (const meshopt::Lod& lod : lods) {
+                        std::cout << " " << lod.indexCount / 3;
+                    }
+                    std::cout << "\n";
+                }
             }
             return;
         }
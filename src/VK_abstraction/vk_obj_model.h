@@ -1,8 +1,10 @@
 #pragma once
 #include "vk_device.h"
 #include "VK_abstraction/vk_buffer.h"
+#include "VK_abstraction/vk_geometryArena.h"
 #include "VK_abstraction/vk_texture.h"
 #include "VK_abstraction/vk_IModel.hpp"
+#include "Utils/vkc_meshSimplifier.h"
 // libs
 #define GLM_FORCE_RADIANS	
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -37,6 +39,19 @@ namespace vkc {
             }
         };
 
+        // Vertex with quantized position (UNORM16 within the mesh bounds), octahedral
+        // normal, half-float UV and UNORM8 colour; 20 bytes instead of 44.
+        // Drawn with vert_packed.vert.
+        struct PackedVertex {
+            uint16_t position[4];   // w unused
+            uint32_t color;
+            uint32_t normal;
+            uint32_t uv;
+
+            static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+            static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+        };
+
         struct SkyboxVertex {
             glm::vec3 position;
             static std::vector<VkVertexInputBindingDescription>   getBindingDescriptions();
@@ -52,6 +67,8 @@ namespace vkc {
             std::vector<Vertex> vertices{};
             std::vector<SkyboxVertex> skyboxVertices{};
             std::vector<uint32_t> indices{};
+            // Level 0 is the loaded mesh; coarser levels follow it in indices
+            std::vector<meshopt::Lod> lods{};
 
             void loadModel(const std::string& filepath, bool isSkybox);
 
@@ -60,10 +77,16 @@ namespace vkc {
 
         };
 
+        // packVertices uploads PackedVertex instead of Vertex (ignored for skyboxes).
+        // Meshes with up to 65536 vertices always get 16-bit indices.
         static std::shared_ptr<VkcOBJmodel> createModelFromFile(
-            VkcDevice& device, std::string const& filepath, bool isSkybox = false);
+            VkcDevice& device, std::string const& filepath, bool isSkybox = false, bool packVertices = false);
 
-        VkcOBJmodel(VkcDevice& device, Builder const& builder);
+        VkcOBJmodel(VkcDevice& device, Builder const& builder, bool packVertices = false);
+        // Builds directly from flat arrays (e.g. a mapped mesh cache entry) without a Builder copy
+        VkcOBJmodel(VkcDevice& device, const void* vertexData, uint32_t vertexStride, uint32_t vertexCount,
+            const uint32_t* indexData, uint32_t indexCount, bool isSkybox, bool packVertices = false,
+            const std::vector<meshopt::Lod>& lods = {});
         ~VkcOBJmodel();
 
         VkcOBJmodel(VkcOBJmodel const&) = delete;
@@ -71,25 +94,57 @@ namespace vkc {
 
         void bind(VkCommandBuffer commandBuffer)override;
         void draw(VkCommandBuffer commandBuffer)override;
+        MemoryUsage getMemoryUsage() const override;
+        bool hasPackedVertices() const override { return packedVertices; }
+        glm::mat4 getPositionDecode() const override { return positionDecode; }
+        uint32_t getLodCount() const override { return lods.empty() ? 1u : static_cast<uint32_t>(lods.size()); }
+        float getLodError(uint32_t level) const override;
+        uint64_t getLodTriangles(uint32_t level) const override;
+        void drawLod(VkCommandBuffer commandBuffer, uint32_t level) override;
+        bool getIndexedDraw(uint32_t level, IndexedDraw& draw) const override;
+        glm::vec4 getBoundingSphere() const override { return glm::vec4(boundingCenter, boundingRadius); }
+        Bounds getBounds() const override { return bounds; }
       
 
        
 
         bool isSkybox() const { return isSkyboxModel; }
+
+        // Object-space bounding sphere and the average world units covered by one
+        // UV unit (area weighted), used to pick streamed texture mips
+        glm::vec3 getBoundingCenter() const { return boundingCenter; }
+        float getBoundingRadius() const { return boundingRadius; }
+        float getWorldUnitsPerUV() const { return worldUnitsPerUV; }
     private:
-        void createVertexBuffers(std::vector<Vertex> const& vertices);
-        void createIndexBuffers(std::vector<uint32_t> const& indices);
-        void createVertexBuffers(const std::vector<SkyboxVertex>& vertices);
+        void computeTextureDensity(const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+
+        // Reserves the model's range in the device's geometry arena and queues the upload
+        void createGeometry(const void* vertexData, uint32_t vertexSize, uint32_t count,
+            const uint32_t* indexData, uint32_t numIndices, bool packVertices);
+        // Level 0 defaults to every index
+        void setLods(const std::vector<meshopt::Lod>& levels);
 
         VkcDevice& vkcDevice;
         bool hasIndexBuffer{ false };
         bool isSkyboxModel{ false };
 
-        std::unique_ptr<VkcBuffer> vertexBuffer;
-        uint32_t vertexCount;
-
-        std::unique_ptr<VkcBuffer> indexBuffer;
-        uint32_t indexCount;
+        // Handle into vkcDevice.geometryArena()
+        uint32_t geometry = VkcGeometryArena::INVALID_MESH;
+        uint32_t vertexStride = 0;
+        uint32_t unpackedVertexStride = 0;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+        VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+        // Ranges of the index list; empty for non-indexed models
+        std::vector<meshopt::Lod> lods;
+
+        bool packedVertices{ false };
+        glm::mat4 positionDecode{ 1.f };
+
+        Bounds bounds;
+        glm::vec3 boundingCenter{ 0.f };
+        float boundingRadius{ 1.f };
+        float worldUnitsPerUV{ 1.f };
 
         std::vector<std::shared_ptr<VkcTexture>> textures;
     };
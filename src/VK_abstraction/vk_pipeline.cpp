@@ -18,18 +18,27 @@ namespace vkc
 		createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
 	}
 
+	VkcPipeline::VkcPipeline
+	(
+		VkcDevice& device,
+		const std::string& compFilepath,
+		VkPipelineLayout pipelineLayout)
+		: vkcDevice{ device }, bindPoint{ VK_PIPELINE_BIND_POINT_COMPUTE } {
+		createComputePipeline(compFilepath, pipelineLayout);
+	}
  
 
 	VkcPipeline::~VkcPipeline() 
 	{
 		vkDestroyShaderModule(vkcDevice.device(), vertShaderModule, nullptr);
 		vkDestroyShaderModule(vkcDevice.device(), fragShaderModule, nullptr);
-		vkDestroyPipeline(vkcDevice.device(), graphicsPipeline, nullptr);
+		vkDestroyShaderModule(vkcDevice.device(), compShaderModule, nullptr);
+		vkDestroyPipeline(vkcDevice.device(), pipeline, nullptr);
 	}
 
 	void VkcPipeline::bind(VkCommandBuffer commandBuffer) 
 	{
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+		vkCmdBindPipeline(commandBuffer, bindPoint, pipeline);
 	}
 	 
 	std::vector<char> VkcPipeline::readFile(const std::string& filepath) 
@@ -125,7 +134,7 @@ namespace vkc
 			1,
 			&pipelineInfo,
 			nullptr,
-			&graphicsPipeline
+			&pipeline
 		) 
 			!= VK_SUCCESS
 			)
@@ -133,6 +142,30 @@ namespace vkc
 			throw std::runtime_error("Failed to create graphics pipeline");
 		}
 	}
+	void VkcPipeline::createComputePipeline(const std::string& compFilepath, VkPipelineLayout pipelineLayout)
+	{
+		assert(
+			pipelineLayout != VK_NULL_HANDLE &&
+			"Cannot create compute pipeline: no pipelineLayout provided");
+
+		auto compCode = readFile(compFilepath);
+		createShaderModule(compCode, &compShaderModule);
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = compShaderModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineIndex = -1;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		if (vkCreateComputePipelines(vkcDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create compute pipeline");
+		}
+	}
 	void VkcPipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule)
 	{
 		VkShaderModuleCreateInfo createInfo{};
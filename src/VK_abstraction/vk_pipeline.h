@@ -36,12 +36,18 @@ namespace vkc {
 			const std::string& vertFilepath,
 			const std::string& fragFilepath,
 			const PipelineConfigInfo& configInfo);
+		// Compute pipeline
+		VkcPipeline(
+			VkcDevice& device,
+			const std::string& compFilepath,
+			VkPipelineLayout pipelineLayout);
 		~VkcPipeline();
 
 		VkcPipeline(const VkcPipeline&) = delete;
 		void operator=(const VkcPipeline&) = delete;
 
 		void bind(VkCommandBuffer commandBuffer);
+		VkPipeline getPipeline() const { return pipeline; }
 		
 		static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
 		static void defaultSkyboxConfigInfo(PipelineConfigInfo& configInfo);
@@ -53,11 +59,15 @@ namespace vkc {
 			const std::string& fragFilepath,
 			const PipelineConfigInfo& configInfo);
 
+		void createComputePipeline(const std::string& compFilepath, VkPipelineLayout pipelineLayout);
+
 		void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
 
 		VkcDevice& vkcDevice;
-		VkPipeline graphicsPipeline;
-		VkShaderModule vertShaderModule;
-		VkShaderModule fragShaderModule;
+		VkPipeline pipeline;
+		VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+		VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+		VkShaderModule compShaderModule = VK_NULL_HANDLE;
 	};
 }// namespace vkc
\ No newline at end of file
@@ -0,0 +1,228 @@
+// vk_renderTargets.cpp
+#include "vk_renderTargets.h"
+#include "vk_device.h"
+
+// STD
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace vkc
+{
+    namespace {
+        constexpr VkImageUsageFlags kAttachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+        VkImageAspectFlags aspectFor(VkFormat format)
+        {
+            switch (format) {
+            case VK_FORMAT_D16_UNORM:
+            case VK_FORMAT_X8_D24_UNORM_PACK32:
+            case VK_FORMAT_D32_SFLOAT:
+                return VK_IMAGE_ASPECT_DEPTH_BIT;
+            case VK_FORMAT_D16_UNORM_S8_UINT:
+            case VK_FORMAT_D24_UNORM_S8_UINT:
+            case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                // Views for attachments cover both aspects
+                return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+            default:
+                return VK_IMAGE_ASPECT_COLOR_BIT;
+            }
+        }
+
+        double toMiB(VkDeviceSize bytes)
+        {
+            return static_cast<double>(bytes) / (1024.0 * 1024.0);
+        }
+    }
+
+    VkcRenderTargets::VkcRenderTargets(VkcDevice& device, std::string name)
+        : device{ device }, name{ std::move(name) }
+    {
+    }
+
+    VkcRenderTargets::~VkcRenderTargets()
+    {
+        destroy();
+    }
+
+    VkcRenderTargets::Handle VkcRenderTargets::add(const Desc& desc)
+    {
+        Target target;
+        target.desc = desc;
+        targets.push_back(target);
+        built = false;
+        return static_cast<Handle>(targets.size() - 1);
+    }
+
+    void VkcRenderTargets::build(VkExtent2D newExtent)
+    {
+        if (built && newExtent.width == extent.width && newExtent.height == extent.height)
+            return;
+
+        destroy();
+        extent = newExtent;
+        for (Target& target : targets) {
+            createTarget(target);
+        }
+        assignSlots();
+        for (Target& target : targets) {
+            createView(target);
+        }
+        built = true;
+        buildVersion++;
+        printStats();
+    }
+
+    void VkcRenderTargets::destroy()
+    {
+        for (Target& target : targets) {
+            if (target.view != VK_NULL_HANDLE) {
+                vkDestroyImageView(device.device(), target.view, nullptr);
+            }
+            if (target.allocation != VK_NULL_HANDLE) {
+                device.destroyImage(target.image, target.allocation);
+            }
+            else if (target.image != VK_NULL_HANDLE) {
+                vkDestroyImage(device.device(), target.image, nullptr);
+            }
+            const Desc desc = target.desc;
+            target = Target{};
+            target.desc = desc;
+        }
+        // Aliased images are gone, so their memory can go
+        for (Slot& slot : slots) {
+            device.allocator().freeMemory(slot.allocation);
+        }
+        slots.clear();
+        stats = Stats{};
+        built = false;
+    }
+
+    void VkcRenderTargets::createTarget(Target& target)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = target.desc.format;
+        imageInfo.extent = { extent.width, extent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = target.desc.usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        // Never sampled, copied or stored: contents only exist inside the render pass
+        target.transient = (target.desc.usage & ~kAttachmentUsage) == 0;
+        if (target.transient) {
+            imageInfo.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+            if (createLazyTarget(target, imageInfo))
+                return;
+        }
+
+        // Memory is bound by assignSlots
+        if (vkCreateImage(device.device(), &imageInfo, nullptr, &target.image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create render target image!");
+        }
+        vkGetImageMemoryRequirements(device.device(), target.image, &target.requirements);
+        stats.dedicatedBytes += target.requirements.size;
+    }
+
+    bool VkcRenderTargets::createLazyTarget(Target& target, const VkImageCreateInfo& imageInfo)
+    {
+        if (!device.allocator().hasLazilyAllocatedMemory())
+            return false;
+        if (device.allocator().createImage(imageInfo,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+                target.image, target.allocation) != VK_SUCCESS) {
+            return false;
+        }
+        target.lazy = true;
+        vkGetImageMemoryRequirements(device.device(), target.image, &target.requirements);
+        stats.lazyBytes += target.requirements.size;
+        stats.dedicatedBytes += target.requirements.size;
+        return true;
+    }
+
+    void VkcRenderTargets::assignSlots()
+    {
+        // Largest first, each into the first slot whose targets are all live in other passes
+        std::vector<Handle> order;
+        for (Handle t = 0; t < targets.size(); t++) {
+            if (!targets[t].lazy) {
+                order.push_back(t);
+            }
+        }
+        std::stable_sort(order.begin(), order.end(), [&](Handle a, Handle b) {
+            return targets[a].requirements.size > targets[b].requirements.size;
+        });
+
+        for (Handle t : order) {
+            Target& target = targets[t];
+            auto fits = [&](const Slot& slot) {
+                if ((slot.requirements.memoryTypeBits & target.requirements.memoryTypeBits) == 0)
+                    return false;
+                for (Handle other : slot.targets) {
+                    const Desc& o = targets[other].desc;
+                    if (target.desc.firstPass <= o.lastPass && o.firstPass <= target.desc.lastPass)
+                        return false;
+                }
+                return true;
+            };
+            auto slot = std::find_if(slots.begin(), slots.end(), fits);
+            if (slot == slots.end()) {
+                slots.emplace_back();
+                slot = slots.end() - 1;
+                slot->requirements = target.requirements;
+            }
+            slot->requirements.size = std::max(slot->requirements.size, target.requirements.size);
+            slot->requirements.alignment = std::max(slot->requirements.alignment, target.requirements.alignment);
+            slot->requirements.memoryTypeBits &= target.requirements.memoryTypeBits;
+            slot->targets.push_back(t);
+            target.slot = static_cast<uint32_t>(slot - slots.begin());
+        }
+
+        for (Slot& slot : slots) {
+            if (device.allocator().allocateMemory(slot.requirements, MemoryPool::RenderTargets,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, slot.allocation) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate render target memory!");
+            }
+            for (Handle t : slot.targets) {
+                VK_CHECK_RESULT(device.allocator().bindImageMemory(slot.allocation, 0, targets[t].image));
+            }
+            stats.committedBytes += slot.requirements.size;
+        }
+    }
+
+    void VkcRenderTargets::createView(Target& target)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = target.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = target.desc.format;
+        viewInfo.subresourceRange.aspectMask = aspectFor(target.desc.format);
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device.device(), &viewInfo, nullptr, &target.view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create render target image view!");
+        }
+    }
+
+    void VkcRenderTargets::printStats() const
+    {
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "VkcRenderTargets (" << name << "): " << targets.size() << " targets at "
+            << extent.width << "x" << extent.height << ", " << toMiB(stats.committedBytes) << " MiB committed, "
+            << toMiB(stats.lazyBytes) << " MiB lazily allocated (" << toMiB(stats.dedicatedBytes)
+            << " MiB as dedicated attachments)\n";
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+}  // namespace vkc
@@ -0,0 +1,108 @@
+// vk_renderTargets.h
+#pragma once
+#include "vulkan/vulkan.h"
+#include <vk_mem_alloc.h>
+
+// STD
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vkc
+{
+    class VkcDevice;
+
+    // Attachments of one or more render passes, created together so they can
+    // share memory:
+    //  - targets only used as attachments are created transient, and on devices
+    //    with lazily allocated memory (tile-based GPUs) may never get physical
+    //    memory at all;
+    //  - all other targets alias one allocation per group whose passes don't
+    //    overlap within the frame.
+    //
+    // Passes are numbered in frame order; a target is live from its firstPass to
+    // its lastPass. Aliased targets keep no contents outside that range, so the
+    // first pass must start from VK_IMAGE_LAYOUT_UNDEFINED and clear or overwrite
+    // them, and the passes' external dependencies must order the last use of one
+    // alias before the first use of the next.
+    //
+    // Main (render) thread only.
+    class VkcRenderTargets
+    {
+    public:
+        using Handle = uint32_t;
+
+        struct Desc {
+            VkFormat          format = VK_FORMAT_UNDEFINED;
+            VkImageUsageFlags usage = 0;
+            uint32_t          firstPass = 0;
+            uint32_t          lastPass = 0;
+        };
+
+        struct Stats {
+            VkDeviceSize committedBytes = 0;   // allocated up front, lazily allocated memory excluded
+            VkDeviceSize lazyBytes = 0;        // lazily allocated targets, backed on demand
+            VkDeviceSize dedicatedBytes = 0;   // one non-transient allocation per target
+        };
+
+        VkcRenderTargets(VkcDevice& device, std::string name);
+        ~VkcRenderTargets();
+
+        VkcRenderTargets(const VkcRenderTargets&) = delete;
+        VkcRenderTargets& operator=(const VkcRenderTargets&) = delete;
+
+        // Targets are created by the next build()
+        Handle add(const Desc& desc);
+
+        // Creates every target at extent, first destroying the old ones. A no-op
+        // when the extent is unchanged and nothing was added.
+        void build(VkExtent2D extent);
+        void destroy();
+
+        VkImage     image(Handle target) const { return targets[target].image; }
+        VkImageView view(Handle target) const { return targets[target].view; }
+        VkFormat    format(Handle target) const { return targets[target].desc.format; }
+        bool        isTransient(Handle target) const { return targets[target].transient; }
+        VkExtent2D  getExtent() const { return extent; }
+        // Bumped by every build() that recreates the targets; framebuffers made from
+        // the views are stale once it changes (a new view may reuse an old handle)
+        uint32_t    version() const { return buildVersion; }
+
+        const Stats& getStats() const { return stats; }
+        void printStats() const;
+
+    private:
+        struct Target {
+            Desc          desc;
+            bool          transient = false;
+            bool          lazy = false;
+            VkImage       image = VK_NULL_HANDLE;
+            VkImageView   view = VK_NULL_HANDLE;
+            VmaAllocation allocation = VK_NULL_HANDLE;   // own memory; aliased targets use their slot's
+            VkMemoryRequirements requirements{};
+            uint32_t      slot = UINT32_MAX;
+        };
+
+        // One allocation shared by targets with disjoint pass ranges
+        struct Slot {
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            VkMemoryRequirements requirements{};
+            std::vector<Handle> targets;
+        };
+
+        void createTarget(Target& target);
+        bool createLazyTarget(Target& target, const VkImageCreateInfo& imageInfo);
+        void createView(Target& target);
+        void assignSlots();
+
+        VkcDevice&          device;
+        std::string         name;
+        std::vector<Target> targets;
+        std::vector<Slot>   slots;
+        VkExtent2D          extent{ 0, 0 };
+        bool                built = false;
+        uint32_t            buildVersion = 0;
+        Stats               stats;
+    };
+
+}  // namespace vkc
@@ -3,6 +3,7 @@
 
 // Project headers
 #include "vk_device.h"
+#include "vk_renderTargets.h"
 
 // vulkan headers
 #include <vulkan/vulkan.h>
@@ -73,9 +74,9 @@ namespace vkc
         std::vector<VkFramebuffer> swapChainFramebuffers;
         VkRenderPass renderPass;
 
-        std::vector<VkImage> depthImages;
-        std::vector<VkDeviceMemory> depthImageMemory;
-        std::vector<VkImageView> depthImageViews;
+        // One per swapchain image; transient, so lazily allocated where the device allows
+        std::unique_ptr<VkcRenderTargets> depthTargets;
+        std::vector<VkcRenderTargets::Handle> depthHandles;
         std::vector<VkImage> swapChainImages;
         std::vector<VkImageView> swapChainImageViews;
 
@@ -1,7 +1,10 @@
 #include "vk_texture.h"
 #include "vk_device.h"
+#include "vk_uploadBatcher.h"
 
 #include <stb_image.h>
+#include <algorithm>
+#include <limits>
 #include <stdexcept>
 #include <cstring>
 
@@ -17,6 +20,11 @@ namespace vkc
 	}
 
 	bool VkcTexture::STBLoadFromFile(const std::string& filename)
+	{
+		return UploadDecoded(DecodeSTB(filename));
+	}
+
+	VkcTexture::DecodedImage VkcTexture::DecodeSTB(const std::string& filename)
 	{
 		int texWidth, texHeight, texChannels;
 		stbi_uc* pixels = stbi_load(filename.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
@@ -24,61 +32,71 @@ namespace vkc
 		{
 			throw std::runtime_error("Failed to load texture image: " + filename);
 		}
-		VkDeviceSize imageSize = static_cast<VkDeviceSize>(texWidth) * texHeight * 4;
-
-		// Stage data
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-		device->createBuffer(
-			imageSize,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBuffer,
-			stagingMemory);
-
-		void* data;
-		vkMapMemory(device->logicalDevice, stagingMemory, 0, imageSize, 0, &data);
-		memcpy(data, pixels, static_cast<size_t>(imageSize));
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
-		stbi_image_free(pixels);
-
-		// Create and upload to 2D image
+
+		DecodedImage decoded;
+		decoded.width = static_cast<uint32_t>(texWidth);
+		decoded.height = static_cast<uint32_t>(texHeight);
+		decoded.layers.emplace_back(pixels, stbi_image_free);
+		return decoded;
+	}
+
+	VkcTexture::DecodedImage VkcTexture::DecodeSTBCubemap(const std::array<std::string, 6>& faces)
+	{
+		DecodedImage decoded;
+		for (int i = 0; i < 6; i++) {
+			int w, h, c;
+			stbi_uc* pixels = stbi_load(faces[i].c_str(), &w, &h, &c, STBI_rgb_alpha);
+			if (!pixels) {
+				throw std::runtime_error("Failed to load skybox face: " + faces[i]);
+			}
+			decoded.layers.emplace_back(pixels, stbi_image_free);
+			decoded.width = static_cast<uint32_t>(w);
+			decoded.height = static_cast<uint32_t>(h);
+		}
+		return decoded;
+	}
+
+	bool VkcTexture::UploadDecoded(const DecodedImage& decoded)
+	{
+		const uint32_t layers = static_cast<uint32_t>(decoded.layers.size());
+		const bool cube = layers == 6;
+		isCubemap = cube;
+
+		VkDeviceSize layerSize = static_cast<VkDeviceSize>(decoded.width) * decoded.height * 4;
+		VkDeviceSize totalSize = layerSize * layers;
+
+		// Create a 2D image (6 layers, CUBE_COMPATIBLE for cubemaps)
 		CreateImage(
-			static_cast<uint32_t>(texWidth),
-			static_cast<uint32_t>(texHeight),
+			decoded.width,
+			decoded.height,
 			VK_FORMAT_R8G8B8A8_SRGB,
 			VK_IMAGE_TILING_OPTIMAL,
 			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			1, // arrayLayers
-			0  // flags
+			layers,
+			cube ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0
 		);
 
-		TransitionImageLayout(
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1 // layerCount
-		);
-		CopyBufferToImage(
-			stagingBuffer,
-			static_cast<uint32_t>(texWidth),
-			static_cast<uint32_t>(texHeight),
-			1 // layerCount
-		);
-		TransitionImageLayout(
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			1 // layerCount
-		);
+		// Stage data, one layer after another, and record the upload into the current batch
+		VkcUploadBatcher& batcher = device->uploadBatcher();
+		VkcUploadBatcher::Staging staging = batcher.allocate(totalSize);
+		for (uint32_t i = 0; i < layers; i++) {
+			memcpy(static_cast<char*>(staging.mapped) + layerSize * i, decoded.layers[i].get(), static_cast<size_t>(layerSize));
+		}
+
+		VkBufferImageCopy region{};
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = layers;
+		region.imageExtent = { decoded.width, decoded.height, 1 };
 
-		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
+		VkImageSubresourceRange subresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, layers };
+		batcher.uploadImage(staging, image, subresourceRange, { region }, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-		// Create view and sampler for 2D
+		// Create view and sampler
 		CreateImageView(
 			VK_FORMAT_R8G8B8A8_SRGB,
-			VK_IMAGE_VIEW_TYPE_2D,
-			1 // layerCount
+			cube ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D,
+			layers
 		);
 		CreateSampler();
 		UpdateDescriptor();
@@ -100,6 +118,21 @@ namespace vkc
 		ktxResult result = loadKTXFile(filename, &ktxTexture);
 		assert(result == KTX_SUCCESS);
 
+		bool ok = KTXUpload(ktxTexture, format, device, copyQueue, imageUsageFlags, imageLayout, forceLinear);
+		ktxTexture_Destroy(ktxTexture);
+		return ok;
+	}
+
+	bool VkcTexture::KTXUpload(
+		ktxTexture*        ktxTexture,
+		VkFormat           format,
+		VkcDevice* device,
+		VkQueue            copyQueue,
+		VkImageUsageFlags  imageUsageFlags,
+		VkImageLayout      imageLayout,
+		bool               forceLinear
+	)
+	{
 		this->device = device;
 		width = ktxTexture->baseWidth;
 		height = ktxTexture->baseHeight;
@@ -113,40 +146,8 @@ namespace vkc
 
 		VkBool32 useStaging = !forceLinear;
 
-		VkMemoryAllocateInfo memAllocInfo = vkc::vkinit::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
-
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
 		if (useStaging)
 		{
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingMemory;
-
-			VkBufferCreateInfo bufferCreateInfo = vkc::vkinit::bufferCreateInfo();
-			bufferCreateInfo.size = ktxTextureSize;
-			// This buffer is used as a transfer source for the buffer copy
-			bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-			bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-			VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-			// Get memory requirements for the staging buffer (alignment, memory type bits)
-			vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-			// Get memory type index for a host visible buffer
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-			VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-			// Copy texture data into staging buffer
-			uint8_t* data;
-			VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-			memcpy(data, ktxTextureData, ktxTextureSize);
-			vkUnmapMemory(device->logicalDevice, stagingMemory);
-
 			// Setup buffer copy regions for each mip level
 			std::vector<VkBufferImageCopy> bufferCopyRegions;
 
@@ -187,15 +188,8 @@ namespace vkc
 			{
 				imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 			}
-			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
-
-			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+			device->createImageWithInfo(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, allocation);
+			residentBytes = device->allocator().allocationSize(allocation);
 
 			VkImageSubresourceRange subresourceRange = {};
 			subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -204,39 +198,16 @@ namespace vkc
 			subresourceRange.layerCount = 1;
 
 
-			// Image barrier for optimal image (target)
-			// Optimal image will be used as destination for the copy
-			vkc::tools::setImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				subresourceRange);
-
-			// Copy mip levels from staging buffer
-			vkCmdCopyBufferToImage(
-				copyCmd,
-				stagingBuffer,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				static_cast<uint32_t>(bufferCopyRegions.size()),
-				bufferCopyRegions.data()
-			);
-
-			// Change texture image layout to shader read after all mip levels have been copied
+			// Stage the whole KTX payload, copy every mip level and move the
+			// image to its final layout as part of the current upload batch
 			this->imageLayout = imageLayout;
-			vkc::tools::setImageLayout(
-				copyCmd,
+			device->uploadBatcher().uploadImage(
+				ktxTextureData,
+				ktxTextureSize,
 				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				imageLayout,
-				subresourceRange);
-
-			device->flushCommandBuffer(copyCmd, copyQueue);
-
-			// Clean up staging resources
-			vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-			vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
+				subresourceRange,
+				bufferCopyRegions,
+				imageLayout);
 		}
 		else
 		{
@@ -248,7 +219,7 @@ namespace vkc
 			assert(formatProperties.linearTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 
 			VkImage mappableImage;
-			VkDeviceMemory mappableMemory;
+			VmaAllocation mappableAllocation;
 
 			VkImageCreateInfo imageCreateInfo = vkc::vkinit::imageCreateInfo();
 			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -262,23 +233,13 @@ namespace vkc
 			imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-			// Load mip map level 0 to linear tiling image
-			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &mappableImage));
-
-			// Get memory requirements for this image 
-			// like size and alignment
-			vkGetImageMemoryRequirements(device->logicalDevice, mappableImage, &memReqs);
-			// Set memory allocation size to required memory size
-			memAllocInfo.allocationSize = memReqs.size;
-
-			// Get memory type that can be mapped to host memory
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-			// Allocate host memory
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &mappableMemory));
-
-			// Bind allocated image for use
-			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, mappableImage, mappableMemory, 0));
+			// Load mip map level 0 to linear tiling image, backed by memory that can be mapped to the host
+			device->createImageWithInfo(
+				imageCreateInfo,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				mappableImage,
+				mappableAllocation);
+			residentBytes = device->allocator().allocationSize(mappableAllocation);
 
 			// Get sub resource layout
 			// Mip map count, array layer, etc.
@@ -294,50 +255,24 @@ namespace vkc
 			vkGetImageSubresourceLayout(device->logicalDevice, mappableImage, &subRes, &subResLayout);
 
 			// Map image memory
-			VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, mappableMemory, 0, memReqs.size, 0, &data));
+			VK_CHECK_RESULT(device->allocator().map(mappableAllocation, &data));
 
 			// Copy image data into memory
-			memcpy(data, ktxTextureData, memReqs.size);
+			memcpy(data, ktxTextureData, residentBytes);
 
-			vkUnmapMemory(device->logicalDevice, mappableMemory);
+			device->allocator().unmap(mappableAllocation);
 
 			// Linear tiled images don't need to be staged
 			// and can be directly used as textures
 			image = mappableImage;
-			deviceMemory = mappableMemory;
+			allocation = mappableAllocation;
 			this->imageLayout = imageLayout;
 
 			// Setup image memory barrier
-			vkc::tools::setImageLayout(copyCmd, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, imageLayout);
-
-			device->flushCommandBuffer(copyCmd, copyQueue);
+			VkImageSubresourceRange subresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			device->uploadBatcher().transitionImage(image, VK_IMAGE_LAYOUT_UNDEFINED, imageLayout, subresourceRange);
 		}
-		ktxTexture_Destroy(ktxTexture);
-		// Create sampler with anisotropic filtering
-		VkSamplerCreateInfo samplerCreateInfo{};
-		samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-		samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
-		samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
-		samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-		samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		samplerCreateInfo.minLod = 0.0f;
-		samplerCreateInfo.maxLod = static_cast<float>(mipLevels);
-		samplerCreateInfo.mipLodBias = 0.0f;
-		samplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
-
-		// Enable anisotropy if supported
-		samplerCreateInfo.anisotropyEnable =
-			device->enabledFeatures.samplerAnisotropy ? VK_TRUE : VK_FALSE;
-		samplerCreateInfo.maxAnisotropy =
-			samplerCreateInfo.anisotropyEnable
-			? device->properties.limits.maxSamplerAnisotropy
-			: 1.0f;
-
-		samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-
-		VK_CHECK_RESULT(vkCreateSampler(device->logicalDevice, &samplerCreateInfo, nullptr, &sampler));
+		CreateMipSampler();
 
 		// Create image view
 		VkImageViewCreateInfo viewCreateInfo{};
@@ -353,53 +288,140 @@ namespace vkc
 
 		return true;
 	}
-	// Loads a cubemap from a single KTX file
-	void VkcTexture::KtxLoadCubemapFromFile(std::string filename, VkFormat format, vkc::VkcDevice* device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout)
-	{
-		isCubemap = true;
-
-		ktxTexture* ktxTexture;
-		ktxResult result = loadKTXFile(filename, &ktxTexture);
-		assert(result == KTX_SUCCESS);
 
+	bool VkcTexture::KTXUploadStreamed(
+		ktxTexture*        ktxTexture,
+		VkFormat           format,
+		VkcDevice*         device,
+		VkImageUsageFlags  imageUsageFlags,
+		VkImageLayout      imageLayout,
+		uint32_t           firstMip
+	)
+	{
 		this->device = device;
+		this->format = format;
+		this->imageLayout = imageLayout;
+		usageFlags = imageUsageFlags;
 		width = ktxTexture->baseWidth;
 		height = ktxTexture->baseHeight;
 		mipLevels = ktxTexture->numLevels;
 
-		ktx_uint8_t* ktxTextureData = ktxTexture_GetData(ktxTexture);
-		ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTexture);
+		SwapImage(CreateMipTail(ktxTexture, std::min(firstMip, mipLevels - 1)), std::min(firstMip, mipLevels - 1));
+		CreateMipSampler();
+		UpdateDescriptor();
+		return true;
+	}
+
+	VkcTexture::ImageAllocation VkcTexture::CreateMipTail(ktxTexture* ktxTexture, uint32_t firstMip) const
+	{
+		assert(firstMip < mipLevels);
+		const uint32_t levels = mipLevels - firstMip;
+		const uint32_t baseWidth = std::max(1u, width >> firstMip);
+		const uint32_t baseHeight = std::max(1u, height >> firstMip);
+
+		// Only the span covering the requested levels is staged. KTX 1 stores the
+		// largest level first and KTX 2 the smallest, so look at every level.
+		ktx_size_t spanBegin = std::numeric_limits<ktx_size_t>::max();
+		ktx_size_t spanEnd = 0;
+		std::vector<VkBufferImageCopy> bufferCopyRegions;
+		for (uint32_t i = 0; i < levels; i++)
+		{
+			ktx_size_t offset;
+			KTX_error_code result = ktxTexture_GetImageOffset(ktxTexture, firstMip + i, 0, 0, &offset);
+			assert(result == KTX_SUCCESS);
+			spanBegin = std::min(spanBegin, offset);
+			spanEnd = std::max(spanEnd, offset + ktxTexture_GetImageSize(ktxTexture, firstMip + i));
+
+			VkBufferImageCopy bufferCopyRegion = {};
+			bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			bufferCopyRegion.imageSubresource.mipLevel = i;
+			bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
+			bufferCopyRegion.imageSubresource.layerCount = 1;
+			bufferCopyRegion.imageExtent.width = std::max(1u, baseWidth >> i);
+			bufferCopyRegion.imageExtent.height = std::max(1u, baseHeight >> i);
+			bufferCopyRegion.imageExtent.depth = 1;
+			bufferCopyRegion.bufferOffset = offset;
+			bufferCopyRegions.push_back(bufferCopyRegion);
+		}
+		for (auto& region : bufferCopyRegions) {
+			region.bufferOffset -= spanBegin;
+		}
+
+		ImageAllocation allocation;
+
+		VkImageCreateInfo imageCreateInfo = vkc::vkinit::imageCreateInfo();
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format = format;
+		imageCreateInfo.mipLevels = levels;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageCreateInfo.extent = { baseWidth, baseHeight, 1 };
+		imageCreateInfo.usage = usageFlags | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		device->createImageWithInfo(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, allocation.image, allocation.allocation);
+		allocation.size = device->allocator().allocationSize(allocation.allocation);
+
+		VkImageSubresourceRange subresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1 };
+		device->uploadBatcher().uploadImage(
+			ktxTexture_GetData(ktxTexture) + spanBegin,
+			spanEnd - spanBegin,
+			allocation.image,
+			subresourceRange,
+			bufferCopyRegions,
+			imageLayout);
+
+		VkImageViewCreateInfo viewCreateInfo = vkc::vkinit::imageViewCreateInfo();
+		viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewCreateInfo.format = format;
+		viewCreateInfo.subresourceRange = subresourceRange;
+		viewCreateInfo.image = allocation.image;
+		VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &allocation.view));
 
-		VkMemoryAllocateInfo memAllocInfo = vkc::vkinit::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
+		return allocation;
+	}
 
-		// Create a host-visible staging buffer that contains the raw image data
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
+	VkcTexture::ImageAllocation VkcTexture::SwapImage(const ImageAllocation& next, uint32_t firstMip)
+	{
+		ImageAllocation previous{ image, allocation, view, residentBytes };
+		image = next.image;
+		allocation = next.allocation;
+		view = next.view;
+		residentBytes = next.size;
+		residentMip = firstMip;
+		UpdateDescriptor();
+		return previous;
+	}
 
-		VkBufferCreateInfo bufferCreateInfo = vkc::vkinit::bufferCreateInfo();
-		bufferCreateInfo.size = ktxTextureSize;
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	void VkcTexture::DestroyImage(VkcDevice* device, const ImageAllocation& allocation)
+	{
+		if (allocation.view) vkDestroyImageView(device->logicalDevice, allocation.view, nullptr);
+		if (allocation.image) device->destroyImage(allocation.image, allocation.allocation);
+	}
 
-		VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
+	// Loads a cubemap from a single KTX file
+	void VkcTexture::KtxLoadCubemapFromFile(std::string filename, VkFormat format, vkc::VkcDevice* device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout)
+	{
+		ktxTexture* ktxTexture;
+		ktxResult result = loadKTXFile(filename, &ktxTexture);
+		assert(result == KTX_SUCCESS);
 
-		// Get memory requirements for the staging buffer (alignment, memory type bits)
-		vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
+		KtxUploadCubemap(ktxTexture, format, device, copyQueue, imageUsageFlags, imageLayout);
+		ktxTexture_Destroy(ktxTexture);
+	}
 
-		memAllocInfo.allocationSize = memReqs.size;
-		// Get memory type index for a host visible buffer
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	void VkcTexture::KtxUploadCubemap(ktxTexture* ktxTexture, VkFormat format, vkc::VkcDevice* device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout)
+	{
+		isCubemap = true;
 
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
+		this->device = device;
+		width = ktxTexture->baseWidth;
+		height = ktxTexture->baseHeight;
+		mipLevels = ktxTexture->numLevels;
 
-		// Copy texture data into staging buffer
-		uint8_t* data;
-		VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-		memcpy(data, ktxTextureData, ktxTextureSize);
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
+		ktx_uint8_t* ktxTextureData = ktxTexture_GetData(ktxTexture);
+		ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTexture);
 
 		// Setup buffer copy regions for each face including all of its mip levels
 		std::vector<VkBufferImageCopy> bufferCopyRegions;
@@ -448,53 +470,24 @@ namespace vkc
 		imageCreateInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
 
 
-		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
-
-		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+		device->createImageWithInfo(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, allocation);
+		residentBytes = device->allocator().allocationSize(allocation);
 
-		// Use a separate command buffer for texture loading
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-		// Image barrier for optimal image (target)
-		// Set initial layout for all array layers (faces) of the optimal (target) tiled texture
+		// Set up all array layers (faces), copy them and move to the final layout in the current upload batch
 		VkImageSubresourceRange subresourceRange = {};
 		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		subresourceRange.baseMipLevel = 0;
 		subresourceRange.levelCount = mipLevels;
 		subresourceRange.layerCount = 6;
 
-		vkc::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			subresourceRange);
-
-		// Copy the cube map faces from the staging buffer to the optimal tiled image
-		vkCmdCopyBufferToImage(
-			copyCmd,
-			stagingBuffer,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			static_cast<uint32_t>(bufferCopyRegions.size()),
-			bufferCopyRegions.data());
-
-		// Change texture image layout to shader read after all faces have been copied
 		this->imageLayout = imageLayout;
-		vkc::tools::setImageLayout(
-			copyCmd,
+		device->uploadBatcher().uploadImage(
+			ktxTextureData,
+			ktxTextureSize,
 			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			imageLayout,
-			subresourceRange);
-
-		device->flushCommandBuffer(copyCmd, copyQueue);
+			subresourceRange,
+			bufferCopyRegions,
+			imageLayout);
 
 		// Create sampler
 		VkSamplerCreateInfo samplerCreateInfo = vkc::vkinit::samplerCreateInfo();
@@ -523,87 +516,18 @@ namespace vkc
 		viewCreateInfo.image = image;
 		VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &view));
 
-		// Clean up staging resources
-		ktxTexture_Destroy(ktxTexture);
-		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-
 		// Update descriptor image info member that can be used for setting up descriptor sets
 		updateDescriptor();
 	}
 	bool VkcTexture::LoadCubemap(const std::array<std::string, 6>& faces) {
-		isCubemap = true;
-
-		int w, h, c;
-		std::vector<stbi_uc*> images(6);
-		for (int i = 0; i < 6; i++) {
-			images[i] = stbi_load(faces[i].c_str(), &w, &h, &c, STBI_rgb_alpha);
-			if (!images[i]) {
-				throw std::runtime_error("Failed to load skybox face: " + faces[i]);
-			}
-		}
-		VkDeviceSize layerSize = w * h * 4;
-		VkDeviceSize totalSize = layerSize * 6;
-
-		// create a single staging buffer large enough for 6 faces
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-		device->createBuffer(totalSize,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBuffer, stagingMemory);
-
-		// copy all 6 faces into the staging buffer, one after another
-		void* data;
-		vkMapMemory(device->logicalDevice, stagingMemory, 0, totalSize, 0, &data);
-		for (int i = 0; i < 6; i++) {
-			memcpy((char*)data + layerSize * i, images[i], layerSize);
-			stbi_image_free(images[i]);
-		}
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
-
-		// Create the cube image: 6 layers, CUBE_COMPATIBLE flag
-		CreateImage(w, h,
-			VK_FORMAT_R8G8B8A8_SRGB,
-			VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			6,                            // arrayLayers
-			VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT);
-
-		// Transition and copy each layer
-		TransitionImageLayout(
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			/*layerCount=*/6);
-		CopyBufferToImage(
-			stagingBuffer, w, h,
-			/*layerCount=*/6);
-		TransitionImageLayout(
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			/*layerCount=*/6);
-
-		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-
-		// Create a CUBE view
-		CreateImageView(
-			VK_FORMAT_R8G8B8A8_SRGB,
-			VK_IMAGE_VIEW_TYPE_CUBE,
-			/*layerCount=*/6);
-
-		CreateSampler();
-		UpdateDescriptor();
-		return true;
+		return UploadDecoded(DecodeSTBCubemap(faces));
 	}
 
 	void VkcTexture::Destroy()
 	{
 		if (sampler) vkDestroySampler(device->logicalDevice, sampler, nullptr);
 		if (view) vkDestroyImageView(device->logicalDevice, view, nullptr);
-		if (image) vkDestroyImage(device->logicalDevice, image, nullptr);
-		if (deviceMemory) vkFreeMemory(device->logicalDevice, deviceMemory, nullptr);
+		if (image) device->destroyImage(image, allocation);
 	}
 
 	void VkcTexture::UpdateDescriptor()
@@ -636,31 +560,11 @@ namespace vkc
 		info.samples = VK_SAMPLE_COUNT_1_BIT;
 		info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-		if (vkCreateImage(device->logicalDevice, &info, nullptr, &image) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to create image!");
-		}
-		VkMemoryRequirements memReq;
-		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReq);
-		deviceMemory = AllocateMemory(memReq, properties);
-		vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0);
+		device->createImageWithInfo(info, properties, image, allocation);
+		residentBytes = device->allocator().allocationSize(allocation);
 		return true;
 	}
 
-	VkDeviceMemory VkcTexture::AllocateMemory(VkMemoryRequirements memRequirements, VkMemoryPropertyFlags properties)
-	{
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = device->findMemoryType(memRequirements.memoryTypeBits, properties);
-
-		VkDeviceMemory memory;
-		if (vkAllocateMemory(device->logicalDevice, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to allocate image memory!");
-		}
-
-		return memory;
-	}
-
 	void VkcTexture::updateDescriptor()
 	{
 	}
@@ -722,30 +626,35 @@ namespace vkc
 		}
 	}
 
-	void VkcTexture::TransitionImageLayout(
-		VkImageLayout oldLayout,
-		VkImageLayout newLayout,
-		uint32_t    layerCount)
+	void VkcTexture::CreateMipSampler()
 	{
-		VkCommandBuffer cmd = device->beginSingleTimeCommands();
-		device->transitionImageLayout(
-			image, format,
-			oldLayout, newLayout,
-			mipLevels, layerCount);
-		device->endSingleTimeCommands(cmd);
-	}
+		// Create sampler with anisotropic filtering
+		VkSamplerCreateInfo samplerCreateInfo{};
+		samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+		samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+		samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerCreateInfo.minLod = 0.0f;
+		samplerCreateInfo.maxLod = static_cast<float>(mipLevels);
+		samplerCreateInfo.mipLodBias = 0.0f;
+		samplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
 
-	void VkcTexture::CopyBufferToImage(
-		VkBuffer buffer,
-		uint32_t width,
-		uint32_t height,
-		uint32_t layerCount)
-	{
-		device->copyBufferToImage(buffer,
-			image,
-			width, height,
-			layerCount);
+		// Enable anisotropy if supported
+		samplerCreateInfo.anisotropyEnable =
+			device->enabledFeatures.samplerAnisotropy ? VK_TRUE : VK_FALSE;
+		samplerCreateInfo.maxAnisotropy =
+			samplerCreateInfo.anisotropyEnable
+			? device->properties.limits.maxSamplerAnisotropy
+			: 1.0f;
+
+		samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+
+		VK_CHECK_RESULT(vkCreateSampler(device->logicalDevice, &samplerCreateInfo, nullptr, &sampler));
 	}
+
 	void VkcTexture::fromBuffer(void* buffer, VkDeviceSize bufferSize, VkFormat format, uint32_t texWidth, uint32_t texHeight, VkcDevice* pdevice, VkQueue copyQueue, VkFilter filter, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout)
 	{
 		assert(buffer);
@@ -755,41 +664,6 @@ namespace vkc
 		height = texHeight;
 		mipLevels = 1;
 
-	
-		VkMemoryAllocateInfo memAllocInfo = vkc::vkinit::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
-
-		// Use a separate command buffer for texture loading
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-		// Create a host-visible staging buffer that contains the raw image data
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo = vkc::vkinit::bufferCreateInfo();
-		bufferCreateInfo.size = bufferSize;
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-		vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer);
-
-		// Get memory requirements for the staging buffer (alignment, memory type bits)
-		vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-		// Get memory type index for a host visible buffer
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory);
-		vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0);
-
-		// Copy texture data into staging buffer
-		uint8_t* data;
-		vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data);
-		memcpy(data, buffer, bufferSize);
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
-
 		VkBufferImageCopy bufferCopyRegion = {};
 		bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		bufferCopyRegion.imageSubresource.mipLevel = 0;
@@ -817,15 +691,8 @@ namespace vkc
 		{
 			imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 		}
-		vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image);
-
-		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory);
-		vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0);
+		device->createImageWithInfo(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, allocation);
+		residentBytes = device->allocator().allocationSize(allocation);
 
 		VkImageSubresourceRange subresourceRange = {};
 		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -833,40 +700,15 @@ namespace vkc
 		subresourceRange.levelCount = mipLevels;
 		subresourceRange.layerCount = 1;
 
-		// Image barrier for optimal image (target)
-		// Optimal image will be used as destination for the copy
-		vkc::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			subresourceRange);
-
-		// Copy mip levels from staging buffer
-		vkCmdCopyBufferToImage(
-			copyCmd,
-			stagingBuffer,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1,
-			&bufferCopyRegion
-		);
-
-		// Change texture image layout to shader read after all mip levels have been copied
+		// Copy and move to the final layout in the current upload batch
 		this->imageLayout = imageLayout;
-		vkc::tools::setImageLayout(
-			copyCmd,
+		device->uploadBatcher().uploadImage(
+			buffer,
+			bufferSize,
 			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			imageLayout,
-			subresourceRange);
-
-		//device->flushCommandBuffer(copyCmd, copyQueue);
-		
-
-		// Clean up staging resources
-		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
+			subresourceRange,
+			{ bufferCopyRegion },
+			imageLayout);
 
 		// Create sampler
 		VkSamplerCreateInfo samplerCreateInfo = {};
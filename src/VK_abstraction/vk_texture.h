@@ -9,6 +9,7 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <memory>
 
 #include "vk_initializers.h"
 #include "vk_tools.h"
@@ -28,6 +29,16 @@ namespace vkc
 		VkcTexture(VkcDevice* device);
 		~VkcTexture();
 
+		// RGBA8 pixels decoded on the CPU, one entry per array layer (6 for cubemaps).
+		// Decoding touches no Vulkan state, so it can run on a worker thread.
+		struct DecodedImage {
+			uint32_t width{ 0 }, height{ 0 };
+			std::vector<std::unique_ptr<unsigned char, void(*)(void*)>> layers;
+		};
+		static DecodedImage DecodeSTB(const std::string& filename);
+		static DecodedImage DecodeSTBCubemap(const std::array<std::string, 6>& faceFilePaths);
+		bool UploadDecoded(const DecodedImage& decoded);
+
 		bool STBLoadFromFile(const std::string& filename);
 		bool KTXLoadFromFile(
 			const std::string& filename,
@@ -38,8 +49,45 @@ namespace vkc
 			VkImageLayout      imageLayout,
 			bool               forceLinear
 		);
+		// Uploads an already loaded KTX texture; the caller keeps ownership of ktxTexture
+		bool KTXUpload(
+			ktxTexture*        ktxTexture,
+			VkFormat           format,
+			VkcDevice*         device,
+			VkQueue            copyQueue,
+			VkImageUsageFlags  imageUsageFlags,
+			VkImageLayout      imageLayout,
+			bool               forceLinear
+		);
+
+		// Mip streaming. A streamed texture only keeps levels [residentMip, mipLevels)
+		// of its KTX source in an image; width, height and mipLevels still describe
+		// the full chain. The image is replaced as levels stream in or get evicted.
+		struct ImageAllocation {
+			VkImage        image = VK_NULL_HANDLE;
+			VmaAllocation  allocation = VK_NULL_HANDLE;
+			VkImageView    view = VK_NULL_HANDLE;
+			VkDeviceSize   size = 0;
+		};
+		bool KTXUploadStreamed(
+			ktxTexture*        ktxTexture,
+			VkFormat           format,
+			VkcDevice*         device,
+			VkImageUsageFlags  imageUsageFlags,
+			VkImageLayout      imageLayout,
+			uint32_t           firstMip
+		);
+		// Creates an image holding levels [firstMip, mipLevels) and records their upload
+		// into the current batch. The texture keeps using its current image.
+		ImageAllocation CreateMipTail(ktxTexture* ktxTexture, uint32_t firstMip) const;
+		// Makes allocation the current image and returns the previous one, which may
+		// still be in use by frames in flight
+		ImageAllocation SwapImage(const ImageAllocation& allocation, uint32_t firstMip);
+		static void DestroyImage(VkcDevice* device, const ImageAllocation& allocation);
+
 		bool LoadCubemap(const std::array<std::string, 6>& faceFilePaths);
 		void KtxLoadCubemapFromFile(std::string filename, VkFormat format, vkc::VkcDevice* device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout);
+		void KtxUploadCubemap(ktxTexture* ktxTexture, VkFormat format, vkc::VkcDevice* device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout);
 		void Destroy();
 		void UpdateDescriptor();
 		void fromBuffer(
@@ -72,13 +120,7 @@ namespace vkc
 			uint32_t layerCount);
 
 		void CreateSampler();
-		void TransitionImageLayout(
-			VkImageLayout oldLayout,
-			VkImageLayout newLayout,
-			uint32_t    layerCount);
-
-		void CopyBufferToImage(VkBuffer buffer, uint32_t width, uint32_t height, uint32_t layerCount);
-		VkDeviceMemory AllocateMemory(VkMemoryRequirements memRequirements, VkMemoryPropertyFlags properties);
+		void CreateMipSampler();
 
 
 
@@ -86,7 +128,7 @@ namespace vkc
 		VkcDevice* device;
 		uint32_t              width{ 0 }, height{ 0 };
 		VkImage image = VK_NULL_HANDLE;
-		VkDeviceMemory deviceMemory = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
 		VkImageView view = VK_NULL_HANDLE;
 		VkSampler sampler = VK_NULL_HANDLE;
 
@@ -96,10 +138,16 @@ namespace vkc
 		VkFormat format = VK_FORMAT_UNDEFINED;
 		uint32_t mipLevels = 1;
 		uint32_t layerCount = 1;
+		VkImageUsageFlags usageFlags = VK_IMAGE_USAGE_SAMPLED_BIT;
+
+		// Finest level in VRAM; always 0 for textures that are not streamed
+		uint32_t residentMip = 0;
+		// Device memory backing the current image
+		VkDeviceSize residentBytes = 0;
 
 		void updateDescriptor();
 		void destroy();
-		ktxResult loadKTXFile(std::string filename, ktxTexture** target);
+		static ktxResult loadKTXFile(std::string filename, ktxTexture** target);
 
 		bool isCubemap{ false };
 		bool IsCubemap() const { return isCubemap; }
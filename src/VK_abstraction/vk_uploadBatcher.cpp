@@ -0,0 +1,465 @@
+// vk_uploadBatcher.cpp
+#include "vk_uploadBatcher.h"
+#include "vk_device.h"
+
+// STD
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace vkc
+{
+    namespace
+    {
+        uint64_t alignUp(uint64_t value, uint64_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        VkCommandPool createPool(VkDevice device, uint32_t queueFamilyIndex)
+        {
+            VkCommandPool pool;
+            VkCommandPoolCreateInfo poolInfo = vkc::vkinit::commandPoolCreateInfo();
+            poolInfo.queueFamilyIndex = queueFamilyIndex;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+            VK_CHECK_RESULT(vkCreateCommandPool(device, &poolInfo, nullptr, &pool));
+            return pool;
+        }
+    }
+
+    VkcUploadBatcher::VkcUploadBatcher(
+        VkcDevice& device,
+        VkQueue graphicsQueue,
+        uint32_t graphicsFamily,
+        VkQueue transferQueue,
+        uint32_t transferFamily,
+        VkDeviceSize ringSize)
+        : device{ device },
+        graphicsQueue{ graphicsQueue },
+        transferQueue{ transferQueue },
+        graphicsFamily{ graphicsFamily },
+        transferFamily{ transferFamily },
+        dedicatedTransfer{ transferFamily != graphicsFamily },
+        ringSize{ ringSize }
+    {
+        graphicsPool = createPool(device.logicalDevice, graphicsFamily);
+        transferPool = dedicatedTransfer ? createPool(device.logicalDevice, transferFamily) : graphicsPool;
+
+        // The ring stays mapped for the lifetime of the batcher
+        VK_CHECK_RESULT(device.createBuffer(
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            ringSize,
+            &ringBuffer,
+            &ringAllocation));
+        VK_CHECK_RESULT(device.allocator().map(ringAllocation, reinterpret_cast<void**>(&ringMapped)));
+    }
+
+    VkcUploadBatcher::~VkcUploadBatcher()
+    {
+        waitIdle();
+
+        for (auto& batch : freeBatches) {
+            vkDestroyFence(device.logicalDevice, batch.fence, nullptr);
+            if (batch.transferDone != VK_NULL_HANDLE) {
+                vkDestroySemaphore(device.logicalDevice, batch.transferDone, nullptr);
+            }
+        }
+        if (dedicatedTransfer) {
+            vkDestroyCommandPool(device.logicalDevice, transferPool, nullptr);
+        }
+        vkDestroyCommandPool(device.logicalDevice, graphicsPool, nullptr);
+
+        device.allocator().unmap(ringAllocation);
+        device.destroyBuffer(ringBuffer, ringAllocation);
+    }
+
+    VkcUploadBatcher::Staging VkcUploadBatcher::allocate(VkDeviceSize size, VkDeviceSize alignment)
+    {
+        stats.bytesStaged += size;
+
+        // Too large for the ring: use a dedicated buffer that is freed when the batch retires
+        if (size > ringSize) {
+            Staging staging;
+            VmaAllocation allocation;
+            VK_CHECK_RESULT(device.createBuffer(
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                size,
+                &staging.buffer,
+                &allocation));
+            VK_CHECK_RESULT(device.allocator().map(allocation, &staging.mapped));
+
+            if (!recording) beginBatch();
+            openBatch.dedicated.emplace_back(staging.buffer, allocation);
+            stats.dedicatedStaging++;
+            return staging;
+        }
+
+        for (;;) {
+            // Nothing outstanding: restart at the beginning of the ring
+            if (ringHead == ringTail && inFlight.empty()) {
+                ringHead = ringTail = 0;
+            }
+
+            uint64_t pos = ringHead % ringSize;
+            uint64_t offset = alignUp(pos, alignment);
+            if (offset + size > ringSize) {
+                offset = ringSize; // does not fit before the end, wrap to the start
+            }
+            uint64_t start = ringHead + (offset - pos);
+            uint64_t end = start + size;
+
+            if (end - ringTail <= ringSize) {
+                ringHead = end;
+                if (!recording) beginBatch();
+
+                Staging staging;
+                staging.buffer = ringBuffer;
+                staging.offset = start % ringSize;
+                staging.mapped = ringMapped + staging.offset;
+                return staging;
+            }
+
+            // Ring is full: wait for the oldest batch to free its range
+            stats.ringStalls++;
+            if (inFlight.empty()) {
+                flush();
+            }
+            retireOldest();
+        }
+    }
+
+    void VkcUploadBatcher::uploadBuffer(const void* data, VkDeviceSize size, VkBuffer dst, VkDeviceSize dstOffset)
+    {
+        Staging staging = allocate(size);
+        memcpy(staging.mapped, data, static_cast<size_t>(size));
+        copyBuffer(staging, dst, size, dstOffset);
+    }
+
+    void VkcUploadBatcher::copyBuffer(const Staging& src, VkBuffer dst, VkDeviceSize size, VkDeviceSize dstOffset)
+    {
+        VkBufferCopy region{};
+        region.srcOffset = src.offset;
+        region.dstOffset = dstOffset;
+        region.size = size;
+        vkCmdCopyBuffer(transferCommandBuffer(), src.buffer, dst, 1, &region);
+        stats.bufferCopies++;
+
+        if (!dedicatedTransfer) {
+            return;
+        }
+
+        // Release on the transfer queue, acquire on the graphics queue
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = transferFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+        barrier.buffer = dst;
+        barrier.offset = dstOffset;
+        barrier.size = size;
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(openBatch.transferCommandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        vkCmdPipelineBarrier(openBatch.graphicsCommandBuffer,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            0, 0, nullptr, 1, &barrier, 0, nullptr);
+        stats.ownershipTransfers++;
+    }
+
+    void VkcUploadBatcher::uploadImage(
+        const void* data,
+        VkDeviceSize size,
+        VkImage image,
+        const VkImageSubresourceRange& range,
+        const std::vector<VkBufferImageCopy>& regions,
+        VkImageLayout finalLayout)
+    {
+        Staging staging = allocate(size);
+        memcpy(staging.mapped, data, static_cast<size_t>(size));
+        uploadImage(staging, image, range, regions, finalLayout);
+    }
+
+    void VkcUploadBatcher::uploadImage(
+        const Staging& src,
+        VkImage image,
+        const VkImageSubresourceRange& range,
+        const std::vector<VkBufferImageCopy>& regions,
+        VkImageLayout finalLayout)
+    {
+        VkCommandBuffer cmd = transferCommandBuffer();
+        vkc::tools::setImageLayout(cmd, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, range);
+        copyBufferToImage(src, image, regions);
+
+        if (!dedicatedTransfer) {
+            vkc::tools::setImageLayout(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout, range);
+            return;
+        }
+
+        // The layout change happens as part of the ownership transfer; release and
+        // acquire must describe the same transition
+        VkImageMemoryBarrier barrier = vkc::vkinit::imageMemoryBarrier();
+        barrier.srcQueueFamilyIndex = transferFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = finalLayout;
+        barrier.image = image;
+        barrier.subresourceRange = range;
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(cmd,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        vkCmdPipelineBarrier(openBatch.graphicsCommandBuffer,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+        stats.ownershipTransfers++;
+    }
+
+    void VkcUploadBatcher::copyBufferToImage(const Staging& src, VkImage image, const std::vector<VkBufferImageCopy>& regions)
+    {
+        std::vector<VkBufferImageCopy> shifted(regions);
+        for (auto& region : shifted) {
+            region.bufferOffset += src.offset;
+        }
+
+        vkCmdCopyBufferToImage(
+            transferCommandBuffer(),
+            src.buffer,
+            image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(shifted.size()),
+            shifted.data());
+        stats.imageCopies++;
+    }
+
+    void VkcUploadBatcher::transitionImage(
+        VkImage image,
+        VkImageLayout oldLayout,
+        VkImageLayout newLayout,
+        const VkImageSubresourceRange& range)
+    {
+        vkc::tools::setImageLayout(graphicsCommandBuffer(), image, oldLayout, newLayout, range);
+    }
+
+    void VkcUploadBatcher::generateMipmaps(
+        VkImage image,
+        uint32_t width,
+        uint32_t height,
+        uint32_t mipLevels,
+        uint32_t layerCount,
+        VkImageLayout finalLayout)
+    {
+        VkCommandBuffer cmd = graphicsCommandBuffer();
+
+        VkImageSubresourceRange mipRange{};
+        mipRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        mipRange.levelCount = 1;
+        mipRange.layerCount = layerCount;
+
+        for (uint32_t i = 1; i < mipLevels; i++) {
+            // Previous level has been written, read from it
+            mipRange.baseMipLevel = i - 1;
+            vkc::tools::setImageLayout(cmd, image,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mipRange,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+            mipRange.baseMipLevel = i;
+            vkc::tools::setImageLayout(cmd, image,
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipRange,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+            VkImageBlit blit{};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = i - 1;
+            blit.srcSubresource.layerCount = layerCount;
+            blit.srcOffsets[1].x = std::max(1, int32_t(width >> (i - 1)));
+            blit.srcOffsets[1].y = std::max(1, int32_t(height >> (i - 1)));
+            blit.srcOffsets[1].z = 1;
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = i;
+            blit.dstSubresource.layerCount = layerCount;
+            blit.dstOffsets[1].x = std::max(1, int32_t(width >> i));
+            blit.dstOffsets[1].y = std::max(1, int32_t(height >> i));
+            blit.dstOffsets[1].z = 1;
+
+            vkCmdBlitImage(cmd,
+                image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1, &blit, VK_FILTER_LINEAR);
+            stats.mipBlits++;
+        }
+
+        // Every level but the last is a blit source now; the last one is still a destination
+        if (mipLevels > 1) {
+            mipRange.baseMipLevel = 0;
+            mipRange.levelCount = mipLevels - 1;
+            vkc::tools::setImageLayout(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, finalLayout, mipRange);
+        }
+        mipRange.baseMipLevel = mipLevels - 1;
+        mipRange.levelCount = 1;
+        vkc::tools::setImageLayout(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout, mipRange);
+    }
+
+    VkCommandBuffer VkcUploadBatcher::transferCommandBuffer()
+    {
+        if (!recording) beginBatch();
+        return openBatch.transferCommandBuffer;
+    }
+
+    VkCommandBuffer VkcUploadBatcher::graphicsCommandBuffer()
+    {
+        if (!recording) beginBatch();
+        return openBatch.graphicsCommandBuffer;
+    }
+
+    void VkcUploadBatcher::beginBatch()
+    {
+        if (!freeBatches.empty()) {
+            openBatch = std::move(freeBatches.back());
+            freeBatches.pop_back();
+            vkResetCommandBuffer(openBatch.graphicsCommandBuffer, 0);
+            if (dedicatedTransfer) {
+                vkResetCommandBuffer(openBatch.transferCommandBuffer, 0);
+            }
+            VK_CHECK_RESULT(vkResetFences(device.logicalDevice, 1, &openBatch.fence));
+        }
+        else {
+            openBatch = Batch{};
+            openBatch.graphicsCommandBuffer = device.createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, graphicsPool, false);
+            openBatch.transferCommandBuffer = openBatch.graphicsCommandBuffer;
+            VkFenceCreateInfo fenceInfo = vkc::vkinit::fenceCreateInfo();
+            VK_CHECK_RESULT(vkCreateFence(device.logicalDevice, &fenceInfo, nullptr, &openBatch.fence));
+
+            if (dedicatedTransfer) {
+                openBatch.transferCommandBuffer = device.createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, transferPool, false);
+                VkSemaphoreCreateInfo semaphoreInfo{};
+                semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+                VK_CHECK_RESULT(vkCreateSemaphore(device.logicalDevice, &semaphoreInfo, nullptr, &openBatch.transferDone));
+            }
+        }
+
+        openBatch.id = nextBatchId;
+
+        VkCommandBufferBeginInfo beginInfo = vkc::vkinit::commandBufferBeginInfo();
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK_RESULT(vkBeginCommandBuffer(openBatch.graphicsCommandBuffer, &beginInfo));
+        if (dedicatedTransfer) {
+            VK_CHECK_RESULT(vkBeginCommandBuffer(openBatch.transferCommandBuffer, &beginInfo));
+        }
+        recording = true;
+    }
+
+    uint64_t VkcUploadBatcher::flush()
+    {
+        retireCompleted();
+        if (!recording) {
+            return nextBatchId - 1;
+        }
+
+        // Make the graphics-queue transfer writes (copies without a transfer queue, mip
+        // blits) visible to everything submitted after this batch
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        vkCmdPipelineBarrier(openBatch.graphicsCommandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        VkSubmitInfo submitInfo = vkc::vkinit::submitInfo();
+        const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+        if (dedicatedTransfer) {
+            VK_CHECK_RESULT(vkEndCommandBuffer(openBatch.transferCommandBuffer));
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &openBatch.transferCommandBuffer;
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &openBatch.transferDone;
+            VK_CHECK_RESULT(vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+            // The acquire half waits for the copies; frames submitted after it are ordered behind it
+            submitInfo = vkc::vkinit::submitInfo();
+            submitInfo.waitSemaphoreCount = 1;
+            submitInfo.pWaitSemaphores = &openBatch.transferDone;
+            submitInfo.pWaitDstStageMask = &waitStage;
+        }
+
+        VK_CHECK_RESULT(vkEndCommandBuffer(openBatch.graphicsCommandBuffer));
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &openBatch.graphicsCommandBuffer;
+        VK_CHECK_RESULT(vkQueueSubmit(graphicsQueue, 1, &submitInfo, openBatch.fence));
+
+        const uint64_t id = openBatch.id;
+        openBatch.ringEnd = ringHead;
+        inFlight.push_back(std::move(openBatch));
+        openBatch = Batch{};
+        recording = false;
+        nextBatchId++;
+        stats.batchesSubmitted++;
+        return id;
+    }
+
+    bool VkcUploadBatcher::isComplete(uint64_t batchId)
+    {
+        retireCompleted();
+        return batchId <= completedBatchId;
+    }
+
+    void VkcUploadBatcher::wait(uint64_t batchId)
+    {
+        if (recording && batchId >= openBatch.id) {
+            flush();
+        }
+        while (completedBatchId < batchId && !inFlight.empty()) {
+            retireOldest();
+        }
+    }
+
+    void VkcUploadBatcher::waitIdle()
+    {
+        flush();
+        while (!inFlight.empty()) {
+            retireOldest();
+        }
+    }
+
+    void VkcUploadBatcher::retireCompleted()
+    {
+        while (!inFlight.empty() && vkGetFenceStatus(device.logicalDevice, inFlight.front().fence) == VK_SUCCESS) {
+            retire(inFlight.front());
+            inFlight.pop_front();
+        }
+    }
+
+    void VkcUploadBatcher::retireOldest()
+    {
+        Batch& oldest = inFlight.front();
+        VK_CHECK_RESULT(vkWaitForFences(device.logicalDevice, 1, &oldest.fence, VK_TRUE, UINT64_MAX));
+        retire(oldest);
+        inFlight.pop_front();
+    }
+
+    void VkcUploadBatcher::retire(Batch& batch)
+    {
+        for (auto& [buffer, allocation] : batch.dedicated) {
+            device.allocator().unmap(allocation);
+            device.destroyBuffer(buffer, allocation);
+        }
+        batch.dedicated.clear();
+
+        ringTail = batch.ringEnd;
+        completedBatchId = batch.id;
+        freeBatches.push_back(std::move(batch));
+    }
+
+}  // namespace vkc
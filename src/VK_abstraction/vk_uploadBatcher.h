@@ -0,0 +1,169 @@
+// vk_uploadBatcher.h
+#pragma once
+#include "vulkan/vulkan.h"
+#include <vk_mem_alloc.h>
+
+// STD
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace vkc
+{
+    class VkcDevice;
+
+    // Collects buffer/image uploads into one command buffer and submits them
+    // together with a single fence, instead of one queue submit + vkQueueWaitIdle
+    // per resource. Source data is staged through a persistently mapped ring
+    // buffer that is recycled as batches retire.
+    //
+    // When the device exposes a dedicated transfer queue family, copies run
+    // there and each resource is released to the graphics family. A small
+    // graphics-queue command buffer waits on the transfer semaphore, acquires
+    // ownership and runs the graphics-only work (mip blits). It is submitted
+    // ahead of the next frame, so the renderer sees the data through
+    // queue submission order. On single-family devices everything goes into
+    // one graphics-queue command buffer.
+    //
+    // flush() never blocks unless the ring is full, so it can be called every
+    // frame. Main (upload) thread only.
+    class VkcUploadBatcher
+    {
+    public:
+        static constexpr VkDeviceSize DEFAULT_RING_SIZE = 64ull * 1024 * 1024;
+
+        struct Staging {
+            VkBuffer     buffer = VK_NULL_HANDLE;
+            VkDeviceSize offset = 0;
+            void*        mapped = nullptr;
+        };
+
+        struct Stats {
+            uint64_t batchesSubmitted = 0;
+            uint64_t bufferCopies = 0;
+            uint64_t imageCopies = 0;
+            uint64_t mipBlits = 0;
+            uint64_t bytesStaged = 0;
+            uint64_t ringStalls = 0;        // allocations that had to wait for a batch to retire
+            uint64_t dedicatedStaging = 0;  // allocations too large for the ring
+            uint64_t ownershipTransfers = 0;
+        };
+
+        VkcUploadBatcher(
+            VkcDevice& device,
+            VkQueue graphicsQueue,
+            uint32_t graphicsFamily,
+            VkQueue transferQueue,
+            uint32_t transferFamily,
+            VkDeviceSize ringSize = DEFAULT_RING_SIZE);
+        ~VkcUploadBatcher();
+
+        VkcUploadBatcher(const VkcUploadBatcher&) = delete;
+        VkcUploadBatcher& operator=(const VkcUploadBatcher&) = delete;
+
+        // Reserves staging memory for the open batch. Fill it and record the copy that
+        // reads it before the next allocate() or flush().
+        Staging allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+        // Stages data and records a copy into dst
+        void uploadBuffer(const void* data, VkDeviceSize size, VkBuffer dst, VkDeviceSize dstOffset = 0);
+        void copyBuffer(const Staging& src, VkBuffer dst, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+
+        // Records UNDEFINED -> TRANSFER_DST, the region copies and TRANSFER_DST -> finalLayout,
+        // handing the covered range over to the graphics family when a transfer queue is used.
+        // Region bufferOffsets are relative to the start of the staged data.
+        void uploadImage(
+            const void* data,
+            VkDeviceSize size,
+            VkImage image,
+            const VkImageSubresourceRange& range,
+            const std::vector<VkBufferImageCopy>& regions,
+            VkImageLayout finalLayout);
+        void uploadImage(
+            const Staging& src,
+            VkImage image,
+            const VkImageSubresourceRange& range,
+            const std::vector<VkBufferImageCopy>& regions,
+            VkImageLayout finalLayout);
+
+        // Layout change recorded on the graphics side of the batch
+        void transitionImage(
+            VkImage image,
+            VkImageLayout oldLayout,
+            VkImageLayout newLayout,
+            const VkImageSubresourceRange& range);
+
+        // Fills mip levels 1..mipLevels-1 by blitting down from level 0, which must be in
+        // TRANSFER_DST_OPTIMAL (e.g. uploadImage with that final layout) with the remaining
+        // levels still UNDEFINED. Leaves the whole chain in finalLayout. Graphics side.
+        void generateMipmaps(
+            VkImage image,
+            uint32_t width,
+            uint32_t height,
+            uint32_t mipLevels,
+            uint32_t layerCount,
+            VkImageLayout finalLayout);
+
+        // Graphics-queue command buffer of the open batch. Runs after every transfer
+        // recorded in the same batch, with ownership already acquired.
+        VkCommandBuffer graphicsCommandBuffer();
+
+        bool usesDedicatedTransferQueue() const { return dedicatedTransfer; }
+
+        // Submits the open batch (if any) and returns its id without waiting
+        uint64_t flush();
+        // Id the work recorded so far will complete with
+        uint64_t currentBatchId() const { return nextBatchId; }
+        bool isComplete(uint64_t batchId);
+        void wait(uint64_t batchId);
+        // Flushes and waits for every submitted batch
+        void waitIdle();
+
+        const Stats& getStats() const { return stats; }
+
+    private:
+        struct Batch {
+            uint64_t        id = 0;
+            VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;  // same as graphics without a transfer queue
+            VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+            VkSemaphore     transferDone = VK_NULL_HANDLE;
+            VkFence         fence = VK_NULL_HANDLE;
+            uint64_t        ringEnd = 0;   // ring head when the batch was submitted
+            std::vector<std::pair<VkBuffer, VmaAllocation>> dedicated;
+        };
+
+        VkCommandBuffer transferCommandBuffer();
+        void copyBufferToImage(const Staging& src, VkImage image, const std::vector<VkBufferImageCopy>& regions);
+        void beginBatch();
+        void retireCompleted();
+        void retireOldest();
+        void retire(Batch& batch);
+
+        VkcDevice&     device;
+        VkQueue        graphicsQueue;
+        VkQueue        transferQueue;
+        uint32_t       graphicsFamily;
+        uint32_t       transferFamily;
+        bool           dedicatedTransfer;
+        VkCommandPool  graphicsPool = VK_NULL_HANDLE;
+        VkCommandPool  transferPool = VK_NULL_HANDLE;
+
+        // Staging ring. Head and tail are running byte totals; position = total % ringSize
+        VkBuffer       ringBuffer = VK_NULL_HANDLE;
+        VmaAllocation  ringAllocation = VK_NULL_HANDLE;
+        uint8_t*       ringMapped = nullptr;
+        VkDeviceSize   ringSize = 0;
+        uint64_t       ringHead = 0;
+        uint64_t       ringTail = 0;
+
+        bool               recording = false;
+        Batch              openBatch;
+        std::deque<Batch>  inFlight;
+        std::vector<Batch> freeBatches;   // retired command buffer + fence pairs
+        uint64_t           nextBatchId = 1;
+        uint64_t           completedBatchId = 0;
+
+        Stats stats;
+    };
+
+}  // namespace vkc